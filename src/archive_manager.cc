@@ -80,6 +80,9 @@ describe(const fs::path& filename)
 #if HAVE_ARCHIVE_H
     static const auto RAW_FORMAT_NAME = string_fragment::from_const("raw");
     static const auto GZ_FILTER_NAME = string_fragment::from_const("gzip");
+#ifdef HAVE_ZSTD_H
+    static const auto ZSTD_FILTER_NAME = string_fragment::from_const("zstd");
+#endif
 
     auto_mem<archive> arc(archive_read_free);
 
@@ -111,6 +114,13 @@ describe(const fs::path& filename)
                 if (filter_count == 2 && GZ_FILTER_NAME == first_filter_name) {
                     return Ok(describe_result{unknown_file{}});
                 }
+#ifdef HAVE_ZSTD_H
+                // The line_buffer decompresses zstd files itself.
+                if (filter_count == 2 && ZSTD_FILTER_NAME == first_filter_name)
+                {
+                    return Ok(describe_result{unknown_file{}});
+                }
+#endif
             }
             log_info(
                 "detected archive: %s -- %s", filename.c_str(), format_name);
@@ -0,0 +1,264 @@
+/**
+ * Copyright (c) 2024, Timothy Stack
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ * * Neither the name of Timothy Stack nor the names of its contributors
+ * may be used to endorse or promote products derived from this software
+ * without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE REGENTS AND CONTRIBUTORS ''AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * @file is_utf8.lines.cc
+ */
+
+#include "is_utf8.lines.hh"
+
+#include <algorithm>
+
+#include "config.h"
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#    define LNAV_UTF8_LINES_X86 1
+#    include <immintrin.h>
+#endif
+
+namespace {
+
+constexpr size_t BLOCK_SIZE = 64;
+
+/**
+ * Bitmasks for a block of BLOCK_SIZE bytes, where bit N is set if byte N in
+ * the block matches.
+ */
+struct block_masks {
+    uint64_t bm_newline{0};
+    uint64_t bm_high{0};
+    uint64_t bm_escape{0};
+    uint64_t bm_tab{0};
+};
+
+using block_scanner_t = block_masks (*)(const unsigned char* data);
+
+block_masks
+scan_partial_block(const unsigned char* data, size_t len)
+{
+    block_masks retval;
+
+    for (size_t lpc = 0; lpc < len; lpc++) {
+        auto ch = data[lpc];
+
+        retval.bm_newline |= uint64_t{ch == '\n'} << lpc;
+        retval.bm_high |= uint64_t{ch >= 0x80} << lpc;
+        retval.bm_escape |= uint64_t{ch == '\x1b'} << lpc;
+        retval.bm_tab |= uint64_t{ch == '\t'} << lpc;
+    }
+
+    return retval;
+}
+
+#ifndef LNAV_UTF8_LINES_X86
+block_masks
+scan_block_scalar(const unsigned char* data)
+{
+    return scan_partial_block(data, BLOCK_SIZE);
+}
+#else
+block_masks
+scan_block_sse2(const unsigned char* data)
+{
+    const auto newlines = _mm_set1_epi8('\n');
+    const auto escapes = _mm_set1_epi8('\x1b');
+    const auto tabs = _mm_set1_epi8('\t');
+    block_masks retval;
+
+    for (size_t lpc = 0; lpc < BLOCK_SIZE; lpc += 16) {
+        auto chunk = _mm_loadu_si128((const __m128i*) (data + lpc));
+
+        retval.bm_newline
+            |= uint64_t{(uint16_t) _mm_movemask_epi8(
+                   _mm_cmpeq_epi8(chunk, newlines))}
+            << lpc;
+        retval.bm_high |= uint64_t{(uint16_t) _mm_movemask_epi8(chunk)}
+            << lpc;
+        retval.bm_escape |= uint64_t{(uint16_t) _mm_movemask_epi8(
+                                _mm_cmpeq_epi8(chunk, escapes))}
+            << lpc;
+        retval.bm_tab
+            |= uint64_t{(uint16_t) _mm_movemask_epi8(
+                   _mm_cmpeq_epi8(chunk, tabs))}
+            << lpc;
+    }
+
+    return retval;
+}
+
+__attribute__((target("avx2"))) block_masks
+scan_block_avx2(const unsigned char* data)
+{
+    const auto newlines = _mm256_set1_epi8('\n');
+    const auto escapes = _mm256_set1_epi8('\x1b');
+    const auto tabs = _mm256_set1_epi8('\t');
+    block_masks retval;
+
+    for (size_t lpc = 0; lpc < BLOCK_SIZE; lpc += 32) {
+        auto chunk = _mm256_loadu_si256((const __m256i*) (data + lpc));
+
+        retval.bm_newline |= uint64_t{(uint32_t) _mm256_movemask_epi8(
+                                 _mm256_cmpeq_epi8(chunk, newlines))}
+            << lpc;
+        retval.bm_high |= uint64_t{(uint32_t) _mm256_movemask_epi8(chunk)}
+            << lpc;
+        retval.bm_escape |= uint64_t{(uint32_t) _mm256_movemask_epi8(
+                                _mm256_cmpeq_epi8(chunk, escapes))}
+            << lpc;
+        retval.bm_tab |= uint64_t{(uint32_t) _mm256_movemask_epi8(
+                             _mm256_cmpeq_epi8(chunk, tabs))}
+            << lpc;
+    }
+
+    return retval;
+}
+#endif
+
+block_scanner_t
+choose_block_scanner()
+{
+#ifdef LNAV_UTF8_LINES_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        return scan_block_avx2;
+    }
+    return scan_block_sse2;
+#else
+    return scan_block_scalar;
+#endif
+}
+
+const block_scanner_t BLOCK_SCANNER = choose_block_scanner();
+
+/**
+ * @return A mask with the bits in the range [low, high) set.
+ */
+uint64_t
+bits_between(size_t low, size_t high)
+{
+    auto below_high = high >= 64 ? ~uint64_t{0} : (uint64_t{1} << high) - 1;
+    auto below_low = low >= 64 ? ~uint64_t{0} : (uint64_t{1} << low) - 1;
+
+    return below_high & ~below_low;
+}
+
+}  // namespace
+
+void
+utf8_line_batch::clear()
+{
+    this->ulb_starts.clear();
+    this->ulb_column_width_guess.clear();
+    this->ulb_is_utf.clear();
+    this->ulb_has_ansi.clear();
+}
+
+utf8_scan_result
+utf8_line_batch::to_scan_result(size_t index,
+                                string_fragment frag,
+                                size_t line_len) const
+{
+    if (!this->ulb_is_utf[index]) {
+        // Invalid lines are rare, so just scan them again to get the
+        // details of the error.
+        return is_utf8(frag, '\n');
+    }
+
+    utf8_scan_result retval;
+
+    retval.usr_has_ansi = this->ulb_has_ansi[index];
+    retval.usr_column_width_guess = this->ulb_column_width_guess[index];
+    retval.usr_valid_frag = frag.sub_range(0, line_len);
+    if ((ssize_t) line_len < frag.length()) {
+        retval.usr_remaining = frag.substr(line_len + 1);
+    }
+
+    return retval;
+}
+
+void
+is_utf8_lines(string_fragment frag, utf8_line_batch& batch_out)
+{
+    const auto* data = frag.udata();
+    const size_t len = frag.length();
+    size_t line_start = 0;
+    bool line_has_high = false;
+    bool line_has_escape = false;
+    size_t line_tabs = 0;
+
+    auto add_line = [&](size_t line_end) {
+        batch_out.ulb_starts.emplace_back(line_start);
+        if (line_has_high) {
+            auto scan_res = is_utf8(frag.sub_range(line_start, line_end));
+
+            batch_out.ulb_is_utf.emplace_back(scan_res.is_valid());
+            batch_out.ulb_has_ansi.emplace_back(scan_res.usr_has_ansi);
+            batch_out.ulb_column_width_guess.emplace_back(
+                scan_res.usr_column_width_guess);
+        } else {
+            // Plain ASCII is always valid and each byte is one column,
+            // with tabs being guessed as eight.
+            batch_out.ulb_is_utf.emplace_back(true);
+            batch_out.ulb_has_ansi.emplace_back(line_has_escape);
+            batch_out.ulb_column_width_guess.emplace_back(
+                line_end - line_start + line_tabs * 7);
+        }
+        line_has_high = false;
+        line_has_escape = false;
+        line_tabs = 0;
+    };
+
+    for (size_t block_start = 0; block_start < len; block_start += BLOCK_SIZE)
+    {
+        auto block_len = std::min(BLOCK_SIZE, len - block_start);
+        auto masks = block_len == BLOCK_SIZE
+            ? BLOCK_SCANNER(data + block_start)
+            : scan_partial_block(data + block_start, block_len);
+        size_t pos = line_start > block_start ? line_start - block_start : 0;
+        auto accumulate = [&](uint64_t range) {
+            line_has_high = line_has_high || (masks.bm_high & range) != 0;
+            line_has_escape
+                = line_has_escape || (masks.bm_escape & range) != 0;
+            line_tabs += __builtin_popcountll(masks.bm_tab & range);
+        };
+
+        while (masks.bm_newline != 0) {
+            size_t bit = __builtin_ctzll(masks.bm_newline);
+
+            accumulate(bits_between(pos, bit));
+            add_line(block_start + bit);
+            line_start = block_start + bit + 1;
+            pos = bit + 1;
+            masks.bm_newline &= masks.bm_newline - 1;
+        }
+        accumulate(bits_between(pos, BLOCK_SIZE));
+    }
+
+    if (line_start < len) {
+        add_line(len);
+    }
+}
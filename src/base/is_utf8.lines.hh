@@ -0,0 +1,87 @@
+/**
+ * Copyright (c) 2024, Timothy Stack
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ * * Neither the name of Timothy Stack nor the names of its contributors
+ * may be used to endorse or promote products derived from this software
+ * without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE REGENTS AND CONTRIBUTORS ''AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * @file is_utf8.lines.hh
+ */
+
+#ifndef lnav_is_utf8_lines_hh
+#define lnav_is_utf8_lines_hh
+
+#include <vector>
+
+#include <stdint.h>
+
+#include "intern_string.hh"
+#include "is_utf8.hh"
+
+/**
+ * The per-line results of scanning a whole buffer of newline-terminated
+ * lines with is_utf8_lines().  The vectors are parallel, with one entry for
+ * each line in the buffer.
+ */
+struct utf8_line_batch {
+    /** The offset of the start of each line in the scanned buffer. */
+    std::vector<uint32_t> ulb_starts;
+    /** The usr_column_width_guess for valid lines. */
+    std::vector<uint32_t> ulb_column_width_guess;
+    std::vector<bool> ulb_is_utf;
+    std::vector<bool> ulb_has_ansi;
+
+    bool empty() const { return this->ulb_starts.empty(); }
+
+    size_t size() const { return this->ulb_starts.size(); }
+
+    void clear();
+
+    /**
+     * Rebuild the result that is_utf8(line, '\n') would have returned for
+     * the line at the given index.
+     *
+     * @param index The index of the line in this batch.
+     * @param frag The data starting at the beginning of the line.
+     * @param line_len The length of the line without the terminator.
+     */
+    utf8_scan_result to_scan_result(size_t index,
+                                    string_fragment frag,
+                                    size_t line_len) const;
+};
+
+/**
+ * Find all of the lines in the given buffer and check whether they are
+ * valid UTF-8 and contain ANSI escapes, in a single pass over the buffer.
+ * The buffer is processed a vector register at a time when the CPU
+ * supports it, with only lines that contain non-ASCII bytes being checked
+ * by is_utf8().  A trailing line without a newline is also added to the
+ * batch.
+ *
+ * @param frag The buffer to scan, which must be smaller than 4GB.
+ * @param batch_out The batch to append the line results to.
+ */
+void is_utf8_lines(string_fragment frag, utf8_line_batch& batch_out);
+
+#endif
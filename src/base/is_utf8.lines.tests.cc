@@ -0,0 +1,99 @@
+/**
+ * Copyright (c) 2024, Timothy Stack
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ * * Neither the name of Timothy Stack nor the names of its contributors
+ * may be used to endorse or promote products derived from this software
+ * without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE REGENTS AND CONTRIBUTORS ''AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <string>
+
+#include "base/is_utf8.lines.hh"
+
+#include "config.h"
+#include "doctest/doctest.h"
+
+static void
+check_against_is_utf8(const std::string& str)
+{
+    auto frag = string_fragment::from_str(str);
+    utf8_line_batch batch;
+    size_t index = 0;
+
+    is_utf8_lines(frag, batch);
+    while (!frag.empty()) {
+        auto expected = is_utf8(frag, '\n');
+
+        REQUIRE(index < batch.size());
+        CHECK(batch.ulb_starts[index] == frag.sf_begin);
+        CHECK(batch.ulb_is_utf[index] == expected.is_valid());
+        CHECK(batch.ulb_has_ansi[index] == expected.usr_has_ansi);
+        if (expected.is_valid() && expected.usr_remaining) {
+            auto line_len = expected.usr_valid_frag.length();
+            auto actual = batch.to_scan_result(index, frag, line_len);
+
+            CHECK(actual.usr_column_width_guess
+                  == expected.usr_column_width_guess);
+            CHECK(actual.usr_valid_frag == expected.usr_valid_frag);
+            CHECK(actual.usr_remaining == expected.usr_remaining);
+        }
+        if (!expected.usr_remaining) {
+            break;
+        }
+        frag = expected.usr_remaining.value();
+        index += 1;
+    }
+    CHECK(index + (frag.empty() ? 0 : 1) == batch.size());
+}
+
+TEST_CASE("is_utf8_lines")
+{
+    check_against_is_utf8("");
+    check_against_is_utf8("abc");
+    check_against_is_utf8("abc\n");
+    check_against_is_utf8("abc\n\ndef\tghi\n");
+    check_against_is_utf8("\x1b[1mbold\x1b[0m\nplain\n");
+    check_against_is_utf8("caf\xc3\xa9\n\xff\xfe bad\nok\n");
+
+    std::string big;
+    for (int lpc = 0; lpc < 1000; lpc++) {
+        big.append(lpc % 7, 'a');
+        if (lpc % 11 == 0) {
+            big.append("\t");
+        }
+        if (lpc % 13 == 0) {
+            big.append("\x1b[m");
+        }
+        if (lpc % 17 == 0) {
+            big.append("\xe2\x82\xac");
+        }
+        if (lpc % 19 == 0) {
+            big.append("\xc3");
+        }
+        big.append(lpc % 5 == 0 ? 70 : 3, 'z');
+        big.append("\n");
+    }
+    check_against_is_utf8(big);
+    check_against_is_utf8(big.substr(0, big.size() - 10));
+}
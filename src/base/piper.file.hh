@@ -36,6 +36,7 @@
 #include <set>
 #include <string>
 
+#include <stdint.h>
 #include <sys/time.h>
 
 #include "auto_mem.hh"
@@ -62,6 +63,12 @@ struct header {
     std::string h_mux_id;
     demux_output_t h_demux_output{demux_output_t::not_applicable};
     std::map<std::string, std::string> h_demux_meta;
+    /**
+     * The name of the file in the same directory that holds the line_meta
+     * records for the lines in this file.  Files written by older versions
+     * do not have this and prefix each line with the metadata as text.
+     */
+    std::string h_line_meta;
 
     bool operator<(const header& rhs) const
     {
@@ -77,9 +84,24 @@ struct header {
     }
 };
 
+/**
+ * The timestamp and level of a captured line.  The records are appended to
+ * the side file named in the header in the same order as the lines, so they
+ * are sorted by offset.
+ */
+struct line_meta {
+    uint64_t lm_offset : 56;
+    uint64_t lm_level : 8;
+    int64_t lm_usecs;
+};
+
+static_assert(sizeof(line_meta) == 16);
+
 const std::filesystem::path& storage_path();
 
 constexpr size_t HEADER_SIZE = 8;
+/** The size of the "<secs>.<usecs>:<level>;" prefix in older captures. */
+constexpr size_t TEXT_LINE_META_SIZE = 22;
 extern const char HEADER_MAGIC[4];
 
 std::optional<auto_buffer> read_header(int fd, const char* first8);
@@ -111,6 +111,33 @@ sql_progress_finished()
     lnav_data.ld_views[LNV_DB].redo_search();
 }
 
+/**
+ * Redraw the DB view while a query is still stepping so that the first
+ * rows can be looked at before the whole result has been read.
+ */
+static void
+sql_stream_rows(db_label_source& dls)
+{
+    static sig_atomic_t stream_counter = 0;
+
+    if (lnav_data.ld_window == nullptr || !lnav_data.ld_looping
+        || &dls != &lnav_data.ld_db_row_source)
+    {
+        return;
+    }
+
+    auto* db_tc = &lnav_data.ld_views[LNV_DB];
+    if (lnav_data.ld_view_stack.top().value_or(nullptr) != db_tc) {
+        return;
+    }
+
+    if (ui_periodic_timer::singleton().time_to_update(stream_counter)) {
+        db_tc->reload_data();
+        lnav_data.ld_view_stack.do_update();
+        lnav_data.ld_status_refresher();
+    }
+}
+
 static Result<std::string, lnav::console::user_message> execute_from_file(
     exec_context& ec,
     const std::string& src,
@@ -492,7 +519,7 @@ execute_sql(exec_context& ec, const std::string& sql, std::string& alt_msg)
             | lnav::itertools::for_each(&logfile::dump_stats);
         if (ec.ec_sql_callback != sql_callback) {
             retval = ec.ec_accumulator->get_string();
-        } else if (!dls.dls_rows.empty()) {
+        } else if (dls.dls_rows.row_count() > 0) {
             lnav_data.ld_views[LNV_DB].reload_data();
             lnav_data.ld_views[LNV_DB].set_left(0);
             if (lnav_data.ld_flags & LNF_HEADLESS) {
@@ -502,11 +529,9 @@ execute_sql(exec_context& ec, const std::string& sql, std::string& alt_msg)
 
                 retval = "";
                 alt_msg = "";
-            } else if (dls.dls_rows.size() == 1) {
-                auto& row = dls.dls_rows[0];
-
+            } else if (dls.dls_rows.row_count() == 1) {
                 if (dls.dls_headers.size() == 1) {
-                    retval = row[0];
+                    retval = dls.get_cell_as_string(0, 0);
                 } else {
                     for (unsigned int lpc = 0; lpc < dls.dls_headers.size();
                          lpc++)
@@ -516,11 +541,12 @@ execute_sql(exec_context& ec, const std::string& sql, std::string& alt_msg)
                         }
                         retval.append(dls.dls_headers[lpc].hm_name);
                         retval.push_back('=');
-                        retval.append(row[lpc]);
+                        dls.dls_rows.append_cell(
+                            0, lpc, db_label_source::NULL_STR, retval);
                     }
                 }
             } else {
-                int row_count = dls.dls_rows.size();
+                int row_count = dls.dls_rows.row_count();
                 char row_count_buf[128];
                 timeval diff_tv;
 
@@ -1008,7 +1034,11 @@ sql_callback(exec_context& ec, sqlite3_stmt* stmt)
     int ncols = sqlite3_column_count(stmt);
 
     if (!sqlite3_stmt_busy(stmt)) {
+        static const auto& cfg
+            = injector::get<const db_label_source_ns::config&>();
+
         dls.clear();
+        dls.dls_rows.set_max_memory_size(cfg.c_max_memory_size);
 
         for (int lpc = 0; lpc < ncols; lpc++) {
             const int type = sqlite3_column_type(stmt, lpc);
@@ -1020,9 +1050,9 @@ sql_callback(exec_context& ec, sqlite3_stmt* stmt)
     }
 
     int retval = 0;
-    auto set_vars = dls.dls_rows.empty();
+    auto set_vars = dls.dls_rows.row_count() == 0;
 
-    if (dls.dls_rows.empty()) {
+    if (set_vars) {
         for (int lpc = 0; lpc < ncols; lpc++) {
             int type = sqlite3_column_type(stmt, lpc);
             std::string colname = sqlite3_column_name(stmt, lpc);
@@ -1051,8 +1081,7 @@ sql_callback(exec_context& ec, sqlite3_stmt* stmt)
         }
     }
 
-    auto row_number = dls.dls_rows.size();
-    dls.dls_rows.resize(row_number + 1);
+    dls.push_row();
     for (int lpc = 0; lpc < ncols; lpc++) {
         auto* raw_value = sqlite3_column_value(stmt, lpc);
         const auto value_type = sqlite3_value_type(raw_value);
@@ -1100,6 +1129,8 @@ sql_callback(exec_context& ec, sqlite3_stmt* stmt)
         }
     }
 
+    sql_stream_rows(dls);
+
     return retval;
 }
 
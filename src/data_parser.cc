@@ -27,7 +27,10 @@
  * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
 
-#include <stack>
+#include <mutex>
+#include <tuple>
+#include <utility>
+#include <vector>
 
 #include "data_parser.hh"
 
@@ -39,6 +42,195 @@ data_format data_parser::FORMAT_COMMA("comma", DT_INVALID, DT_COMMA);
 data_format data_parser::FORMAT_EMDASH("emdash", DT_INVALID, DT_EMDASH);
 data_format data_parser::FORMAT_PLAIN("plain", DT_INVALID, DT_INVALID);
 
+namespace {
+
+/** The size of the blocks that nodes are carved out of. */
+constexpr size_t POOL_BLOCK_SIZE = 64 * 1024;
+/** Nodes are rounded up to a multiple of this size. */
+constexpr size_t POOL_SIZE_STEP = 16;
+/** Larger allocations go directly to the heap. */
+constexpr size_t POOL_MAX_NODE_SIZE = 256;
+constexpr size_t POOL_BUCKET_COUNT = POOL_MAX_NODE_SIZE / POOL_SIZE_STEP;
+
+struct pool_free_node {
+    pool_free_node* pfn_next;
+};
+
+/**
+ * The nodes and partially used blocks left behind by threads that have
+ * exited, waiting to be picked up by the threads that are still running.
+ */
+struct shared_pool {
+    std::mutex sp_mutex;
+    pool_free_node* sp_heads[POOL_BUCKET_COUNT]{};
+    pool_free_node* sp_tails[POOL_BUCKET_COUNT]{};
+    /** The blocks and how much of each has been used. */
+    std::vector<std::pair<char*, size_t>> sp_blocks;
+};
+
+shared_pool&
+get_shared_pool()
+{
+    static auto* retval = new shared_pool();
+
+    return *retval;
+}
+
+struct thread_pool {
+    ~thread_pool();
+
+    /**
+     * Move the nodes in the shared pool into this one.
+     *
+     * @return True if anything was moved.
+     */
+    bool adopt_shared();
+
+    pool_free_node* tp_free_lists[POOL_BUCKET_COUNT]{};
+    char* tp_block{nullptr};
+    size_t tp_block_used{POOL_BLOCK_SIZE};
+};
+
+thread_pool::~thread_pool()
+{
+    auto& sp = get_shared_pool();
+    std::lock_guard<std::mutex> lg(sp.sp_mutex);
+
+    for (size_t lpc = 0; lpc < POOL_BUCKET_COUNT; lpc++) {
+        auto* head = this->tp_free_lists[lpc];
+
+        if (head == nullptr) {
+            continue;
+        }
+
+        auto* tail = head;
+        while (tail->pfn_next != nullptr) {
+            tail = tail->pfn_next;
+        }
+        tail->pfn_next = sp.sp_heads[lpc];
+        if (sp.sp_heads[lpc] == nullptr) {
+            sp.sp_tails[lpc] = tail;
+        }
+        sp.sp_heads[lpc] = head;
+        this->tp_free_lists[lpc] = nullptr;
+    }
+    if (this->tp_block != nullptr && this->tp_block_used < POOL_BLOCK_SIZE) {
+        sp.sp_blocks.emplace_back(this->tp_block, this->tp_block_used);
+    }
+    this->tp_block = nullptr;
+    this->tp_block_used = POOL_BLOCK_SIZE;
+}
+
+bool
+thread_pool::adopt_shared()
+{
+    auto& sp = get_shared_pool();
+    std::lock_guard<std::mutex> lg(sp.sp_mutex);
+    auto retval = false;
+
+    for (size_t lpc = 0; lpc < POOL_BUCKET_COUNT; lpc++) {
+        if (sp.sp_heads[lpc] == nullptr) {
+            continue;
+        }
+
+        sp.sp_tails[lpc]->pfn_next = this->tp_free_lists[lpc];
+        this->tp_free_lists[lpc] = sp.sp_heads[lpc];
+        sp.sp_heads[lpc] = nullptr;
+        sp.sp_tails[lpc] = nullptr;
+        retval = true;
+    }
+    if (!sp.sp_blocks.empty()) {
+        std::tie(this->tp_block, this->tp_block_used) = sp.sp_blocks.back();
+        sp.sp_blocks.pop_back();
+        retval = true;
+    }
+
+    return retval;
+}
+
+/**
+ * Nodes can be freed by a different thread than the one that allocated
+ * them, so the blocks are kept for the life of the process instead of
+ * being tied to the pool of a thread.  The free nodes of a thread are
+ * passed to the shared pool when it exits so they can be reused.
+ */
+char*
+allocate_block()
+{
+    static std::mutex BLOCKS_MUTEX;
+    static auto* BLOCKS = new std::vector<std::unique_ptr<char[]>>();
+
+    std::lock_guard<std::mutex> lg(BLOCKS_MUTEX);
+    BLOCKS->emplace_back(std::make_unique<char[]>(POOL_BLOCK_SIZE));
+    return BLOCKS->back().get();
+}
+
+thread_pool&
+get_thread_pool()
+{
+    static thread_local thread_pool retval;
+
+    return retval;
+}
+
+}  // namespace
+
+void*
+element_pool::allocate(size_t size)
+{
+    if (size == 0 || size > POOL_MAX_NODE_SIZE) {
+        return ::operator new(size);
+    }
+
+    auto& tp = get_thread_pool();
+    auto bucket = (size - 1) / POOL_SIZE_STEP;
+    auto* free_node = tp.tp_free_lists[bucket];
+    if (free_node != nullptr) {
+        tp.tp_free_lists[bucket] = free_node->pfn_next;
+        return free_node;
+    }
+
+    auto node_size = (bucket + 1) * POOL_SIZE_STEP;
+    if (tp.tp_block_used + node_size > POOL_BLOCK_SIZE) {
+        // Check for nodes from exited threads before taking more memory.
+        // Any space left at the end of the current block is given up.
+        if (tp.adopt_shared()) {
+            free_node = tp.tp_free_lists[bucket];
+            if (free_node != nullptr) {
+                tp.tp_free_lists[bucket] = free_node->pfn_next;
+                return free_node;
+            }
+        }
+        if (tp.tp_block_used + node_size > POOL_BLOCK_SIZE) {
+            tp.tp_block = allocate_block();
+            tp.tp_block_used = 0;
+        }
+    }
+
+    auto* retval = &tp.tp_block[tp.tp_block_used];
+    tp.tp_block_used += node_size;
+    return retval;
+}
+
+void
+element_pool::deallocate(void* ptr, size_t size) noexcept
+{
+    if (ptr == nullptr) {
+        return;
+    }
+    if (size == 0 || size > POOL_MAX_NODE_SIZE) {
+        ::operator delete(ptr);
+        return;
+    }
+
+    auto& tp = get_thread_pool();
+    auto bucket = (size - 1) / POOL_SIZE_STEP;
+    auto* free_node = static_cast<pool_free_node*>(ptr);
+
+    free_node->pfn_next = tp.tp_free_lists[bucket];
+    tp.tp_free_lists[bucket] = free_node;
+}
+
 data_parser::data_parser(data_scanner* ds)
     : dp_errors("dp_errors", __FILE__, __LINE__),
       dp_pairs("dp_pairs", __FILE__, __LINE__), dp_msg_format(nullptr),
@@ -49,6 +241,21 @@ data_parser::data_parser(data_scanner* ds)
     }
 }
 
+void
+data_parser::reset(data_scanner* ds)
+{
+    this->dp_group_token.clear();
+    this->dp_group_stack.clear();
+    this->dp_errors.CLEAR();
+    this->dp_pairs.CLEAR();
+    this->dp_schema_id.clear();
+    this->dp_msg_format_begin = ds->get_init_offset();
+    this->dp_scanner = ds;
+    if (TRACE_FILE != nullptr) {
+        fprintf(TRACE_FILE, "input %s\n", ds->get_input().to_string().c_str());
+    }
+}
+
 void
 data_parser::pairup(data_parser::schema_id_t* schema,
                     data_parser::element_list_t& pairs_out,
@@ -565,11 +772,13 @@ data_parser::pairup(data_parser::schema_id_t* schema,
 void
 data_parser::discover_format()
 {
-    std::stack<discover_format_state> state_stack;
+    auto& state_stack = this->dp_format_states;
+
+    state_stack.clear();
     this->dp_group_token.push_back(DT_INVALID);
     this->dp_group_stack.resize(1);
 
-    state_stack.push(discover_format_state());
+    state_stack.emplace_back();
     while (true) {
         auto tok_res = this->dp_scanner->tokenize2();
         if (!tok_res) {
@@ -584,7 +793,7 @@ data_parser::discover_format()
         require(elem.e_capture.c_end >= 0);
         require(elem.e_capture.c_begin <= elem.e_capture.c_end);
 
-        state_stack.top().update_for_element(elem);
+        state_stack.back().update_for_element(elem);
         switch (elem.e_token) {
             case DT_LPAREN:
             case DT_LANGLE:
@@ -592,7 +801,7 @@ data_parser::discover_format()
             case DT_LSQUARE:
                 this->dp_group_token.push_back(elem.e_token);
                 this->dp_group_stack.emplace_back("_anon_", __FILE__, __LINE__);
-                state_stack.push(discover_format_state());
+                state_stack.emplace_back();
                 break;
 
             case DT_EMPTY_CONTAINER: {
@@ -622,10 +831,10 @@ data_parser::discover_format()
 
                     auto riter = this->dp_group_stack.rbegin();
                     ++riter;
-                    state_stack.top().finalize();
+                    state_stack.back().finalize();
                     this->dp_group_stack.back().el_format
-                        = state_stack.top().dfs_format;
-                    state_stack.pop();
+                        = state_stack.back().dfs_format;
+                    state_stack.pop_back();
                     if (!this->dp_group_stack.back().empty()) {
                         (*riter).PUSH_BACK(
                             element(this->dp_group_stack.back(), DNT_GROUP));
@@ -670,17 +879,17 @@ data_parser::discover_format()
         auto riter = this->dp_group_stack.rbegin();
         ++riter;
         if (!this->dp_group_stack.back().empty()) {
-            state_stack.top().finalize();
+            state_stack.back().finalize();
             this->dp_group_stack.back().el_format
-                = state_stack.top().dfs_format;
-            state_stack.pop();
+                = state_stack.back().dfs_format;
+            state_stack.pop_back();
             (*riter).PUSH_BACK(element(this->dp_group_stack.back(), DNT_GROUP));
         }
         this->dp_group_stack.pop_back();
     }
 
-    state_stack.top().finalize();
-    this->dp_group_stack.back().el_format = state_stack.top().dfs_format;
+    state_stack.back().finalize();
+    this->dp_group_stack.back().el_format = state_stack.back().dfs_format;
 }
 
 void
@@ -1195,6 +1404,13 @@ data_parser::element::element(const data_parser::element& other)
     }
 }
 
+data_parser::element::element(data_parser::element&& other) noexcept
+    : e_capture(other.e_capture), e_token(other.e_token),
+      e_sub_elements(other.e_sub_elements)
+{
+    other.e_sub_elements = nullptr;
+}
+
 data_parser::element::~element()
 {
     delete this->e_sub_elements;
@@ -1213,6 +1429,15 @@ data_parser::element::operator=(const data_parser::element& other)
     return *this;
 }
 
+data_parser::element&
+data_parser::element::operator=(data_parser::element&& other) noexcept
+{
+    this->e_capture = other.e_capture;
+    this->e_token = other.e_token;
+    std::swap(this->e_sub_elements, other.e_sub_elements);
+    return *this;
+}
+
 void
 data_parser::element::assign_elements(data_parser::element_list_t& subs)
 {
@@ -1425,5 +1650,19 @@ data_parser::element_list_t::push_back(const data_parser::element& elem,
     require(this->empty()
             || (elem.e_capture.c_begin == -1 && elem.e_capture.c_end == -1)
             || this->back().e_capture.c_end <= elem.e_capture.c_begin);
-    this->std::list<element>::push_back(elem);
+    this->base_t::push_back(elem);
+}
+
+void
+data_parser::element_list_t::push_back(data_parser::element&& elem,
+                                       const char* fn,
+                                       int line)
+{
+    ELEMENT_TRACE;
+
+    require(elem.e_capture.c_end >= -1);
+    require(this->empty()
+            || (elem.e_capture.c_begin == -1 && elem.e_capture.c_end == -1)
+            || this->back().e_capture.c_end <= elem.e_capture.c_begin);
+    this->base_t::push_back(std::move(elem));
 }
@@ -204,6 +204,55 @@ data_format_state_t dfs_comma_next(data_format_state_t state,
         } \
     } while (false);
 
+/**
+ * The lists built by the parser are made up of many small nodes that only
+ * live as long as a line is being parsed.  This pool carves the nodes out
+ * of large blocks and keeps the freed nodes on per-thread free lists, so
+ * parsing a line does not go to the heap once the lists for the previous
+ * lines have been released.  The blocks are never returned to the heap,
+ * so the memory used is bounded by the most nodes that were alive at once.
+ */
+class element_pool {
+public:
+    static void* allocate(size_t size);
+
+    static void deallocate(void* ptr, size_t size) noexcept;
+};
+
+template<typename T>
+struct element_allocator {
+    using value_type = T;
+
+    element_allocator() noexcept = default;
+
+    template<typename U>
+    element_allocator(const element_allocator<U>&) noexcept
+    {
+    }
+
+    T* allocate(size_t n)
+    {
+        return static_cast<T*>(element_pool::allocate(n * sizeof(T)));
+    }
+
+    void deallocate(T* ptr, size_t n) noexcept
+    {
+        element_pool::deallocate(ptr, n * sizeof(T));
+    }
+
+    template<typename U>
+    bool operator==(const element_allocator<U>&) const
+    {
+        return true;
+    }
+
+    template<typename U>
+    bool operator!=(const element_allocator<U>&) const
+    {
+        return false;
+    }
+};
+
 class data_parser {
 public:
     static data_format FORMAT_SEMI;
@@ -218,8 +267,21 @@ public:
     struct element;
     /* typedef std::list<element> element_list_t; */
 
-    class element_list_t : public std::list<element> {
+    class element_list_t
+        : public std::list<element, element_allocator<element>> {
     public:
+        using base_t = std::list<element, element_allocator<element>>;
+
+        static void* operator new(size_t size)
+        {
+            return element_pool::allocate(size);
+        }
+
+        static void operator delete(void* ptr, size_t size)
+        {
+            element_pool::deallocate(ptr, size);
+        }
+
         element_list_t(const char* varname,
                        const char* fn,
                        int line,
@@ -238,7 +300,7 @@ public:
             LIST_INIT_TRACE;
         }
 
-        element_list_t(const element_list_t& other) : std::list<element>(other)
+        element_list_t(const element_list_t& other) : base_t(other)
         {
             this->el_format = other.el_format;
         }
@@ -256,37 +318,47 @@ public:
             ELEMENT_TRACE;
 
             require(elem.e_capture.c_end >= -1);
-            this->std::list<element>::push_front(elem);
+            this->base_t::push_front(elem);
+        }
+
+        void push_front(element&& elem, const char* fn, int line)
+        {
+            ELEMENT_TRACE;
+
+            require(elem.e_capture.c_end >= -1);
+            this->base_t::push_front(std::move(elem));
         }
 
         void push_back(const element& elem, const char* fn, int line);
 
+        void push_back(element&& elem, const char* fn, int line);
+
         void pop_front(const char* fn, int line)
         {
             LIST_TRACE;
 
-            this->std::list<element>::pop_front();
+            this->base_t::pop_front();
         }
 
         void pop_back(const char* fn, int line)
         {
             LIST_TRACE;
 
-            this->std::list<element>::pop_back();
+            this->base_t::pop_back();
         }
 
         void clear2(const char* fn, int line)
         {
             LIST_TRACE;
 
-            this->std::list<element>::clear();
+            this->base_t::clear();
         }
 
         void swap(element_list_t& other, const char* fn, int line)
         {
             SWAP_TRACE(other);
 
-            this->std::list<element>::swap(other);
+            this->base_t::swap(other);
         }
 
         void splice(iterator pos,
@@ -298,7 +370,7 @@ public:
         {
             SPLICE_TRACE;
 
-            this->std::list<element>::splice(pos, other, first, last);
+            this->base_t::splice(pos, other, first, last);
         }
 
         data_format el_format;
@@ -311,12 +383,20 @@ public:
                 data_token_t token,
                 bool assign_subs_elements = true);
 
+        /**
+         * Copying an element moves the sub-elements of the other element
+         * into this one.
+         */
         element(const element& other);
 
+        element(element&& other) noexcept;
+
         ~element();
 
         element& operator=(const element& other);
 
+        element& operator=(element&& other) noexcept;
+
         void assign_elements(element_list_t& subs);
 
         void update_capture();
@@ -387,6 +467,12 @@ public:
 
     data_parser(data_scanner* ds);
 
+    /**
+     * Prepare the parser to parse the line in the given scanner, keeping
+     * the memory used for the previous line.
+     */
+    void reset(data_scanner* ds);
+
     void pairup(schema_id_t* schema,
                 element_list_t& pairs_out,
                 element_list_t& in_list,
@@ -412,7 +498,8 @@ public:
     void print(FILE* out, element_list_t& el);
 
     std::vector<data_token_t> dp_group_token;
-    std::list<element_list_t> dp_group_stack;
+    std::list<element_list_t, element_allocator<element_list_t>>
+        dp_group_stack;
 
     element_list_t dp_errors;
 
@@ -423,6 +510,7 @@ public:
 
 private:
     data_scanner* dp_scanner;
+    std::vector<discover_format_state> dp_format_states;
 };
 
 #endif
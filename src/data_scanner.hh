@@ -211,6 +211,24 @@ public:
 
     void reset() { this->ds_next_offset = this->ds_init_offset; }
 
+    /**
+     * Point the scanner at another line so that it can be reused.  The
+     * line is not copied, so it needs to outlive the use of the scanner.
+     */
+    void reset(string_fragment sf, int off)
+    {
+        this->ds_line.clear();
+        this->ds_sbr.disown();
+        this->ds_input = sf;
+        this->ds_init_offset = off;
+        this->ds_next_offset = off;
+        this->ds_bol = true;
+        this->ds_units = false;
+        this->ds_matching_brackets.clear();
+        this->ds_last_bracket_matched = false;
+        this->cleanup_end();
+    }
+
     int get_init_offset() const { return this->ds_init_offset; }
 
     string_fragment get_input() const { return this->ds_input; }
@@ -54,13 +54,16 @@ db_label_source::text_value_for_line(textview_curses& tc,
 
     label_out.clear();
     this->dls_ansi_attrs.clear();
-    if (row < 0_vl || row >= (int) this->dls_rows.size()) {
+    if (row < 0_vl || row >= (int) this->dls_rows.row_count()) {
         return {};
     }
-    for (int lpc = 0; lpc < (int) this->dls_rows[row].size(); lpc++) {
+    std::string cell_value;
+    for (size_t lpc = 0; lpc < this->dls_headers.size(); lpc++) {
         auto actual_col_size = std::min(this->dls_max_column_width,
                                         this->dls_headers[lpc].hm_column_size);
-        auto cell_str = scrub_ws(this->dls_rows[row][lpc]);
+        cell_value.clear();
+        this->dls_rows.append_cell(row, lpc, NULL_STR, cell_value);
+        auto cell_str = scrub_ws(cell_value.c_str());
         string_attrs_t cell_attrs;
         scrub_ansi_string(cell_str, &cell_attrs);
         truncate_to(cell_str, this->dls_max_column_width);
@@ -94,7 +97,7 @@ db_label_source::text_attrs_for_line(textview_curses& tc,
     struct line_range lr(0, 0);
     const struct line_range lr2(0, -1);
 
-    if (row < 0_vl || row >= (int) this->dls_rows.size()) {
+    if (row < 0_vl || row >= (int) this->dls_rows.row_count()) {
         return;
     }
     sa = this->dls_ansi_attrs;
@@ -119,20 +122,46 @@ db_label_source::text_attrs_for_line(textview_curses& tc,
         require_ge(attr.sa_range.lr_start, 0);
     }
     int cell_start = 0;
+    std::string text_buffer;
     for (size_t lpc = 0; lpc < this->dls_headers.size(); lpc++) {
-        auto row_view = std::string_view{this->dls_rows[row][lpc]};
         const auto& hm = this->dls_headers[lpc];
+        auto cell_type = this->dls_rows.get_type(row, lpc);
+        auto row_view = std::string_view{};
+
+        if (cell_type == db_column_store::cell_type::text) {
+            row_view = this->dls_rows.get_text(row, lpc, text_buffer)
+                           .to_string_view();
+        }
 
         int left = cell_start;
         if (hm.hm_graphable) {
-            auto num_scan_res = scn::scan_value<double>(row_view);
+            std::optional<double> num_value;
+
+            switch (cell_type) {
+                case db_column_store::cell_type::integer:
+                    num_value = this->dls_rows.get_integer(row, lpc);
+                    break;
+                case db_column_store::cell_type::real:
+                    num_value = this->dls_rows.get_real(row, lpc);
+                    break;
+                case db_column_store::cell_type::text: {
+                    auto num_scan_res = scn::scan_value<double>(row_view);
+
+                    if (num_scan_res) {
+                        num_value = num_scan_res->value();
+                    }
+                    break;
+                }
+                case db_column_store::cell_type::null:
+                    break;
+            }
 
-            if (num_scan_res) {
+            if (num_value) {
                 hm.hm_chart.chart_attrs_for_value(tc,
                                                   left,
                                                   this->dls_cell_width[lpc],
                                                   hm.hm_name,
-                                                  num_scan_res->value(),
+                                                  num_value.value(),
                                                   sa);
 
                 for (const auto& attr : sa) {
@@ -187,6 +216,7 @@ db_label_source::push_header(const std::string& colstr,
 {
     this->dls_headers.emplace_back(colstr);
     this->dls_cell_width.push_back(0);
+    this->dls_rows.add_column();
 
     header_meta& hm = this->dls_headers.back();
 
@@ -206,29 +236,35 @@ void
 db_label_source::push_column(const scoped_value_t& sv)
 {
     auto& vc = view_colors::singleton();
-    int index = this->dls_rows.back().size();
+    int index = this->dls_rows.get_next_column();
     auto& hm = this->dls_headers[index];
+    fmt::memory_buffer num_buf;
 
+    // Numbers are kept in binary form and only formatted to figure out the
+    // width of the column, and for the time column.
     auto col_sf = sv.match(
-        [](const std::string& str) { return string_fragment::from_str(str); },
+        [this](const std::string& str) {
+            this->dls_rows.push_text(string_fragment::from_str(str));
+            return string_fragment::from_str(str);
+        },
         [this](const string_fragment& sf) {
-            return sf.to_owned(*this->dls_allocator);
+            this->dls_rows.push_text(sf);
+            return sf;
         },
-        [this](int64_t i) {
-            fmt::memory_buffer buf;
-
-            fmt::format_to(std::back_inserter(buf), FMT_STRING("{}"), i);
-            return string_fragment::from_memory_buffer(buf).to_owned(
-                *this->dls_allocator);
+        [this, &num_buf](int64_t i) {
+            this->dls_rows.push_integer(i);
+            fmt::format_to(std::back_inserter(num_buf), FMT_STRING("{}"), i);
+            return string_fragment::from_memory_buffer(num_buf);
         },
-        [this](double d) {
-            fmt::memory_buffer buf;
-
-            fmt::format_to(std::back_inserter(buf), FMT_STRING("{}"), d);
-            return string_fragment::from_memory_buffer(buf).to_owned(
-                *this->dls_allocator);
+        [this, &num_buf](double d) {
+            this->dls_rows.push_real(d);
+            fmt::format_to(std::back_inserter(num_buf), FMT_STRING("{}"), d);
+            return string_fragment::from_memory_buffer(num_buf);
         },
-        [](null_value_t) { return string_fragment::from_const(NULL_STR); });
+        [this](null_value_t) {
+            this->dls_rows.push_null();
+            return string_fragment::from_const(NULL_STR);
+        });
 
     if (index == this->dls_time_column_index) {
         date_time_scanner dts;
@@ -250,7 +286,6 @@ db_label_source::push_column(const scoped_value_t& sv)
         }
     }
 
-    this->dls_rows.back().push_back(col_sf.data());
     hm.hm_column_size
         = std::max(this->dls_headers[index].hm_column_size,
                    (size_t) utf8_string_length(col_sf.data(), col_sf.length())
@@ -298,7 +333,7 @@ db_label_source::clear()
     this->dls_rows.clear();
     this->dls_time_column.clear();
     this->dls_cell_width.clear();
-    this->dls_allocator = std::make_unique<ArenaAlloc::Alloc<char>>(64 * 1024);
+    this->dls_generation += 1;
 }
 
 std::optional<size_t>
@@ -357,15 +392,21 @@ db_overlay_source::list_value_for_overlay(const listview_curses& lv,
     }
 
     auto& vc = view_colors::singleton();
-    const auto& cols = this->dos_labels->dls_rows[row];
+    const auto& rows = this->dos_labels->dls_rows;
     unsigned long width;
     vis_line_t height;
+    std::string text_buffer;
 
     lv.get_dimensions(height, width);
 
-    for (size_t col = 0; col < cols.size(); col++) {
-        const char* col_value = cols[col];
-        size_t col_len = strlen(col_value);
+    for (size_t col = 0; col < rows.column_count(); col++) {
+        if (rows.get_type(row, col) != db_column_store::cell_type::text) {
+            continue;
+        }
+
+        auto col_sf = rows.get_text(row, col, text_buffer);
+        const char* col_value = col_sf.data();
+        size_t col_len = col_sf.length();
 
         if (!(col_len >= 2
               && ((col_value[0] == '{' && col_value[col_len - 1] == '}')
@@ -0,0 +1,285 @@
+/**
+ * Copyright (c) 2026, Timothy Stack
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ * * Neither the name of Timothy Stack nor the names of its contributors
+ * may be used to endorse or promote products derived from this software
+ * without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE REGENTS AND CONTRIBUTORS ''AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <filesystem>
+
+#include "db_sub_source.column_store.hh"
+
+#include <string.h>
+#include <unistd.h>
+
+#include "base/fs_util.hh"
+#include "base/lnav_log.hh"
+#include "base/paths.hh"
+#include "config.h"
+#include "fmt/format.h"
+
+static constexpr uint64_t SPILLED_BIT = 1ULL << 63;
+static constexpr size_t CHUNK_SIZE = 256 * 1024;
+static constexpr size_t MAX_DICTIONARY_ENTRIES = 1024;
+static constexpr size_t MAX_DICTIONARY_VALUE_LENGTH = 64;
+
+void
+db_column_store::clear()
+{
+    this->cs_columns.clear();
+    this->cs_row_count = 0;
+    this->cs_next_column = 0;
+    this->cs_dictionary_allocator.reset();
+    this->cs_chunks.clear();
+    this->cs_chunk_size = 0;
+    this->cs_chunk_used = 0;
+    this->cs_memory_usage = 0;
+    this->cs_spill_fd.reset();
+    this->cs_spill_size = 0;
+}
+
+void
+db_column_store::push(cell_kind kind, uint64_t value)
+{
+    auto& column = this->cs_columns[this->cs_next_column];
+
+    column.c_kinds.push_back(kind);
+    column.c_values.push_back(value);
+    this->cs_next_column += 1;
+}
+
+void
+db_column_store::push_null()
+{
+    this->push(cell_kind::null, 0);
+}
+
+void
+db_column_store::push_integer(int64_t value)
+{
+    this->push(cell_kind::integer, (uint64_t) value);
+}
+
+void
+db_column_store::push_real(double value)
+{
+    uint64_t bits;
+
+    memcpy(&bits, &value, sizeof(bits));
+    this->push(cell_kind::real, bits);
+}
+
+void
+db_column_store::push_text(string_fragment value)
+{
+    auto& column = this->cs_columns[this->cs_next_column];
+
+    if (value.length() <= MAX_DICTIONARY_VALUE_LENGTH) {
+        auto dict_iter = column.c_dictionary_index.find(value);
+
+        if (dict_iter != column.c_dictionary_index.end()) {
+            this->push(cell_kind::dictionary, dict_iter->second);
+            return;
+        }
+        if (column.c_dictionary.size() < MAX_DICTIONARY_ENTRIES) {
+            if (this->cs_dictionary_allocator == nullptr) {
+                this->cs_dictionary_allocator
+                    = std::make_unique<ArenaAlloc::Alloc<char>>(16 * 1024);
+            }
+
+            auto code = (uint32_t) column.c_dictionary.size();
+            auto owned = value.to_owned(*this->cs_dictionary_allocator);
+
+            column.c_dictionary.emplace_back(owned);
+            column.c_dictionary_index.emplace(owned, code);
+            this->push(cell_kind::dictionary, code);
+            return;
+        }
+    }
+
+    this->push(cell_kind::heap, this->add_to_heap(value));
+}
+
+uint64_t
+db_column_store::add_to_heap(string_fragment value)
+{
+    uint32_t len = value.length();
+    auto needed = sizeof(len) + len;
+
+    if (this->cs_memory_usage + needed > this->cs_max_memory_size
+        && this->cs_spill_fd == -1)
+    {
+        std::error_code errc;
+        std::filesystem::create_directories(lnav::paths::workdir(), errc);
+        auto open_res = lnav::filesystem::open_temp_file(
+            lnav::paths::workdir() / "db-results.XXXXXX");
+
+        if (open_res.isOk()) {
+            auto tmp_pair = open_res.unwrap();
+
+            std::filesystem::remove(tmp_pair.first);
+            this->cs_spill_fd = std::move(tmp_pair.second);
+            log_info("spilling SQL results to a temporary file after %zu bytes",
+                     this->cs_memory_usage);
+        } else {
+            log_error("unable to spill SQL results: %s",
+                      open_res.unwrapErr().c_str());
+            this->cs_max_memory_size = SIZE_MAX;
+        }
+    }
+
+    if (this->cs_spill_fd != -1) {
+        auto offset = this->cs_spill_size;
+
+        if (pwrite(this->cs_spill_fd, &len, sizeof(len), offset)
+                == sizeof(len)
+            && pwrite(this->cs_spill_fd,
+                      value.data(),
+                      len,
+                      offset + sizeof(len))
+                == len)
+        {
+            this->cs_spill_size += needed;
+            return SPILLED_BIT | offset;
+        }
+
+        log_error("unable to write SQL results to temporary file: %s",
+                  strerror(errno));
+        this->cs_spill_fd.reset();
+        this->cs_max_memory_size = SIZE_MAX;
+    }
+
+    if (this->cs_chunks.empty()
+        || this->cs_chunk_used + needed > this->cs_chunk_size)
+    {
+        this->cs_chunk_size = std::max(CHUNK_SIZE, needed);
+        this->cs_chunk_used = 0;
+        this->cs_chunks.emplace_back(
+            std::make_unique<char[]>(this->cs_chunk_size));
+    }
+
+    auto* dst = this->cs_chunks.back().get() + this->cs_chunk_used;
+    auto retval = ((uint64_t) (this->cs_chunks.size() - 1) << 32)
+        | this->cs_chunk_used;
+
+    memcpy(dst, &len, sizeof(len));
+    memcpy(dst + sizeof(len), value.data(), len);
+    this->cs_chunk_used += needed;
+    this->cs_memory_usage += needed;
+
+    return retval;
+}
+
+db_column_store::cell_type
+db_column_store::get_type(size_t row, size_t col) const
+{
+    switch (this->cs_columns[col].c_kinds[row]) {
+        case cell_kind::null:
+            return cell_type::null;
+        case cell_kind::integer:
+            return cell_type::integer;
+        case cell_kind::real:
+            return cell_type::real;
+        case cell_kind::dictionary:
+        case cell_kind::heap:
+            return cell_type::text;
+    }
+
+    return cell_type::null;
+}
+
+double
+db_column_store::get_real(size_t row, size_t col) const
+{
+    auto bits = this->cs_columns[col].c_values[row];
+    double retval;
+
+    memcpy(&retval, &bits, sizeof(retval));
+    return retval;
+}
+
+string_fragment
+db_column_store::get_text(size_t row, size_t col, std::string& buffer) const
+{
+    const auto& column = this->cs_columns[col];
+    auto value = column.c_values[row];
+
+    if (column.c_kinds[row] == cell_kind::dictionary) {
+        return column.c_dictionary[value];
+    }
+
+    uint32_t len;
+    if (value & SPILLED_BIT) {
+        auto offset = value & ~SPILLED_BIT;
+
+        if (pread(this->cs_spill_fd, &len, sizeof(len), offset) != sizeof(len))
+        {
+            return string_fragment::from_const("");
+        }
+        buffer.resize(len);
+        if (pread(this->cs_spill_fd, buffer.data(), len, offset + sizeof(len))
+            != len)
+        {
+            return string_fragment::from_const("");
+        }
+        return string_fragment::from_str(buffer);
+    }
+
+    const auto* src = this->cs_chunks[value >> 32].get() + (value & 0xffffffff);
+
+    memcpy(&len, src, sizeof(len));
+    return string_fragment::from_bytes(src + sizeof(len), len);
+}
+
+void
+db_column_store::append_cell(size_t row,
+                             size_t col,
+                             const char* null_str,
+                             std::string& dst) const
+{
+    switch (this->cs_columns[col].c_kinds[row]) {
+        case cell_kind::null:
+            dst.append(null_str);
+            break;
+        case cell_kind::integer:
+            fmt::format_to(std::back_inserter(dst),
+                           FMT_STRING("{}"),
+                           this->get_integer(row, col));
+            break;
+        case cell_kind::real:
+            fmt::format_to(std::back_inserter(dst),
+                           FMT_STRING("{}"),
+                           this->get_real(row, col));
+            break;
+        case cell_kind::dictionary:
+        case cell_kind::heap: {
+            std::string buffer;
+            auto sf = this->get_text(row, col, buffer);
+
+            dst.append(sf.data(), sf.length());
+            break;
+        }
+    }
+}
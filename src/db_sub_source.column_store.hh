@@ -0,0 +1,173 @@
+/**
+ * Copyright (c) 2026, Timothy Stack
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ * * Neither the name of Timothy Stack nor the names of its contributors
+ * may be used to endorse or promote products derived from this software
+ * without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE REGENTS AND CONTRIBUTORS ''AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef lnav_db_sub_source_column_store_hh
+#define lnav_db_sub_source_column_store_hh
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <stdint.h>
+
+#include "ArenaAlloc/arenaalloc.h"
+#include "base/auto_fd.hh"
+#include "base/intern_string.hh"
+#include "db_sub_source.cfg.hh"
+#include "robin_hood/robin_hood.h"
+
+/**
+ * The storage for the rows of a SQL query result.  The values are kept by
+ * column with numbers in their binary form, so they are only formatted when
+ * they are displayed.  Short strings that repeat are dictionary-encoded and
+ * the rest are appended to a heap that is moved to a temporary file once it
+ * grows past the memory limit.
+ */
+class db_column_store {
+public:
+    enum class cell_type : uint8_t {
+        null,
+        integer,
+        real,
+        text,
+    };
+
+    /** Drop all of the columns and rows. */
+    void clear();
+
+    void add_column() { this->cs_columns.emplace_back(); }
+
+    /**
+     * @param size The number of bytes of text to keep in memory before the
+     *   rest is written to a temporary file.
+     */
+    void set_max_memory_size(size_t size) { this->cs_max_memory_size = size; }
+
+    size_t column_count() const { return this->cs_columns.size(); }
+
+    size_t row_count() const { return this->cs_row_count; }
+
+    /** Start a new row, the values are then pushed column by column. */
+    void add_row()
+    {
+        this->cs_row_count += 1;
+        this->cs_next_column = 0;
+    }
+
+    /** @return The index of the column the next value is pushed to. */
+    size_t get_next_column() const { return this->cs_next_column; }
+
+    void push_null();
+
+    void push_integer(int64_t value);
+
+    void push_real(double value);
+
+    void push_text(string_fragment value);
+
+    cell_type get_type(size_t row, size_t col) const;
+
+    bool is_null(size_t row, size_t col) const
+    {
+        return this->get_type(row, col) == cell_type::null;
+    }
+
+    int64_t get_integer(size_t row, size_t col) const
+    {
+        return (int64_t) this->cs_columns[col].c_values[row];
+    }
+
+    double get_real(size_t row, size_t col) const;
+
+    /**
+     * @param buffer Storage for the text if it has to be read from the
+     *   temporary file.
+     * @return The text of a text cell.
+     */
+    string_fragment get_text(size_t row,
+                             size_t col,
+                             std::string& buffer) const;
+
+    /**
+     * Append the text form of a cell to the given string.  NULL values are
+     * rendered as the given null_str.
+     */
+    void append_cell(size_t row,
+                     size_t col,
+                     const char* null_str,
+                     std::string& dst) const;
+
+    /** @return The number of bytes of text held in memory. */
+    size_t get_memory_usage() const { return this->cs_memory_usage; }
+
+    /** @return The number of bytes of text written to the temporary file. */
+    size_t get_spilled_size() const { return this->cs_spill_size; }
+
+private:
+    enum class cell_kind : uint8_t {
+        null,
+        integer,
+        real,
+        dictionary,
+        heap,
+    };
+
+    struct column {
+        std::vector<cell_kind> c_kinds;
+        /**
+         * The integer, the bits of the double, the dictionary code, or the
+         * location of the text in the heap.
+         */
+        std::vector<uint64_t> c_values;
+        std::vector<string_fragment> c_dictionary;
+        robin_hood::unordered_map<string_fragment,
+                                  uint32_t,
+                                  frag_hasher,
+                                  std::equal_to<string_fragment>>
+            c_dictionary_index;
+    };
+
+    void push(cell_kind kind, uint64_t value);
+
+    uint64_t add_to_heap(string_fragment value);
+
+    std::vector<column> cs_columns;
+    size_t cs_row_count{0};
+    size_t cs_next_column{0};
+    size_t cs_max_memory_size{db_label_source_ns::DEFAULT_MAX_MEMORY_SIZE};
+    std::unique_ptr<ArenaAlloc::Alloc<char>> cs_dictionary_allocator;
+    std::vector<std::unique_ptr<char[]>> cs_chunks;
+    size_t cs_chunk_size{0};
+    size_t cs_chunk_used{0};
+    size_t cs_memory_usage{0};
+    auto_fd cs_spill_fd;
+    size_t cs_spill_size{0};
+};
+
+#endif
@@ -36,7 +36,7 @@
 
 #include <sqlite3.h>
 
-#include "ArenaAlloc/arenaalloc.h"
+#include "db_sub_source.column_store.hh"
 #include "hist_source.hh"
 #include "shlex.resolver.hh"
 #include "textview_curses.hh"
@@ -49,7 +49,7 @@ public:
 
     bool has_log_time_column() const { return !this->dls_time_column.empty(); }
 
-    size_t text_line_count() override { return this->dls_rows.size(); }
+    size_t text_line_count() override { return this->dls_rows.row_count(); }
 
     size_t text_size_for_line(textview_curses& tc,
                               int line,
@@ -79,8 +79,22 @@ public:
 
     void push_header(const std::string& colstr, int type, bool graphable);
 
+    void push_row() { this->dls_rows.add_row(); }
+
     void push_column(const scoped_value_t& sv);
 
+    /**
+     * @return The text form of a cell, with NULL values rendered as
+     *   NULL_STR.
+     */
+    std::string get_cell_as_string(size_t row, size_t col) const
+    {
+        std::string retval;
+
+        this->dls_rows.append_cell(row, col, NULL_STR, retval);
+        return retval;
+    }
+
     void clear();
 
     std::optional<size_t> column_name_to_index(const std::string& name) const;
@@ -108,13 +122,13 @@ public:
 
     size_t dls_max_column_width{120};
     std::vector<header_meta> dls_headers;
-    std::vector<std::vector<const char*>> dls_rows;
+    db_column_store dls_rows;
     std::vector<timeval> dls_time_column;
     std::vector<size_t> dls_cell_width;
     int dls_time_column_index{-1};
     std::optional<size_t> dls_time_column_invalidated_at;
-    std::unique_ptr<ArenaAlloc::Alloc<char>> dls_allocator{
-        std::make_unique<ArenaAlloc::Alloc<char>>(64 * 1024)};
+    /** Incremented whenever the result set is cleared. */
+    uint32_t dls_generation{0};
     string_attrs_t dls_ansi_attrs;
 
     static const char NULL_STR[];
@@ -584,7 +584,7 @@ field_overlay_source::build_meta_line(const listview_curses& lv,
                 0, lpc == comment_lines.size() - 1 ? lead : " \u2502 ");
             comment_line.insert(0, filename_width, ' ');
             if (tc != nullptr) {
-                auto hl = tc->get_highlights();
+                const auto& hl = tc->get_highlights();
                 auto hl_iter = hl.find({highlight_source_t::PREVIEW, "search"});
 
                 if (hl_iter != hl.end()) {
@@ -614,7 +614,7 @@ field_overlay_source::build_meta_line(const listview_curses& lv,
         }
         al.insert(0, filename_width, ' ');
         if (tc != nullptr) {
-            auto hl = tc->get_highlights();
+            const auto& hl = tc->get_highlights();
             auto hl_iter = hl.find({highlight_source_t::PREVIEW, "search"});
 
             if (hl_iter != hl.end()) {
@@ -661,7 +661,7 @@ field_overlay_source::build_meta_line(const listview_curses& lv,
                                      : " \u2502 "_comment);
                 anno_line.insert(0, filename_width, ' ');
                 if (tc != nullptr) {
-                    auto hl = tc->get_highlights();
+                    const auto& hl = tc->get_highlights();
                     auto hl_iter
                         = hl.find({highlight_source_t::PREVIEW, "search"});
 
@@ -94,7 +94,15 @@ detect_file_format(const std::filesystem::path& filename)
                 lnav::piper::multiplex_matcher mm;
                 file_range next_range;
                 line_buffer lb;
-                lb.set_fd(fd);
+                try {
+                    lb.set_fd(fd);
+                } catch (const line_buffer::error& e) {
+                    log_error("unable to read file for format detection: %s "
+                              "-- %s",
+                              filename.c_str(),
+                              strerror(e.e_err));
+                    return retval;
+                }
 
                 while (looping) {
                     auto load_res = lb.load_next_line(next_range);
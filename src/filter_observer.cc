@@ -97,7 +97,7 @@ line_filter_observer::get_min_count(size_t max) const
 void
 line_filter_observer::clear_deleted_filter_state()
 {
-    uint32_t used_mask = 0;
+    logfile_filter_state::filter_mask_t used_mask;
 
     for (auto& filter : this->lfo_filter_stack) {
         if (filter->lf_deleted) {
@@ -107,7 +107,7 @@ line_filter_observer::clear_deleted_filter_state()
                       filter->get_lang());
             continue;
         }
-        used_mask |= (1UL << filter->get_index());
+        used_mask.set(filter->get_index());
     }
     this->lfo_filter_state.clear_deleted_filter_state(used_mask);
 }
@@ -56,15 +56,21 @@ public:
 
     void logline_eof(const logfile& lf) override;
 
-    bool excluded(uint32_t filter_in_mask,
-                  uint32_t filter_out_mask,
-                  size_t offset) const
+    void update_excluded(
+        const logfile_filter_state::filter_mask_t& filter_in_mask,
+        const logfile_filter_state::filter_mask_t& filter_out_mask)
     {
-        bool filtered_in = (filter_in_mask == 0)
-            || (this->lfo_filter_state.tfs_mask[offset] & filter_in_mask) != 0;
-        bool filtered_out
-            = (this->lfo_filter_state.tfs_mask[offset] & filter_out_mask) != 0;
-        return !filtered_in || filtered_out;
+        this->lfo_filter_state.update_excluded(filter_in_mask,
+                                               filter_out_mask);
+    }
+
+    /**
+     * @return True if the line is excluded by the filters passed to the
+     *   last call to update_excluded().
+     */
+    bool excluded(size_t offset) const
+    {
+        return this->lfo_filter_state.is_excluded(offset);
     }
 
     size_t get_min_count(size_t max) const;
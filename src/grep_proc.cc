@@ -31,23 +31,31 @@
 
 #include "grep_proc.hh"
 
+#include <algorithm>
+#include <chrono>
+#include <thread>
+
 #include <errno.h>
 #include <fcntl.h>
-#include <signal.h>
-#include <stdio.h>
 #include <string.h>
-#include <sys/wait.h>
 #include <unistd.h>
 
-#include "base/auto_pid.hh"
 #include "base/lnav_log.hh"
-#include "base/opt_util.hh"
-#include "base/string_util.hh"
 #include "config.h"
-#include "lnav_util.hh"
-#include "scn/scan.h"
 #include "vis_line.hh"
 
+/** The maximum number of lines read from the source for a single chunk. */
+static constexpr size_t CHUNK_SIZE = 10000;
+
+/** The least number of lines that is worth handing to another thread. */
+static constexpr size_t MIN_LINES_PER_WORKER = 512;
+
+/**
+ * The maximum amount of time to hold the main_state_lock while reading lines
+ * for a single chunk.
+ */
+static constexpr auto CHUNK_DEADLINE = std::chrono::milliseconds(25);
+
 template<typename LineType>
 grep_proc<LineType>::grep_proc(std::shared_ptr<lnav::pcre2pp::code> code,
                                grep_proc_source<LineType>& gps,
@@ -55,6 +63,8 @@ grep_proc<LineType>::grep_proc(std::shared_ptr<lnav::pcre2pp::code> code,
     : pollable(ps, pollable::category::background), gp_pcre(code),
       gp_source(gps)
 {
+    this->set_thread_count(0);
+
     require(this->invariant());
 
     gps.register_proc(this);
@@ -66,206 +76,301 @@ grep_proc<LineType>::~grep_proc()
     this->invalidate();
 }
 
+template<typename LineType>
+grep_proc<LineType>&
+grep_proc<LineType>::set_thread_count(size_t count)
+{
+    if (count == 0) {
+        count = std::max(1U, std::thread::hardware_concurrency());
+    }
+    this->gp_thread_count = count;
+
+    return *this;
+}
+
 template<typename LineType>
 void
 grep_proc<LineType>::start()
 {
     require(this->invariant());
 
-    if (this->gp_sink) {
-        // XXX hack to make sure threads used by line_buffer are not active
-        // before the fork.
-        this->gp_sink->grep_quiesce();
-    }
-
     log_debug("grep_proc(%p): start", this);
-    if (this->gp_child_started || this->gp_queue.empty()) {
+    if (this->gp_running || this->gp_queue.empty()) {
         log_debug("grep_proc(%p): nothing to do?", this);
         return;
     }
 
-    auto_pipe in_pipe(STDIN_FILENO);
-    auto_pipe out_pipe(STDOUT_FILENO);
-    auto_pipe err_pipe(STDERR_FILENO);
-
-    /* Get ahold of some pipes for stdout and stderr. */
-    if (out_pipe.open() < 0) {
+    if (this->gp_wakeup_pipe.open() < 0) {
         throw error(errno);
     }
-
-    if (err_pipe.open() < 0) {
-        throw error(errno);
+    for (auto fd : {this->gp_wakeup_pipe.read_end().get(),
+                    this->gp_wakeup_pipe.write_end().get()})
+    {
+        fcntl(fd, F_SETFL, O_NONBLOCK);
+        fcntl(fd, F_SETFD, FD_CLOEXEC);
     }
+    this->gp_running = true;
+    this->start_worker();
 
-    if ((this->gp_child = fork()) < 0) {
-        throw error(errno);
-    }
+    log_debug("grep_proc(%p): started search with %zu thread(s)",
+              this,
+              this->gp_thread_count);
 
-    in_pipe.after_fork(this->gp_child);
-    out_pipe.after_fork(this->gp_child);
-    err_pipe.after_fork(this->gp_child);
+    ensure(this->invariant());
+}
 
-    if (this->gp_child != 0) {
-        log_perror(fcntl(out_pipe.read_end(), F_SETFL, O_NONBLOCK));
-        log_perror(fcntl(out_pipe.read_end(), F_SETFD, 1));
-        this->gp_line_buffer.set_fd(out_pipe.read_end());
+template<typename LineType>
+void
+grep_proc<LineType>::start_worker()
+{
+    require(!this->gp_worker.joinable());
 
-        log_perror(fcntl(err_pipe.read_end(), F_SETFL, O_NONBLOCK));
-        log_perror(fcntl(err_pipe.read_end(), F_SETFD, 1));
-        require(this->gp_err_pipe.get() == -1);
-        this->gp_err_pipe = std::move(err_pipe.read_end());
-        this->gp_child_started = true;
-        this->gp_child_queue_size = this->gp_queue.size();
+    this->gp_stop = false;
+    this->gp_worker = std::thread([this]() { this->worker_loop(); });
+}
 
-        this->gp_queue.clear();
+template<typename LineType>
+void
+grep_proc<LineType>::worker_loop()
+{
+    auto& msl = this->get_supervisor().get_main_state_lock();
+    std::unique_ptr<chunk> pending;
+    auto finished = false;
 
-        log_debug("grep_proc(%p): started child %d", this, this->gp_child);
-        return;
-    }
+    while (!finished && !this->gp_stop) {
+        if (!msl.lock(this->gp_stop)) {
+            break;
+        }
 
-    /* In the child... */
-    lnav::pid::in_child = true;
+        auto next_chunk = this->fill_chunk();
+        msl.unlock();
 
-    /*
-     * Restore the default signal handlers so we don't hang around
-     * forever if there is a problem.
-     */
-    signal(SIGINT, SIG_DFL);
-    signal(SIGTERM, SIG_DFL);
+        if (next_chunk == nullptr) {
+            finished = true;
+        } else {
+            // Match this chunk while the next one is being read.
+            this->dispatch_chunk(*next_chunk);
+        }
+        if (pending) {
+            this->post_result(this->collect_chunk(*pending));
+        }
+        pending = std::move(next_chunk);
+    }
 
-    this->child_init();
+    if (pending) {
+        // Wait for the matching threads since they reference the chunk.
+        this->post_result(this->collect_chunk(*pending));
+    }
 
-    this->child_loop();
+    result fin;
 
-    _exit(0);
+    fin.r_finished = true;
+    this->post_result(std::move(fin));
 }
 
 template<typename LineType>
-void
-grep_proc<LineType>::child_loop()
+std::unique_ptr<typename grep_proc<LineType>::chunk>
+grep_proc<LineType>::fill_chunk()
 {
-    auto md = lnav::pcre2pp::match_data::unitialized();
-    char outbuf[BUFSIZ * 2];
-    std::string line_value;
+    if (!this->gp_cursor) {
+        if (this->gp_queue.empty()) {
+            return nullptr;
+        }
 
-    /* Make sure buffering is on, not sure of the state in the parent. */
-    if (setvbuf(stdout, outbuf, _IOFBF, BUFSIZ * 2) < 0) {
-        perror("setvbuf");
-    }
-    lnav_log_file
-        = make_optional_from_nullable(fopen("/tmp/lnav.grep.err", "a"));
-    line_value.reserve(BUFSIZ * 2);
-    while (!this->gp_queue.empty()) {
-        LineType start_line = this->gp_queue.front().first;
-        LineType stop_line = this->gp_queue.front().second;
-        bool done = false;
-        LineType line;
+        auto req = this->gp_queue.front();
 
         this->gp_queue.pop_front();
-        for (line = this->gp_source.grep_initial_line(start_line,
-                                                      this->gp_highest_line);
-             line != -1 && (stop_line == -1 || line < stop_line) && !done;
-             this->gp_source.grep_next_line(line))
-        {
+        this->gp_active_requests += 1;
+        this->gp_cursor = request_cursor{
+            this->gp_source.grep_initial_line(req.first,
+                                              this->gp_highest_line),
+            req.second,
+        };
+    }
+
+    auto retval = std::make_unique<chunk>();
+    auto& cur = this->gp_cursor.value();
+    auto deadline = std::chrono::steady_clock::now() + CHUNK_DEADLINE;
+    std::string line_value;
+    bool done = false;
+
+    retval->c_lines.reserve(CHUNK_SIZE);
+    retval->c_values.reserve(CHUNK_SIZE);
+    retval->c_options.reserve(CHUNK_SIZE);
+    try {
+        while (retval->c_lines.size() < CHUNK_SIZE) {
+            if (cur.rc_line == -1
+                || (cur.rc_stop != -1 && cur.rc_line >= cur.rc_stop))
+            {
+                done = true;
+                break;
+            }
+
             line_value.clear();
             auto val_res
-                = this->gp_source.grep_value_for_line(line, line_value);
+                = this->gp_source.grep_value_for_line(cur.rc_line, line_value);
             if (!val_res) {
+                this->gp_source.grep_next_line(cur.rc_line);
                 done = true;
-            } else {
-                auto li = val_res.value();
-                uint32_t re_opts = 0;
-                if (li.li_utf8_scan_result.is_valid()) {
-                    re_opts = PCRE2_NO_UTF_CHECK;
-                }
-                auto match_res = this->gp_pcre->capture_from(line_value)
-                                     .into(md)
-                                     .matches(re_opts)
-                                     .ignore_error();
-                if (match_res) {
-                    fmt::println(stdout, FMT_STRING("{}"), (int) line);
-                }
+                break;
             }
 
-            if (((line + 1) % 10000) == 0) {
-                /* Periodically flush the buffer so the parent sees progress */
-                this->child_batch();
+            uint32_t re_opts = 0;
+            if (val_res->li_utf8_scan_result.is_valid()) {
+                re_opts = PCRE2_NO_UTF_CHECK;
+            }
+            retval->c_lines.emplace_back(cur.rc_line);
+            retval->c_values.emplace_back(std::move(line_value));
+            retval->c_options.emplace_back(re_opts);
+            this->gp_source.grep_next_line(cur.rc_line);
+
+            if ((retval->c_lines.size() % 128) == 0
+                && std::chrono::steady_clock::now() > deadline)
+            {
+                break;
             }
         }
+    } catch (const std::exception& e) {
+        log_error("grep_proc(%p): unable to read line %d -- %s",
+                  this,
+                  (int) cur.rc_line,
+                  e.what());
+        retval->c_error = e.what();
+        done = true;
+    }
 
-        if (stop_line == -1) {
-            // When scanning to the end of the source, we need to return the
-            // highest line that was seen so that the next request that
+    if (done) {
+        retval->c_request_done = true;
+        if (cur.rc_stop == -1) {
+            // When scanning to the end of the source, we need to remember
+            // the highest line that was seen so that the next request that
             // continues from the end works properly.
-            fmt::println(stdout, FMT_STRING("h{}"), line - 1);
+            this->gp_highest_line = cur.rc_line - LineType(1);
         }
-        this->gp_highest_line = line - 1_vl;
-        this->child_term();
+        this->gp_cursor = std::nullopt;
     }
+
+    return retval;
 }
 
 template<typename LineType>
 void
-grep_proc<LineType>::cleanup()
+grep_proc<LineType>::dispatch_chunk(chunk& ch)
 {
-    if (this->gp_child != -1 && this->gp_child != 0) {
-        int status = 0;
+    auto line_count = ch.c_lines.size();
 
-        kill(this->gp_child, SIGTERM);
-        while (waitpid(this->gp_child, &status, 0) < 0 && (errno == EINTR)) {
-            ;
-        }
-        require(!WIFSIGNALED(status) || WTERMSIG(status) != SIGABRT);
+    if (line_count == 0) {
+        return;
+    }
 
-        log_info("cleaned up grep child %d", this->gp_child);
-        this->gp_child = -1;
-        this->gp_child_started = false;
+    auto workers = std::min(
+        this->gp_thread_count,
+        std::max(size_t{1}, line_count / MIN_LINES_PER_WORKER));
+    auto lines_per_worker = (line_count + workers - 1) / workers;
+
+    for (size_t lpc = 0; lpc < line_count; lpc += lines_per_worker) {
+        auto end = std::min(line_count, lpc + lines_per_worker);
+
+        ch.c_matches.emplace_back(std::async(
+            std::launch::async, [code = this->gp_pcre, &ch, lpc, end]() {
+                // Each worker needs its own match_data.
+                auto md = code->create_match_data();
+                match_result retval;
+
+                for (auto index = lpc; index < end; index++) {
+                    auto match_res = code->capture_from(ch.c_values[index])
+                                         .into(md)
+                                         .matches(ch.c_options[index]);
+
+                    match_res.match(
+                        [&retval, index](lnav::pcre2pp::matcher::found) {
+                            retval.mr_indexes.emplace_back(index);
+                        },
+                        [](lnav::pcre2pp::matcher::not_found) {},
+                        [&retval](lnav::pcre2pp::matcher::error err) {
+                            if (!retval.mr_error) {
+                                retval.mr_error = err.get_message();
+                            }
+                        });
+                }
 
-        if (this->gp_sink) {
-            for (size_t lpc = 0; lpc < this->gp_child_queue_size; lpc++) {
-                this->gp_sink->grep_end(*this);
-            }
-        }
+                return retval;
+            }));
     }
+}
+
+template<typename LineType>
+typename grep_proc<LineType>::result
+grep_proc<LineType>::collect_chunk(chunk& ch)
+{
+    result retval;
 
-    if (this->gp_err_pipe != -1) {
-        this->gp_err_pipe.reset();
+    retval.r_error = ch.c_error;
+    for (auto& match_future : ch.c_matches) {
+        auto mres = match_future.get();
+
+        for (const auto index : mres.mr_indexes) {
+            retval.r_matches.emplace_back(ch.c_lines[index]);
+        }
+        if (mres.mr_error && !retval.r_error) {
+            retval.r_error = std::move(mres.mr_error);
+        }
     }
+    ch.c_matches.clear();
+    retval.r_request_done = ch.c_request_done;
 
-    this->gp_pipe_range.clear();
-    this->gp_line_buffer.reset();
+    return retval;
+}
 
-    ensure(this->invariant());
+template<typename LineType>
+void
+grep_proc<LineType>::post_result(result res)
+{
+    static const char WAKEUP = '\n';
+
+    {
+        std::lock_guard<std::mutex> lg(this->gp_results_mutex);
 
-    if (!this->gp_queue.empty()) {
-        this->start();
+        this->gp_results.emplace_back(std::move(res));
     }
+
+    // The pipe is non-blocking, so a full pipe just means the main loop
+    // has already been woken up.
+    auto rc = write(this->gp_wakeup_pipe.write_end(), &WAKEUP, 1);
+    (void) rc;
 }
 
 template<typename LineType>
 void
-grep_proc<LineType>::dispatch_line(const string_fragment& line)
+grep_proc<LineType>::cleanup()
 {
-    require(line.is_valid());
-
-    auto sv = line.to_string_view();
-    auto h_scan_res = scn::scan<int>(sv, "h{}");
-    if (h_scan_res) {
-        this->gp_highest_line = LineType{h_scan_res->value()};
-    } else {
-        auto ll_scan_res = scn::scan<int>(sv, "{}");
-        if (ll_scan_res) {
-            this->gp_last_line = LineType{ll_scan_res->value()};
-            /* Starting a new line with matches. */
-            ensure(this->gp_last_line >= 0);
-            /* Pass the match offsets to the sink delegate. */
-            if (this->gp_sink != nullptr) {
-                this->gp_sink->grep_match(*this, this->gp_last_line);
-            }
-        } else {
-            log_error("bad line from child -- %s", line);
+    if (this->gp_worker.joinable()) {
+        this->gp_stop = true;
+        this->get_supervisor().get_main_state_lock().notify();
+        this->gp_worker.join();
+    }
+    {
+        std::lock_guard<std::mutex> lg(this->gp_results_mutex);
+
+        this->gp_results.clear();
+    }
+    this->gp_cursor = std::nullopt;
+
+    if (this->gp_sink) {
+        for (size_t lpc = 0; lpc < this->gp_active_requests; lpc++) {
+            this->gp_sink->grep_end(*this);
         }
     }
+    this->gp_active_requests = 0;
+    this->gp_generation += 1;
+
+    if (this->gp_running) {
+        log_info("grep_proc(%p): search finished", this);
+    }
+    this->gp_wakeup_pipe.close();
+    this->gp_running = false;
+
+    ensure(this->invariant());
 }
 
 template<typename LineType>
@@ -274,75 +379,75 @@ grep_proc<LineType>::check_poll_set(const std::vector<struct pollfd>& pollfds)
 {
     require(this->invariant());
 
-    if (this->gp_err_pipe != -1 && pollfd_ready(pollfds, this->gp_err_pipe)) {
-        char buffer[1024 + 1];
-        ssize_t rc;
-
-        rc = read(this->gp_err_pipe, buffer, sizeof(buffer) - 1);
-        if (rc > 0) {
-            static const char* PREFIX = ": ";
+    if (!this->gp_running
+        || !pollfd_ready(pollfds, this->gp_wakeup_pipe.read_end()))
+    {
+        return;
+    }
 
-            buffer[rc] = '\0';
-            if (strncmp(buffer, PREFIX, strlen(PREFIX)) == 0) {
-                char* lf;
+    char drain_buffer[128];
 
-                if ((lf = strchr(buffer, '\n')) != nullptr) {
-                    *lf = '\0';
-                }
-                if (this->gp_control != nullptr) {
-                    this->gp_control->grep_error(&buffer[strlen(PREFIX)]);
-                }
-            }
-        } else if (rc == 0) {
-            this->gp_err_pipe.reset();
-        }
+    while (read(this->gp_wakeup_pipe.read_end(),
+                drain_buffer,
+                sizeof(drain_buffer))
+           > 0)
+    {
     }
 
-    if (this->gp_line_buffer.get_fd() != -1
-        && pollfd_ready(pollfds, this->gp_line_buffer.get_fd()))
+    std::deque<result> results;
     {
-        try {
-            static const int MAX_LOOPS = 100;
+        std::lock_guard<std::mutex> lg(this->gp_results_mutex);
 
-            int loop_count = 0;
-            bool drained = false;
-
-            while (loop_count < MAX_LOOPS) {
-                auto load_result
-                    = this->gp_line_buffer.load_next_line(this->gp_pipe_range);
+        results.swap(this->gp_results);
+    }
 
-                if (load_result.isErr()) {
-                    log_error("failed to read from grep_proc child: %s",
-                              load_result.unwrapErr().c_str());
-                    break;
+    auto gen = this->gp_generation;
+    auto finished = false;
+
+    for (auto& res : results) {
+        if (this->gp_sink != nullptr) {
+            for (const auto& line : res.r_matches) {
+                this->gp_sink->grep_match(*this, line);
+                if (gen != this->gp_generation) {
+                    // The sink invalidated this search while handling the
+                    // results.
+                    return;
                 }
+            }
+        }
+        if (res.r_error && this->gp_control != nullptr) {
+            this->gp_control->grep_error(res.r_error.value());
+        }
+        if (res.r_request_done) {
+            require(this->gp_active_requests > 0);
 
-                auto li = load_result.unwrap();
-
-                if (li.li_file_range.empty()) {
-                    drained = true;
-                    break;
+            this->gp_active_requests -= 1;
+            if (this->gp_sink) {
+                this->gp_sink->grep_end(*this);
+                if (gen != this->gp_generation) {
+                    return;
                 }
-
-                this->gp_pipe_range = li.li_file_range;
-                this->gp_line_buffer.read_range(li.li_file_range)
-                    .then([this](auto sbr) {
-                        sbr.rtrim(is_line_ending);
-                        this->dispatch_line(sbr.to_string_fragment());
-                    });
-
-                loop_count += 1;
             }
+        }
+        if (res.r_finished) {
+            finished = true;
+        }
+    }
 
-            if (this->gp_sink != nullptr) {
-                this->gp_sink->grep_end_batch(*this);
-            }
+    if (this->gp_sink != nullptr) {
+        this->gp_sink->grep_end_batch(*this);
+        if (gen != this->gp_generation) {
+            return;
+        }
+    }
 
-            if (drained && this->gp_line_buffer.is_pipe_closed()) {
-                this->cleanup();
-            }
-        } catch (line_buffer::error& e) {
+    if (finished) {
+        this->gp_worker.join();
+        if (this->gp_queue.empty()) {
             this->cleanup();
+        } else {
+            // Requests were queued after the worker ran out of work.
+            this->start_worker();
         }
     }
 
@@ -367,12 +472,9 @@ template<typename LineType>
 void
 grep_proc<LineType>::update_poll_set(std::vector<struct pollfd>& pollfds)
 {
-    if (this->gp_line_buffer.get_fd() != -1) {
+    if (this->gp_running) {
         pollfds.push_back(
-            (struct pollfd) {this->gp_line_buffer.get_fd(), POLLIN, 0});
-    }
-    if (this->gp_err_pipe.get() != -1) {
-        pollfds.push_back((struct pollfd) {this->gp_err_pipe, POLLIN, 0});
+            (struct pollfd) {this->gp_wakeup_pipe.read_end(), POLLIN, 0});
     }
 }
 
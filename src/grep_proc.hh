@@ -32,9 +32,15 @@
 #ifndef grep_proc_hh
 #define grep_proc_hh
 
+#include <atomic>
 #include <deque>
 #include <exception>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <optional>
 #include <string>
+#include <thread>
 #include <vector>
 
 #include <poll.h>
@@ -104,8 +110,6 @@ class grep_proc_sink {
 public:
     virtual ~grep_proc_sink() = default;
 
-    virtual void grep_quiesce() {}
-
     /** Called at the start of a new grep run. */
     virtual void grep_begin(grep_proc<LineType>& gp,
                             LineType start,
@@ -131,11 +135,14 @@ public:
 };
 
 /**
- * "Grep" that runs in a separate process so it doesn't stall user-interaction.
- * This class manages the child process and any interactions between the parent
- * and child.  The source data to be matched comes from the grep_proc_source
- * delegate and the results are sent to the grep_proc_sink delegate in the
- * parent process.
+ * "Grep" that runs in the background so it doesn't stall user-interaction.
+ * The lines to be matched are pulled from the grep_proc_source delegate in
+ * chunks by a worker thread and the regular expression is then run over each
+ * chunk by a pool of matching threads.  Since the source is owned by the main
+ * thread, the worker only reads from it while holding the supervisor's
+ * main_state_lock, which is available while the main thread is waiting for
+ * input.  The results are sent to the grep_proc_sink delegate, in line order,
+ * from the main thread.
  *
  * Note: The "grep" executable is not actually used, instead we use the pcre(3)
  * library directly.
@@ -152,7 +159,7 @@ public:
 
     /**
      * Construct a grep_proc object.  You must call the start() method
-     * to fork off the child process and begin processing.
+     * to begin processing.
      *
      * @param code The pcre code to run over the lines of input.
      * @param gps The source of the data to match.
@@ -178,6 +185,14 @@ public:
     /** @return The sink to send results to. */
     grep_proc_sink<LineType>* get_sink() { return this->gp_sink; }
 
+    /**
+     * @param count The number of threads to use when matching a chunk of
+     * lines or zero to use the number of available CPUs.
+     */
+    grep_proc& set_thread_count(size_t count);
+
+    size_t get_thread_count() const { return this->gp_thread_count; }
+
     /**
      * Queue a request to search the input between the given line numbers.
      *
@@ -216,64 +231,114 @@ public:
     /** Check the invariants for this object. */
     bool invariant()
     {
-        if (this->gp_child_started) {
-            require(this->gp_child > 0);
-            require(this->gp_line_buffer.get_fd() != -1);
+        if (this->gp_running) {
+            require(this->gp_wakeup_pipe.read_end() != -1);
         } else {
-            /* require(this->gp_child == -1); XXX doesnt work with static destr
-             */
-            require(this->gp_line_buffer.get_fd() == -1);
+            require(this->gp_wakeup_pipe.read_end() == -1);
+            require(!this->gp_worker.joinable());
+            require(!this->gp_cursor);
         }
 
         return true;
     }
 
 protected:
-    /**
-     * Dispatch a line received from the child.
-     */
-    void dispatch_line(const string_fragment& line);
+    /** The position of the request that is currently being read. */
+    struct request_cursor {
+        LineType rc_line;
+        LineType rc_stop;
+    };
+
+    /** The indexes of the lines in a chunk that matched a pattern. */
+    struct match_result {
+        std::vector<size_t> mr_indexes;
+        std::optional<std::string> mr_error;
+    };
+
+    /** A batch of line values that are matched by the matching threads. */
+    struct chunk {
+        std::vector<LineType> c_lines;
+        std::vector<std::string> c_values;
+        std::vector<uint32_t> c_options;
+        /** The matches in c_lines, one entry per matching thread. */
+        std::vector<std::future<match_result>> c_matches;
+        /** True if this chunk contains the last line of a request. */
+        bool c_request_done{false};
+        std::optional<std::string> c_error;
+    };
+
+    /** The outcome of a chunk that is waiting to be passed to the sink. */
+    struct result {
+        std::vector<LineType> r_matches;
+        std::optional<std::string> r_error;
+        bool r_request_done{false};
+        /** True if this is the last result from the worker thread. */
+        bool r_finished{false};
+    };
+
+    /** Start the worker thread that reads and matches the requests. */
+    void start_worker();
+
+    /** The body of the worker thread. */
+    void worker_loop();
 
     /**
-     * Free any resources used by the object and make sure the child has been
-     * terminated.
+     * Read the next chunk of line values from the source.  Must be called
+     * with the main_state_lock held.
+     *
+     * @return The chunk or nullptr if there are no more requests.
      */
-    void cleanup();
+    std::unique_ptr<chunk> fill_chunk();
 
-    void child_loop();
+    /** Hand off the chunk to the matching threads. */
+    void dispatch_chunk(chunk& ch);
 
-    virtual void child_init() {};
+    /** Wait for the matches in a chunk and collect them into a result. */
+    result collect_chunk(chunk& ch);
 
-    virtual void child_batch() { fflush(stdout); }
+    /** Queue a result for the main thread and wake it up. */
+    void post_result(result res);
 
-    virtual void child_term() { fflush(stdout); }
+    /**
+     * Free any resources used by the object and stop the search.
+     */
+    void cleanup();
 
     std::shared_ptr<lnav::pcre2pp::code> gp_pcre;
     grep_proc_source<LineType>& gp_source; /*< The data source delegate. */
 
-    auto_fd gp_err_pipe; /*< Standard error from the child. */
-    line_buffer gp_line_buffer; /*< Standard out from the child. */
-    file_range gp_pipe_range;
-
-    pid_t gp_child{-1}; /*<
-                         * The child's pid or zero in the
-                         * child.
-                         */
-    bool gp_child_started{false}; /*< True if the child was start()'d. */
-    size_t gp_child_queue_size{0};
+    /**
+     * A pipe that the worker writes to when there are results for the main
+     * loop to pass on in check_poll_set().
+     */
+    auto_pipe gp_wakeup_pipe;
+    bool gp_running{false};
+    /** Incremented each time the search is stopped. */
+    size_t gp_generation{0};
+    size_t gp_thread_count{0};
+
+    std::thread gp_worker;
+    std::atomic<bool> gp_stop{false};
+    std::mutex gp_results_mutex;
+    /** The results from the worker, guarded by gp_results_mutex. */
+    std::deque<result> gp_results;
+
+    /*
+     * The following are shared with the worker and guarded by the
+     * main_state_lock.
+     */
 
     /** The queue of search requests. */
     std::deque<std::pair<LineType, LineType> > gp_queue;
-    LineType gp_last_line{0}; /*<
-                               * The last line number received from
-                               * the child.  For multiple matches,
-                               * the line number is only sent once.
-                               */
+    /** The number of requests taken off the queue that have not ended. */
+    size_t gp_active_requests{0};
+    std::optional<request_cursor> gp_cursor;
     LineType gp_highest_line; /*< The highest numbered line processed
-                               * by the grep child process.  This
-                               * value is used when the start line
-                               * for a queued request is -1.
+                               * by the search.  This value is used
+                               * when the start line for a queued
+                               * request is -1.
                                */
+
     grep_proc_sink<LineType>* gp_sink{nullptr}; /*< The sink delegate. */
     grep_proc_control* gp_control{nullptr}; /*< The control delegate. */
 };
@@ -97,7 +97,7 @@ highlighter::annotate(attr_line_t& al, int start) const
     const auto sf = string_fragment::from_str_range(
         str, start, std::min(size_t{8192}, str.size()));
 
-    if (!sf.is_valid()) {
+    if (!sf.is_valid() || !this->h_regex->may_match(sf)) {
         return;
     }
 
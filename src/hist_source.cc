@@ -36,10 +36,11 @@
 std::optional<vis_line_t>
 hist_source2::row_for_time(timeval tv_bucket)
 {
+    auto& series = this->current_series();
     int retval = 0;
-    auto time_bucket = rounddown(to_us(tv_bucket), this->hs_time_slice);
+    auto time_bucket = rounddown(to_us(tv_bucket), series.ts_slice);
 
-    for (auto& bb : this->hs_blocks) {
+    for (auto& bb : series.ts_blocks) {
         if (time_bucket < bb.bb_buckets[0].b_time) {
             break;
         }
@@ -122,21 +123,63 @@ hist_source2::add_value(std::chrono::microseconds ts,
 {
     require_ge(ts.count(), this->hs_last_ts.count());
 
-    ts = rounddown(ts, this->hs_time_slice);
-    if (ts != this->hs_last_ts) {
-        this->end_of_row();
+    this->hs_last_ts = ts;
+    for (size_t lpc = 0; lpc < this->hs_series.size(); lpc++) {
+        auto& series = this->hs_series[lpc];
+        auto new_row = series.add_value(ts, htype, value);
 
-        this->hs_current_row += 1;
-        this->hs_last_ts = ts;
+        if (lpc == this->hs_current_series && new_row
+            && series.ts_line_count > 1)
+        {
+            this->add_row_to_chart(series.ts_line_count - 2);
+        }
     }
 
-    auto& bucket = this->find_bucket(this->hs_current_row);
-    bucket.b_time = ts;
-    bucket.b_values[htype].hv_value += value;
-
     this->hs_needs_flush = true;
 }
 
+void
+hist_source2::set_time_slice(std::chrono::microseconds slice)
+{
+    if (slice == this->hs_time_slice) {
+        return;
+    }
+
+    this->hs_time_slice = slice;
+
+    auto found = false;
+    for (size_t lpc = 0; lpc < this->hs_series.size(); lpc++) {
+        if (this->hs_series[lpc].ts_slice == slice) {
+            this->hs_current_series = lpc;
+            found = true;
+            break;
+        }
+    }
+
+    if (!found) {
+        // Aggregate from the coarsest series that evenly divides the new
+        // slice so we touch as few buckets as possible.
+        size_t source_index = 0;
+        for (size_t lpc = 1; lpc < this->hs_series.size(); lpc++) {
+            const auto& series = this->hs_series[lpc];
+
+            if (series.ts_slice < slice
+                && slice % series.ts_slice == std::chrono::microseconds::zero()
+                && series.ts_slice > this->hs_series[source_index].ts_slice)
+            {
+                source_index = lpc;
+            }
+        }
+
+        time_series derived{slice};
+        derived.merge(this->hs_series[source_index]);
+        this->hs_series.emplace_back(std::move(derived));
+        this->hs_current_series = this->hs_series.size() - 1;
+    }
+
+    this->rebuild_chart();
+}
+
 void
 hist_source2::init()
 {
@@ -153,10 +196,14 @@ hist_source2::init()
 void
 hist_source2::clear()
 {
-    this->hs_line_count = 0;
-    this->hs_current_row = -1;
     this->hs_last_ts = std::chrono::microseconds::zero();
-    this->hs_blocks.clear();
+    this->hs_series.clear();
+    this->hs_series.emplace_back(BASE_TIME_SLICE);
+    this->hs_current_series = 0;
+    if (this->hs_time_slice != BASE_TIME_SLICE) {
+        this->hs_series.emplace_back(this->hs_time_slice);
+        this->hs_current_series = 1;
+    }
     this->hs_chart.clear();
     this->init();
 }
@@ -164,21 +211,42 @@ hist_source2::clear()
 void
 hist_source2::end_of_row()
 {
-    if (this->hs_current_row >= 0) {
-        auto& last_bucket = this->find_bucket(this->hs_current_row);
+    const auto line_count = this->current_series().ts_line_count;
 
-        for (size_t lpc = 0; lpc < HT__MAX; lpc++) {
-            this->hs_chart.add_value((const hist_type_t) lpc,
-                                     last_bucket.b_values[lpc].hv_value);
-        }
-        this->hs_chart.next_row();
+    if (line_count > 0) {
+        this->add_row_to_chart(line_count - 1);
+    }
+}
+
+void
+hist_source2::add_row_to_chart(int64_t row)
+{
+    auto& bucket = this->find_bucket(row);
+
+    for (size_t lpc = 0; lpc < HT__MAX; lpc++) {
+        this->hs_chart.add_value((const hist_type_t) lpc,
+                                 bucket.b_values[lpc].hv_value);
     }
+    this->hs_chart.next_row();
+}
+
+void
+hist_source2::rebuild_chart()
+{
+    const auto line_count = this->current_series().ts_line_count;
+
+    this->hs_chart.clear();
+    this->init();
+    for (int64_t row = 0; row < line_count; row++) {
+        this->add_row_to_chart(row);
+    }
+    this->hs_needs_flush = false;
 }
 
 std::optional<text_time_translator::row_info>
 hist_source2::time_for_row(vis_line_t row)
 {
-    if (row < 0 || row > this->hs_line_count) {
+    if (row < 0 || row > this->current_series().ts_line_count) {
         return std::nullopt;
     }
 
@@ -187,16 +255,52 @@ hist_source2::time_for_row(vis_line_t row)
     return row_info{timeval{to_time_t(bucket.b_time), 0}, row};
 }
 
+bool
+hist_source2::time_series::add_value(std::chrono::microseconds ts,
+                                     hist_type_t htype,
+                                     double value)
+{
+    auto retval = false;
+    auto row = this->ts_line_count - 1;
+
+    ts = rounddown(ts, this->ts_slice);
+    if (row < 0 || this->find_bucket(row).b_time != ts) {
+        row += 1;
+        retval = true;
+    }
+
+    auto& bucket = this->find_bucket(row);
+    bucket.b_time = ts;
+    bucket.b_values[htype].hv_value += value;
+
+    return retval;
+}
+
+void
+hist_source2::time_series::merge(const time_series& finer)
+{
+    for (int64_t row = 0; row < finer.ts_line_count; row++) {
+        const auto& bucket = finer.ts_blocks[row / BLOCK_SIZE]
+                                 .bb_buckets[row % BLOCK_SIZE];
+
+        for (size_t lpc = 0; lpc < HT__MAX; lpc++) {
+            this->add_value(bucket.b_time,
+                            (hist_type_t) lpc,
+                            bucket.b_values[lpc].hv_value);
+        }
+    }
+}
+
 hist_source2::bucket_t&
-hist_source2::find_bucket(int64_t index)
+hist_source2::time_series::find_bucket(int64_t index)
 {
     const auto block_index = index / BLOCK_SIZE;
-    if (block_index >= this->hs_blocks.size()) {
-        this->hs_blocks.resize(block_index + 1);
+    if (block_index >= this->ts_blocks.size()) {
+        this->ts_blocks.resize(block_index + 1);
     }
-    auto& bb = this->hs_blocks[block_index];
+    auto& bb = this->ts_blocks[block_index];
     const unsigned int intra_block_index = index % BLOCK_SIZE;
     bb.bb_used = std::max(intra_block_index, bb.bb_used);
-    this->hs_line_count = std::max(this->hs_line_count, index + 1);
+    this->ts_line_count = std::max(this->ts_line_count, index + 1);
     return bb.bb_buckets[intra_block_index];
 }
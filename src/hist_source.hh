@@ -376,17 +376,22 @@ public:
 
     void init();
 
-    void set_time_slice(std::chrono::microseconds slice)
-    {
-        this->hs_time_slice = slice;
-    }
+    /**
+     * Change the width of the buckets that are displayed.  The buckets are
+     * derived from the finer-grained counts that are already collected, so
+     * the log does not need to be indexed again.
+     */
+    void set_time_slice(std::chrono::microseconds slice);
 
     std::chrono::microseconds get_time_slice() const
     {
         return this->hs_time_slice;
     }
 
-    size_t text_line_count() override { return this->hs_line_count; }
+    size_t text_line_count() override
+    {
+        return this->current_series().ts_line_count;
+    }
 
     size_t text_line_width(textview_curses& curses) override
     {
@@ -443,13 +448,57 @@ private:
         bucket_t bb_buckets[BLOCK_SIZE];
     };
 
-    bucket_t& find_bucket(int64_t index);
+    /**
+     * The counts for the log messages bucketed by a particular time slice.
+     * Buckets are only ever appended, so all of the series that have been
+     * requested can be kept up-to-date as new messages are indexed.
+     */
+    struct time_series {
+        explicit time_series(std::chrono::microseconds slice)
+            : ts_slice(slice)
+        {
+        }
+
+        /** @return true if a new bucket was started for the value. */
+        bool add_value(std::chrono::microseconds ts,
+                       hist_type_t htype,
+                       double value);
+
+        /** Add the counts from a finer-grained series to this one. */
+        void merge(const time_series& finer);
+
+        bucket_t& find_bucket(int64_t index);
+
+        std::chrono::microseconds ts_slice;
+        int64_t ts_line_count{0};
+        std::vector<bucket_block> ts_blocks;
+    };
+
+    /**
+     * The width of the buckets in the base series.  Every zoom level is
+     * derived from this series.
+     */
+    static constexpr std::chrono::microseconds BASE_TIME_SLICE
+        = std::chrono::seconds{1};
+
+    time_series& current_series()
+    {
+        return this->hs_series[this->hs_current_series];
+    }
+
+    bucket_t& find_bucket(int64_t index)
+    {
+        return this->current_series().find_bucket(index);
+    }
+
+    void add_row_to_chart(int64_t row);
+
+    void rebuild_chart();
 
-    std::chrono::microseconds hs_time_slice{10 * 60};
-    int64_t hs_line_count;
-    int64_t hs_current_row;
+    std::chrono::microseconds hs_time_slice{BASE_TIME_SLICE};
     std::chrono::microseconds hs_last_ts;
-    std::vector<bucket_block> hs_blocks;
+    std::vector<time_series> hs_series;
+    size_t hs_current_series{0};
     stacked_bar_chart<hist_type_t> hs_chart;
     bool hs_needs_flush{false};
 };
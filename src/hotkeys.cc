@@ -690,19 +690,18 @@ DELETE FROM lnav_user_notifications WHERE id = 'org.lnav.mouse-support'
                 }
 
                 if (log_line_index) {
-                    fmt::memory_buffer linestr;
+                    auto col = log_line_index.value();
                     int line_number = (int) tc->get_selection();
-                    unsigned int row;
-
-                    fmt::format_to(std::back_inserter(linestr),
-                                   FMT_STRING("{}"),
-                                   line_number);
-                    linestr.push_back('\0');
-                    for (row = 0; row < dls.dls_rows.size(); row++) {
-                        if (strcmp(dls.dls_rows[row][log_line_index.value()],
-                                   linestr.data())
-                            == 0)
-                        {
+                    auto linestr = fmt::to_string(line_number);
+                    size_t row;
+
+                    for (row = 0; row < dls.dls_rows.row_count(); row++) {
+                        auto matched = dls.dls_rows.get_type(row, col)
+                                == db_column_store::cell_type::integer
+                            ? dls.dls_rows.get_integer(row, col) == line_number
+                            : dls.get_cell_as_string(row, col) == linestr;
+
+                        if (matched) {
                             vis_line_t db_line(row);
 
                             db_tc->set_selection(db_line);
@@ -723,7 +722,9 @@ DELETE FROM lnav_user_notifications WHERE id = 'org.lnav.mouse-support'
                 if (log_line_index) {
                     unsigned int line_number;
 
-                    if (sscanf(dls.dls_rows[db_row][log_line_index.value()],
+                    if (sscanf(dls.get_cell_as_string(
+                                      db_row, log_line_index.value())
+                                   .c_str(),
                                "%d",
                                &line_number)
                         && line_number < tc->listview_rows(*tc))
@@ -736,8 +737,9 @@ DELETE FROM lnav_user_notifications WHERE id = 'org.lnav.mouse-support'
                         date_time_scanner dts;
                         struct timeval tv;
                         struct exttm tm;
-                        const char* col_value = dls.dls_rows[db_row][lpc];
-                        size_t col_len = strlen(col_value);
+                        auto col_str = dls.get_cell_as_string(db_row, lpc);
+                        const char* col_value = col_str.c_str();
+                        size_t col_len = col_str.length();
 
                         if (dts.scan(col_value, col_len, nullptr, &tm, tv)
                             != nullptr)
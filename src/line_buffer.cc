@@ -29,6 +29,7 @@
  * @file line_buffer.cc
  */
 
+#include <arpa/inet.h>
 #include <errno.h>
 #include <fcntl.h>
 #include <stdio.h>
@@ -42,7 +43,10 @@
 #endif
 
 #include <algorithm>
+#include <atomic>
+#include <filesystem>
 #include <set>
+#include <thread>
 
 #ifdef HAVE_X86INTRIN_H
 #    include "simdutf8check.h"
@@ -133,8 +137,10 @@ private:
 };
 /* XXX END */
 
-#define Z_BUFSIZE      65536U
-#define SYNCPOINT_SIZE (1024 * 1024)
+#define Z_BUFSIZE             65536U
+#define SYNCPOINT_SIZE        (1024 * 1024)
+/* Member starts do not need a dictionary, so they can be closer together. */
+#define MEMBER_SYNCPOINT_SIZE (16 * 1024)
 line_buffer::gz_indexed::gz_indexed()
 {
     if ((this->inbuf = auto_mem<Bytef>::malloc(Z_BUFSIZE)) == nullptr) {
@@ -151,6 +157,8 @@ line_buffer::gz_indexed::close()
         ::close(this->gz_fd);
         this->syncpoints.clear();
         this->gz_fd = -1;
+        this->gz_index_dirty = false;
+        this->gz_total_out = std::nullopt;
     }
 }
 
@@ -164,6 +172,7 @@ line_buffer::gz_indexed::init_stream()
     // initialize inflate struct
     int rc = inflateInit2(&this->strm, GZ_HEADER_MODE);
     this->strm.avail_in = 0;
+    this->gz_raw = false;
     if (rc != Z_OK) {
         throw(rc);  // FIXME: exception wrapper
     }
@@ -178,6 +187,11 @@ line_buffer::gz_indexed::continue_stream()
     auto avail_out = this->strm.avail_out;
     auto next_out = this->strm.next_out;
 
+    if (this->gz_raw) {
+        // A raw stream stops before the member's trailer, so skip over it
+        // to get to the next member.
+        total_in += GZ_TRAILER_SIZE;
+    }
     init_stream();
 
     // Restore position and output buffer
@@ -258,6 +272,8 @@ line_buffer::gz_indexed::open(int fd, lnav::gzip::header& hd)
     } else {
         log_error("%d: unable to get gzip header", fd);
     }
+
+    this->load_index();
 }
 
 int
@@ -284,6 +300,17 @@ line_buffer::gz_indexed::stream_data(void* buf, size_t size)
                 // Reached end of stream; re-init for a possible subsequent
                 // stream
                 continue_stream();
+                if (this->strm.total_in >= last + MEMBER_SYNCPOINT_SIZE) {
+                    // The next member does not depend on any earlier data,
+                    // so it is a syncpoint that does not need a dictionary.
+                    auto& dict = this->syncpoints.emplace_back();
+
+                    dict.in = this->strm.total_in;
+                    dict.out = this->strm.total_out;
+                    dict.member_start = true;
+                    last = dict.in;
+                    this->gz_index_dirty = true;
+                }
             } else if (err != Z_OK) {
                 log_error(" inflate-error at %d: %d  %s",
                           this->strm.total_in,
@@ -298,12 +325,20 @@ line_buffer::gz_indexed::stream_data(void* buf, size_t size)
                 && !(this->strm.data_type & GZ_END_OF_FILE_MASK))
             {
                 this->syncpoints.emplace_back(this->strm, size);
-                last = this->strm.total_out;
+                last = this->strm.total_in;
+                this->gz_index_dirty = true;
             }
         } else if (this->strm.avail_out) {
             // Processed all the gz file data but didn't fill
             // the output buffer.  We're done, even though we
             // produced fewer bytes than requested.
+            if (!this->gz_total_out) {
+                this->gz_total_out = this->strm.total_out;
+                this->gz_index_dirty = true;
+            }
+            if (this->gz_index_dirty) {
+                this->save_index();
+            }
             break;
         }
     }
@@ -319,13 +354,13 @@ line_buffer::gz_indexed::seek(off_t offset)
 
     indexDict* dict = nullptr;
     // Find highest syncpoint not past offset
-    // FIXME: Make this a binary-tree search
-    for (auto& d : this->syncpoints) {
-        if (d.out <= offset) {
-            dict = &d;
-        } else {
-            break;
-        }
+    auto dict_iter = std::upper_bound(
+        this->syncpoints.begin(),
+        this->syncpoints.end(),
+        offset,
+        [](off_t off, const indexDict& d) { return off < d.out; });
+    if (dict_iter != this->syncpoints.begin()) {
+        dict = &*std::prev(dict_iter);
     }
 
     // Choose highest available syncpoint, or keep current offset if it's ok
@@ -336,6 +371,7 @@ line_buffer::gz_indexed::seek(off_t offset)
         inflateEnd(&this->strm);
         if (dict) {
             dict->apply(&this->strm);
+            this->gz_raw = !dict->member_start;
         } else {
             init_stream();
         }
@@ -367,6 +403,329 @@ line_buffer::gz_indexed::read(void* buf, size_t offset, size_t size)
     return bytes;
 }
 
+/**
+ * Decompress the data between a syncpoint and the given offset in the
+ * decompressed stream and write it to the same offset in out_fd.
+ *
+ * @param start The syncpoint to start at or nullptr for the start of the file.
+ */
+static bool
+inflate_segment(int gz_fd,
+                const line_buffer::gz_indexed::indexDict* start,
+                off_t end_out,
+                int out_fd)
+{
+    static constexpr size_t OUT_BUFSIZE = 1024 * 1024;
+
+    z_stream strm{};
+    off_t in_off = 0;
+    off_t out_off = 0;
+    auto raw = start != nullptr && !start->member_start;
+    int rc;
+
+    if (start == nullptr) {
+        rc = inflateInit2(&strm, GZ_HEADER_MODE);
+    } else {
+        rc = start->apply(&strm);
+        in_off = start->in;
+        out_off = start->out;
+    }
+    if (rc != Z_OK) {
+        return false;
+    }
+
+    std::vector<Bytef> in_buf(Z_BUFSIZE);
+    std::vector<Bytef> out_buf(OUT_BUFSIZE);
+    auto retval = true;
+    while (out_off < end_out) {
+        if (strm.avail_in == 0) {
+            auto nread = pread(gz_fd, in_buf.data(), in_buf.size(), in_off);
+            if (nread <= 0) {
+                retval = false;
+                break;
+            }
+            in_off += nread;
+            strm.next_in = in_buf.data();
+            strm.avail_in = nread;
+        }
+
+        strm.next_out = out_buf.data();
+        strm.avail_out
+            = std::min(static_cast<off_t>(out_buf.size()), end_out - out_off);
+        auto err = inflate(&strm, Z_NO_FLUSH);
+        auto produced = strm.next_out - out_buf.data();
+        if (produced > 0
+            && pwrite(out_fd, out_buf.data(), produced, out_off) != produced)
+        {
+            retval = false;
+            break;
+        }
+        out_off += produced;
+
+        if (err == Z_STREAM_END) {
+            // The next member starts right after this one.
+            auto* next_in = strm.next_in;
+            auto avail_in = strm.avail_in;
+
+            if (raw) {
+                // A raw stream stops before the member's trailer.
+                auto skip = std::min(avail_in, GZ_TRAILER_SIZE);
+
+                next_in += skip;
+                avail_in -= skip;
+                in_off += GZ_TRAILER_SIZE - skip;
+                raw = false;
+            }
+            inflateEnd(&strm);
+            if (inflateInit2(&strm, GZ_HEADER_MODE) != Z_OK) {
+                return false;
+            }
+            strm.next_in = next_in;
+            strm.avail_in = avail_in;
+        } else if (err != Z_OK && err != Z_BUF_ERROR) {
+            log_error("inflate-error at %lld: %d  %s",
+                      (long long) in_off,
+                      err,
+                      strm.msg ? strm.msg : "");
+            retval = false;
+            break;
+        }
+    }
+    inflateEnd(&strm);
+
+    return retval;
+}
+
+bool
+line_buffer::gz_indexed::inflate_to(int out_fd)
+{
+    struct stat st;
+
+    if (!*this || !this->gz_total_out || this->syncpoints.empty()
+        || fstat(this->gz_fd, &st) == -1
+        || st.st_size != this->gz_stat.st_size
+        || st.st_mtime != this->gz_stat.st_mtime)
+    {
+        return false;
+    }
+
+    auto total_out = static_cast<off_t>(this->gz_total_out.value());
+    auto segment_count = this->syncpoints.size() + 1;
+    size_t thread_count = std::max(1U, std::thread::hardware_concurrency());
+    thread_count = std::min(thread_count, segment_count);
+
+    log_info("%d: decompressing %zu segments using %zu threads",
+             this->gz_fd,
+             segment_count,
+             thread_count);
+
+    std::atomic<size_t> next_segment{0};
+    std::atomic<bool> failed{false};
+    std::vector<std::future<void>> workers;
+    for (size_t lpc = 0; lpc < thread_count; lpc++) {
+        workers.emplace_back(std::async(
+            std::launch::async,
+            [this, &next_segment, &failed, segment_count, total_out, out_fd]() {
+                while (!failed) {
+                    auto index = next_segment.fetch_add(1);
+                    if (index >= segment_count) {
+                        break;
+                    }
+
+                    const auto* start
+                        = index == 0 ? nullptr : &this->syncpoints[index - 1];
+                    auto end_out = index < this->syncpoints.size()
+                        ? this->syncpoints[index].out
+                        : total_out;
+                    if (start != nullptr && start->out >= end_out) {
+                        continue;
+                    }
+                    if (!inflate_segment(this->gz_fd, start, end_out, out_fd))
+                    {
+                        failed = true;
+                    }
+                }
+            }));
+    }
+    for (auto& worker : workers) {
+        worker.get();
+    }
+
+    return !failed;
+}
+
+static std::filesystem::path
+gz_index_cache_path()
+{
+    return lnav::paths::workdir() / "gz-index";
+}
+
+static std::filesystem::path
+gz_index_path(const struct stat& st)
+{
+    auto base_name = hasher().update(st.st_dev).update(st.st_ino).to_string();
+
+    return gz_index_cache_path() / base_name.substr(0, 2)
+        / fmt::format(FMT_STRING("{}.idx"), base_name);
+}
+
+namespace {
+
+/**
+ * The header for the file that holds the syncpoints of a gzip file.  The
+ * entries follow the header, each one is an index_entry followed by the
+ * dictionary, if there is one.
+ */
+struct gz_index_header {
+    static constexpr char MAGIC[8] = {'l', 'n', 'a', 'v', 'g', 'z', 'x', '\0'};
+    static constexpr uint32_t FORMAT_VERSION = 1;
+
+    char h_magic[8];
+    uint32_t h_version{FORMAT_VERSION};
+    uint32_t h_count{0};
+    uint64_t h_dev{0};
+    uint64_t h_ino{0};
+    int64_t h_size{0};
+    int64_t h_mtime{0};
+    /** The size of the decompressed data or -1 if it is not known. */
+    int64_t h_total_out{-1};
+};
+
+struct gz_index_entry {
+    int64_t e_in{0};
+    int64_t e_out{0};
+    uint8_t e_bits{0};
+    uint8_t e_in_bits{0};
+    uint8_t e_member_start{0};
+    uint8_t e_padding{0};
+    uint32_t e_dict_size{0};
+};
+
+}  // namespace
+
+void
+line_buffer::gz_indexed::load_index()
+{
+    if (fstat(this->gz_fd, &this->gz_stat) == -1) {
+        return;
+    }
+
+    auto index_path = gz_index_path(this->gz_stat);
+    auto read_res = lnav::filesystem::read_file(index_path);
+    if (read_res.isErr()) {
+        return;
+    }
+
+    auto content = read_res.unwrap();
+    gz_index_header hdr;
+    if (content.size() < sizeof(hdr)) {
+        return;
+    }
+    memcpy(&hdr, content.data(), sizeof(hdr));
+    if (memcmp(hdr.h_magic, gz_index_header::MAGIC, sizeof(hdr.h_magic)) != 0
+        || hdr.h_version != gz_index_header::FORMAT_VERSION
+        || hdr.h_dev != (uint64_t) this->gz_stat.st_dev
+        || hdr.h_ino != (uint64_t) this->gz_stat.st_ino
+        || hdr.h_size != this->gz_stat.st_size
+        || hdr.h_mtime != this->gz_stat.st_mtime)
+    {
+        log_info("%d: gzip index is stale -- %s",
+                 this->gz_fd,
+                 index_path.c_str());
+        return;
+    }
+
+    std::vector<indexDict> syncpoints;
+    size_t offset = sizeof(hdr);
+    syncpoints.reserve(hdr.h_count);
+    for (uint32_t lpc = 0; lpc < hdr.h_count; lpc++) {
+        gz_index_entry entry;
+
+        if (offset + sizeof(entry) > content.size()) {
+            return;
+        }
+        memcpy(&entry, content.data() + offset, sizeof(entry));
+        offset += sizeof(entry);
+        if (offset + entry.e_dict_size > content.size()
+            || (!entry.e_member_start && entry.e_dict_size != GZ_WINSIZE))
+        {
+            return;
+        }
+
+        auto& dict = syncpoints.emplace_back();
+        dict.in = entry.e_in;
+        dict.out = entry.e_out;
+        dict.bits = entry.e_bits;
+        dict.in_bits = entry.e_in_bits;
+        dict.member_start = entry.e_member_start;
+        dict.index.assign(content.data() + offset,
+                          content.data() + offset + entry.e_dict_size);
+        offset += entry.e_dict_size;
+    }
+
+    log_info("%d: loaded %zu syncpoints from gzip index -- %s",
+             this->gz_fd,
+             syncpoints.size(),
+             index_path.c_str());
+    this->syncpoints = std::move(syncpoints);
+    if (hdr.h_total_out >= 0) {
+        this->gz_total_out = hdr.h_total_out;
+    }
+}
+
+void
+line_buffer::gz_indexed::save_index()
+{
+    if (this->gz_index_future.valid()
+        && this->gz_index_future.wait_for(std::chrono::seconds(0))
+            != std::future_status::ready)
+    {
+        // The previous index is still being written, the index stays dirty
+        // so the next pass can save it.
+        return;
+    }
+
+    gz_index_header hdr;
+    std::string content;
+
+    memcpy(hdr.h_magic, gz_index_header::MAGIC, sizeof(hdr.h_magic));
+    hdr.h_count = this->syncpoints.size();
+    hdr.h_dev = this->gz_stat.st_dev;
+    hdr.h_ino = this->gz_stat.st_ino;
+    hdr.h_size = this->gz_stat.st_size;
+    hdr.h_mtime = this->gz_stat.st_mtime;
+    hdr.h_total_out = this->gz_total_out.value_or(-1);
+    content.append((const char*) &hdr, sizeof(hdr));
+    for (const auto& dict : this->syncpoints) {
+        gz_index_entry entry;
+
+        entry.e_in = dict.in;
+        entry.e_out = dict.out;
+        entry.e_bits = dict.bits;
+        entry.e_in_bits = dict.in_bits;
+        entry.e_member_start = dict.member_start;
+        entry.e_dict_size = dict.index.size();
+        content.append((const char*) &entry, sizeof(entry));
+        content.append((const char*) dict.index.data(), dict.index.size());
+    }
+
+    this->gz_index_dirty = false;
+    this->gz_index_future = std::async(
+        std::launch::async,
+        [index_path = gz_index_path(this->gz_stat),
+         content = std::move(content)]() {
+            std::error_code ec;
+            std::filesystem::create_directories(index_path.parent_path(), ec);
+            auto write_res = lnav::filesystem::write_file(
+                index_path, string_fragment::from_str(content));
+            if (write_res.isErr()) {
+                log_error("unable to write gzip index -- %s: %s",
+                          index_path.c_str(),
+                          write_res.unwrapErr().c_str());
+            }
+        });
+}
+
 line_buffer::line_buffer()
 {
     ensure(this->invariant());
@@ -385,6 +744,119 @@ line_buffer::~line_buffer()
     this->set_fd(empty_fd);
 }
 
+void
+line_buffer::set_piper_header(auto_buffer& meta_buf)
+{
+    static intern_string_t SRC = intern_string::lookup("piper");
+
+    auto meta_sf = string_fragment::from_bytes(meta_buf.in(), meta_buf.size());
+    auto meta_parse_res
+        = lnav::piper::header_handlers.parser_for(SRC).of(meta_sf);
+    if (meta_parse_res.isErr()) {
+        log_error(
+            "failed to parse piper header: %s",
+            meta_parse_res.unwrapErr()[0].to_attr_line().get_string().c_str());
+        throw error(EINVAL);
+    }
+
+    auto hdr = meta_parse_res.unwrap();
+
+    this->lb_line_metadata = true;
+    this->lb_line_meta_prefix_size = hdr.h_line_meta.empty()
+        ? lnav::piper::TEXT_LINE_META_SIZE
+        : 0;
+    this->lb_file_offset = lnav::piper::HEADER_SIZE + meta_buf.size();
+    this->lb_piper_header_size = this->lb_file_offset;
+    this->lb_header = std::move(hdr);
+}
+
+void
+line_buffer::set_line_meta_fd(auto_fd fd)
+{
+    this->lb_line_meta_fd = std::move(fd);
+    this->lb_line_metas.clear();
+    this->lb_line_metas_index = 0;
+}
+
+std::optional<lnav::piper::line_meta>
+line_buffer::find_line_meta(file_off_t off)
+{
+    static constexpr size_t BATCH_SIZE = 4096;
+
+    auto& metas = this->lb_line_metas;
+    auto in_batch = [&metas, off]() {
+        return !metas.empty() && (file_off_t) metas.front().lm_offset <= off
+            && off <= (file_off_t) metas.back().lm_offset;
+    };
+
+    if (!in_batch()) {
+        struct stat st;
+
+        if (fstat(this->lb_line_meta_fd, &st) == -1) {
+            return std::nullopt;
+        }
+
+        // Binary search the file for the record and then read in a batch
+        // starting from there since the lines are usually read in order.
+        size_t low = 0;
+        size_t high = st.st_size / sizeof(lnav::piper::line_meta);
+        while (low < high) {
+            auto mid = low + (high - low) / 2;
+            lnav::piper::line_meta lm;
+
+            if (pread(this->lb_line_meta_fd, &lm, sizeof(lm), mid * sizeof(lm))
+                != sizeof(lm))
+            {
+                return std::nullopt;
+            }
+            if ((file_off_t) lm.lm_offset < off) {
+                low = mid + 1;
+            } else {
+                high = mid;
+            }
+        }
+
+        metas.resize(BATCH_SIZE);
+        auto rc = pread(this->lb_line_meta_fd,
+                        metas.data(),
+                        BATCH_SIZE * sizeof(lnav::piper::line_meta),
+                        low * sizeof(lnav::piper::line_meta));
+        metas.resize(std::max(rc, (ssize_t) 0)
+                     / sizeof(lnav::piper::line_meta));
+        this->lb_line_metas_index = 0;
+        if (!in_batch()) {
+            metas.clear();
+            return std::nullopt;
+        }
+    }
+
+    if (this->lb_line_metas_index >= metas.size()
+        || (file_off_t) metas[this->lb_line_metas_index].lm_offset != off)
+    {
+        auto iter = std::lower_bound(
+            metas.begin(),
+            metas.end(),
+            off,
+            [](const lnav::piper::line_meta& lm, file_off_t off) {
+                return (file_off_t) lm.lm_offset < off;
+            });
+        if (iter == metas.end() || (file_off_t) iter->lm_offset != off) {
+            return std::nullopt;
+        }
+        this->lb_line_metas_index = std::distance(metas.begin(), iter);
+    }
+
+    auto retval = metas[this->lb_line_metas_index];
+    // The last record might be rewritten if it was for a partial line, so
+    // it is not kept around.
+    if (this->lb_line_metas_index + 1 == metas.size()) {
+        metas.clear();
+    } else {
+        this->lb_line_metas_index += 1;
+    }
+    return retval;
+}
+
 void
 line_buffer::set_fd(auto_fd& fd)
 {
@@ -398,6 +870,14 @@ line_buffer::set_fd(auto_fd& fd)
         }
     }
 
+    {
+        safe::WriteAccess<safe_zstd_reader> zr(this->lb_zstd_file);
+
+        if (*zr) {
+            zr->close();
+        }
+    }
+
     if (this->lb_bz_file) {
         this->lb_bz_file = false;
     }
@@ -420,29 +900,7 @@ line_buffer::set_fd(auto_fd& fd)
                 auto piper_hdr_opt = lnav::piper::read_header(fd, gz_id);
 
                 if (piper_hdr_opt) {
-                    static intern_string_t SRC = intern_string::lookup("piper");
-
-                    auto meta_buf = std::move(piper_hdr_opt.value());
-
-                    auto meta_sf = string_fragment::from_bytes(meta_buf.in(),
-                                                               meta_buf.size());
-                    auto meta_parse_res
-                        = lnav::piper::header_handlers.parser_for(SRC).of(
-                            meta_sf);
-                    if (meta_parse_res.isErr()) {
-                        log_error("failed to parse piper header: %s",
-                                  meta_parse_res.unwrapErr()[0]
-                                      .to_attr_line()
-                                      .get_string()
-                                      .c_str());
-                        throw error(EINVAL);
-                    }
-
-                    this->lb_line_metadata = true;
-                    this->lb_file_offset
-                        = lnav::piper::HEADER_SIZE + meta_buf.size();
-                    this->lb_piper_header_size = this->lb_file_offset;
-                    this->lb_header = meta_parse_res.unwrap();
+                    this->set_piper_header(piper_hdr_opt.value());
                 } else if (gz_id[0] == '\037' && gz_id[1] == '\213') {
                     int gzfd = dup(fd);
 
@@ -455,13 +913,46 @@ line_buffer::set_fd(auto_fd& fd)
 
                     this->lb_gz_file.writeAccess()->open(gzfd, hdr);
                     this->lb_compressed = true;
+                    {
+                        // Rotated piper captures are compressed along with
+                        // their header.
+                        safe::WriteAccess<safe_gz_indexed> gi(
+                            this->lb_gz_file);
+                        char piper_id[lnav::piper::HEADER_SIZE];
+
+                        if (gi->read(piper_id, 0, sizeof(piper_id))
+                                == sizeof(piper_id)
+                            && memcmp(piper_id,
+                                      lnav::piper::HEADER_MAGIC,
+                                      sizeof(lnav::piper::HEADER_MAGIC))
+                                == 0)
+                        {
+                            uint32_t meta_size;
+
+                            memcpy(&meta_size,
+                                   &piper_id[sizeof(lnav::piper::HEADER_MAGIC)],
+                                   sizeof(meta_size));
+                            meta_size = ntohl(meta_size);
+                            auto meta_buf = auto_buffer::alloc(meta_size);
+                            if (gi->read(meta_buf.in(),
+                                         lnav::piper::HEADER_SIZE,
+                                         meta_size)
+                                != (int) meta_size)
+                            {
+                                log_error("failed to read piper header");
+                                throw error(EINVAL);
+                            }
+                            meta_buf.resize(meta_size);
+                            this->set_piper_header(meta_buf);
+                        }
+                    }
                     this->lb_file_time = hdr.h_mtime.tv_sec;
                     if (this->lb_file_time < 0) {
                         this->lb_file_time = 0;
                     }
                     this->lb_compressed_offset
                         = lseek(this->lb_fd, 0, SEEK_CUR);
-                    if (!hdr.empty()) {
+                    if (!hdr.empty() && !this->is_piper()) {
                         this->lb_header = std::move(hdr);
                     }
                     this->resize_buffer(INITIAL_COMPRESSED_BUFFER_SIZE);
@@ -483,6 +974,18 @@ line_buffer::set_fd(auto_fd& fd)
 
                     this->lb_compressed_offset = 0;
                 }
+#endif
+#ifdef HAVE_ZSTD_H
+                else if (lnav::zstd::is_zstd(gz_id, sizeof(gz_id)))
+                {
+                    auto_fd zstdfd(dup(fd));
+
+                    log_perror(fcntl(zstdfd, F_SETFD, FD_CLOEXEC));
+                    this->lb_zstd_file.writeAccess()->open(std::move(zstdfd));
+                    this->lb_compressed = true;
+                    this->lb_compressed_offset = 0;
+                    this->resize_buffer(INITIAL_COMPRESSED_BUFFER_SIZE);
+                }
 #endif
             }
             this->lb_seekable = true;
@@ -582,8 +1085,7 @@ line_buffer::ensure_available(file_off_t start, ssize_t max_length)
             this->resize_buffer(roundup_size(max_length, DEFAULT_INCREMENT));
         }
     }
-    this->lb_line_starts.clear();
-    this->lb_line_is_utf.clear();
+    this->lb_lines.clear();
 }
 
 bool
@@ -594,6 +1096,7 @@ line_buffer::load_next_buffer()
     auto start = this->lb_loader_file_offset.value();
     ssize_t rc = 0;
     safe::WriteAccess<safe_gz_indexed> gi(this->lb_gz_file);
+    safe::WriteAccess<safe_zstd_reader> zr(this->lb_zstd_file);
 
     // log_debug("BEGIN preload read");
     /* ... read in the new data. */
@@ -622,6 +1125,24 @@ line_buffer::load_next_buffer()
                       this->lb_alt_buffer->capacity());
 #endif
         }
+    } else if (!this->lb_cached_fd && *zr) {
+        if (this->lb_file_size != (ssize_t) -1 && this->in_range(start)
+            && this->in_range(this->lb_file_size - 1))
+        {
+            rc = 0;
+        } else {
+            rc = zr->read(this->lb_alt_buffer.value().end(),
+                          start + this->lb_alt_buffer.value().size(),
+                          this->lb_alt_buffer.value().available());
+            this->lb_compressed_offset = zr->get_source_offset();
+            if (rc != -1 && (rc < this->lb_alt_buffer.value().available())
+                && (start + this->lb_alt_buffer.value().size() + rc
+                    > this->lb_file_size))
+            {
+                this->lb_file_size
+                    = (start + this->lb_alt_buffer.value().size() + rc);
+            }
+        }
     }
 #ifdef HAVE_BZLIB_H
     else if (!this->lb_cached_fd && this->lb_bz_file)
@@ -731,21 +1252,10 @@ line_buffer::load_next_buffer()
     // log_debug("END preload read");
 
     if (start > this->lb_last_line_offset) {
-        const auto* line_start = this->lb_alt_buffer.value().begin();
-
-        do {
-            auto before = line_start - this->lb_alt_buffer->begin();
-            auto remaining = this->lb_alt_buffer.value().size() - before;
-            auto frag = string_fragment::from_bytes(line_start, remaining);
-            auto utf_scan_res = is_utf8(frag, '\n');
-            auto lf = utf_scan_res.remaining_ptr(frag);
-            this->lb_alt_line_starts.emplace_back(before);
-            this->lb_alt_line_is_utf.emplace_back(utf_scan_res.is_valid());
-            this->lb_alt_line_has_ansi.emplace_back(utf_scan_res.usr_has_ansi);
-
-            line_start = lf;
-        } while (line_start != nullptr
-                 && line_start < this->lb_alt_buffer->end());
+        is_utf8_lines(
+            string_fragment::from_bytes(this->lb_alt_buffer->begin(),
+                                        this->lb_alt_buffer->size()),
+            this->lb_alt_lines);
     }
 
     return retval;
@@ -794,12 +1304,8 @@ line_buffer::fill_range(file_off_t start, ssize_t max_length)
         this->lb_loader_file_offset = std::nullopt;
         this->lb_buffer.swap(this->lb_alt_buffer.value());
         this->lb_alt_buffer.value().clear();
-        this->lb_line_starts = std::move(this->lb_alt_line_starts);
-        this->lb_alt_line_starts.clear();
-        this->lb_line_is_utf = std::move(this->lb_alt_line_is_utf);
-        this->lb_alt_line_is_utf.clear();
-        this->lb_line_has_ansi = std::move(this->lb_alt_line_has_ansi);
-        this->lb_alt_line_has_ansi.clear();
+        this->lb_lines = std::move(this->lb_alt_lines);
+        this->lb_alt_lines.clear();
         this->lb_stats.s_used_preloads += 1;
         this->lb_next_line_start_index = 0;
         this->lb_next_buffer_offset = 0;
@@ -852,6 +1358,7 @@ line_buffer::fill_range(file_off_t start, ssize_t max_length)
         this->ensure_available(start, max_length);
 
         safe::WriteAccess<safe_gz_indexed> gi(this->lb_gz_file);
+        safe::WriteAccess<safe_zstd_reader> zr(this->lb_zstd_file);
 
         /* ... read in the new data. */
         if (!this->lb_cached_fd && *gi) {
@@ -882,6 +1389,22 @@ line_buffer::fill_range(file_off_t start, ssize_t max_length)
                       rc,
                       this->lb_buffer.capacity());
 #endif
+        } else if (!this->lb_cached_fd && *zr) {
+            if (this->lb_file_size != (ssize_t) -1 && this->in_range(start)
+                && this->in_range(this->lb_file_size - 1))
+            {
+                rc = 0;
+            } else {
+                this->lb_stats.s_decompressions += 1;
+                rc = zr->read(this->lb_buffer.end(),
+                              this->lb_file_offset + this->lb_buffer.size(),
+                              this->lb_buffer.available());
+                this->lb_compressed_offset = zr->get_source_offset();
+                if (rc != -1 && (rc < this->lb_buffer.available())) {
+                    this->lb_file_size
+                        = (this->lb_file_offset + this->lb_buffer.size() + rc);
+                }
+            }
         }
 #ifdef HAVE_BZLIB_H
         else if (!this->lb_cached_fd && this->lb_bz_file)
@@ -1110,47 +1633,40 @@ line_buffer::load_next_line(file_range prev_line)
         ssize_t utf8_end = -1;
 
         bool found_in_cache = false;
-        if (!this->lb_line_starts.empty()) {
+        if (!this->lb_lines.empty()) {
+            const auto& starts = this->lb_lines.ulb_starts;
             auto buffer_offset = offset - this->lb_file_offset;
+            auto start_iter = starts.end();
 
-            if (this->lb_next_buffer_offset == buffer_offset) {
-                auto start_iter = this->lb_line_starts.begin()
-                    + this->lb_next_line_start_index;
-                auto next_line_iter = start_iter + 1;
-                if (next_line_iter != this->lb_line_starts.end()) {
-                    utf8_end = *next_line_iter - 1 - *start_iter;
-                    found_in_cache = true;
-                    lf = line_start + utf8_end;
-
-                    this->lb_next_buffer_offset = *next_line_iter;
-                    this->lb_next_line_start_index += 1;
-                } else {
-                    // log_debug("no next iter");
-                }
+            if (this->lb_next_buffer_offset == buffer_offset
+                && this->lb_next_line_start_index < starts.size())
+            {
+                start_iter = starts.begin() + this->lb_next_line_start_index;
             } else {
-                auto start_iter = std::lower_bound(this->lb_line_starts.begin(),
-                                                   this->lb_line_starts.end(),
-                                                   buffer_offset);
-                if (start_iter != this->lb_line_starts.end()) {
-                    auto next_line_iter = start_iter + 1;
-
-                    // log_debug("found offset %d %d", buffer_offset,
-                    // *start_iter);
-                    if (next_line_iter != this->lb_line_starts.end()) {
-                        utf8_end = *next_line_iter - 1 - *start_iter;
-                        found_in_cache = true;
-                        lf = line_start + utf8_end;
-
-                        this->lb_next_line_start_index = std::distance(
-                            this->lb_alt_line_starts.begin(), next_line_iter);
-                        this->lb_next_buffer_offset = *next_line_iter;
-                    } else {
-                        // log_debug("no next iter");
-                    }
-                } else {
+                start_iter = std::lower_bound(
+                    starts.begin(), starts.end(), buffer_offset);
+                if (start_iter != starts.end() && *start_iter != buffer_offset)
+                {
                     // log_debug("no buffer_offset found");
+                    start_iter = starts.end();
                 }
             }
+            if (start_iter != starts.end() && start_iter + 1 != starts.end()) {
+                auto next_line_iter = start_iter + 1;
+                auto line_index = std::distance(starts.begin(), start_iter);
+
+                utf8_end = *next_line_iter - 1 - *start_iter;
+                found_in_cache = true;
+                lf = line_start + utf8_end;
+                retval.li_utf8_scan_result = this->lb_lines.to_scan_result(
+                    line_index,
+                    string_fragment::from_bytes(line_start,
+                                                retval.li_file_range.fr_size),
+                    utf8_end);
+
+                this->lb_next_line_start_index = line_index + 1;
+                this->lb_next_buffer_offset = *next_line_iter;
+            }
         }
 
         if (!found_in_cache) {
@@ -1255,7 +1771,19 @@ line_buffer::load_next_line(file_range prev_line)
     retval.li_file_range.fr_metadata.m_valid_utf
         = retval.li_utf8_scan_result.is_valid();
 
-    if (this->lb_line_metadata) {
+    if (this->lb_line_meta_fd.has_value()) {
+        auto lm_opt = this->find_line_meta(retval.li_file_range.fr_offset);
+        if (lm_opt) {
+            retval.li_timestamp.tv_sec = lm_opt->lm_usecs / 1000000;
+            retval.li_timestamp.tv_usec = lm_opt->lm_usecs % 1000000;
+            retval.li_timestamp.tv_sec
+                = lnav::to_local_time(date::sys_seconds{std::chrono::seconds{
+                                          retval.li_timestamp.tv_sec}})
+                      .time_since_epoch()
+                      .count();
+            retval.li_level = (log_level_t) lm_opt->lm_level;
+        }
+    } else if (this->lb_line_meta_prefix_size > 0) {
         auto sv = std::string_view{
             line_start,
             (size_t) retval.li_file_range.fr_size,
@@ -1314,7 +1842,7 @@ line_buffer::read_range(file_range fr)
         return Err(fmt::format(
             FMT_STRING("short-read (need: {}; avail: {})"), fr.fr_size, avail));
     }
-    if (this->lb_line_metadata) {
+    if (this->lb_line_meta_prefix_size > 0) {
         auto new_start
             = static_cast<const char*>(memchr(line_start, ';', fr.fr_size));
         if (new_start) {
@@ -1349,18 +1877,19 @@ line_buffer::gz_indexed::indexDict::indexDict(const z_stream& s,
     this->in_bits = last_byte_in >> (8 - this->bits);
     // Copy the last 32k uncompressed data (sliding window) to our
     // index
-    memcpy(this->index, s.next_out - GZ_WINSIZE, GZ_WINSIZE);
+    this->index.assign(s.next_out - GZ_WINSIZE, s.next_out);
 }
 
 int
-line_buffer::gz_indexed::indexDict::apply(z_streamp s)
+line_buffer::gz_indexed::indexDict::apply(z_streamp s) const
 {
     s->zalloc = Z_NULL;
     s->zfree = Z_NULL;
     s->opaque = Z_NULL;
     s->avail_in = 0;
     s->next_in = Z_NULL;
-    auto ret = inflateInit2(s, GZ_RAW_MODE);
+    auto ret
+        = inflateInit2(s, this->member_start ? GZ_HEADER_MODE : GZ_RAW_MODE);
     if (ret != Z_OK) {
         return ret;
     }
@@ -1369,7 +1898,9 @@ line_buffer::gz_indexed::indexDict::apply(z_streamp s)
     }
     s->total_in = this->in;
     s->total_out = this->out;
-    inflateSetDictionary(s, this->index, GZ_WINSIZE);
+    if (!this->member_start) {
+        inflateSetDictionary(s, this->index.data(), this->index.size());
+    }
     return ret;
 }
 
@@ -1429,7 +1960,8 @@ line_buffer::enable_cache()
                                 .to_string();
     auto cache_dir = line_buffer_cache_path() / cached_base_name.substr(0, 2);
 
-    std::filesystem::create_directories(cache_dir);
+    std::error_code ec;
+    std::filesystem::create_directories(cache_dir, ec);
 
     auto cached_file_name = fmt::format(FMT_STRING("{}.bin"), cached_base_name);
     auto cached_file_path = cache_dir / cached_file_name;
@@ -1462,6 +1994,39 @@ line_buffer::enable_cache()
     }
 
     auto write_fd = create_res.unwrap();
+
+    {
+        safe::WriteAccess<safe_gz_indexed> gi(this->lb_gz_file);
+
+        if (*gi && gi->inflate_to(write_fd)) {
+            log_info("%d: cached file content using the gzip index",
+                     this->lb_fd.get());
+            lnav::filesystem::create_file(cached_done_path, O_WRONLY, 0600);
+            this->lb_cached_fd = std::move(write_fd);
+            return;
+        }
+    }
+    if (this->lb_zstd_file.readAccess()->operator bool()) {
+        auto decomp_res = lnav::zstd::decompress_to(this->lb_fd, write_fd);
+        if (decomp_res.isOk()) {
+            log_info("%d: cached %llu bytes of zstd file content",
+                     this->lb_fd.get(),
+                     (unsigned long long) decomp_res.unwrap());
+            lnav::filesystem::create_file(cached_done_path, O_WRONLY, 0600);
+            this->lb_cached_fd = std::move(write_fd);
+            return;
+        }
+        log_error("%d: unable to decompress zstd file -- %s",
+                  this->lb_fd.get(),
+                  decomp_res.unwrapErr().c_str());
+    }
+    if (ftruncate(write_fd, 0) == -1) {
+        log_error("%d: unable to truncate cache file -- %s",
+                  this->lb_fd.get(),
+                  strerror(errno));
+        return;
+    }
+
     auto done = false;
 
     static constexpr ssize_t FILL_LENGTH = 1024 * 1024;
@@ -1495,23 +2060,30 @@ line_buffer::cleanup_cache()
 {
     (void) std::async(std::launch::async, []() {
         auto now = std::filesystem::file_time_type::clock::now();
-        auto cache_path = line_buffer_cache_path();
+        const std::pair<std::filesystem::path, std::chrono::hours>
+            cache_paths[] = {
+                {line_buffer_cache_path(), 1h},
+                // The gzip indexes are small and save a lot of work.
+                {gz_index_cache_path(), 7 * 24h},
+            };
         std::vector<std::filesystem::path> to_remove;
         std::error_code ec;
 
-        for (const auto& cache_subdir :
-             std::filesystem::directory_iterator(cache_path, ec))
-        {
-            for (const auto& entry :
-                 std::filesystem::directory_iterator(cache_subdir, ec))
+        for (const auto& cache_pair : cache_paths) {
+            for (const auto& cache_subdir :
+                 std::filesystem::directory_iterator(cache_pair.first, ec))
             {
-                auto mtime = std::filesystem::last_write_time(entry.path());
-                auto exp_time = mtime + 1h;
-                if (now < exp_time) {
-                    continue;
-                }
+                for (const auto& entry :
+                     std::filesystem::directory_iterator(cache_subdir, ec))
+                {
+                    auto mtime = std::filesystem::last_write_time(entry.path());
+                    auto exp_time = mtime + cache_pair.second;
+                    if (now < exp_time) {
+                        continue;
+                    }
 
-                to_remove.emplace_back(entry.path());
+                    to_remove.emplace_back(entry.path());
+                }
             }
         }
 
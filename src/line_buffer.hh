@@ -35,9 +35,11 @@
 #include <array>
 #include <exception>
 #include <future>
+#include <optional>
 #include <vector>
 
 #include <errno.h>
+#include <sys/stat.h>
 #include <sys/types.h>
 #include <unistd.h>
 #include <zlib.h>
@@ -46,9 +48,11 @@
 #include "base/auto_mem.hh"
 #include "base/file_range.hh"
 #include "base/is_utf8.hh"
+#include "base/is_utf8.lines.hh"
 #include "base/lnav.gzip.hh"
 #include "base/piper.file.hh"
 #include "base/result.h"
+#include "line_buffer.zstd.hh"
 #include "log_level.hh"
 #include "mapbox/variant.hpp"
 #include "safe/safe.h"
@@ -87,6 +91,7 @@ public:
 #define GZ_WINSIZE           32768U /*> gzip's max supported dictionary is 15-bits */
 #define GZ_RAW_MODE          (-15) /*> Raw inflate data mode */
 #define GZ_HEADER_MODE       (15 + 32) /*> Automatic zstd or gzip decoding */
+#define GZ_TRAILER_SIZE      8U /*> Size of the CRC and length after a member */
 #define GZ_BORROW_BITS_MASK  7 /*> Bits (0-7) consumed in previous block */
 #define GZ_END_OF_BLOCK_MASK 128 /*> Stopped because reached end-of-block */
 #define GZ_END_OF_FILE_MASK  64 /*> Stopped because reached end-of-file */
@@ -121,23 +126,50 @@ public:
          */
         int read(void* buf, size_t offset, size_t size);
 
+        /**
+         * Decompress the whole file into the given descriptor.  The pieces
+         * between syncpoints are independent, so they are decompressed
+         * concurrently.  This only works once the file has been read to
+         * the end at least once.
+         *
+         * @param out_fd The descriptor to write the decompressed data to.
+         * @return True if the data was written.
+         */
+        bool inflate_to(int out_fd);
+
         struct indexDict {
             off_t in = 0;
             off_t out = 0;
             unsigned char bits = 0;
             unsigned char in_bits = 0;
-            Bytef index[GZ_WINSIZE];
+            /**
+             * True if this point is the start of a gzip member, which can
+             * be decompressed without a dictionary.
+             */
+            bool member_start = false;
+            std::vector<Bytef> index;
+            indexDict() = default;
             indexDict(z_stream const& s, const file_size_t size);
 
-            int apply(z_streamp s);
+            int apply(z_streamp s) const;
         };
 
     private:
+        void load_index();
+        void save_index();
+
         z_stream strm{}; /*< gzip streams structure */
         std::vector<indexDict>
             syncpoints; /*< indexed dictionaries as discovered */
         auto_mem<Bytef> inbuf; /*< Compressed data buffer */
         int gz_fd = -1; /*< The file to read data from. */
+        bool gz_raw{false}; /*< The stream was started from a dictionary. */
+        struct stat gz_stat {}; /*< The stat of the file when it was opened. */
+        bool gz_index_dirty{false}; /*< New syncpoints need to be saved. */
+        /** The pending write of the syncpoint index, if any. */
+        std::future<void> gz_index_future;
+        /** The size of the decompressed data, once the end has been seen. */
+        std::optional<file_size_t> gz_total_out;
     };
 
     /** Construct an empty line_buffer. */
@@ -267,7 +299,23 @@ public:
 
     bool is_piper() const { return this->lb_piper_header_size > 0; }
 
-    size_t line_count_guess() const { return this->lb_line_starts.size(); }
+    /**
+     * @return The size of the metadata at the start of each line that is
+     *   skipped by read_range().  This is only non-zero for piper captures
+     *   written by older versions that did not use a line metadata file.
+     */
+    size_t get_line_meta_prefix_size() const
+    {
+        return this->lb_line_meta_prefix_size;
+    }
+
+    /**
+     * Set the descriptor for the file with the line_meta records for the
+     * lines in a piper capture.
+     */
+    void set_line_meta_fd(auto_fd fd);
+
+    size_t line_count_guess() const { return this->lb_lines.size(); }
 
     static void cleanup_cache();
 
@@ -334,21 +382,29 @@ private:
 
     bool load_next_buffer();
 
+    void set_piper_header(auto_buffer& meta_buf);
+
+    std::optional<lnav::piper::line_meta> find_line_meta(file_off_t off);
+
     using safe_gz_indexed = safe::Safe<gz_indexed>;
+    using safe_zstd_reader = safe::Safe<lnav::zstd::reader>;
 
     shared_buffer lb_share_manager;
 
     auto_fd lb_fd; /*< The file to read data from. */
     safe_gz_indexed lb_gz_file; /*< File reader for gzipped files. */
     bool lb_bz_file{false}; /*< Flag set for bzip2 compressed files. */
+    safe_zstd_reader lb_zstd_file; /*< File reader for zstd files. */
     bool lb_line_metadata{false};
+    size_t lb_line_meta_prefix_size{0};
     file_ssize_t lb_piper_header_size{0};
+    auto_fd lb_line_meta_fd;
+    std::vector<lnav::piper::line_meta> lb_line_metas;
+    size_t lb_line_metas_index{0};
 
     auto_buffer lb_buffer{auto_buffer::alloc(DEFAULT_LINE_BUFFER_SIZE)};
     std::optional<auto_buffer> lb_alt_buffer;
-    std::vector<uint32_t> lb_alt_line_starts;
-    std::vector<bool> lb_alt_line_is_utf;
-    std::vector<bool> lb_alt_line_has_ansi;
+    utf8_line_batch lb_alt_lines;
     std::future<bool> lb_loader_future;
     std::optional<file_off_t> lb_loader_file_offset;
 
@@ -370,11 +426,9 @@ private:
     bool lb_is_utf8{true};
     file_off_t lb_last_line_offset{-1}; /*< */
 
-    std::vector<uint32_t> lb_line_starts;
+    utf8_line_batch lb_lines;
     file_off_t lb_next_buffer_offset{0};
     size_t lb_next_line_start_index{0};
-    std::vector<bool> lb_line_is_utf;
-    std::vector<bool> lb_line_has_ansi;
     stats lb_stats;
 
     std::optional<auto_fd> lb_cached_fd;
@@ -0,0 +1,615 @@
+/**
+ * Copyright (c) 2024, Timothy Stack
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ * * Neither the name of Timothy Stack nor the names of its contributors
+ * may be used to endorse or promote products derived from this software
+ * without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE REGENTS AND CONTRIBUTORS ''AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * @file line_buffer.zstd.cc
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <future>
+#include <memory>
+#include <thread>
+
+#include "line_buffer.zstd.hh"
+
+#include <errno.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "base/lnav_log.hh"
+#include "config.h"
+#include "fmt/format.h"
+
+#ifdef HAVE_ZSTD_H
+#    include <zstd.h>
+#endif
+
+namespace lnav::zstd {
+
+static constexpr uint32_t FRAME_MAGIC = 0xFD2FB528;
+static constexpr uint32_t SKIPPABLE_MAGIC_START = 0x184D2A50;
+static constexpr uint32_t SKIPPABLE_MAGIC_MASK = 0xFFFFFFF0;
+/** The magic number at the end of the seek table in the seekable format. */
+static constexpr uint32_t SEEKABLE_MAGIC = 0x8F92EAB1;
+static constexpr uint32_t SEEK_TABLE_FRAME_MAGIC = 0x184D2A5E;
+static constexpr size_t SEEK_TABLE_FOOTER_SIZE = 9;
+static constexpr size_t SKIPPABLE_HEADER_SIZE = 8;
+static constexpr size_t BLOCK_HEADER_SIZE = 3;
+static constexpr size_t CHECKSUM_SIZE = 4;
+static constexpr size_t FRAME_HEADER_SIZE_MAX = 18;
+
+/**
+ * Frames that decompress to more than this are not decompressed in parallel
+ * since the whole frame is held in memory.
+ */
+static constexpr file_size_t MAX_PARALLEL_FRAME_SIZE = 64 * 1024 * 1024;
+
+static uint32_t
+read_le32(const unsigned char* buf)
+{
+    return uint32_t{buf[0]} | (uint32_t{buf[1]} << 8)
+        | (uint32_t{buf[2]} << 16) | (uint32_t{buf[3]} << 24);
+}
+
+static bool
+pread_all(int fd, void* buf, size_t len, file_off_t off)
+{
+    auto* bits = static_cast<char*>(buf);
+
+    while (len > 0) {
+        auto rc = pread(fd, bits, len, off);
+        if (rc <= 0) {
+            if (rc < 0 && errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        bits += rc;
+        len -= rc;
+        off += rc;
+    }
+    return true;
+}
+
+static bool
+pwrite_all(int fd, const void* buf, size_t len, file_off_t off)
+{
+    const auto* bits = static_cast<const char*>(buf);
+
+    while (len > 0) {
+        auto rc = pwrite(fd, bits, len, off);
+        if (rc <= 0) {
+            if (rc < 0 && errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        bits += rc;
+        len -= rc;
+        off += rc;
+    }
+    return true;
+}
+
+bool
+is_zstd(const char* buffer, size_t len)
+{
+    return len >= 4 && read_le32((const unsigned char*) buffer) == FRAME_MAGIC;
+}
+
+/**
+ * Read the seek table at the end of a file in the seekable format.
+ *
+ * @return The frames listed in the table or nullopt if there is no valid
+ * table.
+ */
+static std::optional<std::vector<frame>>
+read_seek_table(int fd, file_size_t file_size)
+{
+    unsigned char footer[SEEK_TABLE_FOOTER_SIZE];
+
+    if (file_size < SEEK_TABLE_FOOTER_SIZE + SKIPPABLE_HEADER_SIZE
+        || !pread_all(
+            fd, footer, sizeof(footer), file_size - SEEK_TABLE_FOOTER_SIZE))
+    {
+        return std::nullopt;
+    }
+
+    auto frame_count = read_le32(footer);
+    auto descriptor = footer[4];
+    if (read_le32(&footer[5]) != SEEKABLE_MAGIC || (descriptor & 0x7c) != 0) {
+        return std::nullopt;
+    }
+
+    size_t entry_size = (descriptor & 0x80) ? 12 : 8;
+    auto table_size = file_size_t{frame_count} * entry_size;
+    if (table_size + SEEK_TABLE_FOOTER_SIZE + SKIPPABLE_HEADER_SIZE
+        > file_size)
+    {
+        return std::nullopt;
+    }
+
+    auto table_start = file_size - SEEK_TABLE_FOOTER_SIZE - table_size
+        - SKIPPABLE_HEADER_SIZE;
+    unsigned char skip_hdr[SKIPPABLE_HEADER_SIZE];
+    if (!pread_all(fd, skip_hdr, sizeof(skip_hdr), table_start)
+        || read_le32(skip_hdr) != SEEK_TABLE_FRAME_MAGIC
+        || read_le32(&skip_hdr[4]) != table_size + SEEK_TABLE_FOOTER_SIZE)
+    {
+        return std::nullopt;
+    }
+
+    std::vector<unsigned char> table(table_size);
+    if (!pread_all(
+            fd, table.data(), table.size(), table_start + sizeof(skip_hdr)))
+    {
+        return std::nullopt;
+    }
+
+    std::vector<frame> retval;
+    file_off_t in_off = 0;
+    file_off_t out_off = 0;
+    retval.reserve(frame_count);
+    for (size_t lpc = 0; lpc < frame_count; lpc++) {
+        const auto* entry = &table[lpc * entry_size];
+        auto& fr = retval.emplace_back();
+
+        fr.f_in = in_off;
+        fr.f_in_size = read_le32(entry);
+        fr.f_out = out_off;
+        fr.f_out_size = read_le32(&entry[4]);
+        in_off += fr.f_in_size;
+        out_off += fr.f_out_size.value();
+    }
+    if (in_off != (file_off_t) table_start) {
+        log_warning("%d: zstd seek table does not cover the file", fd);
+        return std::nullopt;
+    }
+
+    return retval;
+}
+
+Result<std::vector<frame>, std::string>
+find_frames(int fd)
+{
+    struct stat st;
+
+    if (fstat(fd, &st) == -1) {
+        return Err(fmt::format(FMT_STRING("unable to stat file: {}"),
+                               strerror(errno)));
+    }
+
+    auto file_size = static_cast<file_size_t>(st.st_size);
+    auto table_opt = read_seek_table(fd, file_size);
+    if (table_opt) {
+        log_info("%d: found zstd seek table with %zu frames",
+                 fd,
+                 table_opt->size());
+        return Ok(std::move(table_opt.value()));
+    }
+
+    static const size_t DICT_ID_SIZES[] = {0, 1, 2, 4};
+    static const size_t CONTENT_SIZE_SIZES[] = {0, 2, 4, 8};
+
+    std::vector<frame> retval;
+    file_off_t in_off = 0;
+    std::optional<file_off_t> out_off = 0;
+    while ((file_size_t) in_off < file_size) {
+        unsigned char hdr[FRAME_HEADER_SIZE_MAX];
+        auto hdr_len = std::min(sizeof(hdr), (size_t) (file_size - in_off));
+
+        if (hdr_len < sizeof(uint32_t)
+            || !pread_all(fd, hdr, hdr_len, in_off))
+        {
+            return Err(fmt::format(
+                FMT_STRING("truncated zstd frame header at {}"), in_off));
+        }
+
+        auto magic = read_le32(hdr);
+        if ((magic & SKIPPABLE_MAGIC_MASK) == SKIPPABLE_MAGIC_START) {
+            if (hdr_len < SKIPPABLE_HEADER_SIZE) {
+                return Err(fmt::format(
+                    FMT_STRING("truncated skippable frame at {}"), in_off));
+            }
+            in_off += SKIPPABLE_HEADER_SIZE + read_le32(&hdr[4]);
+            continue;
+        }
+        if (magic != FRAME_MAGIC) {
+            return Err(fmt::format(
+                FMT_STRING("invalid zstd frame magic at {}"), in_off));
+        }
+
+        auto descriptor = hdr[4];
+        auto content_size_flag = descriptor >> 6;
+        auto single_segment = (descriptor >> 5) & 1;
+        auto has_checksum = (descriptor >> 2) & 1;
+        auto hdr_size = 4 + 1 + (single_segment ? 0 : 1)
+            + DICT_ID_SIZES[descriptor & 3]
+            + (content_size_flag == 0 ? single_segment
+                                      : CONTENT_SIZE_SIZES[content_size_flag]);
+        if (hdr_size > hdr_len) {
+            return Err(fmt::format(
+                FMT_STRING("truncated zstd frame header at {}"), in_off));
+        }
+
+        auto& fr = retval.emplace_back();
+        fr.f_in = in_off;
+#ifdef HAVE_ZSTD_H
+        auto content_size = ZSTD_getFrameContentSize(hdr, hdr_size);
+        if (content_size != ZSTD_CONTENTSIZE_UNKNOWN
+            && content_size != ZSTD_CONTENTSIZE_ERROR && out_off)
+        {
+            fr.f_out = out_off.value();
+            fr.f_out_size = content_size;
+            out_off = out_off.value() + content_size;
+        } else {
+            // The offsets of the following frames are not known either.
+            out_off = std::nullopt;
+        }
+#else
+        out_off = std::nullopt;
+#endif
+
+        auto block_off = in_off + hdr_size;
+        auto last_block = false;
+        while (!last_block) {
+            unsigned char block_hdr[BLOCK_HEADER_SIZE];
+
+            if (!pread_all(fd, block_hdr, sizeof(block_hdr), block_off)) {
+                return Err(fmt::format(
+                    FMT_STRING("truncated zstd block header at {}"),
+                    block_off));
+            }
+
+            auto bh = uint32_t{block_hdr[0]} | (uint32_t{block_hdr[1]} << 8)
+                | (uint32_t{block_hdr[2]} << 16);
+            auto block_type = (bh >> 1) & 3;
+            last_block = bh & 1;
+            if (block_type == 3) {
+                return Err(fmt::format(
+                    FMT_STRING("invalid zstd block type at {}"), block_off));
+            }
+            // RLE blocks store a single byte.
+            block_off += BLOCK_HEADER_SIZE + (block_type == 1 ? 1 : bh >> 3);
+        }
+        if (has_checksum) {
+            block_off += CHECKSUM_SIZE;
+        }
+        if ((file_size_t) block_off > file_size) {
+            return Err(
+                fmt::format(FMT_STRING("truncated zstd frame at {}"), in_off));
+        }
+        fr.f_in_size = block_off - in_off;
+        in_off = block_off;
+    }
+
+    return Ok(std::move(retval));
+}
+
+#ifdef HAVE_ZSTD_H
+using dctx_ptr = std::unique_ptr<ZSTD_DCtx, decltype(&ZSTD_freeDCtx)>;
+
+static Result<file_size_t, std::string>
+decompress_stream(int in_fd, int out_fd)
+{
+    auto dctx = dctx_ptr(ZSTD_createDCtx(), ZSTD_freeDCtx);
+    if (dctx == nullptr) {
+        return Err(std::string("unable to create zstd context"));
+    }
+
+    std::vector<char> in_buf(ZSTD_DStreamInSize());
+    std::vector<char> out_buf(ZSTD_DStreamOutSize());
+    file_off_t in_off = 0;
+    file_off_t out_off = 0;
+    size_t last_rc = 0;
+    while (true) {
+        auto nread = pread(in_fd, in_buf.data(), in_buf.size(), in_off);
+        if (nread < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return Err(fmt::format(FMT_STRING("unable to read file: {}"),
+                                   strerror(errno)));
+        }
+        if (nread == 0) {
+            break;
+        }
+        in_off += nread;
+
+        ZSTD_inBuffer input = {in_buf.data(), (size_t) nread, 0};
+        while (input.pos < input.size) {
+            ZSTD_outBuffer output = {out_buf.data(), out_buf.size(), 0};
+
+            last_rc = ZSTD_decompressStream(dctx.get(), &output, &input);
+            if (ZSTD_isError(last_rc)) {
+                return Err(
+                    fmt::format(FMT_STRING("zstd decompression failed: {}"),
+                                ZSTD_getErrorName(last_rc)));
+            }
+            if (!pwrite_all(out_fd, out_buf.data(), output.pos, out_off)) {
+                return Err(fmt::format(FMT_STRING("unable to write data: {}"),
+                                       strerror(errno)));
+            }
+            out_off += output.pos;
+        }
+    }
+    if (last_rc != 0) {
+        return Err(std::string("truncated zstd file"));
+    }
+
+    return Ok(static_cast<file_size_t>(out_off));
+}
+#endif
+
+Result<file_size_t, std::string>
+decompress_to(int in_fd, int out_fd)
+{
+#ifdef HAVE_ZSTD_H
+    auto frames_res = find_frames(in_fd);
+    if (frames_res.isErr()) {
+        log_warning("%d: unable to find zstd frames, decompressing serially "
+                    "-- %s",
+                    in_fd,
+                    frames_res.unwrapErr().c_str());
+        return decompress_stream(in_fd, out_fd);
+    }
+
+    auto frames = frames_res.unwrap();
+    auto parallel = frames.size() > 1
+        && std::all_of(frames.begin(), frames.end(), [](const auto& fr) {
+               return fr.f_out_size
+                   && fr.f_out_size.value() <= MAX_PARALLEL_FRAME_SIZE
+                   && fr.f_in_size <= MAX_PARALLEL_FRAME_SIZE;
+           });
+    if (!parallel) {
+        log_info("%d: decompressing %zu zstd frames serially",
+                 in_fd,
+                 frames.size());
+        return decompress_stream(in_fd, out_fd);
+    }
+
+    size_t thread_count = std::max(1U, std::thread::hardware_concurrency());
+    thread_count = std::min(thread_count, frames.size());
+
+    log_info("%d: decompressing %zu zstd frames using %zu threads",
+             in_fd,
+             frames.size(),
+             thread_count);
+
+    std::atomic<size_t> next_frame{0};
+    std::atomic<bool> failed{false};
+    std::vector<std::future<void>> workers;
+    for (size_t lpc = 0; lpc < thread_count; lpc++) {
+        workers.emplace_back(std::async(
+            std::launch::async,
+            [&frames, &next_frame, &failed, in_fd, out_fd]() {
+                auto dctx = dctx_ptr(ZSTD_createDCtx(), ZSTD_freeDCtx);
+                std::vector<char> in_buf;
+                std::vector<char> out_buf;
+
+                if (dctx == nullptr) {
+                    failed = true;
+                    return;
+                }
+                while (!failed) {
+                    auto index = next_frame.fetch_add(1);
+                    if (index >= frames.size()) {
+                        break;
+                    }
+
+                    const auto& fr = frames[index];
+                    in_buf.resize(fr.f_in_size);
+                    out_buf.resize(fr.f_out_size.value());
+                    if (!pread_all(
+                            in_fd, in_buf.data(), in_buf.size(), fr.f_in))
+                    {
+                        failed = true;
+                        break;
+                    }
+                    auto rc = ZSTD_decompressDCtx(dctx.get(),
+                                                  out_buf.data(),
+                                                  out_buf.size(),
+                                                  in_buf.data(),
+                                                  in_buf.size());
+                    if (ZSTD_isError(rc) || rc != out_buf.size()) {
+                        log_error("%d: failed to decompress zstd frame at %lld",
+                                  in_fd,
+                                  (long long) fr.f_in);
+                        failed = true;
+                        break;
+                    }
+                    if (!pwrite_all(
+                            out_fd, out_buf.data(), out_buf.size(), fr.f_out))
+                    {
+                        failed = true;
+                        break;
+                    }
+                }
+            }));
+    }
+    for (auto& worker : workers) {
+        worker.get();
+    }
+
+    if (failed) {
+        return Err(std::string("unable to decompress zstd frames"));
+    }
+
+    const auto& last = frames.back();
+    return Ok(static_cast<file_size_t>(last.f_out + last.f_out_size.value()));
+#else
+    return Err(std::string("lnav was built without zstd support"));
+#endif
+}
+
+void
+reader::open(auto_fd fd)
+{
+    struct stat st;
+
+    this->close();
+    this->r_fd = std::move(fd);
+#ifdef HAVE_ZSTD_H
+    this->r_dctx = ZSTD_createDCtx();
+    this->r_in_buf.resize(ZSTD_DStreamInSize());
+#endif
+
+    std::optional<std::vector<frame>> table_opt;
+    if (fstat(this->r_fd, &st) == 0) {
+        table_opt = read_seek_table(this->r_fd, st.st_size);
+    }
+    if (table_opt && !table_opt->empty()) {
+        log_info("%d: found zstd seek table with %zu frames",
+                 this->r_fd.get(),
+                 table_opt->size());
+        this->r_frames = std::move(table_opt.value());
+    } else {
+        this->r_frames.emplace_back();
+    }
+}
+
+void
+reader::close()
+{
+#ifdef HAVE_ZSTD_H
+    if (this->r_dctx != nullptr) {
+        ZSTD_freeDCtx(this->r_dctx);
+    }
+#endif
+    this->r_dctx = nullptr;
+    this->r_fd.reset();
+    this->r_frames.clear();
+    this->r_in_buf.clear();
+    this->r_in_pos = 0;
+    this->r_in_len = 0;
+    this->r_in_off = 0;
+    this->r_out_off = 0;
+}
+
+void
+reader::restart_at(const frame& fr)
+{
+#ifdef HAVE_ZSTD_H
+    ZSTD_DCtx_reset(this->r_dctx, ZSTD_reset_session_only);
+#endif
+    this->r_in_pos = 0;
+    this->r_in_len = 0;
+    this->r_in_off = fr.f_in;
+    this->r_out_off = fr.f_out;
+}
+
+ssize_t
+reader::decompress(char* dst, size_t len)
+{
+#ifdef HAVE_ZSTD_H
+    size_t produced = 0;
+
+    while (produced < len) {
+        if (this->r_in_pos == this->r_in_len) {
+            auto nread = pread(this->r_fd,
+                               this->r_in_buf.data(),
+                               this->r_in_buf.size(),
+                               this->r_in_off);
+            if (nread < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                return -1;
+            }
+            if (nread == 0) {
+                break;
+            }
+            this->r_in_pos = 0;
+            this->r_in_len = nread;
+            this->r_in_off += nread;
+        }
+
+        ZSTD_inBuffer input
+            = {this->r_in_buf.data(), this->r_in_len, this->r_in_pos};
+        ZSTD_outBuffer output = {dst + produced, len - produced, 0};
+        auto rc = ZSTD_decompressStream(this->r_dctx, &output, &input);
+        if (ZSTD_isError(rc)) {
+            log_error("%d: zstd decompression failed at %lld -- %s",
+                      this->r_fd.get(),
+                      (long long) this->get_source_offset(),
+                      ZSTD_getErrorName(rc));
+            errno = EIO;
+            return -1;
+        }
+        this->r_in_pos = input.pos;
+        produced += output.pos;
+        this->r_out_off += output.pos;
+        if (rc == 0) {
+            // A frame was finished, remember where the next one starts so
+            // that later reads can restart from there.
+            auto in_off = this->get_source_offset();
+            if (in_off > this->r_frames.back().f_in) {
+                auto& fr = this->r_frames.emplace_back();
+
+                fr.f_in = in_off;
+                fr.f_out = this->r_out_off;
+            }
+        }
+    }
+
+    return produced;
+#else
+    errno = ENOTSUP;
+    return -1;
+#endif
+}
+
+ssize_t
+reader::read(void* buf, file_off_t offset, size_t size)
+{
+    auto iter = std::upper_bound(
+        this->r_frames.begin(),
+        this->r_frames.end(),
+        offset,
+        [](file_off_t off, const frame& fr) { return off < fr.f_out; });
+    const auto& start = *std::prev(iter);
+
+    if (offset < this->r_out_off || start.f_out > this->r_out_off) {
+        this->restart_at(start);
+    }
+
+    char scratch[32 * 1024];
+    while (this->r_out_off < offset) {
+        auto rc = this->decompress(
+            scratch,
+            std::min(sizeof(scratch), (size_t) (offset - this->r_out_off)));
+        if (rc <= 0) {
+            return rc;
+        }
+    }
+
+    return this->decompress((char*) buf, size);
+}
+
+}  // namespace lnav::zstd
@@ -0,0 +1,157 @@
+/**
+ * Copyright (c) 2024, Timothy Stack
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ * * Neither the name of Timothy Stack nor the names of its contributors
+ * may be used to endorse or promote products derived from this software
+ * without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE REGENTS AND CONTRIBUTORS ''AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * @file line_buffer.zstd.hh
+ */
+
+#ifndef lnav_line_buffer_zstd_hh
+#define lnav_line_buffer_zstd_hh
+
+#include <optional>
+#include <vector>
+
+#include <stddef.h>
+#include <sys/types.h>
+
+#include "base/auto_fd.hh"
+#include "base/file_range.hh"
+#include "base/result.h"
+
+struct ZSTD_DCtx_s;
+
+namespace lnav::zstd {
+
+/**
+ * A zstd frame in a compressed file.
+ */
+struct frame {
+    /** The offset of the frame in the compressed file. */
+    file_off_t f_in{0};
+    file_size_t f_in_size{0};
+    /** The offset of the frame's content in the decompressed data. */
+    file_off_t f_out{0};
+    /** The size of the frame's content, if it is known. */
+    std::optional<file_size_t> f_out_size;
+};
+
+/**
+ * @return True if the buffer starts with the zstd frame magic number.
+ */
+bool is_zstd(const char* buffer, size_t len);
+
+/**
+ * Find the frames in a zstd file.  The seek table of files in the seekable
+ * format is used when it is present, otherwise the frame and block headers
+ * are walked.  Skippable frames are not included in the result.
+ *
+ * @param fd The compressed file.
+ * @return The frames in the order they appear in the file.
+ */
+Result<std::vector<frame>, std::string> find_frames(int fd);
+
+/**
+ * Streaming reader for zstd files that supports reads at any offset in the
+ * decompressed data.  The frames listed in the seek table of a file in the
+ * seekable format are used as restart points.  For other files, the frame
+ * boundaries are recorded as they are found while reading, so later reads
+ * do not have to start from the beginning of the file.
+ */
+class reader {
+public:
+    reader() = default;
+
+    reader(const reader&) = delete;
+
+    ~reader() { this->close(); }
+
+    explicit operator bool() const { return this->r_fd != -1; }
+
+    /**
+     * @param fd The compressed file, which is owned by the reader.
+     */
+    void open(auto_fd fd);
+
+    void close();
+
+    /**
+     * Decompress bytes from the file.
+     *
+     * @param buf The buffer to store the data in.
+     * @param offset The offset in the decompressed data.
+     * @param size The maximum number of bytes to read.
+     * @return The number of bytes read, which is less than size at the end
+     * of the file, or -1 with errno set if there was an error.
+     */
+    ssize_t read(void* buf, file_off_t offset, size_t size);
+
+    /**
+     * @return The offset in the compressed file that has been consumed.
+     */
+    file_off_t get_source_offset() const
+    {
+        return this->r_in_off - (this->r_in_len - this->r_in_pos);
+    }
+
+    /**
+     * @return The frames that can be used as restart points.
+     */
+    const std::vector<frame>& get_frames() const { return this->r_frames; }
+
+private:
+    void restart_at(const frame& fr);
+
+    ssize_t decompress(char* dst, size_t len);
+
+    auto_fd r_fd;
+    ZSTD_DCtx_s* r_dctx{nullptr};
+    /** The known frame starts, ordered by their offset in both streams. */
+    std::vector<frame> r_frames;
+    std::vector<char> r_in_buf;
+    size_t r_in_pos{0};
+    size_t r_in_len{0};
+    /** The offset in the file of the next byte to read into r_in_buf. */
+    file_off_t r_in_off{0};
+    /** The offset in the decompressed data of the next byte produced. */
+    file_off_t r_out_off{0};
+};
+
+/**
+ * Decompress a zstd file into the given descriptor.  When the sizes of all
+ * the frames are known, the frames are decompressed concurrently and
+ * written to their offsets in out_fd.  Otherwise, the file is decompressed
+ * as a single stream.
+ *
+ * @param in_fd The compressed file.
+ * @param out_fd The descriptor to write the decompressed data to.
+ * @return The size of the decompressed data.
+ */
+Result<file_size_t, std::string> decompress_to(int in_fd, int out_fd);
+
+}  // namespace lnav::zstd
+
+#endif
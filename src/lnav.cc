@@ -105,9 +105,11 @@
 #include "log_format_loader.hh"
 #include "log_gutter_source.hh"
 #include "log_vtab_impl.hh"
+#include "logfile.cache.hh"
 #include "logfile.hh"
 #include "logfile_sub_source.hh"
 #include "md4cpp.hh"
+#include "opid_vtab.hh"
 #include "piper.looper.hh"
 #include "readline_curses.hh"
 #include "readline_highlighters.hh"
@@ -1828,14 +1830,21 @@ VALUES ('org.lnav.mouse-support', -1, DATETIME('now', '+1 minute'),
 
             ps->update_poll_set(pollfds);
             ui_now = ui_clock::now();
-            auto poll_to
-                = (!changes && ui_now < loop_deadline && session_stage >= 1)
+            auto more_schemas = false;
+            if (!changes && ui_now < loop_deadline && session_stage >= 1) {
+                // Use the rest of the idle time to parse message schemas
+                // for the logline tables.
+                more_schemas = index_schemas(loop_deadline);
+                ui_now = ui_clock::now();
+            }
+            auto poll_to = (!changes && !more_schemas && ui_now < loop_deadline
+                            && session_stage >= 1)
                 ? std::chrono::duration_cast<std::chrono::milliseconds>(
                       loop_deadline - ui_now)
                 : 0ms;
 
             // log_debug("poll");
-            rc = poll(&pollfds[0], pollfds.size(), poll_to.count());
+            rc = ps->poll(pollfds, poll_to);
 
             gettimeofday(&current_time, nullptr);
             if (lb.lb_last_view != nullptr) {
@@ -2038,6 +2047,7 @@ VALUES ('org.lnav.mouse-support', -1, DATETIME('now', '+1 minute'),
                         line_buffer::cleanup_cache();
                         archive_manager::cleanup_cache();
                         tailer::cleanup_cache();
+                        lnav::logfile::cache::cleanup();
                         lnav::piper::cleanup();
                         file_converter_manager::cleanup();
                         ran_cleanup = true;
@@ -2225,7 +2235,8 @@ wait_for_children()
             break;
         }
 
-        int rc = poll(&pollfds[0], pollfds.size(), to.tv_usec / 1000);
+        int rc = ps->poll(
+            pollfds, std::chrono::milliseconds(to.tv_usec / 1000));
 
         if (rc < 0) {
             switch (errno) {
@@ -2447,6 +2458,7 @@ main(int argc, char* argv[])
     register_regexp_vtab(lnav_data.ld_db.in());
     register_xpath_vtab(lnav_data.ld_db.in());
     register_fstat_vtab(lnav_data.ld_db.in());
+    register_opid_vtab(lnav_data.ld_db.in());
     lnav::events::register_events_tab(lnav_data.ld_db.in());
 
     auto _vtab_cleanup = finally([] {
@@ -3580,6 +3592,9 @@ SELECT tbl_name FROM sqlite_master WHERE sql LIKE 'CREATE VIRTUAL TABLE%'
                 lnav_data.ld_view_stack.push_back(log_tc);
                 // Read all of stdin
                 wait_for_pipers();
+                // Rotated captures are replaced by their compressed versions,
+                // so pick those up before running any commands.
+                rescan_files(true);
                 rebuild_indexes_repeatedly();
                 wait_for_children();
 
@@ -407,6 +407,24 @@ rebuild_indexes_repeatedly()
     }
 }
 
+bool
+index_schemas(ui_clock::time_point deadline)
+{
+    for (const auto& ld : lnav_data.ld_log_source) {
+        auto* lf = ld->get_file_ptr();
+
+        if (lf == nullptr || !ld->is_visible()) {
+            continue;
+        }
+
+        if (lf->get_schema_index().index_lines(*lf, deadline)) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
 bool
 update_active_files(file_collection& new_files)
 {
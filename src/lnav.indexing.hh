@@ -43,6 +43,14 @@ struct rebuild_indexes_result_t {
 rebuild_indexes_result_t rebuild_indexes(
     std::optional<ui_clock::time_point> deadline = std::nullopt);
 void rebuild_indexes_repeatedly();
+
+/**
+ * Parse the schemas of the log messages that have not been looked at yet,
+ * stopping at the deadline.
+ *
+ * @return true if there are more messages to be parsed.
+ */
+bool index_schemas(ui_clock::time_point deadline);
 bool rescan_files(bool required = false);
 bool update_active_files(file_collection& new_files);
 void do_observer_update(const std::shared_ptr<logfile>& lf);
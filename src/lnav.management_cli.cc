@@ -35,6 +35,7 @@
 #include "base/humanize.hh"
 #include "base/humanize.time.hh"
 #include "base/itertools.hh"
+#include "base/lnav.gzip.hh"
 #include "base/paths.hh"
 #include "base/result.h"
 #include "base/string_util.hh"
@@ -859,6 +860,10 @@ struct subcmd_piper_t {
                 }
 
                 total_size += entry.file_size();
+                if (!startswith(entry.path().filename().string(), "out.")) {
+                    continue;
+                }
+
                 char buffer[lnav::piper::HEADER_SIZE];
 
                 auto entry_open_res
@@ -876,6 +881,11 @@ struct subcmd_piper_t {
                                 entry.path().c_str());
                     continue;
                 }
+                if (lnav::gzip::is_gzipped(buffer, sizeof(buffer))) {
+                    // Rotated files are compressed and the header in the
+                    // uncompressed file is enough for the listing.
+                    continue;
+                }
                 auto hdr_bits_opt = lnav::piper::read_header(entry_fd, buffer);
                 if (!hdr_bits_opt) {
                     log_warning("could not read piper header: %s",
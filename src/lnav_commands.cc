@@ -28,6 +28,7 @@
  */
 
 #include <fstream>
+#include <map>
 #include <regex>
 #include <string>
 #include <unordered_map>
@@ -68,6 +69,7 @@
 #include "lnav_config.hh"
 #include "lnav_util.hh"
 #include "log.annotate.hh"
+#include "log.filter_expr.hh"
 #include "log_data_helper.hh"
 #include "log_data_table.hh"
 #include "log_format_loader.hh"
@@ -1033,6 +1035,25 @@ com_mark(exec_context& ec, std::string cmdline, std::vector<std::string>& args)
     return Ok(retval);
 }
 
+/**
+ * @return The description to show in the preview for a :filter-expr or
+ *   :mark-expr, including whether the expression is evaluated natively or
+ *   needs SQLite.
+ */
+static std::string
+expr_preview_description(const std::string& expr)
+{
+    auto compile_res = lnav::log::filter_expr::compile(expr);
+
+    if (compile_res.isOk()) {
+        return "Matches are highlighted in the text view (evaluated natively)";
+    }
+
+    return fmt::format(FMT_STRING("Matches are highlighted in the text view "
+                                  "(evaluated by SQLite: {})"),
+                       compile_res.unwrapErr());
+}
+
 static Result<std::string, lnav::console::user_message>
 com_mark_expr(exec_context& ec,
               std::string cmdline,
@@ -1090,7 +1111,7 @@ com_mark_expr(exec_context& ec,
                 return Err(set_res.unwrapErr());
             }
             lnav_data.ld_preview_status_source[0].get_description().set_value(
-                "Matches are highlighted in the text view");
+                expr_preview_description(expr));
         } else {
             auto set_res = lss.set_sql_marker(expr, stmt.release());
 
@@ -1386,22 +1407,24 @@ json_write_row(yajl_gen handle,
     for (size_t col = 0; col < dls.dls_headers.size(); col++) {
         obj_map.gen(dls.dls_headers[col].hm_name);
 
-        if (dls.dls_rows[row][col] == db_label_source::NULL_STR) {
+        if (dls.dls_rows.is_null(row, col)) {
             obj_map.gen();
             continue;
         }
 
         auto& hm = dls.dls_headers[col];
+        auto cell_str = dls.get_cell_as_string(row, col);
+        const auto* cell = cell_str.c_str();
 
         switch (hm.hm_column_type) {
             case SQLITE_FLOAT:
             case SQLITE_INTEGER: {
-                auto len = strlen(dls.dls_rows[row][col]);
+                auto len = strlen(cell);
 
                 if (len == 0) {
                     obj_map.gen();
                 } else {
-                    yajl_gen_number(handle, dls.dls_rows[row][col], len);
+                    yajl_gen_number(handle, cell, len);
                 }
                 break;
             }
@@ -1418,7 +1441,7 @@ json_write_row(yajl_gen handle,
                             &json_op::ptr_callbacks, &jo);
 
                         const unsigned char* json_in
-                            = (const unsigned char*) dls.dls_rows[row][col];
+                            = (const unsigned char*) cell;
                         switch (yajl_parse(parse_handle.in(),
                                            json_in,
                                            strlen((const char*) json_in)))
@@ -1431,7 +1454,7 @@ json_write_row(yajl_gen handle,
                                     json_in,
                                     strlen((const char*) json_in));
                                 log_error("unable to parse JSON cell: %s", err);
-                                obj_map.gen(dls.dls_rows[row][col]);
+                                obj_map.gen(cell);
                                 yajl_free_error(parse_handle.in(), err);
                                 return;
                             }
@@ -1448,7 +1471,7 @@ json_write_row(yajl_gen handle,
                                     json_in,
                                     strlen((const char*) json_in));
                                 log_error("unable to parse JSON cell: %s", err);
-                                obj_map.gen(dls.dls_rows[row][col]);
+                                obj_map.gen(cell);
                                 yajl_free_error(parse_handle.in(), err);
                                 return;
                             }
@@ -1460,15 +1483,15 @@ json_write_row(yajl_gen handle,
                     default:
                         obj_map.gen(anonymize
                                         ? ta.next(string_fragment::from_c_str(
-                                              dls.dls_rows[row][col]))
-                                        : dls.dls_rows[row][col]);
+                                              cell))
+                                        : cell);
                         break;
                 }
                 break;
             default:
                 obj_map.gen(anonymize ? ta.next(string_fragment::from_c_str(
-                                            dls.dls_rows[row][col]))
-                                      : dls.dls_rows[row][col]);
+                                            cell))
+                                      : cell);
                 break;
         }
     }
@@ -1610,8 +1633,6 @@ com_save_to(exec_context& ec,
     int line_count = 0;
 
     if (args[0] == "write-csv-to") {
-        std::vector<std::vector<const char*>>::iterator row_iter;
-        std::vector<const char*>::iterator iter;
         std::vector<db_label_source::header_meta>::iterator hdr_iter;
         bool first = true;
 
@@ -1627,23 +1648,23 @@ com_save_to(exec_context& ec,
         }
         fprintf(outfile, "\n");
 
-        for (row_iter = dls.dls_rows.begin(); row_iter != dls.dls_rows.end();
-             ++row_iter)
-        {
-            if (ec.ec_dry_run && distance(dls.dls_rows.begin(), row_iter) > 10)
-            {
+        for (size_t row = 0; row < dls.dls_rows.row_count(); row++) {
+            if (ec.ec_dry_run && row > 10) {
                 break;
             }
 
             first = true;
-            for (iter = row_iter->begin(); iter != row_iter->end(); ++iter) {
+            for (size_t col = 0; col < dls.dls_headers.size(); col++) {
+                auto cell = dls.get_cell_as_string(row, col);
+
                 if (!first) {
                     fprintf(outfile, ",");
                 }
                 csv_write_string(
                     outfile,
-                    anonymize ? ta.next(string_fragment::from_c_str(*iter))
-                              : *iter);
+                    anonymize ? ta.next(string_fragment::from_c_str(
+                                    cell.c_str()))
+                              : cell.c_str());
                 first = false;
             }
             fprintf(outfile, "\n");
@@ -1696,7 +1717,7 @@ com_save_to(exec_context& ec,
 
                 fprintf(outfile, "\u2502");
 
-                auto cell = std::string(dls.dls_rows[row][col]);
+                auto cell = dls.get_cell_as_string(row, col);
                 if (anonymize) {
                     cell = ta.next(cell);
                 }
@@ -1739,7 +1760,7 @@ com_save_to(exec_context& ec,
         {
             yajlpp_array root_array(gen);
 
-            for (size_t row = 0; row < dls.dls_rows.size(); row++) {
+            for (size_t row = 0; row < dls.dls_rows.row_count(); row++) {
                 if (ec.ec_dry_run && row > 10) {
                     break;
                 }
@@ -1754,7 +1775,7 @@ com_save_to(exec_context& ec,
         yajl_gen_config(gen, yajl_gen_beautify, 0);
         yajl_gen_config(gen, yajl_gen_print_callback, yajl_writer, outfile);
 
-        for (size_t row = 0; row < dls.dls_rows.size(); row++) {
+        for (size_t row = 0; row < dls.dls_rows.row_count(); row++) {
             if (ec.ec_dry_run && row > 10) {
                 break;
             }
@@ -1825,23 +1846,20 @@ com_save_to(exec_context& ec,
         }
     } else if (args[0] == "write-raw-to") {
         if (tc == &lnav_data.ld_views[LNV_DB]) {
-            for (auto row_iter = dls.dls_rows.begin();
-                 row_iter != dls.dls_rows.end();
-                 ++row_iter)
-            {
-                if (ec.ec_dry_run
-                    && distance(dls.dls_rows.begin(), row_iter) > 10)
-                {
+            for (size_t row = 0; row < dls.dls_rows.row_count(); row++) {
+                if (ec.ec_dry_run && row > 10) {
                     break;
                 }
 
-                for (auto& iter : *row_iter) {
+                for (size_t col = 0; col < dls.dls_headers.size(); col++) {
+                    auto cell = dls.get_cell_as_string(row, col);
+
                     if (anonymize) {
-                        fputs(
-                            ta.next(string_fragment::from_c_str(iter)).c_str(),
-                            outfile);
+                        fputs(ta.next(string_fragment::from_c_str(cell.c_str()))
+                                  .c_str(),
+                              outfile);
                     } else {
-                        fputs(iter, outfile);
+                        fputs(cell.c_str(), outfile);
                     }
                 }
                 fprintf(outfile, "\n");
@@ -2660,7 +2678,7 @@ com_filter_expr(exec_context& ec,
                 return Err(set_res.unwrapErr());
             }
             lnav_data.ld_preview_status_source[0].get_description().set_value(
-                "Matches are highlighted in the text view");
+                expr_preview_description(expr));
         } else {
             lnav_data.ld_log_source.set_preview_sql_filter(nullptr);
             auto set_res
@@ -2749,6 +2767,126 @@ com_disable_word_wrap(exec_context& ec,
 
 static std::set<std::string> custom_logline_tables;
 
+/**
+ * Show a histogram of the schemas that have been found so far in the files
+ * with the same format as the logline table in the second preview panel.
+ */
+static void
+preview_logline_table_schemas(const log_data_table& ldt,
+                              const logfile& template_file)
+{
+    static constexpr size_t MAX_ROWS = 5;
+    static constexpr size_t BAR_WIDTH = 20;
+    static constexpr size_t MAX_KEYS_WIDTH = 60;
+
+    struct summary {
+        const logfile_schema_index::schema* s_schema;
+        size_t s_count{0};
+    };
+
+    std::map<logfile_schema_index::schema_id_t, summary> schemas;
+    size_t indexed_lines = 0;
+    size_t total_lines = 0;
+    auto overflowed = false;
+
+    for (const auto& ld : lnav_data.ld_log_source) {
+        auto* lf = ld->get_file_ptr();
+
+        if (lf == nullptr || !ld->is_visible()
+            || lf->get_format_name() != template_file.get_format_name())
+        {
+            continue;
+        }
+
+        const auto& si = lf->get_schema_index();
+
+        total_lines += lf->size();
+        if (si.is_overflowed()) {
+            overflowed = true;
+            continue;
+        }
+        indexed_lines += si.get_indexed_line_count();
+        for (const auto& sch : si.get_schemas()) {
+            if (sch.s_lines.empty()) {
+                continue;
+            }
+
+            auto& sum = schemas[sch.s_id];
+            if (sum.s_schema == nullptr) {
+                sum.s_schema = &sch;
+            }
+            sum.s_count += sch.s_lines.size();
+        }
+    }
+
+    if (schemas.empty()) {
+        return;
+    }
+
+    std::vector<summary> rows;
+    size_t total_count = 0;
+    size_t table_count = 0;
+
+    rows.reserve(schemas.size());
+    for (const auto& sch_pair : schemas) {
+        rows.emplace_back(sch_pair.second);
+        total_count += sch_pair.second.s_count;
+        if (sch_pair.first == ldt.get_schema_id()) {
+            table_count = sch_pair.second.s_count;
+        }
+    }
+    std::stable_sort(
+        rows.begin(), rows.end(), [](const auto& lhs, const auto& rhs) {
+            return lhs.s_count > rhs.s_count;
+        });
+
+    auto desc = fmt::format(
+        FMT_STRING("The table will have {} of the {} messages parsed"),
+        table_count,
+        total_count);
+    if (overflowed) {
+        desc.append(", some files have too many schemas to summarize");
+    } else if (indexed_lines < total_lines) {
+        desc.append(fmt::format(FMT_STRING(" ({}% of the lines)"),
+                                indexed_lines * 100 / total_lines));
+    }
+    desc.append(":");
+
+    attr_line_t al;
+    auto max_count = rows.front().s_count;
+    for (size_t lpc = 0; lpc < rows.size() && lpc < MAX_ROWS; lpc++) {
+        const auto& row = rows[lpc];
+        auto keys = row.s_schema->s_keys.empty() ? std::string("(no pairs)")
+                                                 : row.s_schema->s_keys;
+
+        if (keys.size() > MAX_KEYS_WIDTH) {
+            keys.resize(MAX_KEYS_WIDTH - 3);
+            keys.append("...");
+        }
+        if (!al.empty()) {
+            al.append("\n");
+        }
+        al.append(fmt::format(
+            FMT_STRING("{:>9} {:<{}} {}{}"),
+            row.s_count,
+            std::string(std::max(size_t{1}, row.s_count * BAR_WIDTH / max_count),
+                        '#'),
+            BAR_WIDTH,
+            keys,
+            row.s_schema->s_id == ldt.get_schema_id() ? "  <- this table"
+                                                      : ""));
+    }
+    if (rows.size() > MAX_ROWS) {
+        al.append(fmt::format(FMT_STRING("\n    ... and {} more schema(s)"),
+                              rows.size() - MAX_ROWS));
+    }
+
+    lnav_data.ld_preview_status_source[1].get_description().set_value(desc);
+    lnav_data.ld_preview_view[1].set_sub_source(
+        &lnav_data.ld_preview_source[1]);
+    lnav_data.ld_preview_source[1].replace_with(al);
+}
+
 static Result<std::string, lnav::console::user_message>
 com_create_logline_table(exec_context& ec,
                          std::string cmdline,
@@ -2773,6 +2911,11 @@ com_create_logline_table(exec_context& ec,
 
             if (ec.ec_dry_run) {
                 attr_line_t al(ldt->get_table_statement());
+                auto template_cl = cl;
+                const auto* template_file
+                    = lnav_data.ld_log_source.find_file_ptr(template_cl);
+
+                preview_logline_table_schemas(*ldt, *template_file);
 
                 lnav_data.ld_preview_status_source[0]
                     .get_description()
@@ -4460,7 +4603,7 @@ com_summarize(exec_context& ec,
                 lnav_data.ld_views[LNV_DB].reload_data();
                 lnav_data.ld_views[LNV_DB].set_left(0);
 
-                if (dls.dls_rows.size() > 0) {
+                if (dls.dls_rows.row_count() > 0) {
                     ensure_view(&lnav_data.ld_views[LNV_DB]);
                 }
             }
@@ -4597,7 +4740,9 @@ com_zoom_to(exec_context& ec,
                         lnav_data.ld_views[LNV_HISTOGRAM].get_top());
                     if (old_time_opt) {
                         old_time = old_time_opt.value().ri_time;
-                        rebuild_hist();
+                        lnav_data.ld_hist_source2.set_time_slice(
+                            ZOOM_LEVELS[lnav_data.ld_zoom_level]);
+                        hist_view.reload_data();
                         lnav_data.ld_hist_source2.row_for_time(old_time) |
                             [](auto new_top) {
                                 lnav_data.ld_views[LNV_HISTOGRAM].set_top(
@@ -4605,6 +4750,10 @@ com_zoom_to(exec_context& ec,
                             };
                     }
                 }
+                // The buckets are derived from the counts that were already
+                // collected, so changing the slice does not need a re-index.
+                lnav_data.ld_hist_source2.set_time_slice(
+                    ZOOM_LEVELS[lnav_data.ld_zoom_level]);
 
                 auto& spectro_view = lnav_data.ld_views[LNV_SPECTRO];
 
@@ -92,6 +92,9 @@ static auto fvc = injector::bind<file_vtab::config>::to_instance(
 static auto lc = injector::bind<lnav::logfile::config>::to_instance(
     +[]() { return &lnav_config.lc_logfile; });
 
+static auto sc = injector::bind<lnav::search::config>::to_instance(
+    +[]() { return &lnav_config.lc_search; });
+
 static auto p = injector::bind<lnav::piper::config>::to_instance(
     +[]() { return &lnav_config.lc_piper; });
 
@@ -119,6 +122,9 @@ static auto tssc = injector::bind<top_status_source_cfg>::to_instance(
 static auto ltc = injector::bind<lnav::textfile::config>::to_instance(
     +[]() { return &lnav_config.lc_textfile; });
 
+static auto dvc = injector::bind<db_label_source_ns::config>::to_instance(
+    +[]() { return &lnav_config.lc_db_view; });
+
 bool
 check_experimental(const char* feature_name)
 {
@@ -1265,6 +1271,20 @@ static const struct json_path_container piper_handlers = {
         .with_min_value(2)
         .with_description("The number of rotated files to keep")
         .for_field(&_lnav_config::lc_piper, &lnav::piper::config::c_rotations),
+    yajlpp::property_handler("compress")
+        .with_synopsis("bool")
+        .with_description(
+            "Compress capture files after they have been rotated out")
+        .for_field(&_lnav_config::lc_piper, &lnav::piper::config::c_compress),
+    yajlpp::property_handler("max-total-size")
+        .with_synopsis("<bytes>")
+        .with_description(
+            "The maximum amount of space used by all captures.  The oldest "
+            "captures are removed first when the limit is exceeded.  A value "
+            "of zero disables the limit.")
+        .with_min_value(0)
+        .for_field(&_lnav_config::lc_piper,
+                   &lnav::piper::config::c_max_total_size),
     yajlpp::property_handler("ttl")
         .with_synopsis("<duration>")
         .with_description(
@@ -1295,6 +1315,18 @@ static const struct json_path_container textfile_handlers = {
                    &lnav::textfile::config::c_max_unformatted_line_length),
 };
 
+static const struct json_path_container db_view_handlers = {
+    yajlpp::property_handler("max-memory-size")
+        .with_synopsis("<bytes>")
+        .with_description(
+            "The maximum amount of text from a query result to keep in "
+            "memory.  Anything past this limit is written to a temporary "
+            "file")
+        .with_min_value(0)
+        .for_field(&_lnav_config::lc_db_view,
+                   &db_label_source_ns::config::c_max_memory_size),
+};
+
 static const struct json_path_container logfile_handlers = {
     yajlpp::property_handler("max-unrecognized-lines")
         .with_synopsis("<lines>")
@@ -1303,6 +1335,52 @@ static const struct json_path_container logfile_handlers = {
         .with_min_value(1)
         .for_field(&_lnav_config::lc_logfile,
                    &lnav::logfile::config::lc_max_unrecognized_lines),
+    yajlpp::property_handler("index-cache-min-size")
+        .with_synopsis("<bytes>")
+        .with_description("The minimum size of a file before its index is "
+                          "saved to disk so that it can be reused the next "
+                          "time the file is opened.  A value of zero "
+                          "disables the cache")
+        .with_min_value(0)
+        .for_field(&_lnav_config::lc_logfile,
+                   &lnav::logfile::config::lc_index_cache_min_size),
+    yajlpp::property_handler("index-threads")
+        .with_synopsis("<count>")
+        .with_description("The number of threads to use when indexing "
+                          "multiple files or large sections of a single "
+                          "file.  A value of zero means one thread per CPU "
+                          "and a value of one disables concurrent indexing")
+        .with_min_value(0)
+        .for_field(&_lnav_config::lc_logfile,
+                   &lnav::logfile::config::lc_index_threads),
+    yajlpp::property_handler("column-store-max-size")
+        .with_synopsis("<bytes>")
+        .with_description("The maximum amount of memory used for each file to "
+                          "cache the values extracted by SQL queries so that "
+                          "later queries do not need to parse the lines "
+                          "again.  A value of zero disables the cache")
+        .with_min_value(0)
+        .for_field(&_lnav_config::lc_logfile,
+                   &lnav::logfile::config::lc_column_store_max_size),
+    yajlpp::property_handler("column-store-total-max-size")
+        .with_synopsis("<bytes>")
+        .with_description("The maximum amount of memory used for all files "
+                          "to cache the values extracted by SQL queries.  "
+                          "When it is reached, the values for the files "
+                          "that were least recently queried are dropped")
+        .with_min_value(0)
+        .for_field(&_lnav_config::lc_logfile,
+                   &lnav::logfile::config::lc_column_store_total_max_size),
+};
+
+static const struct json_path_container search_handlers = {
+    yajlpp::property_handler("threads")
+        .with_synopsis("<count>")
+        .with_description("The number of threads to use when matching lines "
+                          "against a search pattern.  A value of zero means "
+                          "one thread per CPU")
+        .with_min_value(0)
+        .for_field(&_lnav_config::lc_search, &lnav::search::config::c_threads),
 };
 
 static const struct json_path_container ssh_config_handlers = {
@@ -1603,6 +1681,9 @@ static const struct json_path_container tuning_handlers = {
     yajlpp::property_handler("logfile")
         .with_description("Settings related to log files")
         .with_children(logfile_handlers),
+    yajlpp::property_handler("search")
+        .with_description("Settings related to searching")
+        .with_children(search_handlers),
     yajlpp::property_handler("remote")
         .with_description("Settings related to remote file support")
         .with_children(remote_handlers),
@@ -1615,6 +1696,9 @@ static const struct json_path_container tuning_handlers = {
     yajlpp::property_handler("textfile")
         .with_description("Settings related to text file handling")
         .with_children(textfile_handlers),
+    yajlpp::property_handler("db-view")
+        .with_description("Settings related to the SQL query results view")
+        .with_children(db_view_handlers),
     yajlpp::property_handler("url-scheme")
         .with_description("Settings related to custom URL handling")
         .with_children(url_handlers),
@@ -44,8 +44,10 @@
 #include "base/file_range.hh"
 #include "base/lnav.console.hh"
 #include "base/result.h"
+#include "db_sub_source.cfg.hh"
 #include "external_opener.cfg.hh"
 #include "file_vtab.cfg.hh"
+#include "grep_proc.cfg.hh"
 #include "lnav_config_fwd.hh"
 #include "log.annotate.cfg.hh"
 #include "log_level.hh"
@@ -125,6 +127,7 @@ struct _lnav_config {
     lnav::piper::config lc_piper;
     file_vtab::config lc_file_vtab;
     lnav::logfile::config lc_logfile;
+    lnav::search::config lc_search;
     tailer::config lc_tailer;
     sysclip::config lc_sysclip;
     lnav::url_handler::config lc_url_handlers;
@@ -132,6 +135,7 @@ struct _lnav_config {
     lnav::log::annotate::config lc_log_annotations;
     lnav::external_opener::config lc_opener;
     lnav::textfile::config lc_textfile;
+    db_label_source_ns::config lc_db_view;
 };
 
 extern struct _lnav_config lnav_config;
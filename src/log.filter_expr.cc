@@ -0,0 +1,1286 @@
+/**
+ * Copyright (c) 2024, Timothy Stack
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ * * Neither the name of Timothy Stack nor the names of its contributors
+ * may be used to endorse or promote products derived from this software
+ * without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE REGENTS AND CONTRIBUTORS ''AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "log.filter_expr.hh"
+
+#include <algorithm>
+
+#include <errno.h>
+#include <sqlite3.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "base/lnav_log.hh"
+#include "base/string_attr_type.hh"
+#include "config.h"
+#include "fmt/format.h"
+#include "log_format.hh"
+#include "pcrepp/pcre2pp.hh"
+#include "sql_util.hh"
+
+namespace lnav::log::filter_expr {
+
+namespace {
+
+enum class tri_t : uint8_t {
+    no,
+    yes,
+    null,
+};
+
+tri_t
+to_tri(bool b)
+{
+    return b ? tri_t::yes : tri_t::no;
+}
+
+tri_t
+negate(tri_t t)
+{
+    switch (t) {
+        case tri_t::no:
+            return tri_t::yes;
+        case tri_t::yes:
+            return tri_t::no;
+        case tri_t::null:
+            break;
+    }
+    return tri_t::null;
+}
+
+bool
+is_numeric(const value& v)
+{
+    return v.v_kind == value::kind_t::integer
+        || v.v_kind == value::kind_t::real;
+}
+
+double
+to_double(const value& v)
+{
+    return v.v_kind == value::kind_t::integer ? (double) v.v_integer
+                                              : v.v_real;
+}
+
+/**
+ * Compare two non-NULL values using the SQLite rules for values without
+ * an affinity: numbers sort before text and text is compared with the
+ * BINARY collation.
+ */
+int
+compare_values(const value& lhs, const value& rhs)
+{
+    if (is_numeric(lhs) && is_numeric(rhs)) {
+        if (lhs.v_kind == value::kind_t::integer
+            && rhs.v_kind == value::kind_t::integer)
+        {
+            return lhs.v_integer < rhs.v_integer
+                ? -1
+                : (lhs.v_integer > rhs.v_integer ? 1 : 0);
+        }
+
+        auto ld = to_double(lhs);
+        auto rd = to_double(rhs);
+
+        return ld < rd ? -1 : (ld > rd ? 1 : 0);
+    }
+    if (is_numeric(lhs)) {
+        return -1;
+    }
+    if (is_numeric(rhs)) {
+        return 1;
+    }
+
+    auto min_len = std::min(lhs.v_text.length(), rhs.v_text.length());
+    auto rc = min_len == 0
+        ? 0
+        : memcmp(lhs.v_text.data(), rhs.v_text.data(), min_len);
+    if (rc != 0) {
+        return rc;
+    }
+    return lhs.v_text.length() - rhs.v_text.length();
+}
+
+/**
+ * Convert a non-NULL value to text the same way SQLite does when a number
+ * is passed to a string operator.
+ */
+string_fragment
+to_text(const value& v, std::string& buffer)
+{
+    switch (v.v_kind) {
+        case value::kind_t::integer:
+            buffer = fmt::to_string(v.v_integer);
+            break;
+        case value::kind_t::real: {
+            char real_buf[64];
+
+            sqlite3_snprintf(sizeof(real_buf), real_buf, "%!.15g", v.v_real);
+            buffer = real_buf;
+            break;
+        }
+        case value::kind_t::null:
+        case value::kind_t::text:
+            return v.v_text;
+    }
+
+    return string_fragment::from_str(buffer);
+}
+
+tri_t
+to_truth(const value& v)
+{
+    switch (v.v_kind) {
+        case value::kind_t::null:
+            return tri_t::null;
+        case value::kind_t::integer:
+            return to_tri(v.v_integer != 0);
+        case value::kind_t::real:
+            return to_tri(v.v_real != 0.0);
+        case value::kind_t::text: {
+            auto str = v.v_text.to_string();
+
+            return to_tri(strtod(str.c_str(), nullptr) != 0.0);
+        }
+    }
+
+    return tri_t::null;
+}
+
+size_t
+utf8_char_length(string_fragment sf, size_t pos)
+{
+    auto ch = (unsigned char) sf.data()[pos];
+    size_t retval = 1;
+
+    if (ch >= 0xf0) {
+        retval = 4;
+    } else if (ch >= 0xe0) {
+        retval = 3;
+    } else if (ch >= 0xc0) {
+        retval = 2;
+    }
+
+    return std::min(retval, sf.length() - pos);
+}
+
+char
+fold_ascii(char ch)
+{
+    return (ch >= 'A' && ch <= 'Z') ? ch - 'A' + 'a' : ch;
+}
+
+/**
+ * Match a string against a LIKE pattern, which is case-insensitive for
+ * ASCII characters like the built-in SQLite function.
+ */
+bool
+like_match(string_fragment pattern, string_fragment str)
+{
+    const auto npos = std::string::npos;
+    size_t pi = 0, si = 0, star_pi = npos, star_si = 0;
+
+    while (si < (size_t) str.length()) {
+        if (pi < (size_t) pattern.length() && pattern.data()[pi] == '%') {
+            pi += 1;
+            star_pi = pi;
+            star_si = si;
+            continue;
+        }
+        if (pi < (size_t) pattern.length() && pattern.data()[pi] == '_') {
+            pi += 1;
+            si += utf8_char_length(str, si);
+            continue;
+        }
+        if (pi < (size_t) pattern.length()
+            && fold_ascii(pattern.data()[pi]) == fold_ascii(str.data()[si]))
+        {
+            pi += 1;
+            si += 1;
+            continue;
+        }
+        if (star_pi != npos) {
+            pi = star_pi;
+            star_si += utf8_char_length(str, star_si);
+            si = star_si;
+            continue;
+        }
+        return false;
+    }
+
+    while (pi < (size_t) pattern.length() && pattern.data()[pi] == '%') {
+        pi += 1;
+    }
+
+    return pi == (size_t) pattern.length();
+}
+
+}  // namespace
+
+struct node {
+    enum class op_t : uint8_t {
+        literal,
+        variable,
+        logical_and,
+        logical_or,
+        logical_not,
+        compare,
+        like,
+        regexp,
+        in,
+        is_null,
+        truth,
+    };
+
+    enum class compare_t : uint8_t {
+        eq,
+        ne,
+        lt,
+        le,
+        gt,
+        ge,
+    };
+
+    explicit node(op_t op) : n_op(op) {}
+
+    op_t n_op;
+    compare_t n_compare{compare_t::eq};
+    /** Set for the NOT LIKE, NOT REGEXP, NOT IN, and IS NOT NULL forms. */
+    bool n_negate{false};
+    value n_literal;
+    std::string n_literal_storage;
+    size_t n_variable{0};
+    std::vector<std::unique_ptr<node>> n_children;
+    std::shared_ptr<lnav::pcre2pp::code> n_regex;
+
+    const value& operand(const std::vector<value>& vars) const
+    {
+        if (this->n_op == op_t::variable) {
+            return vars[this->n_variable];
+        }
+        return this->n_literal;
+    }
+
+    tri_t eval(const std::vector<value>& vars) const
+    {
+        switch (this->n_op) {
+            case op_t::literal:
+            case op_t::variable:
+            case op_t::truth:
+                return to_truth(this->n_children.empty()
+                                    ? this->operand(vars)
+                                    : this->n_children[0]->operand(vars));
+            case op_t::logical_and: {
+                auto retval = tri_t::yes;
+
+                for (const auto& child : this->n_children) {
+                    auto res = child->eval(vars);
+
+                    if (res == tri_t::no) {
+                        return tri_t::no;
+                    }
+                    if (res == tri_t::null) {
+                        retval = tri_t::null;
+                    }
+                }
+                return retval;
+            }
+            case op_t::logical_or: {
+                auto retval = tri_t::no;
+
+                for (const auto& child : this->n_children) {
+                    auto res = child->eval(vars);
+
+                    if (res == tri_t::yes) {
+                        return tri_t::yes;
+                    }
+                    if (res == tri_t::null) {
+                        retval = tri_t::null;
+                    }
+                }
+                return retval;
+            }
+            case op_t::logical_not:
+                return negate(this->n_children[0]->eval(vars));
+            case op_t::compare: {
+                const auto& lhs = this->n_children[0]->operand(vars);
+                const auto& rhs = this->n_children[1]->operand(vars);
+
+                if (lhs.v_kind == value::kind_t::null
+                    || rhs.v_kind == value::kind_t::null)
+                {
+                    return tri_t::null;
+                }
+
+                auto rc = compare_values(lhs, rhs);
+                switch (this->n_compare) {
+                    case compare_t::eq:
+                        return to_tri(rc == 0);
+                    case compare_t::ne:
+                        return to_tri(rc != 0);
+                    case compare_t::lt:
+                        return to_tri(rc < 0);
+                    case compare_t::le:
+                        return to_tri(rc <= 0);
+                    case compare_t::gt:
+                        return to_tri(rc > 0);
+                    case compare_t::ge:
+                        return to_tri(rc >= 0);
+                }
+                return tri_t::null;
+            }
+            case op_t::like: {
+                const auto& lhs = this->n_children[0]->operand(vars);
+                const auto& pattern = this->n_children[1]->operand(vars);
+
+                if (lhs.v_kind == value::kind_t::null
+                    || pattern.v_kind == value::kind_t::null)
+                {
+                    return tri_t::null;
+                }
+
+                std::string lhs_buf, pattern_buf;
+                auto res = to_tri(like_match(to_text(pattern, pattern_buf),
+                                             to_text(lhs, lhs_buf)));
+                return this->n_negate ? negate(res) : res;
+            }
+            case op_t::regexp: {
+                const auto& lhs = this->n_children[0]->operand(vars);
+
+                if (lhs.v_kind == value::kind_t::null) {
+                    return tri_t::null;
+                }
+
+                std::string lhs_buf;
+                auto res = to_tri(this->n_regex->find_in(to_text(lhs, lhs_buf))
+                                      .ignore_error()
+                                      .has_value());
+                return this->n_negate ? negate(res) : res;
+            }
+            case op_t::in: {
+                const auto& lhs = this->n_children[0]->operand(vars);
+
+                if (lhs.v_kind == value::kind_t::null) {
+                    return tri_t::null;
+                }
+
+                auto retval = tri_t::no;
+                for (size_t lpc = 1; lpc < this->n_children.size(); lpc++) {
+                    const auto& rhs = this->n_children[lpc]->operand(vars);
+
+                    if (rhs.v_kind == value::kind_t::null) {
+                        retval = tri_t::null;
+                    } else if (compare_values(lhs, rhs) == 0) {
+                        retval = tri_t::yes;
+                        break;
+                    }
+                }
+                return this->n_negate ? negate(retval) : retval;
+            }
+            case op_t::is_null: {
+                const auto& lhs = this->n_children[0]->operand(vars);
+                auto res = to_tri(lhs.v_kind == value::kind_t::null);
+
+                return this->n_negate ? negate(res) : res;
+            }
+        }
+
+        return tri_t::null;
+    }
+};
+
+namespace {
+
+struct token {
+    enum class type_t : uint8_t {
+        end,
+        identifier,
+        variable,
+        string,
+        number,
+        oper,
+        lparen,
+        rparen,
+        comma,
+        unknown,
+    };
+
+    type_t t_type{type_t::end};
+    string_fragment t_text;
+
+    bool is_keyword(const char* kw) const
+    {
+        return this->t_type == type_t::identifier
+            && this->t_text.iequal(string_fragment::from_c_str(kw));
+    }
+
+    bool is_oper(const char* op) const
+    {
+        return this->t_type == type_t::oper && this->t_text == op;
+    }
+};
+
+bool
+is_ident_char(char ch)
+{
+    return isalnum((unsigned char) ch) || ch == '_' || ch == '$'
+        || (unsigned char) ch >= 0x80;
+}
+
+class parser {
+public:
+    explicit parser(string_fragment sf) : p_remaining(sf) { this->advance(); }
+
+    std::unique_ptr<node> parse(std::vector<variable>& vars)
+    {
+        this->p_variables = &vars;
+
+        auto retval = this->parse_or();
+        if (retval != nullptr && this->p_token.t_type != token::type_t::end)
+        {
+            return this->fail("unexpected text");
+        }
+        return retval;
+    }
+
+    std::string p_error;
+
+private:
+    void advance()
+    {
+        auto sf = this->p_remaining.trim();
+        auto& tok = this->p_token;
+
+        tok.t_text = sf.sub_range(0, 0);
+        if (sf.empty()) {
+            tok.t_type = token::type_t::end;
+            this->p_remaining = sf;
+            return;
+        }
+
+        const auto* data = sf.data();
+        auto len = (size_t) sf.length();
+        size_t end = 1;
+        auto ch = data[0];
+
+        if (ch == '(') {
+            tok.t_type = token::type_t::lparen;
+        } else if (ch == ')') {
+            tok.t_type = token::type_t::rparen;
+        } else if (ch == ',') {
+            tok.t_type = token::type_t::comma;
+        } else if (ch == ':' || ch == '$' || ch == '@') {
+            tok.t_type = token::type_t::variable;
+            while (end < len && is_ident_char(data[end])) {
+                end += 1;
+            }
+            if (end == 1) {
+                tok.t_type = token::type_t::unknown;
+            }
+        } else if (ch == '\'') {
+            tok.t_type = token::type_t::unknown;
+            while (end < len) {
+                if (data[end] == '\'') {
+                    if (end + 1 < len && data[end + 1] == '\'') {
+                        end += 2;
+                        continue;
+                    }
+                    end += 1;
+                    tok.t_type = token::type_t::string;
+                    break;
+                }
+                end += 1;
+            }
+        } else if (isdigit((unsigned char) ch)
+                   || (ch == '.' && len > 1 && isdigit((unsigned char) data[1])))
+        {
+            tok.t_type = token::type_t::number;
+            while (end < len
+                   && (isalnum((unsigned char) data[end]) || data[end] == '.'
+                       || ((data[end] == '-' || data[end] == '+')
+                           && (data[end - 1] == 'e' || data[end - 1] == 'E'))))
+            {
+                end += 1;
+            }
+        } else if (isalpha((unsigned char) ch) || ch == '_') {
+            tok.t_type = token::type_t::identifier;
+            while (end < len && is_ident_char(data[end])) {
+                end += 1;
+            }
+        } else if (strchr("=!<>", ch) != nullptr) {
+            tok.t_type = token::type_t::oper;
+            if (end < len
+                && (data[end] == '=' || (ch == '<' && data[end] == '>')))
+            {
+                end += 1;
+            }
+        } else if (ch == '-') {
+            tok.t_type = token::type_t::oper;
+        } else {
+            tok.t_type = token::type_t::unknown;
+        }
+
+        tok.t_text = sf.sub_range(0, end);
+        this->p_remaining = sf.substr(end);
+    }
+
+    std::unique_ptr<node> fail(const std::string& msg)
+    {
+        if (this->p_error.empty()) {
+            if (this->p_token.t_type == token::type_t::end) {
+                this->p_error = fmt::format(FMT_STRING("{} at the end"), msg);
+            } else {
+                this->p_error = fmt::format(FMT_STRING("{} near \"{}\""),
+                                            msg,
+                                            this->p_token.t_text);
+            }
+        }
+        return nullptr;
+    }
+
+    std::unique_ptr<node> parse_or()
+    {
+        auto lhs = this->parse_and();
+
+        if (lhs == nullptr || !this->p_token.is_keyword("or")) {
+            return lhs;
+        }
+
+        auto retval = std::make_unique<node>(node::op_t::logical_or);
+        retval->n_children.emplace_back(std::move(lhs));
+        while (this->p_token.is_keyword("or")) {
+            this->advance();
+            auto rhs = this->parse_and();
+            if (rhs == nullptr) {
+                return nullptr;
+            }
+            retval->n_children.emplace_back(std::move(rhs));
+        }
+
+        return retval;
+    }
+
+    std::unique_ptr<node> parse_and()
+    {
+        auto lhs = this->parse_not();
+
+        if (lhs == nullptr || !this->p_token.is_keyword("and")) {
+            return lhs;
+        }
+
+        auto retval = std::make_unique<node>(node::op_t::logical_and);
+        retval->n_children.emplace_back(std::move(lhs));
+        while (this->p_token.is_keyword("and")) {
+            this->advance();
+            auto rhs = this->parse_not();
+            if (rhs == nullptr) {
+                return nullptr;
+            }
+            retval->n_children.emplace_back(std::move(rhs));
+        }
+
+        return retval;
+    }
+
+    std::unique_ptr<node> parse_not()
+    {
+        if (!this->p_token.is_keyword("not")) {
+            return this->parse_predicate();
+        }
+
+        this->advance();
+        auto child = this->parse_not();
+        if (child == nullptr) {
+            return nullptr;
+        }
+
+        auto retval = std::make_unique<node>(node::op_t::logical_not);
+        retval->n_children.emplace_back(std::move(child));
+        return retval;
+    }
+
+    std::unique_ptr<node> parse_predicate()
+    {
+        static const std::vector<std::pair<const char*, node::compare_t>>
+            COMPARE_OPS = {
+                {"=", node::compare_t::eq},
+                {"==", node::compare_t::eq},
+                {"!=", node::compare_t::ne},
+                {"<>", node::compare_t::ne},
+                {"<", node::compare_t::lt},
+                {"<=", node::compare_t::le},
+                {">", node::compare_t::gt},
+                {">=", node::compare_t::ge},
+            };
+
+        if (this->p_token.t_type == token::type_t::lparen) {
+            this->advance();
+            auto retval = this->parse_or();
+            if (retval == nullptr) {
+                return nullptr;
+            }
+            if (this->p_token.t_type != token::type_t::rparen) {
+                return this->fail("expecting a closing parenthesis");
+            }
+            this->advance();
+            return retval;
+        }
+
+        auto lhs = this->parse_operand();
+        if (lhs == nullptr) {
+            return nullptr;
+        }
+
+        for (const auto& op : COMPARE_OPS) {
+            if (!this->p_token.is_oper(op.first)) {
+                continue;
+            }
+
+            this->advance();
+            auto rhs = this->parse_operand();
+            if (rhs == nullptr) {
+                return nullptr;
+            }
+
+            auto retval = std::make_unique<node>(node::op_t::compare);
+            retval->n_compare = op.second;
+            retval->n_children.emplace_back(std::move(lhs));
+            retval->n_children.emplace_back(std::move(rhs));
+            return retval;
+        }
+
+        if (this->p_token.is_keyword("is")) {
+            auto retval = std::make_unique<node>(node::op_t::is_null);
+
+            this->advance();
+            if (this->p_token.is_keyword("not")) {
+                retval->n_negate = true;
+                this->advance();
+            }
+            if (!this->p_token.is_keyword("null")) {
+                return this->fail("only IS NULL is supported");
+            }
+            this->advance();
+            retval->n_children.emplace_back(std::move(lhs));
+            return retval;
+        }
+
+        auto negated = false;
+        if (this->p_token.is_keyword("not")) {
+            negated = true;
+            this->advance();
+        }
+
+        if (this->p_token.is_keyword("like")) {
+            this->advance();
+            auto rhs = this->parse_operand();
+            if (rhs == nullptr) {
+                return nullptr;
+            }
+            if (this->p_token.is_keyword("escape")) {
+                return this->fail("LIKE with an ESCAPE is not supported");
+            }
+
+            auto retval = std::make_unique<node>(node::op_t::like);
+            retval->n_negate = negated;
+            retval->n_children.emplace_back(std::move(lhs));
+            retval->n_children.emplace_back(std::move(rhs));
+            return retval;
+        }
+
+        if (this->p_token.is_keyword("regexp")) {
+            this->advance();
+            auto rhs = this->parse_operand();
+            if (rhs == nullptr) {
+                return nullptr;
+            }
+            if (rhs->n_op != node::op_t::literal
+                || rhs->n_literal.v_kind != value::kind_t::text)
+            {
+                return this->fail(
+                    "REGEXP is only supported with a string literal pattern");
+            }
+
+            auto compile_res
+                = lnav::pcre2pp::code::from(rhs->n_literal.v_text);
+            if (compile_res.isErr()) {
+                return this->fail("invalid regular expression");
+            }
+
+            auto retval = std::make_unique<node>(node::op_t::regexp);
+            retval->n_negate = negated;
+            retval->n_regex = compile_res.unwrap().to_shared();
+            retval->n_children.emplace_back(std::move(lhs));
+            return retval;
+        }
+
+        if (this->p_token.is_keyword("in")) {
+            this->advance();
+            if (this->p_token.t_type != token::type_t::lparen) {
+                return this->fail("IN is only supported with a list");
+            }
+            this->advance();
+
+            auto retval = std::make_unique<node>(node::op_t::in);
+            retval->n_negate = negated;
+            retval->n_children.emplace_back(std::move(lhs));
+            while (true) {
+                auto elem = this->parse_operand();
+                if (elem == nullptr) {
+                    return nullptr;
+                }
+                retval->n_children.emplace_back(std::move(elem));
+                if (this->p_token.t_type == token::type_t::rparen) {
+                    this->advance();
+                    break;
+                }
+                if (this->p_token.t_type != token::type_t::comma) {
+                    return this->fail("expecting a comma");
+                }
+                this->advance();
+            }
+            return retval;
+        }
+
+        if (negated) {
+            return this->fail("unsupported operator");
+        }
+
+        auto retval = std::make_unique<node>(node::op_t::truth);
+        retval->n_children.emplace_back(std::move(lhs));
+        return retval;
+    }
+
+    std::unique_ptr<node> parse_operand()
+    {
+        const auto& tok = this->p_token;
+
+        if (tok.t_type == token::type_t::variable) {
+            auto retval = std::make_unique<node>(node::op_t::variable);
+            auto name = tok.t_text.to_string();
+            auto& vars = *this->p_variables;
+            auto iter = std::find_if(
+                vars.begin(), vars.end(), [&name](const auto& var) {
+                    return var.v_name == name;
+                });
+
+            if (iter == vars.end()) {
+                auto var_res = resolve_variable(name);
+                if (!var_res) {
+                    return this->fail("unsupported variable");
+                }
+                vars.emplace_back(var_res.value());
+                iter = std::prev(vars.end());
+            }
+            retval->n_variable = std::distance(vars.begin(), iter);
+            this->advance();
+            return retval;
+        }
+
+        auto retval = std::make_unique<node>(node::op_t::literal);
+        if (tok.t_type == token::type_t::string) {
+            auto& storage = retval->n_literal_storage;
+            auto inner = tok.t_text.sub_range(1, tok.t_text.length() - 1);
+
+            for (ssize_t lpc = 0; lpc < inner.length(); lpc++) {
+                storage.push_back(inner.data()[lpc]);
+                if (inner.data()[lpc] == '\'') {
+                    lpc += 1;
+                }
+            }
+            retval->n_literal = value::from_text(
+                string_fragment::from_str(retval->n_literal_storage));
+            this->advance();
+            return retval;
+        }
+
+        auto negative = false;
+        if (tok.is_oper("-")) {
+            negative = true;
+            this->advance();
+        }
+        if (tok.t_type == token::type_t::number) {
+            auto num_str = tok.t_text.to_string();
+            char* end = nullptr;
+
+            errno = 0;
+            if (num_str.size() > 2 && num_str[0] == '0'
+                && (num_str[1] == 'x' || num_str[1] == 'X'))
+            {
+                retval->n_literal = value::from_integer(
+                    (int64_t) strtoull(num_str.c_str(), &end, 16));
+            } else if (num_str.find_first_of(".eE") == std::string::npos) {
+                auto i = strtoll(num_str.c_str(), &end, 10);
+                if (errno == ERANGE) {
+                    retval->n_literal
+                        = value::from_real(strtod(num_str.c_str(), &end));
+                } else {
+                    retval->n_literal = value::from_integer(i);
+                }
+            } else {
+                retval->n_literal
+                    = value::from_real(strtod(num_str.c_str(), &end));
+            }
+            if (end == nullptr || *end != '\0') {
+                return this->fail("invalid number");
+            }
+            if (negative) {
+                retval->n_literal.v_integer = -retval->n_literal.v_integer;
+                retval->n_literal.v_real = -retval->n_literal.v_real;
+            }
+            this->advance();
+            return retval;
+        }
+        if (negative) {
+            return this->fail("unsupported negation");
+        }
+
+        if (tok.is_keyword("null")) {
+            this->advance();
+            return retval;
+        }
+        if (tok.is_keyword("true") || tok.is_keyword("false")) {
+            retval->n_literal = value::from_integer(tok.is_keyword("true"));
+            this->advance();
+            return retval;
+        }
+
+        return this->fail("unsupported expression");
+    }
+
+    static std::optional<variable> resolve_variable(const std::string& name)
+    {
+        static const std::vector<std::pair<const char*, variable_kind_t>>
+            LOG_VARS = {
+                {":log_level", variable_kind_t::log_level},
+                {":log_time", variable_kind_t::log_time},
+                {":log_time_msecs", variable_kind_t::log_time_msecs},
+                {":log_mark", variable_kind_t::log_mark},
+                {":log_comment", variable_kind_t::log_comment},
+                {":log_format", variable_kind_t::log_format},
+                {":log_format_regex", variable_kind_t::log_format_regex},
+                {":log_path", variable_kind_t::log_path},
+                {":log_unique_path", variable_kind_t::log_unique_path},
+                {":log_text", variable_kind_t::log_text},
+                {":log_body", variable_kind_t::log_body},
+                {":log_opid", variable_kind_t::log_opid},
+            };
+        variable retval;
+
+        retval.v_name = name;
+        if (name[0] == '$') {
+            retval.v_kind = variable_kind_t::env;
+            return retval;
+        }
+        for (const auto& log_var : LOG_VARS) {
+            if (name == log_var.first) {
+                retval.v_kind = log_var.second;
+                return retval;
+            }
+        }
+        if (name == ":log_annotations" || name == ":log_tags"
+            || name == ":log_raw_text")
+        {
+            return std::nullopt;
+        }
+
+        retval.v_kind = variable_kind_t::field;
+        retval.v_field = intern_string::lookup(name.substr(1));
+        return retval;
+    }
+
+    string_fragment p_remaining;
+    token p_token;
+    std::vector<variable>* p_variables{nullptr};
+};
+
+}  // namespace
+
+value
+value::from_integer(int64_t i)
+{
+    value retval;
+
+    retval.v_kind = kind_t::integer;
+    retval.v_integer = i;
+    return retval;
+}
+
+value
+value::from_real(double d)
+{
+    value retval;
+
+    retval.v_kind = kind_t::real;
+    retval.v_real = d;
+    return retval;
+}
+
+value
+value::from_text(string_fragment sf)
+{
+    value retval;
+
+    retval.v_kind = kind_t::text;
+    retval.v_text = sf;
+    return retval;
+}
+
+program::~program() = default;
+
+bool
+program::eval(const std::vector<value>& vars) const
+{
+    return this->p_root->eval(vars) == tri_t::yes;
+}
+
+cost_t
+cost_of(variable_kind_t kind)
+{
+    switch (kind) {
+        case variable_kind_t::log_text:
+            return cost_t::read;
+        case variable_kind_t::log_body:
+        case variable_kind_t::log_opid:
+        case variable_kind_t::field:
+            return cost_t::annotate;
+        default:
+            return cost_t::none;
+    }
+}
+
+message::message(::logfile& lf, ::logfile::const_iterator ll)
+    : m_file(lf), m_line(ll),
+      m_line_number(std::distance(lf.cbegin(), ll))
+{
+}
+
+string_fragment
+message::get_timestamp()
+{
+    if (this->m_timestamp_len == 0) {
+        this->m_timestamp_len = sql_strftime(this->m_timestamp,
+                                             sizeof(this->m_timestamp),
+                                             this->m_line->get_timeval(),
+                                             'T');
+    }
+
+    return string_fragment::from_bytes(this->m_timestamp,
+                                       this->m_timestamp_len);
+}
+
+const logline_value_vector&
+message::read()
+{
+    if (!this->m_read) {
+        this->m_file.read_full_message(this->m_line, this->m_values.lvv_sbr);
+        this->m_values.lvv_sbr.erase_ansi();
+        this->m_read = true;
+    }
+
+    return this->m_values;
+}
+
+const logline_value_vector&
+message::annotate()
+{
+    if (!this->m_annotated) {
+        this->read();
+        this->m_file.get_format()->annotate(
+            &this->m_file, this->m_line_number, this->m_attrs, this->m_values);
+        this->m_annotated = true;
+    }
+
+    return this->m_values;
+}
+
+bool
+program::precheck(const std::vector<value>& vars) const
+{
+    return this->run_prechecks(cost_t::read, vars);
+}
+
+bool
+program::run_prechecks(cost_t cost, const std::vector<value>& vars) const
+{
+    for (const auto& pc : this->p_prechecks) {
+        if (pc.pc_cost > cost) {
+            break;
+        }
+        if (pc.pc_node->eval(vars) != tri_t::yes) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool
+program::eval(::logfile& lf, ::logfile::const_iterator ll) const
+{
+    message msg(lf, ll);
+
+    return this->eval(msg);
+}
+
+bool
+program::eval(message& msg) const
+{
+    std::vector<value> vars(this->p_variables.size());
+
+    this->fill(msg, cost_t::none, vars);
+    if (!this->run_prechecks(cost_t::none, vars)) {
+        return false;
+    }
+    if (this->p_cost >= cost_t::read) {
+        this->fill(msg, cost_t::read, vars);
+        if (!this->run_prechecks(cost_t::read, vars)) {
+            return false;
+        }
+    }
+    if (this->p_cost >= cost_t::annotate) {
+        this->fill(msg, cost_t::annotate, vars);
+    }
+
+    return this->eval(vars);
+}
+
+void
+program::fill(message& msg, cost_t cost, std::vector<value>& vars) const
+{
+    auto& lf = msg.get_file();
+    auto ll = msg.get_line();
+    auto format = lf.get_format();
+    auto line_number = msg.get_line_number();
+    const logline_value_vector* values = nullptr;
+
+    switch (cost) {
+        case cost_t::none:
+            break;
+        case cost_t::read:
+            values = &msg.read();
+            break;
+        case cost_t::annotate:
+            values = &msg.annotate();
+            break;
+    }
+
+    for (size_t lpc = 0; lpc < this->p_variables.size(); lpc++) {
+        const auto& var = this->p_variables[lpc];
+        auto& val = vars[lpc];
+
+        if (cost_of(var.v_kind) != cost) {
+            continue;
+        }
+
+        switch (var.v_kind) {
+            case variable_kind_t::env: {
+                const auto* env_value = getenv(var.v_name.c_str() + 1);
+
+                if (env_value != nullptr) {
+                    val = value::from_text(
+                        string_fragment::from_c_str(env_value));
+                }
+                break;
+            }
+            case variable_kind_t::log_level:
+                val = value::from_text(
+                    string_fragment::from_c_str(ll->get_level_name()));
+                break;
+            case variable_kind_t::log_time:
+                val = value::from_text(msg.get_timestamp());
+                break;
+            case variable_kind_t::log_time_msecs:
+                val = value::from_integer(
+                    ll->get_time<std::chrono::milliseconds>().count());
+                break;
+            case variable_kind_t::log_mark:
+                val = value::from_integer(ll->is_marked());
+                break;
+            case variable_kind_t::log_comment: {
+                const auto& bm = lf.get_bookmark_metadata();
+                auto bm_iter = bm.find(line_number);
+
+                if (bm_iter != bm.end() && !bm_iter->second.bm_comment.empty())
+                {
+                    val = value::from_text(string_fragment::from_str(
+                        bm_iter->second.bm_comment));
+                }
+                break;
+            }
+            case variable_kind_t::log_format:
+                val = value::from_text(
+                    format->get_name().to_string_fragment());
+                break;
+            case variable_kind_t::log_format_regex:
+                val = value::from_text(
+                    format->get_pattern_name(line_number).to_string_fragment());
+                break;
+            case variable_kind_t::log_path:
+                val = value::from_text(
+                    string_fragment::from_str(lf.get_filename().native()));
+                break;
+            case variable_kind_t::log_unique_path:
+                val = value::from_text(
+                    string_fragment::from_str(lf.get_unique_path().native()));
+                break;
+            case variable_kind_t::log_text:
+                val = value::from_text(values->lvv_sbr.to_string_fragment());
+                break;
+            case variable_kind_t::log_body: {
+                auto body_attr_opt = get_string_attr(msg.get_attrs(), SA_BODY);
+
+                if (body_attr_opt) {
+                    const auto& sar
+                        = body_attr_opt.value().saw_string_attr->sa_range;
+
+                    val = value::from_text(string_fragment::from_bytes(
+                        values->lvv_sbr.get_data_at(sar.lr_start),
+                        sar.length()));
+                }
+                break;
+            }
+            case variable_kind_t::log_opid:
+                if (values->lvv_opid_value) {
+                    val = value::from_text(string_fragment::from_str(
+                        values->lvv_opid_value.value()));
+                }
+                break;
+            case variable_kind_t::field:
+                for (const auto& lv : values->lvv_values) {
+                    if (lv.lv_meta.lvm_name != var.v_field) {
+                        continue;
+                    }
+
+                    switch (lv.lv_meta.lvm_kind) {
+                        case value_kind_t::VALUE_BOOLEAN:
+                        case value_kind_t::VALUE_INTEGER:
+                            val = value::from_integer(lv.lv_value.i);
+                            break;
+                        case value_kind_t::VALUE_FLOAT:
+                            val = value::from_real(lv.lv_value.d);
+                            break;
+                        case value_kind_t::VALUE_NULL:
+                            break;
+                        default:
+                            val = value::from_text(string_fragment::from_bytes(
+                                lv.text_value(), lv.text_length()));
+                            break;
+                    }
+                    break;
+                }
+                break;
+        }
+    }
+}
+
+static cost_t
+node_cost(const node& n, const std::vector<variable>& vars)
+{
+    auto retval = n.n_op == node::op_t::variable
+        ? cost_of(vars[n.n_variable].v_kind)
+        : cost_t::none;
+
+    for (const auto& child : n.n_children) {
+        retval = std::max(retval, node_cost(*child, vars));
+    }
+
+    return retval;
+}
+
+Result<std::shared_ptr<program>, std::string>
+compile(const std::string& expr)
+{
+    auto retval = std::make_shared<program>();
+    parser p(string_fragment::from_str(expr));
+
+    retval->p_root = p.parse(retval->p_variables);
+    if (retval->p_root == nullptr) {
+        log_info("filter expression will be evaluated by SQLite: %s -- %s",
+                 expr.c_str(),
+                 p.p_error.c_str());
+        return Err(p.p_error);
+    }
+
+    for (const auto& var : retval->p_variables) {
+        retval->p_cost = std::max(retval->p_cost, cost_of(var.v_kind));
+    }
+
+    // The conjuncts of a top-level AND that are cheaper to decide than the
+    // whole expression are checked first so that most messages are
+    // rejected before they are read or annotated.
+    if (retval->p_cost != cost_t::none) {
+        std::vector<const node*> conjuncts;
+
+        if (retval->p_root->n_op == node::op_t::logical_and) {
+            for (const auto& child : retval->p_root->n_children) {
+                conjuncts.emplace_back(child.get());
+            }
+        } else {
+            conjuncts.emplace_back(retval->p_root.get());
+        }
+        for (const auto* conj : conjuncts) {
+            auto cost = node_cost(*conj, retval->p_variables);
+
+            if (cost < retval->p_cost) {
+                retval->p_prechecks.emplace_back(
+                    program::precheck_t{conj, cost});
+            }
+        }
+        std::stable_sort(retval->p_prechecks.begin(),
+                         retval->p_prechecks.end(),
+                         [](const auto& lhs, const auto& rhs) {
+                             return lhs.pc_cost < rhs.pc_cost;
+                         });
+    }
+
+    log_info("filter expression will be evaluated natively: %s",
+             expr.c_str());
+    return Ok(retval);
+}
+
+Result<std::shared_ptr<program>, std::string>
+compile(sqlite3_stmt* stmt)
+{
+    static const auto PREFIX = string_fragment::from_const("SELECT 1 WHERE ");
+
+    const auto* sql = sqlite3_sql(stmt);
+    if (sql == nullptr) {
+        return Err(std::string("statement has no SQL"));
+    }
+
+    auto sql_sf = string_fragment::from_c_str(sql);
+    if (!sql_sf.startswith(PREFIX.data())) {
+        return Err(std::string("statement is not a filter expression"));
+    }
+
+    return compile(sql_sf.substr(PREFIX.length()).to_string());
+}
+
+}  // namespace lnav::log::filter_expr
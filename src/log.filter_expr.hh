@@ -0,0 +1,243 @@
+/**
+ * Copyright (c) 2024, Timothy Stack
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ * * Neither the name of Timothy Stack nor the names of its contributors
+ * may be used to endorse or promote products derived from this software
+ * without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE REGENTS AND CONTRIBUTORS ''AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef lnav_log_filter_expr_hh
+#define lnav_log_filter_expr_hh
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "base/intern_string.hh"
+#include "base/result.h"
+#include "log_format.hh"
+#include "logfile.hh"
+
+struct sqlite3_stmt;
+
+/**
+ * A compiler for the SQL expressions used by :filter-expr and :mark-expr.
+ * Evaluating these expressions with SQLite requires binding the values
+ * extracted from every message to a prepared statement and stepping it.
+ * Expressions that only use comparisons, AND/OR/NOT, LIKE, REGEXP, IN
+ * lists, and IS NULL checks over the bound variables are compiled into a
+ * tree that is evaluated directly against the message instead.  The
+ * semantics of the SQLite operators are followed, including the handling
+ * of NULL and the ordering of values with different types.
+ */
+namespace lnav::log::filter_expr {
+
+struct value {
+    enum class kind_t : uint8_t {
+        null,
+        integer,
+        real,
+        text,
+    };
+
+    static value from_integer(int64_t i);
+    static value from_real(double d);
+    static value from_text(string_fragment sf);
+
+    kind_t v_kind{kind_t::null};
+    int64_t v_integer{0};
+    double v_real{0.0};
+    string_fragment v_text;
+};
+
+enum class variable_kind_t : uint8_t {
+    env,
+    field,
+    log_level,
+    log_time,
+    log_time_msecs,
+    log_mark,
+    log_comment,
+    log_format,
+    log_format_regex,
+    log_path,
+    log_unique_path,
+    log_text,
+    log_body,
+    log_opid,
+};
+
+struct variable {
+    /** The name of the variable, including the leading ':' or '$'. */
+    std::string v_name;
+    variable_kind_t v_kind{variable_kind_t::field};
+    /** The name of the format field for variable_kind_t::field. */
+    intern_string_t v_field;
+};
+
+/**
+ * How much of a message has to be loaded to get the value of a variable.
+ */
+enum class cost_t : uint8_t {
+    /** The value comes from the line index or the file. */
+    none,
+    /** The text of the message has to be read. */
+    read,
+    /** The message has to be read and annotated by the format. */
+    annotate,
+};
+
+cost_t cost_of(variable_kind_t kind);
+
+/**
+ * A message in a log file whose contents are read and annotated on demand,
+ * so that the work can be shared by several expressions evaluated against
+ * the same message.
+ */
+class message {
+public:
+    message(::logfile& lf, ::logfile::const_iterator ll);
+
+    ::logfile& get_file() const { return this->m_file; }
+
+    ::logfile::const_iterator get_line() const { return this->m_line; }
+
+    size_t get_line_number() const { return this->m_line_number; }
+
+    /**
+     * @return The timestamp of the message in the format used by SQL.
+     */
+    string_fragment get_timestamp();
+
+    /**
+     * Read the full message with any ANSI escapes removed.
+     */
+    const logline_value_vector& read();
+
+    /**
+     * Read and annotate the message to get the values of the fields.
+     */
+    const logline_value_vector& annotate();
+
+    const string_attrs_t& get_attrs() const { return this->m_attrs; }
+
+private:
+    ::logfile& m_file;
+    ::logfile::const_iterator m_line;
+    size_t m_line_number;
+    char m_timestamp[64];
+    size_t m_timestamp_len{0};
+    bool m_read{false};
+    bool m_annotated{false};
+    logline_value_vector m_values;
+    string_attrs_t m_attrs;
+};
+
+struct node;
+
+class program {
+public:
+    ~program();
+
+    /**
+     * @return The variables referenced by the expression.
+     */
+    const std::vector<variable>& get_variables() const
+    {
+        return this->p_variables;
+    }
+
+    /**
+     * Evaluate the expression with the given values for the variables.
+     *
+     * @param vars The values in the same order as get_variables().
+     * @return True if the expression is true, false if it is false or NULL.
+     */
+    bool eval(const std::vector<value>& vars) const;
+
+    /**
+     * Evaluate the top-level conjuncts of the expression that do not need
+     * the message to be annotated.  The values of the other variables are
+     * ignored.
+     *
+     * @return False if the expression cannot be true.
+     */
+    bool precheck(const std::vector<value>& vars) const;
+
+    /**
+     * Evaluate the expression against a message in a log file.
+     */
+    bool eval(::logfile& lf, ::logfile::const_iterator ll) const;
+
+    /**
+     * Evaluate the expression against a message, only loading as much of
+     * the message as is needed to decide the result.
+     */
+    bool eval(message& msg) const;
+
+    /**
+     * @return The most expensive variable referenced by the expression.
+     */
+    cost_t get_cost() const { return this->p_cost; }
+
+private:
+    struct precheck_t {
+        const node* pc_node;
+        cost_t pc_cost;
+    };
+
+    void fill(message& msg, cost_t cost, std::vector<value>& vars) const;
+    bool run_prechecks(cost_t cost, const std::vector<value>& vars) const;
+
+    friend Result<std::shared_ptr<program>, std::string> compile(
+        const std::string& expr);
+
+    std::unique_ptr<node> p_root;
+    std::vector<variable> p_variables;
+    /**
+     * The conjuncts at the top of the expression that can be evaluated
+     * before the message is annotated, cheapest first.
+     */
+    std::vector<precheck_t> p_prechecks;
+    cost_t p_cost{cost_t::none};
+};
+
+/**
+ * Compile an expression.
+ *
+ * @param expr The expression from the :filter-expr/:mark-expr command.
+ * @return The compiled program or the reason the expression needs to be
+ *   evaluated by SQLite.
+ */
+Result<std::shared_ptr<program>, std::string> compile(const std::string& expr);
+
+/**
+ * Compile the expression in a statement prepared by :filter-expr or
+ * :mark-expr, which has the form "SELECT 1 WHERE <expr>".
+ */
+Result<std::shared_ptr<program>, std::string> compile(sqlite3_stmt* stmt);
+
+}  // namespace lnav::log::filter_expr
+
+#endif
@@ -0,0 +1,267 @@
+/**
+ * Copyright (c) 2024, Timothy Stack
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ * * Neither the name of Timothy Stack nor the names of its contributors
+ * may be used to endorse or promote products derived from this software
+ * without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE REGENTS AND CONTRIBUTORS ''AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "log.format_detect.hh"
+
+#include <algorithm>
+
+#include <string.h>
+#include <strings.h>
+
+#include "config.h"
+#include "log_format_ext.hh"
+
+namespace lnav::log {
+
+static bool
+literal_at(string_fragment line,
+           size_t offset,
+           const std::string& text,
+           bool caseless)
+{
+    if (offset + text.size() > (size_t) line.length()) {
+        return false;
+    }
+
+    const auto* data = line.data() + offset;
+    if (caseless) {
+        return strncasecmp(data, text.data(), text.size()) == 0;
+    }
+    return memcmp(data, text.data(), text.size()) == 0;
+}
+
+format_detector&
+format_detector::singleton()
+{
+    static format_detector retval;
+
+    return retval;
+}
+
+void
+format_detector::build(const std::vector<std::shared_ptr<log_format>>& formats)
+{
+    this->fd_entries.clear();
+    this->fd_literals.clear();
+    for (auto& by_byte : this->fd_literals_by_first_byte) {
+        by_byte.clear();
+    }
+
+    auto literal_index = [this](const std::string& text, bool caseless) {
+        auto iter = std::find_if(
+            this->fd_literals.begin(),
+            this->fd_literals.end(),
+            [&](const auto& lit) {
+                return lit.l_text == text && lit.l_caseless == caseless;
+            });
+        if (iter != this->fd_literals.end()) {
+            return (int32_t) std::distance(this->fd_literals.begin(), iter);
+        }
+
+        auto retval = (uint32_t) this->fd_literals.size();
+        auto first = (unsigned char) text[0];
+        this->fd_literals.emplace_back(literal{text, caseless});
+        if (caseless) {
+            this->fd_literals_by_first_byte[tolower(first)].emplace_back(
+                retval);
+            if (toupper(first) != tolower(first)) {
+                this->fd_literals_by_first_byte[toupper(first)].emplace_back(
+                    retval);
+            }
+        } else {
+            this->fd_literals_by_first_byte[first].emplace_back(retval);
+        }
+        return (int32_t) retval;
+    };
+
+    for (const auto& format : formats) {
+        auto& ent = this->fd_entries.emplace_back();
+
+        ent.e_format = format.get();
+        ent.e_name = format->get_name();
+
+        const auto* elf = dynamic_cast<const external_log_format*>(format.get());
+        if (elf == nullptr) {
+            continue;
+        }
+
+        switch (elf->elf_type) {
+            case external_log_format::elf_type_t::ELF_TYPE_JSON:
+                ent.e_prefilter = prefilter_t::json;
+                break;
+            case external_log_format::elf_type_t::ELF_TYPE_TEXT: {
+                std::vector<pattern_gate> gates;
+                std::bitset<256> first_bytes;
+                auto gated = true;
+
+                for (const auto& pat : elf->elf_pattern_order) {
+                    if (pat->p_module_format) {
+                        continue;
+                    }
+
+                    const auto& code = pat->p_pcre.pp_value;
+                    if (code == nullptr) {
+                        gated = false;
+                        break;
+                    }
+
+                    pattern_gate pg;
+                    if (code->is_anchored()) {
+                        pg.pg_first_bytes
+                            = code->get_first_bytes().value_or(
+                                std::bitset<256>{});
+                    }
+                    pg.pg_min_length = code->get_min_length();
+                    const auto& rl = code->get_required_literal();
+                    if (rl && rl->rl_anchored) {
+                        pg.pg_prefix = rl->rl_text;
+                        pg.pg_prefix_caseless = rl->rl_caseless;
+                    } else if (rl) {
+                        pg.pg_literal_index
+                            = literal_index(rl->rl_text, rl->rl_caseless);
+                    }
+                    if (pg.pg_first_bytes.none()) {
+                        first_bytes.set();
+                    } else {
+                        first_bytes |= pg.pg_first_bytes;
+                    }
+                    if (pg.is_empty()) {
+                        gated = false;
+                        break;
+                    }
+                    gates.emplace_back(std::move(pg));
+                }
+                if (gated) {
+                    ent.e_prefilter = prefilter_t::pattern;
+                    ent.e_first_bytes = first_bytes;
+                    ent.e_patterns = std::move(gates);
+                }
+                break;
+            }
+            default:
+                break;
+        }
+    }
+}
+
+format_detector::candidates
+format_detector::find_candidates(string_fragment line) const
+{
+    candidates retval(*this, line);
+    auto remaining = this->fd_literals.size();
+    const auto* data = (const unsigned char*) line.data();
+
+    retval.c_found.resize(this->fd_literals.size());
+    for (size_t lpc = 0; lpc < (size_t) line.length() && remaining > 0; lpc++)
+    {
+        const auto& ids = this->fd_literals_by_first_byte[data[lpc]];
+
+        for (const auto id : ids) {
+            if (retval.c_found[id]) {
+                continue;
+            }
+
+            const auto& lit = this->fd_literals[id];
+            if (literal_at(line, lpc, lit.l_text, lit.l_caseless)) {
+                retval.c_found[id] = true;
+                remaining -= 1;
+            }
+        }
+    }
+
+    return retval;
+}
+
+bool
+format_detector::candidates::may_match(size_t index,
+                                       const log_format* format) const
+{
+    const auto& entries = this->c_detector.fd_entries;
+
+    if (index >= entries.size() || entries[index].e_format != format) {
+        return true;
+    }
+
+    const auto& ent = entries[index];
+    switch (ent.e_prefilter) {
+        case prefilter_t::none:
+            return true;
+        case prefilter_t::json:
+            return this->c_line.startswith("{");
+        case prefilter_t::pattern: {
+            const auto first_byte = this->c_line.empty()
+                ? -1
+                : (int) (unsigned char) this->c_line.front();
+
+            if (first_byte != -1 && !ent.e_first_bytes.test(first_byte)) {
+                return false;
+            }
+            for (const auto& pg : ent.e_patterns) {
+                if (pg.pg_first_bytes.any()
+                    && (first_byte == -1
+                        || !pg.pg_first_bytes.test(first_byte)))
+                {
+                    continue;
+                }
+                if ((size_t) this->c_line.length() < pg.pg_min_length) {
+                    continue;
+                }
+                if (!pg.pg_prefix.empty()
+                    && !literal_at(
+                        this->c_line, 0, pg.pg_prefix, pg.pg_prefix_caseless))
+                {
+                    continue;
+                }
+                if (pg.pg_literal_index != -1
+                    && !this->c_found[pg.pg_literal_index])
+                {
+                    continue;
+                }
+                return true;
+            }
+            return false;
+        }
+    }
+
+    return true;
+}
+
+format_detector::format_stats*
+format_detector::get_stats(size_t index, const log_format* format)
+{
+    if (index >= this->fd_entries.size()
+        || this->fd_entries[index].e_format != format)
+    {
+        return nullptr;
+    }
+
+    return &this->fd_entries[index].e_stats;
+}
+
+}  // namespace lnav::log
@@ -0,0 +1,161 @@
+/**
+ * Copyright (c) 2024, Timothy Stack
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ * * Neither the name of Timothy Stack nor the names of its contributors
+ * may be used to endorse or promote products derived from this software
+ * without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE REGENTS AND CONTRIBUTORS ''AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef lnav_log_format_detect_hh
+#define lnav_log_format_detect_hh
+
+#include <array>
+#include <bitset>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "base/intern_string.hh"
+
+class log_format;
+
+namespace lnav::log {
+
+/**
+ * An index over the root log formats that is used during format detection
+ * to quickly rule out the formats that cannot possibly match a line.  For
+ * each pattern of a text format, the index keeps the bytes that an anchored
+ * pattern can start with, the minimum length of a match, and a literal
+ * string that the pattern requires.  The unanchored literals from all of
+ * the formats are gathered into a single table that is checked in one pass
+ * over the line.  A format only needs to be scanned if one of its patterns
+ * passes all of its checks.
+ */
+class format_detector {
+public:
+    enum class prefilter_t {
+        /** The format has to be scanned for every line. */
+        none,
+        /** The line must be a JSON object. */
+        json,
+        /** The line must pass the checks for one of the patterns. */
+        pattern,
+    };
+
+    struct format_stats {
+        size_t fs_scans{0};
+        size_t fs_skips{0};
+        size_t fs_matches{0};
+        std::chrono::nanoseconds fs_scan_time{0};
+    };
+
+    struct pattern_gate {
+        /** The bytes that the line can start with, empty if any byte. */
+        std::bitset<256> pg_first_bytes;
+        size_t pg_min_length{0};
+        /** The literal that has to be at the start of the line. */
+        std::string pg_prefix;
+        bool pg_prefix_caseless{false};
+        /** The index of the literal in the table or -1. */
+        int32_t pg_literal_index{-1};
+
+        bool is_empty() const
+        {
+            return this->pg_first_bytes.none() && this->pg_min_length == 0
+                && this->pg_prefix.empty() && this->pg_literal_index == -1;
+        }
+    };
+
+    struct entry {
+        const log_format* e_format{nullptr};
+        intern_string_t e_name;
+        prefilter_t e_prefilter{prefilter_t::none};
+        /** The union of the first bytes of the patterns. */
+        std::bitset<256> e_first_bytes;
+        std::vector<pattern_gate> e_patterns;
+        format_stats e_stats;
+    };
+
+    /**
+     * The result of checking a line against the index.
+     */
+    class candidates {
+    public:
+        /**
+         * @param index The position of the format in the root formats.
+         * @param format The format at that position.
+         * @return false if the format cannot match the line.
+         */
+        bool may_match(size_t index, const log_format* format) const;
+
+    private:
+        friend format_detector;
+
+        candidates(const format_detector& fd, string_fragment line)
+            : c_detector(fd), c_line(line)
+        {
+        }
+
+        const format_detector& c_detector;
+        string_fragment c_line;
+        std::vector<bool> c_found;
+    };
+
+    static format_detector& singleton();
+
+    /**
+     * Rebuild the index from the given formats, the stats are reset.
+     */
+    void build(const std::vector<std::shared_ptr<log_format>>& formats);
+
+    candidates find_candidates(string_fragment line) const;
+
+    /**
+     * @return The stats for the format at the given position in the root
+     *   formats or nullptr if the index is out-of-date.
+     */
+    format_stats* get_stats(size_t index, const log_format* format);
+
+    const std::vector<entry>& get_entries() const
+    {
+        return this->fd_entries;
+    }
+
+    size_t get_literal_count() const { return this->fd_literals.size(); }
+
+private:
+    struct literal {
+        std::string l_text;
+        bool l_caseless{false};
+    };
+
+    std::vector<entry> fd_entries;
+    std::vector<literal> fd_literals;
+    std::array<std::vector<uint32_t>, 256> fd_literals_by_first_byte;
+};
+
+}  // namespace lnav::log
+
+#endif
@@ -0,0 +1,351 @@
+/**
+ * Copyright (c) 2026, Timothy Stack
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ * * Neither the name of Timothy Stack nor the names of its contributors
+ * may be used to endorse or promote products derived from this software
+ * without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE REGENTS AND CONTRIBUTORS ''AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <algorithm>
+
+#include "log.opid_index.hh"
+
+#include "config.h"
+#include "logfile.hh"
+
+namespace lnav::log {
+
+static bool
+entry_less(const opid_index::entry& lhs, const opid_index::entry& rhs)
+{
+    if (lhs.e_range.tr_begin != rhs.e_range.tr_begin) {
+        return lhs.e_range.tr_begin < rhs.e_range.tr_begin;
+    }
+    if (lhs.e_opid != rhs.e_opid) {
+        return lhs.e_opid < rhs.e_opid;
+    }
+    // the operation comes before its sub-operations
+    if (lhs.e_subid.is_valid() != rhs.e_subid.is_valid()) {
+        return !lhs.e_subid.is_valid();
+    }
+    return lhs.e_subid < rhs.e_subid;
+}
+
+bool
+opid_index::update(const std::vector<std::shared_ptr<::logfile>>& files)
+{
+    std::vector<source> curr_sources;
+    opid_set dirty;
+    auto all_updated = false;
+
+    curr_sources.reserve(files.size());
+    for (const auto& lf : files) {
+        safe::WriteAccess<logfile::safe_opid_state> w_opid_map(
+            lf->get_opids());
+        auto& updates = w_opid_map->los_index_updates;
+
+        curr_sources.emplace_back(source{
+            lf.get(),
+            w_opid_map->los_generation,
+        });
+        if (updates.ou_all) {
+            all_updated = true;
+        } else {
+            dirty.insert(updates.ou_opids.begin(), updates.ou_opids.end());
+        }
+        updates.reset();
+    }
+
+    if (all_updated || curr_sources != this->oi_sources) {
+        this->clear();
+        for (const auto& lf : files) {
+            safe::ReadAccess<logfile::safe_opid_state> r_opid_map(
+                lf->get_opids());
+
+            this->add(r_opid_map->los_opid_ranges);
+        }
+        this->build();
+        this->oi_sources = std::move(curr_sources);
+
+        return true;
+    }
+
+    if (dirty.empty()) {
+        return false;
+    }
+
+    std::vector<std::unique_ptr<safe::ReadAccess<logfile::safe_opid_state>>>
+        r_opid_maps;
+    std::vector<const log_opid_map*> maps;
+    auto cleared = false;
+    r_opid_maps.reserve(files.size());
+    maps.reserve(files.size());
+    for (size_t lpc = 0; lpc < files.size(); lpc++) {
+        r_opid_maps.emplace_back(
+            std::make_unique<safe::ReadAccess<logfile::safe_opid_state>>(
+                files[lpc]->get_opids()));
+        const auto& opid_state = *r_opid_maps.back();
+
+        maps.emplace_back(&opid_state->los_opid_ranges);
+        if (opid_state->los_generation
+            != curr_sources[lpc].s_generation)
+        {
+            cleared = true;
+        }
+    }
+    if (!cleared) {
+        // The dirty opids refer to the maps, so they are only valid if
+        // none of the files were cleared since they were taken.
+        for (const auto& opid : dirty) {
+            this->update_opid(opid, maps);
+        }
+    }
+    if (cleared || this->needs_rebuild()) {
+        this->clear();
+        for (const auto* map : maps) {
+            this->add(*map);
+        }
+        this->build();
+        this->oi_sources = std::move(curr_sources);
+    }
+
+    return true;
+}
+
+void
+opid_index::clear()
+{
+    this->oi_sources.clear();
+    this->oi_merged.clear();
+    this->oi_entries.clear();
+    this->oi_dead.clear();
+    this->oi_opid_entries.clear();
+    this->oi_tree_size = 0;
+    this->oi_live_count = 0;
+    this->oi_tree = tree_t{};
+    this->oi_allocator.reset();
+}
+
+void
+opid_index::add(const log_opid_map& opids)
+{
+    for (const auto& pair : opids) {
+        auto merged_iter = this->oi_merged.find(pair.first);
+
+        if (merged_iter == this->oi_merged.end()) {
+            auto emp_res = this->oi_merged.emplace(
+                pair.first.to_owned(this->oi_allocator), pair.second);
+
+            for (auto& sub : emp_res.first->second.otr_sub_ops) {
+                sub.ostr_subid = sub.ostr_subid.to_owned(this->oi_allocator);
+            }
+        } else {
+            auto prev_sub_count = merged_iter->second.otr_sub_ops.size();
+
+            merged_iter->second |= pair.second;
+            if (merged_iter->second.otr_sub_ops.size() != prev_sub_count) {
+                for (auto& sub : merged_iter->second.otr_sub_ops) {
+                    sub.ostr_subid
+                        = sub.ostr_subid.to_owned(this->oi_allocator);
+                }
+            }
+        }
+    }
+}
+
+void
+opid_index::append_entries(const string_fragment& opid,
+                           const opid_time_range& otr)
+{
+    // Cleared ranges have their beginning after the end.
+    if (otr.otr_range.tr_end < otr.otr_range.tr_begin) {
+        return;
+    }
+
+    this->oi_entries.emplace_back(entry{
+        opid,
+        string_fragment::invalid(),
+        otr.otr_range,
+        otr.otr_level_stats,
+    });
+    for (const auto& sub : otr.otr_sub_ops) {
+        if (sub.ostr_range.tr_end < sub.ostr_range.tr_begin) {
+            continue;
+        }
+        this->oi_entries.emplace_back(entry{
+            opid,
+            sub.ostr_subid,
+            sub.ostr_range,
+            sub.ostr_level_stats,
+        });
+    }
+}
+
+void
+opid_index::build()
+{
+    this->oi_entries.clear();
+    for (const auto& pair : this->oi_merged) {
+        this->append_entries(pair.first, pair.second);
+    }
+    this->oi_merged.clear();
+
+    std::stable_sort(
+        this->oi_entries.begin(), this->oi_entries.end(), entry_less);
+
+    tree_t::interval_vector intervals;
+    intervals.reserve(this->oi_entries.size());
+    this->oi_opid_entries.clear();
+    for (size_t lpc = 0; lpc < this->oi_entries.size(); lpc++) {
+        const auto& ent = this->oi_entries[lpc];
+
+        intervals.emplace_back(to_us(ent.e_range.tr_begin).count(),
+                               to_us(ent.e_range.tr_end).count(),
+                               lpc);
+        this->oi_opid_entries[ent.e_opid].emplace_back(lpc);
+    }
+    this->oi_tree = tree_t{std::move(intervals)};
+    this->oi_dead.assign(this->oi_entries.size(), false);
+    this->oi_tree_size = this->oi_entries.size();
+    this->oi_live_count = this->oi_entries.size();
+}
+
+void
+opid_index::update_opid(const string_fragment& opid,
+                        const std::vector<const log_opid_map*>& maps)
+{
+    std::optional<opid_time_range> merged;
+
+    for (const auto* map : maps) {
+        auto iter = map->find(opid);
+        if (iter == map->end()) {
+            continue;
+        }
+
+        if (merged) {
+            merged.value() |= iter->second;
+        } else {
+            merged = iter->second;
+        }
+    }
+
+    auto entries_iter = this->oi_opid_entries.find(opid);
+    if (entries_iter != this->oi_opid_entries.end()) {
+        for (const auto index : entries_iter->second) {
+            if (!this->oi_dead[index]) {
+                this->oi_dead[index] = true;
+                this->oi_live_count -= 1;
+            }
+        }
+        entries_iter->second.clear();
+    }
+    if (!merged) {
+        return;
+    }
+
+    string_fragment owned_opid;
+    if (entries_iter != this->oi_opid_entries.end()) {
+        owned_opid = entries_iter->first;
+    } else {
+        owned_opid = opid.to_owned(this->oi_allocator);
+        entries_iter
+            = this->oi_opid_entries.emplace(owned_opid, std::vector<size_t>{})
+                  .first;
+    }
+    for (auto& sub : merged->otr_sub_ops) {
+        sub.ostr_subid = sub.ostr_subid.to_owned(this->oi_allocator);
+    }
+
+    auto start = this->oi_entries.size();
+    this->append_entries(owned_opid, merged.value());
+    for (auto index = start; index < this->oi_entries.size(); index++) {
+        entries_iter->second.emplace_back(index);
+        this->oi_dead.emplace_back(false);
+        this->oi_live_count += 1;
+    }
+}
+
+bool
+opid_index::needs_rebuild() const
+{
+    auto appended = this->oi_entries.size() - this->oi_tree_size;
+
+    return appended > 1024 && appended > this->oi_tree_size / 8;
+}
+
+std::vector<const opid_index::entry*>
+opid_index::overlapping(const timeval& low, const timeval& high) const
+{
+    const auto low_us = to_us(low).count();
+    const auto high_us = to_us(high).count();
+    std::vector<size_t> indexes;
+
+    this->oi_tree.visit_overlapping(
+        low_us, high_us, [this, &indexes](const auto& iv) {
+            if (!this->oi_dead[iv.value]) {
+                indexes.emplace_back(iv.value);
+            }
+        });
+    std::sort(indexes.begin(), indexes.end());
+
+    std::vector<const entry*> retval;
+    retval.reserve(indexes.size());
+    for (const auto index : indexes) {
+        retval.emplace_back(&this->oi_entries[index]);
+    }
+
+    std::vector<const entry*> appended;
+    for (auto index = this->oi_tree_size; index < this->oi_entries.size();
+         index++)
+    {
+        const auto& ent = this->oi_entries[index];
+
+        if (this->oi_dead[index] || to_us(ent.e_range.tr_begin).count() > high_us
+            || to_us(ent.e_range.tr_end).count() < low_us)
+        {
+            continue;
+        }
+        appended.emplace_back(&ent);
+    }
+    if (!appended.empty()) {
+        auto ptr_less = [](const entry* lhs, const entry* rhs) {
+            return entry_less(*lhs, *rhs);
+        };
+        std::vector<const entry*> merged;
+
+        std::sort(appended.begin(), appended.end(), ptr_less);
+        merged.reserve(retval.size() + appended.size());
+        std::merge(retval.begin(),
+                   retval.end(),
+                   appended.begin(),
+                   appended.end(),
+                   std::back_inserter(merged),
+                   ptr_less);
+        retval = std::move(merged);
+    }
+
+    return retval;
+}
+
+}  // namespace lnav::log
@@ -0,0 +1,148 @@
+/**
+ * Copyright (c) 2026, Timothy Stack
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ * * Neither the name of Timothy Stack nor the names of its contributors
+ * may be used to endorse or promote products derived from this software
+ * without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE REGENTS AND CONTRIBUTORS ''AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef lnav_log_opid_index_hh
+#define lnav_log_opid_index_hh
+
+#include <memory>
+#include <vector>
+
+#include "ArenaAlloc/arenaalloc.h"
+#include "base/intern_string.hh"
+#include "base/time_util.hh"
+#include "intervaltree/IntervalTree.h"
+#include "log_format_fwd.hh"
+
+class logfile;
+
+namespace lnav::log {
+
+/**
+ * An index of the time ranges of the operations and sub-operations across a
+ * set of log files.  The ranges for an operation that appears in more than
+ * one file are merged together.  The index is built all at once and then
+ * answers which operations overlap a point or span of time without looking
+ * at every operation.  Operations that are updated afterward are appended
+ * to a short list that is searched linearly until there are enough of them
+ * to make it worth rebuilding.
+ */
+class opid_index {
+public:
+    struct entry {
+        string_fragment e_opid;
+        /** The ID of the sub-operation or an invalid fragment. */
+        string_fragment e_subid;
+        time_range e_range;
+        log_level_stats e_level_stats;
+    };
+
+    /**
+     * Bring the index up-to-date with the operations in the given files.
+     * Only the operations that were updated since the last call are
+     * recomputed, unless the files have changed or there were too many
+     * updates to track.
+     *
+     * @return true if the index changed.
+     */
+    bool update(const std::vector<std::shared_ptr<::logfile>>& files);
+
+    void clear();
+
+    /** Merge the operations from a single file into the index. */
+    void add(const log_opid_map& opids);
+
+    /** Build the interval tree after the operations have been added. */
+    void build();
+
+    /**
+     * Replace the entries for an operation with its ranges merged from the
+     * given maps.
+     */
+    void update_opid(const string_fragment& opid,
+                     const std::vector<const log_opid_map*>& maps);
+
+    /**
+     * @return the entries whose range overlaps the inclusive range
+     *   [low, high] in the order of their start times.
+     */
+    std::vector<const entry*> overlapping(const timeval& low,
+                                          const timeval& high) const;
+
+    size_t size() const { return this->oi_live_count; }
+
+private:
+    struct source {
+        const ::logfile* s_file;
+        uint32_t s_generation;
+
+        bool operator==(const source& rhs) const
+        {
+            return this->s_file == rhs.s_file
+                && this->s_generation == rhs.s_generation;
+        }
+    };
+
+    using merged_map
+        = robin_hood::unordered_map<string_fragment,
+                                    opid_time_range,
+                                    frag_hasher,
+                                    std::equal_to<string_fragment>>;
+    using entry_map
+        = robin_hood::unordered_map<string_fragment,
+                                    std::vector<size_t>,
+                                    frag_hasher,
+                                    std::equal_to<string_fragment>>;
+    using tree_t = interval_tree::IntervalTree<int64_t, size_t>;
+
+    void append_entries(const string_fragment& opid,
+                        const opid_time_range& otr);
+
+    /** @return true if the entries outside of the tree should be merged. */
+    bool needs_rebuild() const;
+
+    std::vector<source> oi_sources;
+    ArenaAlloc::Alloc<char> oi_allocator{16 * 1024};
+    merged_map oi_merged;
+    /**
+     * The entries in the tree sorted by start time followed by the entries
+     * that were appended by update_opid().
+     */
+    std::vector<entry> oi_entries;
+    /** True for the entries that were replaced by update_opid(). */
+    std::vector<bool> oi_dead;
+    /** The indexes of the entries for each operation. */
+    entry_map oi_opid_entries;
+    size_t oi_tree_size{0};
+    size_t oi_live_count{0};
+    tree_t oi_tree;
+};
+
+}  // namespace lnav::log
+
+#endif
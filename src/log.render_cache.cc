@@ -0,0 +1,177 @@
+/**
+ * Copyright (c) 2024, Timothy Stack
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ * * Neither the name of Timothy Stack nor the names of its contributors
+ * may be used to endorse or promote products derived from this software
+ * without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE REGENTS AND CONTRIBUTORS ''AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "log.render_cache.hh"
+
+#include "config.h"
+
+namespace lnav::log {
+
+static void
+rebase_values(std::vector<logline_value>& values,
+              const std::string& from,
+              const std::string& to)
+{
+    const auto* from_begin = from.data();
+    const auto* from_end = from.data() + from.size();
+
+    for (auto& lv : values) {
+        if (lv.lv_frag.sf_string >= from_begin
+            && lv.lv_frag.sf_string <= from_end)
+        {
+            lv.lv_frag.sf_string
+                = to.data() + (lv.lv_frag.sf_string - from_begin);
+        }
+    }
+}
+
+std::shared_ptr<const render_cache::entry>
+render_cache::entry::capture(const std::string& value,
+                             const string_attrs_t& attrs,
+                             const logline_value_vector& values)
+{
+    auto retval = std::make_shared<entry>();
+
+    retval->e_value = value;
+    retval->e_attrs = attrs;
+    retval->e_values = values.lvv_values;
+    retval->e_opid_value = values.lvv_opid_value;
+    retval->e_opid_provenance = values.lvv_opid_provenance;
+    rebase_values(retval->e_values, value, retval->e_value);
+
+    return retval;
+}
+
+void
+render_cache::entry::restore_into(std::string& value,
+                                  string_attrs_t& attrs,
+                                  logline_value_vector& values) const
+{
+    value = this->e_value;
+    attrs = this->e_attrs;
+    values.lvv_values = this->e_values;
+    values.lvv_opid_value = this->e_opid_value;
+    values.lvv_opid_provenance = this->e_opid_provenance;
+    rebase_values(values.lvv_values, this->e_value, value);
+}
+
+size_t
+render_cache::entry::memory_usage() const
+{
+    auto retval = sizeof(*this) + this->e_value.capacity()
+        + this->e_attrs.capacity() * sizeof(string_attr)
+        + this->e_values.capacity() * sizeof(logline_value);
+
+    for (const auto& lv : this->e_values) {
+        if (lv.lv_str) {
+            retval += lv.lv_str->capacity();
+        }
+    }
+
+    return retval;
+}
+
+std::shared_ptr<const render_cache::entry>
+render_cache::get(const key& k)
+{
+    auto iter = this->rc_index.find(k);
+
+    if (iter == this->rc_index.end()) {
+        this->rc_stats.s_misses += 1;
+        return nullptr;
+    }
+
+    this->rc_stats.s_hits += 1;
+    this->rc_lru.splice(this->rc_lru.begin(), this->rc_lru, iter->second);
+    return iter->second->second;
+}
+
+void
+render_cache::put(const key& k, std::shared_ptr<const entry> ent)
+{
+    auto usage = ent->memory_usage();
+
+    if (usage > this->rc_budget) {
+        return;
+    }
+
+    auto iter = this->rc_index.find(k);
+    if (iter != this->rc_index.end()) {
+        this->evict(iter->second);
+    }
+
+    this->rc_lru.emplace_front(k, std::move(ent));
+    this->rc_index[k] = this->rc_lru.begin();
+    this->rc_memory_usage += usage;
+    while (this->rc_memory_usage > this->rc_budget) {
+        this->evict(std::prev(this->rc_lru.end()));
+        this->rc_stats.s_evictions += 1;
+    }
+}
+
+void
+render_cache::invalidate()
+{
+    if (this->rc_index.empty()) {
+        return;
+    }
+
+    this->rc_lru.clear();
+    this->rc_index.clear();
+    this->rc_memory_usage = 0;
+    this->rc_stats.s_invalidations += 1;
+}
+
+void
+render_cache::invalidate(uint64_t begin, uint64_t end)
+{
+    auto iter = this->rc_index.lower_bound(key{begin, 0});
+    auto end_iter = this->rc_index.lower_bound(key{end, 0});
+
+    if (iter == end_iter) {
+        return;
+    }
+
+    while (iter != end_iter) {
+        auto lru_iter = (iter++)->second;
+
+        this->evict(lru_iter);
+    }
+    this->rc_stats.s_invalidations += 1;
+}
+
+void
+render_cache::evict(lru_list_t::iterator iter)
+{
+    this->rc_memory_usage -= iter->second->memory_usage();
+    this->rc_index.erase(iter->first);
+    this->rc_lru.erase(iter);
+}
+
+}  // namespace lnav::log
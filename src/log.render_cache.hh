@@ -0,0 +1,149 @@
+/**
+ * Copyright (c) 2024, Timothy Stack
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ * * Neither the name of Timothy Stack nor the names of its contributors
+ * may be used to endorse or promote products derived from this software
+ * without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE REGENTS AND CONTRIBUTORS ''AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef lnav_log_render_cache_hh
+#define lnav_log_render_cache_hh
+
+#include <list>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "base/attr_line.hh"
+#include "log_format.hh"
+
+namespace lnav::log {
+
+/**
+ * An LRU cache of the parts of a log line that are expensive to render: the
+ * text read from the file with the ANSI escapes removed and the attributes
+ * and values produced by the log format.  The decorations that depend on the
+ * view state, like the file name and time offset columns, are added after a
+ * lookup and are not part of the cache.  The cache is bounded by an
+ * approximate memory budget instead of a number of entries since a message
+ * can be very large when rendered in full.
+ */
+class render_cache {
+public:
+    static constexpr size_t DEFAULT_BUDGET = 8 * 1024 * 1024;
+
+    struct key {
+        uint64_t k_line;
+        uint32_t k_flags;
+
+        bool operator<(const key& rhs) const
+        {
+            return this->k_line < rhs.k_line
+                || (this->k_line == rhs.k_line && this->k_flags < rhs.k_flags);
+        }
+    };
+
+    struct entry {
+        /**
+         * Copy the given rendering into a new entry.  The string fragments
+         * in the values that point into the given line are adjusted to point
+         * into the entry's copy.
+         */
+        static std::shared_ptr<const entry> capture(
+            const std::string& value,
+            const string_attrs_t& attrs,
+            const logline_value_vector& values);
+
+        /**
+         * Copy this rendering out to the given line, attributes, and values.
+         * The string fragments in the values are adjusted to point into the
+         * new line, so it must not be modified while the values are in use.
+         */
+        void restore_into(std::string& value,
+                          string_attrs_t& attrs,
+                          logline_value_vector& values) const;
+
+        size_t memory_usage() const;
+
+        std::string e_value;
+        string_attrs_t e_attrs;
+        std::vector<logline_value> e_values;
+        std::optional<std::string> e_opid_value;
+        logline_value_vector::opid_provenance e_opid_provenance{
+            logline_value_vector::opid_provenance::none};
+    };
+
+    struct stats {
+        size_t s_hits{0};
+        size_t s_misses{0};
+        size_t s_evictions{0};
+        size_t s_invalidations{0};
+    };
+
+    explicit render_cache(size_t budget = DEFAULT_BUDGET)
+        : rc_budget(budget)
+    {
+    }
+
+    std::shared_ptr<const entry> get(const key& k);
+
+    void put(const key& k, std::shared_ptr<const entry> ent);
+
+    /**
+     * Drop all of the entries since the lines they were rendered from
+     * might have changed.
+     */
+    void invalidate();
+
+    /**
+     * Drop the entries for the lines in the half-open range [begin, end)
+     * since the lines they were rendered from might have changed.
+     */
+    void invalidate(uint64_t begin, uint64_t end);
+
+    size_t size() const { return this->rc_index.size(); }
+
+    size_t get_memory_usage() const { return this->rc_memory_usage; }
+
+    size_t get_budget() const { return this->rc_budget; }
+
+    const stats& get_stats() const { return this->rc_stats; }
+
+private:
+    using lru_list_t
+        = std::list<std::pair<key, std::shared_ptr<const entry>>>;
+
+    void evict(lru_list_t::iterator iter);
+
+    lru_list_t rc_lru;
+    std::map<key, lru_list_t::iterator> rc_index;
+    size_t rc_budget;
+    size_t rc_memory_usage{0};
+    stats rc_stats;
+};
+
+}  // namespace lnav::log
+
+#endif
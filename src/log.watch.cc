@@ -35,6 +35,7 @@
 #include "bound_tags.hh"
 #include "lnav.events.hh"
 #include "lnav_config_fwd.hh"
+#include "log.filter_expr.hh"
 #include "log_format.hh"
 #include "logfile_sub_source.cfg.hh"
 #include "readline_highlighters.hh"
@@ -45,11 +46,139 @@ namespace lnav {
 namespace log {
 namespace watch {
 
+/**
+ * How the value for a bind parameter in a watch expression is found.
+ */
+struct binding {
+    enum class kind_t : uint8_t {
+        env,
+        log_level,
+        log_time,
+        log_time_msecs,
+        log_format,
+        log_format_regex,
+        log_path,
+        log_unique_path,
+        log_text,
+        log_body,
+        log_opid,
+        log_raw_text,
+        log_tags,
+        field,
+    };
+
+    int b_index;
+    kind_t b_kind;
+    /** The name of the environment variable or the field. */
+    std::string b_name;
+    intern_string_t b_field;
+    /** The position of the field in the values of the last message. */
+    size_t b_value_hint{0};
+};
+
 struct compiled_watch_expr {
     auto_mem<sqlite3_stmt> cwe_stmt{sqlite3_finalize};
+    /** The expression compiled by the filter_expr module, if possible. */
+    std::shared_ptr<filter_expr::program> cwe_program;
+    /**
+     * The fields referenced by the expression.  The expression does not
+     * match a message that is missing one of them.
+     */
+    std::vector<intern_string_t> cwe_fields;
+    /** The plan for binding the parameters of the statement. */
+    std::vector<binding> cwe_bindings;
+    /** How much of the message needs to be loaded for the bindings. */
+    filter_expr::cost_t cwe_cost{filter_expr::cost_t::none};
     bool cwe_enabled{true};
 };
 
+static void
+compile_bindings(compiled_watch_expr& cwe)
+{
+    static const std::vector<std::pair<const char*, binding::kind_t>>
+        LOG_VARS = {
+            {":log_level", binding::kind_t::log_level},
+            {":log_time", binding::kind_t::log_time},
+            {":log_time_msecs", binding::kind_t::log_time_msecs},
+            {":log_format", binding::kind_t::log_format},
+            {":log_format_regex", binding::kind_t::log_format_regex},
+            {":log_path", binding::kind_t::log_path},
+            {":log_unique_path", binding::kind_t::log_unique_path},
+            {":log_text", binding::kind_t::log_text},
+            {":log_body", binding::kind_t::log_body},
+            {":log_opid", binding::kind_t::log_opid},
+            {":log_raw_text", binding::kind_t::log_raw_text},
+            {":log_tags", binding::kind_t::log_tags},
+        };
+
+    auto* stmt = cwe.cwe_stmt.in();
+    auto count = sqlite3_bind_parameter_count(stmt);
+    for (int lpc = 0; lpc < count; lpc++) {
+        const auto* name = sqlite3_bind_parameter_name(stmt, lpc + 1);
+        binding b;
+
+        b.b_index = lpc + 1;
+        if (name[0] == '$') {
+            b.b_kind = binding::kind_t::env;
+            b.b_name = &name[1];
+            cwe.cwe_bindings.emplace_back(std::move(b));
+            continue;
+        }
+
+        auto iter = std::find_if(
+            LOG_VARS.begin(), LOG_VARS.end(), [name](const auto& elem) {
+                return strcmp(name, elem.first) == 0;
+            });
+        if (iter != LOG_VARS.end()) {
+            b.b_kind = iter->second;
+        } else {
+            b.b_kind = binding::kind_t::field;
+            b.b_name = &name[1];
+            b.b_field = intern_string::lookup(b.b_name);
+        }
+        switch (b.b_kind) {
+            case binding::kind_t::log_text:
+                cwe.cwe_cost = std::max(cwe.cwe_cost, filter_expr::cost_t::read);
+                break;
+            case binding::kind_t::log_body:
+            case binding::kind_t::log_opid:
+            case binding::kind_t::field:
+                cwe.cwe_cost = filter_expr::cost_t::annotate;
+                break;
+            default:
+                break;
+        }
+        cwe.cwe_bindings.emplace_back(std::move(b));
+    }
+}
+
+static void
+compile_program(compiled_watch_expr& cwe)
+{
+    auto compile_res = filter_expr::compile(cwe.cwe_stmt.in());
+    if (compile_res.isErr()) {
+        return;
+    }
+
+    auto prog = compile_res.unwrap();
+    for (const auto& var : prog->get_variables()) {
+        switch (var.v_kind) {
+            case filter_expr::variable_kind_t::field:
+                cwe.cwe_fields.emplace_back(var.v_field);
+                break;
+            case filter_expr::variable_kind_t::log_mark:
+            case filter_expr::variable_kind_t::log_comment:
+                // These are not bound for watch expressions, so they are
+                // treated as fields by SQLite.
+                return;
+            default:
+                break;
+        }
+    }
+
+    cwe.cwe_program = prog;
+}
+
 struct expressions : public lnav_config_listener {
     expressions() : lnav_config_listener(__FILE__) {}
 
@@ -99,6 +228,10 @@ struct expressions : public lnav_config_listener {
                 continue;
             }
 
+            compile_program(cwe);
+            if (!cwe.cwe_program) {
+                compile_bindings(cwe);
+            }
             this->e_watch_exprs.emplace(pair.first, std::move(cwe));
         }
     }
@@ -110,159 +243,185 @@ struct expressions : public lnav_config_listener {
 
 static expressions exprs;
 
-void
-eval_with(logfile& lf, logfile::iterator ll)
+static const logline_value*
+find_value(const logline_value_vector& values,
+           const intern_string_t& name,
+           size_t& hint)
 {
-    if (std::none_of(exprs.e_watch_exprs.begin(),
-                     exprs.e_watch_exprs.end(),
-                     [](const auto& elem) { return elem.second.cwe_enabled; }))
-    {
-        return;
+    const auto& lvs = values.lvv_values;
+
+    if (hint < lvs.size() && lvs[hint].lv_meta.lvm_name == name) {
+        return &lvs[hint];
+    }
+    for (size_t lpc = 0; lpc < lvs.size(); lpc++) {
+        if (lvs[lpc].lv_meta.lvm_name == name) {
+            hint = lpc;
+            return &lvs[lpc];
+        }
     }
 
-    static auto& lnav_db = injector::get<auto_sqlite3&>();
+    return nullptr;
+}
 
-    char timestamp_buffer[64] = "";
-    shared_buffer_ref raw_sbr;
-    logline_value_vector values;
-    lf.read_full_message(ll, values.lvv_sbr);
-    values.lvv_sbr.erase_ansi();
-    auto format = lf.get_format();
-    string_attrs_t sa;
-    auto line_number = std::distance(lf.begin(), ll);
-    format->annotate(&lf, line_number, sa, values);
+static bool
+has_fields(const logline_value_vector& values,
+           const std::vector<intern_string_t>& fields)
+{
+    for (const auto& field : fields) {
+        size_t hint = 0;
 
-    for (auto& watch_pair : exprs.e_watch_exprs) {
-        if (!watch_pair.second.cwe_enabled) {
-            continue;
+        if (find_value(values, field, hint) == nullptr) {
+            return false;
         }
+    }
 
-        auto* stmt = watch_pair.second.cwe_stmt.in();
-        sqlite3_reset(stmt);
+    return true;
+}
 
-        auto count = sqlite3_bind_parameter_count(stmt);
-        auto missing_column = false;
-        for (int lpc = 0; lpc < count; lpc++) {
-            const auto* name = sqlite3_bind_parameter_name(stmt, lpc + 1);
+/**
+ * Bind the parameters of a statement that could not be compiled.
+ *
+ * @return False if a field referenced by the statement is missing.
+ */
+static bool
+bind_values(compiled_watch_expr& cwe,
+            filter_expr::message& msg,
+            shared_buffer_ref& raw_sbr)
+{
+    auto* stmt = cwe.cwe_stmt.in();
+    auto& lf = msg.get_file();
+    auto ll = msg.get_line();
+    auto format = lf.get_format();
+    const logline_value_vector* values = nullptr;
+
+    switch (cwe.cwe_cost) {
+        case filter_expr::cost_t::none:
+            break;
+        case filter_expr::cost_t::read:
+            values = &msg.read();
+            break;
+        case filter_expr::cost_t::annotate:
+            values = &msg.annotate();
+            break;
+    }
 
-            if (name[0] == '$') {
+    sqlite3_reset(stmt);
+    sqlite3_clear_bindings(stmt);
+    for (auto& b : cwe.cwe_bindings) {
+        switch (b.b_kind) {
+            case binding::kind_t::env: {
                 const char* env_value;
 
-                if ((env_value = getenv(&name[1])) != nullptr) {
+                if ((env_value = getenv(b.b_name.c_str())) != nullptr) {
                     sqlite3_bind_text(
-                        stmt, lpc + 1, env_value, -1, SQLITE_STATIC);
+                        stmt, b.b_index, env_value, -1, SQLITE_STATIC);
                 }
-                continue;
+                break;
             }
-            if (strcmp(name, ":log_level") == 0) {
+            case binding::kind_t::log_level:
                 sqlite3_bind_text(
-                    stmt, lpc + 1, ll->get_level_name(), -1, SQLITE_STATIC);
-                continue;
-            }
-            if (strcmp(name, ":log_time") == 0) {
-                auto len = sql_strftime(timestamp_buffer,
-                                        sizeof(timestamp_buffer),
-                                        ll->get_timeval(),
-                                        'T');
+                    stmt, b.b_index, ll->get_level_name(), -1, SQLITE_STATIC);
+                break;
+            case binding::kind_t::log_time: {
+                auto ts = msg.get_timestamp();
+
                 sqlite3_bind_text(
-                    stmt, lpc + 1, timestamp_buffer, len, SQLITE_STATIC);
-                continue;
+                    stmt, b.b_index, ts.data(), ts.length(), SQLITE_STATIC);
+                break;
             }
-            if (strcmp(name, ":log_time_msecs") == 0) {
+            case binding::kind_t::log_time_msecs:
                 sqlite3_bind_int64(
                     stmt,
-                    lpc + 1,
+                    b.b_index,
                     ll->get_time<std::chrono::milliseconds>().count());
-                continue;
-            }
-            if (strcmp(name, ":log_format") == 0) {
+                break;
+            case binding::kind_t::log_format: {
                 const auto format_name = format->get_name();
                 sqlite3_bind_text(stmt,
-                                  lpc + 1,
+                                  b.b_index,
                                   format_name.get(),
                                   format_name.size(),
                                   SQLITE_STATIC);
-                continue;
+                break;
             }
-            if (strcmp(name, ":log_format_regex") == 0) {
-                const auto pat_name = format->get_pattern_name(line_number);
+            case binding::kind_t::log_format_regex: {
+                const auto pat_name
+                    = format->get_pattern_name(msg.get_line_number());
                 sqlite3_bind_text(stmt,
-                                  lpc + 1,
+                                  b.b_index,
                                   pat_name.get(),
                                   pat_name.size(),
                                   SQLITE_STATIC);
-                continue;
+                break;
             }
-            if (strcmp(name, ":log_path") == 0) {
+            case binding::kind_t::log_path: {
                 const auto& filename = lf.get_filename();
                 sqlite3_bind_text(stmt,
-                                  lpc + 1,
+                                  b.b_index,
                                   filename.c_str(),
                                   filename.native().length(),
                                   SQLITE_STATIC);
-                continue;
+                break;
             }
-            if (strcmp(name, ":log_unique_path") == 0) {
+            case binding::kind_t::log_unique_path: {
                 const auto& filename = lf.get_unique_path();
                 sqlite3_bind_text(stmt,
-                                  lpc + 1,
+                                  b.b_index,
                                   filename.c_str(),
                                   filename.native().length(),
                                   SQLITE_STATIC);
-                continue;
+                break;
             }
-            if (strcmp(name, ":log_text") == 0) {
+            case binding::kind_t::log_text:
                 sqlite3_bind_text(stmt,
-                                  lpc + 1,
-                                  values.lvv_sbr.get_data(),
-                                  values.lvv_sbr.length(),
+                                  b.b_index,
+                                  values->lvv_sbr.get_data(),
+                                  values->lvv_sbr.length(),
                                   SQLITE_STATIC);
-                continue;
-            }
-            if (strcmp(name, ":log_body") == 0) {
-                auto body_attr_opt = get_string_attr(sa, SA_BODY);
+                break;
+            case binding::kind_t::log_body: {
+                auto body_attr_opt = get_string_attr(msg.get_attrs(), SA_BODY);
                 if (body_attr_opt) {
                     const auto& sar
                         = body_attr_opt.value().saw_string_attr->sa_range;
 
                     sqlite3_bind_text(stmt,
-                                      lpc + 1,
-                                      values.lvv_sbr.get_data_at(sar.lr_start),
+                                      b.b_index,
+                                      values->lvv_sbr.get_data_at(sar.lr_start),
                                       sar.length(),
                                       SQLITE_STATIC);
                 } else {
-                    sqlite3_bind_null(stmt, lpc + 1);
+                    sqlite3_bind_null(stmt, b.b_index);
                 }
-                continue;
+                break;
             }
-            if (strcmp(name, ":log_opid") == 0) {
-                if (values.lvv_opid_value) {
+            case binding::kind_t::log_opid:
+                if (values->lvv_opid_value) {
                     sqlite3_bind_text(stmt,
-                                      lpc + 1,
-                                      values.lvv_opid_value->c_str(),
-                                      values.lvv_opid_value->length(),
+                                      b.b_index,
+                                      values->lvv_opid_value->c_str(),
+                                      values->lvv_opid_value->length(),
                                       SQLITE_STATIC);
                 } else {
-                    sqlite3_bind_null(stmt, lpc + 1);
+                    sqlite3_bind_null(stmt, b.b_index);
                 }
-                continue;
-            }
-            if (strcmp(name, ":log_raw_text") == 0) {
+                break;
+            case binding::kind_t::log_raw_text: {
                 auto res = lf.read_raw_message(ll);
 
                 if (res.isOk()) {
                     raw_sbr = res.unwrap();
                     sqlite3_bind_text(stmt,
-                                      lpc + 1,
+                                      b.b_index,
                                       raw_sbr.get_data(),
                                       raw_sbr.length(),
                                       SQLITE_STATIC);
                 }
-                continue;
+                break;
             }
-            if (strcmp(name, ":log_tags") == 0) {
+            case binding::kind_t::log_tags: {
                 const auto& bm = lf.get_bookmark_metadata();
-                auto bm_iter = bm.find(line_number);
+                auto bm_iter = bm.find(msg.get_line_number());
                 if (bm_iter != bm.end() && !bm_iter->second.bm_tags.empty()) {
                     const auto& meta = bm_iter->second;
                     yajlpp_gen gen;
@@ -280,82 +439,111 @@ eval_with(logfile& lf, logfile::iterator ll)
                     string_fragment sf = gen.to_string_fragment();
 
                     sqlite3_bind_text(stmt,
-                                      lpc + 1,
+                                      b.b_index,
                                       sf.data(),
                                       sf.length(),
                                       SQLITE_TRANSIENT);
                 }
-                continue;
+                break;
             }
-            auto found = false;
-            for (const auto& lv : values.lvv_values) {
-                if (lv.lv_meta.lvm_name != &name[1]) {
-                    continue;
-                }
+            case binding::kind_t::field: {
+                const auto* lv = find_value(*values, b.b_field, b.b_value_hint);
 
-                found = true;
-                switch (lv.lv_meta.lvm_kind) {
+                if (lv == nullptr) {
+                    return false;
+                }
+                switch (lv->lv_meta.lvm_kind) {
                     case value_kind_t::VALUE_BOOLEAN:
-                        sqlite3_bind_int64(stmt, lpc + 1, lv.lv_value.i);
+                        sqlite3_bind_int64(stmt, b.b_index, lv->lv_value.i);
                         break;
                     case value_kind_t::VALUE_FLOAT:
-                        sqlite3_bind_double(stmt, lpc + 1, lv.lv_value.d);
+                        sqlite3_bind_double(stmt, b.b_index, lv->lv_value.d);
                         break;
                     case value_kind_t::VALUE_INTEGER:
-                        sqlite3_bind_int64(stmt, lpc + 1, lv.lv_value.i);
+                        sqlite3_bind_int64(stmt, b.b_index, lv->lv_value.i);
                         break;
                     case value_kind_t::VALUE_NULL:
-                        sqlite3_bind_null(stmt, lpc + 1);
+                        sqlite3_bind_null(stmt, b.b_index);
                         break;
                     default:
                         sqlite3_bind_text(stmt,
-                                          lpc + 1,
-                                          lv.text_value(),
-                                          lv.text_length(),
+                                          b.b_index,
+                                          lv->text_value(),
+                                          lv->text_length(),
                                           SQLITE_TRANSIENT);
                         break;
                 }
                 break;
             }
-            if (!found) {
-                missing_column = true;
-                break;
-            }
         }
+    }
 
-        if (missing_column) {
+    return true;
+}
+
+void
+eval_with(logfile& lf, logfile::iterator ll)
+{
+    if (std::none_of(exprs.e_watch_exprs.begin(),
+                     exprs.e_watch_exprs.end(),
+                     [](const auto& elem) { return elem.second.cwe_enabled; }))
+    {
+        return;
+    }
+
+    static auto& lnav_db = injector::get<auto_sqlite3&>();
+
+    // The message is only read and annotated if an expression needs it and
+    // then the results are shared by all of the expressions.
+    filter_expr::message msg(lf, ll);
+    shared_buffer_ref raw_sbr;
+
+    for (auto& watch_pair : exprs.e_watch_exprs) {
+        auto& cwe = watch_pair.second;
+
+        if (!cwe.cwe_enabled) {
             continue;
         }
 
-        auto step_res = sqlite3_step(stmt);
-
-        switch (step_res) {
-            case SQLITE_OK:
-            case SQLITE_DONE:
+        if (cwe.cwe_program) {
+            if (!cwe.cwe_program->eval(msg)) {
                 continue;
-            case SQLITE_ROW:
-                break;
-            default: {
-                log_error("failed to execute watch expression: %s -- %s",
-                          watch_pair.first.c_str(),
-                          sqlite3_errmsg(lnav_db));
-                watch_pair.second.cwe_enabled = false;
+            }
+            if (!cwe.cwe_fields.empty()
+                && !has_fields(msg.annotate(), cwe.cwe_fields))
+            {
+                continue;
+            }
+        } else {
+            if (!bind_values(cwe, msg, raw_sbr)) {
                 continue;
             }
-        }
 
-        if (!timestamp_buffer[0]) {
-            sql_strftime(timestamp_buffer,
-                         sizeof(timestamp_buffer),
-                         ll->get_timeval(),
-                         'T');
+            auto step_res = sqlite3_step(cwe.cwe_stmt.in());
+
+            switch (step_res) {
+                case SQLITE_OK:
+                case SQLITE_DONE:
+                    continue;
+                case SQLITE_ROW:
+                    break;
+                default: {
+                    log_error("failed to execute watch expression: %s -- %s",
+                              watch_pair.first.c_str(),
+                              sqlite3_errmsg(lnav_db));
+                    cwe.cwe_enabled = false;
+                    continue;
+                }
+            }
         }
+
+        const auto& values = msg.annotate();
         auto lmd = lnav::events::log::msg_detected{
             watch_pair.first,
             lf.get_filename(),
             lf.get_format_name().to_string(),
-            (uint32_t) line_number,
-            timestamp_buffer,
+            (uint32_t) msg.get_line_number(),
+            msg.get_timestamp().to_string(),
         };
         for (const auto& lv : values.lvv_values) {
             switch (lv.lv_meta.lvm_kind) {
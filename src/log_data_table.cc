@@ -55,29 +55,23 @@ log_data_table::get_columns_int()
     auto& metas = this->ldt_value_metas;
     content_line_t cl_copy = this->ldt_template_line;
     auto lf = this->ldt_log_source.find(cl_copy);
-    struct line_range body;
-    string_attrs_t sa;
     logline_value_vector line_values;
     auto format = lf->get_format();
+    data_scanner ds{string_fragment{}};
+    data_parser dp(&ds);
 
     if (this->ldt_format_impl != nullptr) {
         this->ldt_format_impl->get_columns(cols);
     }
-    lf->read_full_message(lf->begin() + cl_copy, line_values.lvv_sbr);
-    line_values.lvv_sbr.erase_ansi();
-    format->annotate(lf.get(), cl_copy, sa, line_values, false);
-    body = find_string_attr_range(sa, &SA_BODY);
-    if (body.lr_end == -1) {
+    if (!logfile_schema_index::parse_message(
+            *lf, cl_copy, line_values, ds, dp))
+    {
         this->ldt_schema_id.clear();
         return;
     }
 
-    data_scanner ds(line_values.lvv_sbr, body.lr_start, body.lr_end);
-    data_parser dp(&ds);
     column_namer cn{column_namer::language::SQL};
 
-    dp.parse();
-
     for (auto pair_iter = dp.dp_pairs.begin(); pair_iter != dp.dp_pairs.end();
          ++pair_iter)
     {
@@ -112,6 +106,79 @@ log_data_table::get_columns_int()
     this->ldt_schema_id = dp.dp_schema_id;
 }
 
+void
+log_data_table::filter(log_cursor& lc, logfile_sub_source& lss)
+{
+    // The lines from the schema index are only used when nothing else is
+    // narrowing down the lines since the cursor would otherwise skip ahead
+    // line-by-line from an index entry that did not pass the constraints.
+    if (lc.lc_indexed_lines.size() != 1
+        || lc.lc_indexed_lines.back() != lc.lc_curr_line
+        || !lc.lc_format_name.empty() || !lc.lc_pattern_name.empty()
+        || lc.lc_level_constraint || lc.lc_opid || !lc.lc_log_path.empty()
+        || !lc.lc_unique_path.empty())
+    {
+        return;
+    }
+
+    const auto& format_name = this->ldt_format_impl->get_name();
+    std::vector<std::pair<const logfile*, std::vector<bool>>> matches;
+
+    for (const auto& ld : lss) {
+        auto* lf = ld->get_file_ptr();
+
+        if (lf == nullptr || !ld->is_visible()
+            || lf->get_format_name() != format_name)
+        {
+            continue;
+        }
+
+        auto& si = lf->get_schema_index();
+        if (!si.is_complete(*lf)) {
+            return;
+        }
+
+        std::vector<bool> lines(lf->size());
+        const auto* sch = si.find(this->ldt_schema_id);
+        if (sch != nullptr) {
+            for (auto line : sch->s_lines) {
+                lines[line] = true;
+            }
+        }
+        matches.emplace_back(lf, std::move(lines));
+    }
+
+    auto end_line = std::min(lc.lc_end_line, vis_line_t(lss.text_line_count()));
+    const std::vector<bool>* curr_lines = nullptr;
+    const logfile* curr_file = nullptr;
+
+    lc.lc_indexed_lines.clear();
+    for (auto vl = lc.lc_curr_line; vl < end_line; ++vl) {
+        auto cl = lss.at(vl);
+        const auto* lf = lss.find_file_ptr(cl);
+
+        if (lf != curr_file) {
+            curr_file = lf;
+            curr_lines = nullptr;
+            for (const auto& match : matches) {
+                if (match.first == lf) {
+                    curr_lines = &match.second;
+                    break;
+                }
+            }
+        }
+        if (curr_lines != nullptr && cl < curr_lines->size()
+            && (*curr_lines)[cl])
+        {
+            lc.lc_indexed_lines.push_back(vl);
+        }
+    }
+    // The end line is left at the front so the cursor reaches EOF after
+    // the last match instead of continuing on line-by-line.
+    lc.lc_indexed_lines.push_back(lc.lc_end_line);
+    std::reverse(lc.lc_indexed_lines.begin(), lc.lc_indexed_lines.end());
+}
+
 bool
 log_data_table::next(log_cursor& lc, logfile_sub_source& lss)
 {
@@ -136,22 +203,15 @@ log_data_table::next(log_cursor& lc, logfile_sub_source& lss)
         return false;
     }
 
-    string_attrs_t sa;
-    struct line_range body;
     logline_value_vector line_values;
+    auto& dp = this->ldt_parser;
 
-    lf->read_full_message(lf_iter, line_values.lvv_sbr);
-    line_values.lvv_sbr.erase_ansi();
-    lf->get_format()->annotate(lf, cl, sa, line_values, false);
-    body = find_string_attr_range(sa, &SA_BODY);
-    if (body.lr_end == -1) {
+    if (!logfile_schema_index::parse_message(
+            *lf, cl, line_values, this->ldt_scanner, dp))
+    {
         return false;
     }
 
-    data_scanner ds(line_values.lvv_sbr, body.lr_start, body.lr_end);
-    data_parser dp(&ds);
-    dp.parse();
-
     lf_iter->set_schema(dp.dp_schema_id);
 
     /* The cached schema ID in the log line is not complete, so we still */
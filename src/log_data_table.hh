@@ -58,16 +58,26 @@ public:
         log_vtab_impl::get_foreign_keys(keys_inout);
     }
 
+    void filter(log_cursor& lc, logfile_sub_source& lss) override;
+
     bool next(log_cursor& lc, logfile_sub_source& lss) override;
 
     void extract(logfile* lf,
                  uint64_t line_number,
                  logline_value_vector& values) override;
 
+    const data_parser::schema_id_t& get_schema_id() const
+    {
+        return this->ldt_schema_id;
+    }
+
 private:
     logfile_sub_source& ldt_log_source;
     const content_line_t ldt_template_line;
     data_parser::schema_id_t ldt_schema_id;
+    /** The scanner and parser are reused for each row to avoid churn. */
+    data_scanner ldt_scanner{string_fragment{}};
+    data_parser ldt_parser{&this->ldt_scanner};
     data_parser::element_list_t ldt_pairs;
     std::shared_ptr<log_vtab_impl> ldt_format_impl;
     std::vector<vtab_column> ldt_cols;
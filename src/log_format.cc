@@ -53,6 +53,7 @@
 #include "sql_util.hh"
 #include "sqlite-extension-func.hh"
 #include "sqlitepp.hh"
+#include "yajlpp/json_scanner.hh"
 #include "yajlpp/yajlpp.hh"
 #include "yajlpp/yajlpp_def.hh"
 
@@ -76,6 +77,7 @@ const intern_string_t log_format::LOG_TIME_STR
     = intern_string::lookup("log_time");
 const intern_string_t log_format::LOG_LEVEL_STR
     = intern_string::lookup("log_level");
+uint32_t log_format::lf_field_state_generation = 0;
 
 static const uint32_t DATE_TIME_SET_FLAGS = ETF_YEAR_SET | ETF_MONTH_SET
     | ETF_DAY_SET | ETF_HOUR_SET | ETF_MINUTE_SET | ETF_SECOND_SET;
@@ -163,6 +165,40 @@ opid_time_range::close_sub_ops(const string_fragment& subid)
     }
 }
 
+void
+log_opid_state::clear()
+{
+    this->los_opid_ranges.clear();
+    this->los_sub_in_use.clear();
+    this->los_generation += 1;
+    this->los_timeline_updates = opid_updates{};
+    this->los_index_updates = opid_updates{};
+}
+
+void
+opid_updates::mark(const string_fragment& opid, size_t opid_count)
+{
+    if (this->ou_all) {
+        return;
+    }
+
+    this->ou_opids.emplace(opid);
+    if (this->ou_opids.size() > 1024 && this->ou_opids.size() > opid_count / 2)
+    {
+        this->ou_opids.clear();
+        this->ou_all = true;
+    }
+}
+
+void
+log_opid_state::mark_updated(const string_fragment& opid)
+{
+    const auto opid_count = this->los_opid_ranges.size();
+
+    this->los_timeline_updates.mark(opid, opid_count);
+    this->los_index_updates.mark(opid, opid_count);
+}
+
 log_opid_map::iterator
 log_opid_state::insert_op(ArenaAlloc::Alloc<char>& alloc,
                           const string_fragment& opid,
@@ -882,6 +918,12 @@ static int read_json_field(yajlpp_parse_context* ypc,
                            const unsigned char* str,
                            size_t len);
 
+static void index_json_string(json_log_userdata* jlu,
+                              const intern_string_t field_name,
+                              bool top_level,
+                              const unsigned char* str,
+                              size_t len);
+
 static int
 read_json_null(yajlpp_parse_context* ypc)
 {
@@ -904,19 +946,18 @@ read_json_bool(yajlpp_parse_context* ypc, int val)
     return 1;
 }
 
-static int
-read_json_number(yajlpp_parse_context* ypc,
-                 const char* numberVal,
-                 size_t numberLen)
+static bool
+index_json_number(json_log_userdata* jlu,
+                  const intern_string_t field_name,
+                  bool top_level,
+                  const char* numberVal,
+                  size_t numberLen)
 {
-    json_log_userdata* jlu = (json_log_userdata*) ypc->ypc_userdata;
-    const intern_string_t field_name = ypc->get_path();
-
     auto number_frag = string_fragment::from_bytes(numberVal, numberLen);
     auto scan_res = scn::scan_value<double>(number_frag.to_string_view());
     if (!scan_res) {
         log_error("invalid number %.*s", numberLen, numberVal);
-        return 0;
+        return false;
     }
 
     auto val = scan_res->value();
@@ -983,12 +1024,24 @@ read_json_number(yajlpp_parse_context* ypc,
     }
 
     jlu->add_sub_lines_for(field_name,
-                           ypc->is_level(1),
+                           top_level,
                            val,
                            (const unsigned char*) numberVal,
                            numberLen);
 
-    return 1;
+    return true;
+}
+
+static int
+read_json_number(yajlpp_parse_context* ypc,
+                 const char* numberVal,
+                 size_t numberLen)
+{
+    json_log_userdata* jlu = (json_log_userdata*) ypc->ypc_userdata;
+    const intern_string_t field_name = ypc->get_path();
+
+    return index_json_number(
+        jlu, field_name, ypc->is_level(1), numberVal, numberLen);
 }
 
 static int
@@ -1035,6 +1088,128 @@ static const struct json_path_container json_log_handlers = {
         .add_cb(read_json_field),
 };
 
+static bool
+index_json_value(json_log_userdata* jlu,
+                 const intern_string_t field_name,
+                 bool top_level,
+                 const yajlpp::json_scanner::member& mem,
+                 std::string& scratch)
+{
+    using value_type = yajlpp::json_scanner::value_type;
+
+    switch (mem.m_type) {
+        case value_type::string: {
+            auto value = mem.m_value;
+
+            if (mem.m_value_escaped) {
+                scratch.clear();
+                yajlpp::json_scanner::unescape(value, scratch);
+                value = string_fragment::from_str(scratch);
+            }
+            index_json_string(jlu,
+                              field_name,
+                              top_level,
+                              value.udata(),
+                              value.length());
+            return true;
+        }
+        case value_type::number:
+            return index_json_number(jlu,
+                                     field_name,
+                                     top_level,
+                                     mem.m_value.data(),
+                                     mem.m_value.length());
+        default:
+            jlu->add_sub_lines_for(field_name, top_level);
+            return true;
+    }
+}
+
+/**
+ * Index a JSON log line without a full parse.  Only the fields in the
+ * format's scan plan are decoded, everything else is skipped over after
+ * being checked for validity.
+ *
+ * @return false if the line needs to go through yajl instead.
+ */
+static bool
+index_json_line(json_log_userdata* jlu, string_fragment line)
+{
+    thread_local std::vector<yajlpp::json_scanner::member> members;
+    thread_local std::string scratch;
+    thread_local std::string nested_scratch;
+    thread_local std::string path;
+    const auto& plan = *jlu->jlu_format->jlf_scan_plan;
+
+    auto scan_res = yajlpp::json_scanner::scan_object(line, members);
+    if (!scan_res.sr_valid || scan_res.sr_unusual_numbers) {
+        return false;
+    }
+
+    for (const auto& mem : members) {
+        path.clear();
+        if (mem.m_key_escaped) {
+            scratch.clear();
+            yajlpp::json_scanner::unescape(mem.m_key, scratch);
+            yajlpp::json_scanner::append_path_key(
+                string_fragment::from_str(scratch), path);
+        } else {
+            yajlpp::json_scanner::append_path_key(mem.m_key, path);
+        }
+
+        const auto path_sf = string_fragment::from_str(path);
+        const auto field_iter = plan.jsp_fields.find(path_sf);
+
+        if (mem.is_container()) {
+            if (field_iter == plan.jsp_fields.end()) {
+                if (!jlu->jlu_format->jlf_hide_extra) {
+                    jlu->jlu_sub_line_count += 1;
+                }
+            } else {
+                jlu->add_sub_lines_for(field_iter->second, true);
+            }
+            if (plan.jsp_containers.contains(path_sf)) {
+                auto success = true;
+
+                yajlpp::json_scanner::walk_nested(
+                    mem,
+                    path,
+                    [&](const std::string& nested_path,
+                        const yajlpp::json_scanner::member& nested) {
+                        auto nested_iter = plan.jsp_fields.find(
+                            string_fragment::from_str(nested_path));
+
+                        if (nested_iter == plan.jsp_fields.end()) {
+                            return;
+                        }
+                        success = index_json_value(jlu,
+                                                   nested_iter->second,
+                                                   false,
+                                                   nested,
+                                                   nested_scratch)
+                            && success;
+                    });
+                if (!success) {
+                    return false;
+                }
+            }
+            continue;
+        }
+
+        if (field_iter == plan.jsp_fields.end()) {
+            if (!jlu->jlu_format->jlf_hide_extra) {
+                jlu->jlu_sub_line_count += 1;
+            }
+            continue;
+        }
+        if (!index_json_value(jlu, field_iter->second, true, mem, scratch)) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
 static int rewrite_json_field(yajlpp_parse_context* ypc,
                               const unsigned char* str,
                               size_t len);
@@ -1274,22 +1449,28 @@ external_log_format::scan(logfile& lf,
         this->lf_desc_captures.clear();
         this->lf_desc_allocator.reset();
 
-        yajl_reset(handle);
-        ypc.set_static_handler(json_log_handlers.jpc_children[0]);
-        ypc.ypc_userdata = &jlu;
-        ypc.ypc_ignore_unused = true;
-        ypc.ypc_alt_callbacks.yajl_start_array = json_array_start;
-        ypc.ypc_alt_callbacks.yajl_start_map = json_array_start;
-        ypc.ypc_alt_callbacks.yajl_end_array = nullptr;
-        ypc.ypc_alt_callbacks.yajl_end_map = nullptr;
         jlu.jlu_format = this;
         jlu.jlu_base_line = &ll;
         jlu.jlu_line_value = sbr.get_data();
         jlu.jlu_line_size = sbr.length();
         jlu.jlu_handle = handle;
-        if (yajl_parse(handle, line_data, sbr.length()) == yajl_status_ok
-            && yajl_complete_parse(handle) == yajl_status_ok)
-        {
+
+        auto parsed = this->jlf_scan_plan != nullptr
+            && index_json_line(&jlu, line_frag);
+        if (!parsed) {
+            yajl_reset(handle);
+            ypc.set_static_handler(json_log_handlers.jpc_children[0]);
+            ypc.ypc_userdata = &jlu;
+            ypc.ypc_ignore_unused = true;
+            ypc.ypc_alt_callbacks.yajl_start_array = json_array_start;
+            ypc.ypc_alt_callbacks.yajl_start_map = json_array_start;
+            ypc.ypc_alt_callbacks.yajl_end_array = nullptr;
+            ypc.ypc_alt_callbacks.yajl_end_map = nullptr;
+            parsed = yajl_parse(handle, line_data, sbr.length())
+                    == yajl_status_ok
+                && yajl_complete_parse(handle) == yajl_status_ok;
+        }
+        if (parsed) {
             if (ll.get_time<std::chrono::microseconds>().count() == 0) {
                 if (this->lf_specialized) {
                     ll.set_ignore(true);
@@ -1701,6 +1882,19 @@ external_log_format::scan(logfile& lf,
     return scan_no_match{"no patterns matched"};
 }
 
+bool
+external_log_format::is_scan_thread_safe() const
+{
+    // The module formats are shared by every file, along with the state
+    // they keep while matching, so a format that can have modules needs to
+    // be scanned on the main thread.
+    return std::none_of(this->elf_pattern_order.begin(),
+                        this->elf_pattern_order.end(),
+                        [](const auto& pat) {
+                            return pat->p_module_field_index != -1;
+                        });
+}
+
 uint8_t
 external_log_format::module_scan(string_fragment body_cap,
                                  const intern_string_t& mod_name)
@@ -2012,6 +2206,19 @@ read_json_field(yajlpp_parse_context* ypc, const unsigned char* str, size_t len)
 {
     json_log_userdata* jlu = (json_log_userdata*) ypc->ypc_userdata;
     const intern_string_t field_name = ypc->get_path();
+
+    index_json_string(jlu, field_name, ypc->is_level(1), str, len);
+
+    return 1;
+}
+
+static void
+index_json_string(json_log_userdata* jlu,
+                  const intern_string_t field_name,
+                  bool top_level,
+                  const unsigned char* str,
+                  size_t len)
+{
     struct timeval tv_out;
     auto frag = string_fragment::from_bytes(str, len);
 
@@ -2086,10 +2293,7 @@ read_json_field(yajlpp_parse_context* ypc, const unsigned char* str, size_t len)
         jlu->jlu_format->lf_desc_captures.emplace(field_name, frag_copy);
     }
 
-    jlu->add_sub_lines_for(
-        field_name, ypc->is_level(1), std::nullopt, str, len);
-
-    return 1;
+    jlu->add_sub_lines_for(field_name, top_level, std::nullopt, str, len);
 }
 
 static int
@@ -3843,6 +4047,43 @@ external_log_format::build(std::vector<lnav::console::user_message>& errors)
     }
 
     this->lf_value_stats.resize(this->elf_value_defs.size());
+
+    if (this->elf_type == elf_type_t::ELF_TYPE_JSON
+        && this->elf_level_pointer.pp_value == nullptr)
+    {
+        auto plan = std::make_shared<json_scan_plan>();
+        auto add_field = [&plan](const intern_string_t& field_name) {
+            if (field_name.empty()) {
+                return;
+            }
+
+            auto path_sf = field_name.to_string_fragment();
+            plan->jsp_fields.emplace(path_sf, field_name);
+
+            auto sep_iter = std::find_if(path_sf.begin(),
+                                         path_sf.end(),
+                                         [](char ch) {
+                                             return ch == '/' || ch == '#';
+                                         });
+            if (sep_iter != path_sf.end()) {
+                plan->jsp_containers.emplace(path_sf.sub_range(
+                    0, std::distance(path_sf.begin(), sep_iter)));
+            }
+        };
+
+        for (const auto& vd_pair : this->elf_value_defs) {
+            add_field(vd_pair.first);
+        }
+        add_field(this->lf_timestamp_field);
+        add_field(this->lf_subsecond_field);
+        add_field(this->elf_level_field);
+        add_field(this->elf_opid_field);
+        add_field(this->elf_subid_field);
+        for (const auto& desc_field : this->lf_desc_fields) {
+            add_field(desc_field);
+        }
+        this->jlf_scan_plan = plan;
+    }
 }
 
 void
@@ -4427,6 +4668,7 @@ external_log_format::hide_field(const intern_string_t field_name, bool val)
     }
 
     vd_iter->second->vd_meta.lvm_user_hidden = val;
+    lf_field_state_generation += 1;
     if (this->elf_type == elf_type_t::ELF_TYPE_JSON) {
         bool found = false;
 
@@ -551,6 +551,13 @@ public:
 
     virtual bool format_changed() { return false; }
 
+    /**
+     * @return True if scan() on a specialized instance of this format only
+     * touches state owned by that instance, so that different files can be
+     * indexed on separate threads.
+     */
+    virtual bool is_scan_thread_safe() const { return false; }
+
     struct pattern_for_lines {
         pattern_for_lines(uint32_t pfl_line, uint32_t pfl_pat_index);
 
@@ -659,6 +666,12 @@ public:
     static const intern_string_t LOG_TIME_STR;
     static const intern_string_t LOG_LEVEL_STR;
 
+    /**
+     * Incremented each time a field is hidden or shown so that any cached
+     * renderings of log messages can be thrown away.
+     */
+    static uint32_t lf_field_state_generation;
+
 protected:
     static std::vector<std::shared_ptr<log_format>> lf_root_formats;
 
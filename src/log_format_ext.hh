@@ -208,6 +208,8 @@ public:
 
     bool format_changed() override;
 
+    bool is_scan_thread_safe() const override;
+
     std::set<std::string> get_source_path() const override
     {
         return this->elf_source_path;
@@ -453,6 +455,30 @@ public:
     string_attrs_t jlf_line_attrs;
     std::shared_ptr<yajlpp_parse_context> jlf_parse_context;
     std::shared_ptr<yajl_handle_t> jlf_yajl_handle;
+
+    /**
+     * The parts of a JSON log message that are needed when indexing.  The
+     * paths are in the same format as yajlpp_parse_context::get_path().
+     */
+    struct json_scan_plan {
+        /** The fields that affect indexing, like the timestamp and level. */
+        robin_hood::unordered_map<string_fragment,
+                                  intern_string_t,
+                                  frag_hasher,
+                                  std::equal_to<string_fragment>>
+            jsp_fields;
+        /** The top-level keys with interesting fields nested under them. */
+        robin_hood::unordered_set<string_fragment,
+                                  frag_hasher,
+                                  std::equal_to<string_fragment>>
+            jsp_containers;
+    };
+
+    /**
+     * The plan for scanning JSON log lines without a full parse or
+     * nullptr if every line needs to be parsed with yajl.
+     */
+    std::shared_ptr<const json_scan_plan> jlf_scan_plan;
     shared_buffer jlf_share_manager;
 
 private:
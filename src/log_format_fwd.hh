@@ -100,9 +100,47 @@ using sub_opid_map = robin_hood::unordered_map<string_fragment,
                                                frag_hasher,
                                                std::equal_to<string_fragment>>;
 
+using opid_set = robin_hood::unordered_set<string_fragment,
+                                           frag_hasher,
+                                           std::equal_to<string_fragment>>;
+
+/**
+ * The opids whose ranges have changed since a consumer last took them.
+ */
+struct opid_updates {
+    opid_set ou_opids;
+    /**
+     * True if the updates have not been taken yet or there were too many
+     * to be worth tracking individually.
+     */
+    bool ou_all{true};
+
+    void mark(const string_fragment& opid, size_t opid_count);
+
+    /** Start tracking the updates from scratch. */
+    void reset()
+    {
+        this->ou_opids.clear();
+        this->ou_all = false;
+    }
+};
+
 struct log_opid_state {
     log_opid_map los_opid_ranges;
     sub_opid_map los_sub_in_use;
+    /**
+     * Incremented when the ranges are discarded so that anyone tracking
+     * the updates below knows to start over.
+     */
+    uint32_t los_generation{0};
+    /** The updates that have not been applied to the timeline. */
+    opid_updates los_timeline_updates;
+    /** The updates that have not been applied to the active_opids index. */
+    opid_updates los_index_updates;
+
+    void clear();
+
+    void mark_updated(const string_fragment& opid);
 
     log_opid_map::iterator insert_op(ArenaAlloc::Alloc<char>& alloc,
                                      const string_fragment& opid,
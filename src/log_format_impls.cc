@@ -327,9 +327,11 @@ public:
     {
         if (field_name == TS_META.lvm_name) {
             TS_META.lvm_user_hidden = val;
+            lf_field_state_generation += 1;
             return true;
         } else if (field_name == LEVEL_META.lvm_name) {
             LEVEL_META.lvm_user_hidden = val;
+            lf_field_state_generation += 1;
             return true;
         }
         return false;
@@ -933,6 +935,7 @@ public:
         }
 
         fd_iter->second.lvm_user_hidden = val;
+        lf_field_state_generation += 1;
 
         return true;
     }
@@ -1610,6 +1613,7 @@ public:
             }
             date_iter->second.lvm_user_hidden = val;
             time_iter->second.lvm_user_hidden = val;
+            lf_field_state_generation += 1;
             return true;
         }
 
@@ -1619,6 +1623,7 @@ public:
         }
 
         fd_iter->second.lvm_user_hidden = val;
+        lf_field_state_generation += 1;
 
         return true;
     }
@@ -50,6 +50,7 @@
 #include "file_format.hh"
 #include "fmt/format.h"
 #include "lnav_config.hh"
+#include "log.format_detect.hh"
 #include "log_format_ext.hh"
 #include "sql_execute.hh"
 #include "sql_util.hh"
@@ -1496,6 +1497,19 @@ load_formats(const std::vector<std::filesystem::path>& extra_paths,
     });
     roots.insert(
         iter, graph_ordered_formats.begin(), graph_ordered_formats.end());
+
+    auto& detector = lnav::log::format_detector::singleton();
+    detector.build(roots);
+    log_info("Format detection index: %zu formats; %zu literals",
+             detector.get_entries().size(),
+             detector.get_literal_count());
+    for (const auto& ent : detector.get_entries()) {
+        if (ent.e_prefilter
+            == lnav::log::format_detector::prefilter_t::none)
+        {
+            log_info("  %s cannot be prefiltered", ent.e_name.get());
+        }
+    }
 }
 
 static void
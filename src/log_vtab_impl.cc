@@ -231,6 +231,131 @@ log_vtab_impl::extract(logfile* lf,
     format->annotate(lf, line_number, this->vi_attrs, values, false);
 }
 
+void
+log_vtab_impl::column_index::clear()
+{
+    this->ci_value_to_lines.clear();
+    this->ci_numeric_lines.clear();
+    this->ci_sorted_count = 0;
+    this->ci_other_lines.clear();
+    this->ci_max_line = 0_vl;
+}
+
+void
+log_vtab_impl::column_index::enable(bool equality, bool range)
+{
+    if ((equality && !this->ci_equality) || (range && !this->ci_range)) {
+        this->ci_equality = this->ci_equality || equality;
+        this->ci_range = this->ci_range || range;
+        this->clear();
+    }
+}
+
+void
+log_vtab_impl::column_index::add_value(vis_line_t vl, const logline_value& lv)
+{
+    if (this->ci_equality) {
+        auto& lines = this->ci_value_to_lines[lv.to_string()];
+
+        if (lines.empty() || lines.back() != vl) {
+            lines.push_back(vl);
+        }
+    }
+
+    if (this->ci_range) {
+        std::optional<double> num;
+
+        switch (lv.lv_meta.lvm_kind) {
+            case value_kind_t::VALUE_BOOLEAN:
+            case value_kind_t::VALUE_INTEGER:
+                num = (double) lv.lv_value.i;
+                break;
+            case value_kind_t::VALUE_FLOAT:
+                num = lv.lv_value.d;
+                break;
+            default:
+                break;
+        }
+
+        if (num) {
+            if (this->ci_numeric_lines.empty()
+                || this->ci_numeric_lines.back().second != vl)
+            {
+                this->ci_numeric_lines.emplace_back(num.value(), vl);
+            }
+        } else if (this->ci_other_lines.empty()
+                   || this->ci_other_lines.back() != vl)
+        {
+            this->ci_other_lines.push_back(vl);
+        }
+    }
+}
+
+void
+log_vtab_impl::column_index::lines_in_range(
+    const log_cursor::integral_constraint<double>& cons,
+    std::vector<vis_line_t>& lines_out)
+{
+    auto& nums = this->ci_numeric_lines;
+
+    if (this->ci_sorted_count < nums.size()) {
+        auto mid = std::next(nums.begin(), this->ci_sorted_count);
+
+        std::sort(mid, nums.end());
+        std::inplace_merge(nums.begin(), mid, nums.end());
+        this->ci_sorted_count = nums.size();
+    }
+
+    // The values were converted to doubles, so the bounds are inclusive to
+    // avoid dropping lines because of rounding.  SQLite will check the
+    // actual values.
+    auto lower = nums.begin();
+    auto upper = nums.end();
+    switch (cons.ic_op) {
+        case SQLITE_INDEX_CONSTRAINT_GT:
+        case SQLITE_INDEX_CONSTRAINT_GE:
+            lower = std::lower_bound(
+                nums.begin(),
+                nums.end(),
+                cons.ic_value,
+                [](const auto& lhs, double rhs) { return lhs.first < rhs; });
+            break;
+        case SQLITE_INDEX_CONSTRAINT_LT:
+        case SQLITE_INDEX_CONSTRAINT_LE:
+            upper = std::upper_bound(
+                nums.begin(),
+                nums.end(),
+                cons.ic_value,
+                [](double lhs, const auto& rhs) { return lhs < rhs.first; });
+            break;
+        default:
+            break;
+    }
+
+    for (auto iter = lower; iter != upper; ++iter) {
+        lines_out.push_back(iter->second);
+    }
+    lines_out.insert(lines_out.end(),
+                     this->ci_other_lines.begin(),
+                     this->ci_other_lines.end());
+}
+
+size_t
+log_vtab_impl::column_index::memory_usage() const
+{
+    size_t retval = 0;
+
+    for (const auto& pair : this->ci_value_to_lines) {
+        retval += sizeof(pair) + pair.first.capacity()
+            + pair.second.capacity() * sizeof(vis_line_t);
+    }
+    retval += this->ci_numeric_lines.capacity()
+        * sizeof(decltype(this->ci_numeric_lines)::value_type);
+    retval += this->ci_other_lines.capacity() * sizeof(vis_line_t);
+
+    return retval;
+}
+
 bool
 log_vtab_impl::is_valid(log_cursor& lc, logfile_sub_source& lss)
 {
@@ -457,17 +582,20 @@ vt_eof(sqlite3_vtab_cursor* cur)
 static void
 populate_indexed_columns(vtab_cursor* vc, log_vtab* vt)
 {
-    if (vc->log_cursor.is_eof() || vc->log_cursor.lc_indexed_columns.empty()) {
+    if (vc->log_cursor.is_eof()
+        || (vc->log_cursor.lc_indexed_columns.empty()
+            && vc->log_cursor.lc_range_columns.empty()))
+    {
         return;
     }
 
     logfile* lf = nullptr;
 
-    for (const auto& ic : vc->log_cursor.lc_indexed_columns) {
-        auto& ci = vt->vi->vi_column_indexes[ic.cc_column];
+    auto index_column = [vc, vt, &lf](int32_t column) {
+        auto& ci = vt->vi->vi_column_indexes[column];
 
         if (vc->log_cursor.lc_curr_line < ci.ci_max_line) {
-            continue;
+            return;
         }
 
         if (lf == nullptr) {
@@ -482,32 +610,51 @@ populate_indexed_columns(vtab_cursor* vc, log_vtab* vt)
             vt->vi->extract(lf, line_number, vc->line_values);
         }
 
-        auto sub_col = logline_value_meta::table_column{
-            (size_t) (ic.cc_column - VT_COL_MAX)};
+        auto sub_col
+            = logline_value_meta::table_column{(size_t) (column - VT_COL_MAX)};
         auto lv_iter = find_if(vc->line_values.lvv_values.begin(),
                                vc->line_values.lvv_values.end(),
                                logline_value_cmp(nullptr, sub_col));
         if (lv_iter == vc->line_values.lvv_values.end()
             || lv_iter->lv_meta.lvm_kind == value_kind_t::VALUE_NULL)
         {
-            continue;
+            return;
         }
 
-        auto value = lv_iter->to_string();
-
 #ifdef DEBUG_INDEXING
         log_debug("updated index for column %d %s -> %d",
-                  ic.cc_column,
-                  value.c_str(),
+                  column,
+                  lv_iter->to_string().c_str(),
                   (int) vc->log_cursor.lc_curr_line);
 #endif
 
-        if (ci.ci_value_to_lines[value].empty()
-            || ci.ci_value_to_lines[value].back()
-                != vc->log_cursor.lc_curr_line)
-        {
-            ci.ci_value_to_lines[value].push_back(vc->log_cursor.lc_curr_line);
-        }
+        ci.add_value(vc->log_cursor.lc_curr_line, *lv_iter);
+    };
+
+    for (const auto& ic : vc->log_cursor.lc_indexed_columns) {
+        index_column(ic.cc_column);
+    }
+    for (const auto& rc : vc->log_cursor.lc_range_columns) {
+        index_column(rc.rc_column);
+    }
+}
+
+/**
+ * Record that the lines before the given one have been added to the indexes
+ * for the constrained columns.
+ */
+static void
+update_indexed_max_line(vtab_cursor* vc, log_vtab* vt, vis_line_t vl)
+{
+    for (const auto& ic : vc->log_cursor.lc_indexed_columns) {
+        auto& ci = vt->vi->vi_column_indexes[ic.cc_column];
+
+        ci.ci_max_line = std::max(ci.ci_max_line, vl);
+    }
+    for (const auto& rc : vc->log_cursor.lc_range_columns) {
+        auto& ci = vt->vi->vi_column_indexes[rc.rc_column];
+
+        ci.ci_max_line = std::max(ci.ci_max_line, vl);
     }
 }
 
@@ -542,11 +689,14 @@ vt_next(sqlite3_vtab_cursor* cur)
             vc->log_cursor.lc_sub_index = 0;
         }
         if (vc->log_cursor.is_eof()) {
+            update_indexed_max_line(vc, vt, vc->log_cursor.lc_curr_line);
             done = true;
         } else {
             done = vt->vi->next(vc->log_cursor, *vt->lss);
             if (done) {
                 populate_indexed_columns(vc, vt);
+                update_indexed_max_line(
+                    vc, vt, vc->log_cursor.lc_curr_line + 1_vl);
             } else {
                 if (!vc->log_cursor.lc_indexed_lines.empty()) {
                     vc->log_cursor.lc_curr_line
@@ -600,13 +750,7 @@ vt_next_no_rowid(sqlite3_vtab_cursor* cur)
                 vc->log_cursor.lc_curr_line += 1_vl;
             }
             vc->log_cursor.lc_sub_index = 0;
-            for (auto& col_constraint : vc->log_cursor.lc_indexed_columns) {
-                vt->vi->vi_column_indexes[col_constraint.cc_column].ci_max_line
-                    = std::max(
-                        vt->vi->vi_column_indexes[col_constraint.cc_column]
-                            .ci_max_line,
-                        vc->log_cursor.lc_curr_line);
-            }
+            update_indexed_max_line(vc, vt, vc->log_cursor.lc_curr_line);
         }
     } while (!done);
 
@@ -619,6 +763,42 @@ vt_next_no_rowid(sqlite3_vtab_cursor* cur)
     return SQLITE_OK;
 }
 
+static void
+column_store_result(sqlite3_context* ctx,
+                    const logfile_column_store::column& cs_col,
+                    size_t row)
+{
+    using type_t = logfile_column_store::column::type_t;
+
+    if (cs_col.is_null(row)) {
+        sqlite3_result_null(ctx);
+        return;
+    }
+
+    switch (cs_col.get_type()) {
+        case type_t::integer:
+            sqlite3_result_int64(ctx, cs_col.get_integer(row));
+            break;
+        case type_t::real:
+            sqlite3_result_double(ctx, cs_col.get_real(row));
+            break;
+        case type_t::text:
+        case type_t::json: {
+            const auto& str = cs_col.get_text(row);
+
+            sqlite3_result_text(ctx, str.c_str(), str.size(), SQLITE_TRANSIENT);
+            if (cs_col.get_type() == type_t::json) {
+                sqlite3_result_subtype(ctx, JSON_SUBTYPE);
+            }
+            break;
+        }
+        case type_t::unknown:
+        case type_t::unsupported:
+            sqlite3_result_null(ctx);
+            break;
+    }
+}
+
 static int
 vt_column(sqlite3_vtab_cursor* cur, sqlite3_context* ctx, int col)
 {
@@ -831,13 +1011,26 @@ vt_column(sqlite3_vtab_cursor* cur, sqlite3_context* ctx, int col)
                         break;
                     }
                     case log_footer_columns::filters: {
-                        const auto& filter_mask
-                            = (*ld)->ld_filter_state.lfo_filter_state.tfs_mask;
+                        const auto& filter_state
+                            = (*ld)->ld_filter_state.lfo_filter_state;
+                        const auto& filters = vt->lss->get_filters();
+                        std::vector<size_t> matched;
+
+                        for (const auto& filter : filters) {
+                            if (filter->lf_deleted) {
+                                continue;
+                            }
+
+                            if (filter_state.is_set(filter->get_index(),
+                                                    line_number))
+                            {
+                                matched.emplace_back(filter->get_index());
+                            }
+                        }
 
-                        if (!filter_mask[line_number]) {
+                        if (matched.empty()) {
                             sqlite3_result_null(ctx);
                         } else {
-                            const auto& filters = vt->lss->get_filters();
                             yajlpp_gen gen;
 
                             yajl_gen_config(gen, yajl_gen_beautify, false);
@@ -845,17 +1038,8 @@ vt_column(sqlite3_vtab_cursor* cur, sqlite3_context* ctx, int col)
                             {
                                 yajlpp_array arr(gen);
 
-                                for (const auto& filter : filters) {
-                                    if (filter->lf_deleted) {
-                                        continue;
-                                    }
-
-                                    uint32_t mask
-                                        = (1UL << filter->get_index());
-
-                                    if (filter_mask[line_number] & mask) {
-                                        arr.gen(filter->get_index());
-                                    }
+                                for (auto index : matched) {
+                                    arr.gen(index);
                                 }
                             }
 
@@ -1023,9 +1207,29 @@ vt_column(sqlite3_vtab_cursor* cur, sqlite3_context* ctx, int col)
                 }
             } else {
                 if (vc->line_values.lvv_values.empty()) {
+                    auto* cs_table = vt->vi->vi_supports_column_store
+                        ? lf->get_column_store().get_table(
+                              vt->vi->get_name(), vt->vi->vi_column_count)
+                        : nullptr;
+
+                    if (cs_table != nullptr && cs_table->has_row(line_number))
+                    {
+                        const auto* cs_col
+                            = cs_table->get_column(col - VT_COL_MAX);
+
+                        if (cs_col != nullptr) {
+                            column_store_result(ctx, *cs_col, line_number);
+                            break;
+                        }
+                    }
+
                     vc->cache_msg(lf, ll);
                     require(vc->line_values.lvv_sbr.get_data() != nullptr);
                     vt->vi->extract(lf, line_number, vc->line_values);
+                    if (cs_table != nullptr) {
+                        lf->get_column_store().add_row(
+                            *cs_table, line_number, vc->line_values);
+                    }
                 }
 
                 auto sub_col = logline_value_meta::table_column{
@@ -1373,6 +1577,7 @@ vt_filter(sqlite3_vtab_cursor* p_vtc,
     p_cur->log_cursor.lc_level_constraint = std::nullopt;
     p_cur->log_cursor.lc_log_path.clear();
     p_cur->log_cursor.lc_indexed_columns.clear();
+    p_cur->log_cursor.lc_range_columns.clear();
     p_cur->log_cursor.lc_last_log_path_match = nullptr;
     p_cur->log_cursor.lc_last_log_path_mismatch = nullptr;
     p_cur->log_cursor.lc_unique_path.clear();
@@ -1634,6 +1839,20 @@ vt_filter(sqlite3_vtab_cursor* p_vtc,
                         case log_footer_columns::line_hash:
                             break;
                     }
+                } else if (op != SQLITE_INDEX_CONSTRAINT_EQ) {
+                    switch (sqlite3_value_type(argv[lpc])) {
+                        case SQLITE_INTEGER:
+                        case SQLITE_FLOAT:
+                            p_cur->log_cursor.lc_range_columns.emplace_back(
+                                col,
+                                log_cursor::integral_constraint<double>{
+                                    op,
+                                    sqlite3_value_double(argv[lpc]),
+                                });
+                            break;
+                        default:
+                            break;
+                    }
                 } else {
                     const auto* value
                         = (const char*) sqlite3_value_text(argv[lpc]);
@@ -1661,46 +1880,87 @@ vt_filter(sqlite3_vtab_cursor* p_vtc,
         }
     }
 
-    if (!p_cur->log_cursor.lc_indexed_columns.empty()) {
+    if (!p_cur->log_cursor.lc_indexed_columns.empty()
+        || !p_cur->log_cursor.lc_range_columns.empty())
+    {
         std::optional<vis_line_t> max_indexed_line;
 
-        for (const auto& icol : p_cur->log_cursor.lc_indexed_columns) {
-            auto& coli = vt->vi->vi_column_indexes[icol.cc_column];
+        auto check_index = [vt, &max_indexed_line](
+                               int32_t column, bool equality, bool range) {
+            auto& coli = vt->vi->vi_column_indexes[column];
 
             if (coli.ci_index_generation != vt->lss->lss_index_generation) {
-                coli.ci_value_to_lines.clear();
+                coli.clear();
                 coli.ci_index_generation = vt->lss->lss_index_generation;
-                coli.ci_max_line = 0_vl;
             }
+            coli.enable(equality, range);
 
             if (!max_indexed_line) {
                 max_indexed_line = coli.ci_max_line;
             } else if (coli.ci_max_line < max_indexed_line.value()) {
                 max_indexed_line = coli.ci_max_line;
             }
+        };
+
+        for (const auto& icol : p_cur->log_cursor.lc_indexed_columns) {
+            check_index(icol.cc_column, true, false);
+        }
+        for (const auto& rcol : p_cur->log_cursor.lc_range_columns) {
+            check_index(rcol.rc_column, false, true);
         }
 
+        // The constraints are all ANDed together, so the candidate lines
+        // are the intersection of the lines found for each one.
+        std::optional<std::vector<vis_line_t>> candidates;
+        auto intersect = [&candidates](std::vector<vis_line_t> lines) {
+            std::sort(lines.begin(), lines.end());
+            lines.erase(std::unique(lines.begin(), lines.end()), lines.end());
+            if (!candidates) {
+                candidates = std::move(lines);
+                return;
+            }
+
+            std::vector<vis_line_t> both;
+            std::set_intersection(candidates->begin(),
+                                  candidates->end(),
+                                  lines.begin(),
+                                  lines.end(),
+                                  std::back_inserter(both));
+            candidates = std::move(both);
+        };
+
         for (const auto& icol : p_cur->log_cursor.lc_indexed_columns) {
             auto& coli = vt->vi->vi_column_indexes[icol.cc_column];
+            std::vector<vis_line_t> lines;
 
             auto iter
                 = coli.ci_value_to_lines.find(icol.cc_constraint.sc_value);
             if (iter != coli.ci_value_to_lines.end()) {
-                for (auto vl : iter->second) {
-                    if (vl >= max_indexed_line.value()) {
-                        continue;
-                    }
+                lines = iter->second;
+            }
+            intersect(std::move(lines));
+        }
+        for (const auto& rcol : p_cur->log_cursor.lc_range_columns) {
+            auto& coli = vt->vi->vi_column_indexes[rcol.rc_column];
+            std::vector<vis_line_t> lines;
 
-                    if (vl < p_cur->log_cursor.lc_curr_line) {
-                        continue;
-                    }
+            coli.lines_in_range(rcol.rc_constraint, lines);
+            intersect(std::move(lines));
+        }
+
+        for (auto vl : candidates.value()) {
+            if (vl >= max_indexed_line.value()) {
+                continue;
+            }
+
+            if (vl < p_cur->log_cursor.lc_curr_line) {
+                continue;
+            }
 
 #ifdef DEBUG_INDEXING
-                    log_debug("adding indexed line %d", (int) vl);
+            log_debug("adding indexed line %d", (int) vl);
 #endif
-                    p_cur->log_cursor.lc_indexed_lines.push_back(vl);
-                }
-            }
+            p_cur->log_cursor.lc_indexed_lines.push_back(vl);
         }
 
         if (max_indexed_line && max_indexed_line.value() > 0_vl) {
@@ -1717,6 +1977,8 @@ vt_filter(sqlite3_vtab_cursor* p_vtc,
         {
             log_debug("max indexed out of sync, clearing other indexes");
             p_cur->log_cursor.lc_level_constraint = std::nullopt;
+            p_cur->log_cursor.lc_format_name.clear();
+            p_cur->log_cursor.lc_pattern_name.clear();
             p_cur->log_cursor.lc_curr_line = 0_vl;
             opid_val = std::nullopt;
             log_time_range = std::nullopt;
@@ -1748,21 +2010,9 @@ vt_filter(sqlite3_vtab_cursor* p_vtc,
         }
         if (log_time_range->vtr_end) {
             auto vl_max_opt
-                = vt->lss->row_for_time(log_time_range->vtr_end.value());
+                = vt->lss->find_after_time(log_time_range->vtr_end.value());
             if (vl_max_opt) {
                 p_cur->log_cursor.lc_end_line = vl_max_opt.value();
-                for (const auto& msg_info :
-                     vt->lss->window_at(vl_max_opt.value(),
-                                        vis_line_t(vt->lss->text_line_count())))
-                {
-                    if (log_time_range->vtr_end.value()
-                        < msg_info.get_logline().get_timeval())
-                    {
-                        break;
-                    }
-                    p_cur->log_cursor.lc_end_line
-                        = msg_info.get_vis_line() + 1_vl;
-                }
             }
         }
     }
@@ -1788,6 +2038,61 @@ vt_filter(sqlite3_vtab_cursor* p_vtc,
     return rc;
 }
 
+/**
+ * Guess the fraction of rows that will satisfy a constraint so that SQLite
+ * can choose between the available indexes.
+ */
+static double
+estimate_selectivity(
+    log_vtab* vt,
+    double total_rows,
+    const sqlite3_index_info::sqlite3_index_constraint& constraint)
+{
+    auto is_eq = constraint.op == SQLITE_INDEX_CONSTRAINT_EQ
+        || constraint.op == SQLITE_INDEX_CONSTRAINT_IS;
+
+    switch (constraint.iColumn) {
+        case VT_COL_LINE_NUMBER:
+            return is_eq ? 1.0 / total_rows : 0.25;
+        case VT_COL_LOG_TIME:
+        case VT_COL_LEVEL:
+            return 0.25;
+        default:
+            break;
+    }
+
+    if (constraint.iColumn > (VT_COL_MAX + vt->vi->vi_column_count - 1)) {
+        auto footer_column = static_cast<log_footer_columns>(
+            constraint.iColumn - (VT_COL_MAX + vt->vi->vi_column_count - 1)
+            - 1);
+
+        switch (footer_column) {
+            case log_footer_columns::opid:
+            case log_footer_columns::user_opid:
+                return 0.01;
+            case log_footer_columns::time_msecs:
+                return 0.25;
+            default:
+                return 0.5;
+        }
+    }
+
+    if (!is_eq) {
+        return 0.25;
+    }
+
+    auto iter = vt->vi->vi_column_indexes.find(constraint.iColumn);
+    if (iter != vt->vi->vi_column_indexes.end()
+        && iter->second.ci_equality
+        && iter->second.ci_index_generation == vt->lss->lss_index_generation
+        && !iter->second.ci_value_to_lines.empty())
+    {
+        return 1.0 / iter->second.ci_value_to_lines.size();
+    }
+
+    return 0.1;
+}
+
 static int
 vt_best_index(sqlite3_vtab* tab, sqlite3_index_info* p_info)
 {
@@ -1802,6 +2107,19 @@ vt_best_index(sqlite3_vtab* tab, sqlite3_index_info* p_info)
     if (!vt->vi->vi_supports_indexes) {
         return SQLITE_OK;
     }
+
+    // The range index only holds numeric values, so a range constraint on
+    // a text column is left for SQLite to check.
+    std::vector<log_vtab_impl::vtab_column> cols;
+    vt->vi->get_columns(cols);
+    auto is_numeric_column = [&cols](int col) {
+        auto col_index = col - VT_COL_MAX;
+        if (col_index < 0 || col_index >= (int) cols.size()) {
+            return false;
+        }
+        return cols[col_index].vc_type == SQLITE_INTEGER
+            || cols[col_index].vc_type == SQLITE_FLOAT;
+    };
     for (int lpc = 0; lpc < p_info->nConstraint; lpc++) {
         const auto& constraint = p_info->aConstraint[lpc];
         if (!constraint.usable || constraint.op == SQLITE_INDEX_CONSTRAINT_MATCH
@@ -1927,7 +2245,13 @@ vt_best_index(sqlite3_vtab* tab, sqlite3_index_info* p_info)
                         case log_footer_columns::line_hash:
                             break;
                     }
-                } else if (op == SQLITE_INDEX_CONSTRAINT_EQ) {
+                } else if (op == SQLITE_INDEX_CONSTRAINT_EQ
+                           || ((op == SQLITE_INDEX_CONSTRAINT_GT
+                                || op == SQLITE_INDEX_CONSTRAINT_GE
+                                || op == SQLITE_INDEX_CONSTRAINT_LT
+                                || op == SQLITE_INDEX_CONSTRAINT_LE)
+                               && is_numeric_column(col)))
+                {
                     argvInUse += 1;
                     indexes.push_back(constraint);
                     p_info->aConstraintUsage[lpc].argvIndex = argvInUse;
@@ -1941,6 +2265,28 @@ vt_best_index(sqlite3_vtab* tab, sqlite3_index_info* p_info)
         }
     }
 
+    // The rows are produced in the order of the log view, which is sorted
+    // by time, so an ascending sort on the time or line number is a no-op.
+    auto order_consumed = p_info->nOrderBy > 0;
+    for (int lpc = 0; lpc < p_info->nOrderBy; lpc++) {
+        const auto& order_by = p_info->aOrderBy[lpc];
+        auto footer_time_msecs = VT_COL_MAX + vt->vi->vi_column_count
+            + (int) log_footer_columns::time_msecs;
+
+        if (order_by.desc
+            || (order_by.iColumn != VT_COL_LINE_NUMBER
+                && order_by.iColumn != VT_COL_LOG_TIME
+                && order_by.iColumn != footer_time_msecs))
+        {
+            order_consumed = false;
+            break;
+        }
+    }
+    if (order_consumed) {
+        log_debug("  order by is consumed");
+        p_info->orderByConsumed = 1;
+    }
+
     if (argvInUse) {
         auto full_desc = fmt::format(FMT_STRING("SEARCH {} USING {}"),
                                      vt->vi->get_name().get(),
@@ -1971,7 +2317,14 @@ vt_best_index(sqlite3_vtab* tab, sqlite3_index_info* p_info)
         p_info->idxNum = argvInUse;
         p_info->idxStr = static_cast<char*>(storage);
         p_info->needToFreeIdxStr = 1;
-        p_info->estimatedCost = 10.0;
+
+        auto total_rows = std::max(1.0, (double) vt->lss->text_line_count());
+        auto estimated_rows = total_rows;
+        for (const auto& index : indexes) {
+            estimated_rows *= estimate_selectivity(vt, total_rows, index);
+        }
+        p_info->estimatedRows = std::max(1.0, estimated_rows);
+        p_info->estimatedCost = std::max(1.0, estimated_rows);
     } else {
         static char fullscan_str[] = "fullscan";
 
@@ -2300,6 +2653,14 @@ log_vtab_manager::unregister_vtab(intern_string_t name)
         rc = sqlite3_exec(this->vm_db, sql, NULL, NULL, NULL);
 
         this->vm_impls.erase(name);
+
+        for (auto& ld : this->vm_source) {
+            auto* lf = ld->get_file_ptr();
+
+            if (lf != nullptr) {
+                lf->get_column_store().drop_table(name);
+            }
+        }
     }
 
     return retval;
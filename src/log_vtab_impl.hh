@@ -126,6 +126,16 @@ struct log_cursor {
         string_constraint cc_constraint;
     };
 
+    struct range_constraint {
+        range_constraint(int32_t col, integral_constraint<double> cons)
+            : rc_column(col), rc_constraint(cons)
+        {
+        }
+
+        int32_t rc_column;
+        integral_constraint<double> rc_constraint;
+    };
+
     vis_line_t lc_curr_line;
     int lc_sub_index;
     vis_line_t lc_end_line;
@@ -144,6 +154,7 @@ struct log_cursor {
     logfile* lc_last_unique_path_mismatch{nullptr};
 
     std::vector<column_constraint> lc_indexed_columns;
+    std::vector<range_constraint> lc_range_columns;
     std::vector<vis_line_t> lc_indexed_lines;
 
     enum class constraint_t {
@@ -227,9 +238,42 @@ public:
                          uint64_t line_number,
                          logline_value_vector& values);
 
+    /**
+     * An index of the values in a column that is built up as the table is
+     * scanned.  The lines before ci_max_line have all been indexed.
+     */
     struct column_index {
+        void clear();
+
+        /**
+         * Make sure the index can answer the given type of constraint,
+         * resetting it if the index needs to be rebuilt to do so.
+         */
+        void enable(bool equality, bool range);
+
+        void add_value(vis_line_t vl, const logline_value& lv);
+
+        /**
+         * Append the lines that might match the given range constraint.
+         */
+        void lines_in_range(const log_cursor::integral_constraint<double>& cons,
+                            std::vector<vis_line_t>& lines_out);
+
+        size_t memory_usage() const;
+
+        bool ci_equality{false};
+        bool ci_range{false};
         robin_hood::unordered_map<std::string, std::vector<vis_line_t>>
             ci_value_to_lines;
+        /**
+         * The numeric values in the column.  The entries before
+         * ci_sorted_count are sorted and the rest have been added since
+         * the last range lookup.
+         */
+        std::vector<std::pair<double, vis_line_t>> ci_numeric_lines;
+        size_t ci_sorted_count{0};
+        /** The lines with values that are not numbers. */
+        std::vector<vis_line_t> ci_other_lines;
         uint32_t ci_index_generation{0};
         vis_line_t ci_max_line{0};
     };
@@ -237,6 +281,11 @@ public:
     std::map<int32_t, column_index> vi_column_indexes;
 
     bool vi_supports_indexes{true};
+    /**
+     * True if each row maps to a single log message, so the values returned
+     * by extract() can be cached in the file's column store.
+     */
+    bool vi_supports_column_store{false};
     int vi_column_count{0};
     string_attrs_t vi_attrs;
 
@@ -250,6 +299,7 @@ public:
     log_format_vtab_impl(const log_format& format)
         : log_vtab_impl(format.get_name()), lfvi_format(format)
     {
+        this->vi_supports_column_store = true;
     }
 
     virtual bool next(log_cursor& lc, logfile_sub_source& lss);
@@ -0,0 +1,214 @@
+/**
+ * Copyright (c) 2024, Timothy Stack
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ * * Neither the name of Timothy Stack nor the names of its contributors
+ * may be used to endorse or promote products derived from this software
+ * without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE REGENTS AND CONTRIBUTORS ''AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * @file logfile.cache.cc
+ */
+
+#include <chrono>
+#include <future>
+#include <vector>
+
+#include "logfile.cache.hh"
+
+#include <errno.h>
+#include <unistd.h>
+
+#include "base/fs_util.hh"
+#include "base/lnav_log.hh"
+#include "base/paths.hh"
+#include "config.h"
+#include "fmt/format.h"
+#include "hasher.hh"
+
+using namespace std::chrono_literals;
+
+namespace lnav::logfile::cache {
+
+static std::filesystem::path
+cache_path()
+{
+    return lnav::paths::workdir() / "index-cache";
+}
+
+bool
+header::is_valid() const
+{
+    return memcmp(this->h_magic, MAGIC, sizeof(MAGIC)) == 0
+        && this->h_version == FORMAT_VERSION;
+}
+
+std::filesystem::path
+path_for(const struct stat& st)
+{
+    auto base_name = hasher()
+                         .update(st.st_dev)
+                         .update(st.st_ino)
+                         .to_string();
+
+    return cache_path() / base_name.substr(0, 2)
+        / fmt::format(FMT_STRING("{}.idx"), base_name);
+}
+
+bool
+hash_block(int fd, file_off_t end, uint64_t (&out)[2])
+{
+    char buffer[BLOCK_SIZE];
+    auto start = std::max(file_off_t{0}, end - BLOCK_SIZE);
+    auto len = end - start;
+    auto rc = pread(fd, buffer, len, start);
+
+    if (rc != len) {
+        return false;
+    }
+
+    auto bits = hasher().update(buffer, len).to_array();
+    memcpy(out, bits.in(), sizeof(out));
+    return true;
+}
+
+void
+cleanup()
+{
+    (void) std::async(std::launch::async, []() {
+        auto now = std::filesystem::file_time_type::clock::now();
+        std::vector<std::filesystem::path> to_remove;
+        std::error_code ec;
+
+        for (const auto& cache_subdir :
+             std::filesystem::directory_iterator(cache_path(), ec))
+        {
+            for (const auto& entry :
+                 std::filesystem::directory_iterator(cache_subdir, ec))
+            {
+                auto mtime = std::filesystem::last_write_time(entry.path(), ec);
+                auto exp_time = mtime + 7 * 24h;
+                if (ec || now < exp_time) {
+                    continue;
+                }
+
+                to_remove.emplace_back(entry.path());
+            }
+        }
+
+        for (auto& entry : to_remove) {
+            log_debug("removing index cache: %s", entry.c_str());
+            std::filesystem::remove(entry, ec);
+        }
+    });
+}
+
+static bool
+write_all(int fd, const std::string& data)
+{
+    const auto* bits = data.data();
+    auto len = data.size();
+
+    while (len > 0) {
+        auto rc = ::write(fd, bits, len);
+        if (rc <= 0) {
+            if (rc < 0 && errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        bits += rc;
+        len -= rc;
+    }
+    return true;
+}
+
+std::future<void>
+write(snapshot snap)
+{
+    return std::async(std::launch::async, [snap = std::move(snap)]() {
+        std::error_code ec;
+        std::filesystem::create_directories(snap.s_path.parent_path(), ec);
+
+        auto tmp_pattern = snap.s_path;
+        tmp_pattern += ".XXXXXX";
+        auto tmp_res = lnav::filesystem::open_temp_file(tmp_pattern);
+        if (tmp_res.isErr()) {
+            log_error("unable to create index cache -- %s",
+                      tmp_res.unwrapErr().c_str());
+            return;
+        }
+
+        auto tmp_pair = tmp_res.unwrap();
+        auto hdr_bits = std::string((const char*) &snap.s_header,
+                                    sizeof(snap.s_header));
+        if (!write_all(tmp_pair.second, hdr_bits)
+            || !write_all(tmp_pair.second, snap.s_lines)
+            || !write_all(tmp_pair.second, snap.s_metadata))
+        {
+            log_error("unable to write index cache -- %s: %s",
+                      tmp_pair.first.c_str(),
+                      strerror(errno));
+            std::filesystem::remove(tmp_pair.first, ec);
+            return;
+        }
+
+        std::filesystem::rename(tmp_pair.first, snap.s_path, ec);
+        if (ec) {
+            log_error("unable to rename index cache -- %s: %s",
+                      snap.s_path.c_str(),
+                      ec.message().c_str());
+            std::filesystem::remove(tmp_pair.first, ec);
+            return;
+        }
+
+        log_info("saved %llu lines to index cache -- %s",
+                 (unsigned long long) snap.s_header.h_line_count,
+                 snap.s_path.c_str());
+    });
+}
+
+writer&
+writer::put(const string_fragment& sf)
+{
+    this->put(static_cast<uint32_t>(sf.length()));
+    this->w_buffer.append(sf.data(), sf.length());
+    return *this;
+}
+
+string_fragment
+reader::get_str()
+{
+    auto len = this->get<uint32_t>();
+
+    if (this->r_error || this->r_offset + len > this->r_buffer.size()) {
+        this->r_error = true;
+        return string_fragment::invalid();
+    }
+
+    auto retval = string_fragment::from_bytes(
+        this->r_buffer.data() + this->r_offset, len);
+    this->r_offset += len;
+    return retval;
+}
+
+}  // namespace lnav::logfile::cache
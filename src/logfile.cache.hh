@@ -0,0 +1,186 @@
+/**
+ * Copyright (c) 2024, Timothy Stack
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ * * Neither the name of Timothy Stack nor the names of its contributors
+ * may be used to endorse or promote products derived from this software
+ * without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE REGENTS AND CONTRIBUTORS ''AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * @file logfile.cache.hh
+ */
+
+#ifndef lnav_logfile_cache_hh
+#define lnav_logfile_cache_hh
+
+#include <filesystem>
+#include <future>
+#include <string>
+#include <type_traits>
+
+#include <stdint.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include "base/file_range.hh"
+#include "base/intern_string.hh"
+
+namespace lnav::logfile::cache {
+
+/**
+ * The fixed-size header at the start of an index cache file.  The packed
+ * logline array immediately follows the header and the variable-length
+ * metadata follows the lines.
+ */
+struct header {
+    static constexpr char MAGIC[8] = {'l', 'n', 'a', 'v', 'i', 'd', 'x', '\0'};
+    static constexpr uint32_t FORMAT_VERSION = 1;
+
+    char h_magic[8];
+    uint32_t h_version{FORMAT_VERSION};
+    uint32_t h_logline_size{0};
+    /** Hash of the lnav binary, format definitions, and settings. */
+    uint64_t h_fingerprint[2]{};
+    uint64_t h_dev{0};
+    uint64_t h_ino{0};
+    int64_t h_file_size{0};
+    int64_t h_mtime{0};
+    /** Hash of the first and last blocks of the indexed content. */
+    uint64_t h_head_hash[2]{};
+    uint64_t h_tail_hash[2]{};
+    /** The offset in the file where indexing stopped. */
+    int64_t h_index_size{0};
+    uint64_t h_line_count{0};
+    uint64_t h_metadata_size{0};
+
+    bool is_valid() const;
+};
+
+static_assert(std::is_trivially_copyable_v<header>);
+
+/** The size of the blocks at the start and end that are hashed. */
+constexpr file_ssize_t BLOCK_SIZE = 4 * 1024;
+
+std::filesystem::path path_for(const struct stat& st);
+
+/**
+ * Hash the block of data that ends at the given offset.
+ *
+ * @param fd The file to read.
+ * @param end The offset where the block ends.
+ * @param out The hash of the block.
+ * @return true if the block could be read.
+ */
+bool hash_block(int fd, file_off_t end, uint64_t (&out)[2]);
+
+/**
+ * Remove cache files that have not been used recently.
+ */
+void cleanup();
+
+/**
+ * A copy of the index of a file that is ready to be written to the cache.
+ */
+struct snapshot {
+    std::filesystem::path s_path;
+    header s_header;
+    /** The packed logline array. */
+    std::string s_lines;
+    std::string s_metadata;
+};
+
+/**
+ * Write a snapshot to its cache file on a background thread.  The data is
+ * written to a temporary file that is then renamed into place, so readers
+ * never see a partial cache.
+ */
+std::future<void> write(snapshot snap);
+
+/**
+ * Simple helper for encoding the variable-length metadata section.
+ */
+class writer {
+public:
+    template<typename T>
+    writer& put(const T& value)
+    {
+        static_assert(std::is_trivially_copyable_v<T>);
+
+        this->w_buffer.append((const char*) &value, sizeof(value));
+        return *this;
+    }
+
+    writer& put(const string_fragment& sf);
+
+    writer& put(const std::string& str)
+    {
+        return this->put(string_fragment::from_str(str));
+    }
+
+    const std::string& get_buffer() const { return this->w_buffer; }
+
+private:
+    std::string w_buffer;
+};
+
+/**
+ * Helper for decoding the metadata section written by a writer.  Reads past
+ * the end of the buffer set the error flag instead of failing immediately so
+ * that the caller can check once at the end.
+ */
+class reader {
+public:
+    explicit reader(const std::string& buffer) : r_buffer(buffer) {}
+
+    template<typename T>
+    T get()
+    {
+        static_assert(std::is_trivially_copyable_v<T>);
+
+        T retval{};
+        if (this->r_offset + sizeof(T) > this->r_buffer.size()) {
+            this->r_error = true;
+            return retval;
+        }
+        memcpy(&retval, this->r_buffer.data() + this->r_offset, sizeof(T));
+        this->r_offset += sizeof(T);
+        return retval;
+    }
+
+    string_fragment get_str();
+
+    bool is_valid() const
+    {
+        return !this->r_error && this->r_offset == this->r_buffer.size();
+    }
+
+    bool has_error() const { return this->r_error; }
+
+private:
+    const std::string& r_buffer;
+    size_t r_offset{0};
+    bool r_error{false};
+};
+
+}  // namespace lnav::logfile::cache
+
+#endif
@@ -29,6 +29,8 @@
  * @file logfile.cc
  */
 
+#include <future>
+#include <thread>
 #include <utility>
 
 #include "logfile.hh"
@@ -51,8 +53,11 @@
 #include "file_options.hh"
 #include "hasher.hh"
 #include "lnav_util.hh"
+#include "log.format_detect.hh"
 #include "log.watch.hh"
 #include "log_format.hh"
+#include "log_format_ext.hh"
+#include "logfile.cache.hh"
 #include "logfile.cfg.hh"
 #include "piper.looper.hh"
 #include "yajlpp/yajlpp_def.hh"
@@ -63,6 +68,68 @@ static auto intern_lifetime = intern_string::get_table_lifetime();
 
 static const size_t INDEX_RESERVE_INCREMENT = 1024;
 
+/**
+ * The number of lines at the start of a file that are checked against all of
+ * the formats to find the best match.
+ */
+static constexpr size_t MAX_DETECTION_LINES = 250;
+
+/**
+ * The amount of unindexed data that is needed before it is worth splitting
+ * it up and indexing the pieces concurrently.
+ */
+static constexpr file_ssize_t MIN_SPLIT_SIZE = 32 * 1024 * 1024;
+
+/**
+ * The maximum amount of data each thread indexes in a single pass of
+ * logfile::index_concurrently().
+ */
+static constexpr file_ssize_t MAX_CHUNK_SIZE = 64 * 1024 * 1024;
+
+/**
+ * The number of lines a thread indexes between checks of the deadline.
+ */
+static constexpr size_t DEADLINE_CHECK_LINES = 1024;
+
+/**
+ * A piece of the file that is indexed on its own thread by
+ * logfile::index_concurrently().
+ */
+struct index_chunk {
+    explicit index_chunk(file_range range) : ic_range(range) {}
+
+    file_range ic_range;
+    /** The time of the last line before the split. */
+    std::chrono::microseconds ic_seed_time{0};
+    std::shared_ptr<log_format> ic_format;
+    ArenaAlloc::Alloc<char> ic_allocator{64 * 1024};
+    scan_batch_context ic_sbc{this->ic_allocator};
+    /**
+     * The lines in this chunk.  The first element is a copy of the last line
+     * before the split so that the format always has a previous line to
+     * refer to.
+     */
+    std::vector<logline> ic_lines;
+    /**
+     * Flags for the lines before the first one that matched the format.
+     * These lines depend on the end of the previous chunk, so they are
+     * fixed up while stitching.  A flag is true if the line was treated as
+     * a continuation of the previous one.
+     */
+    std::vector<bool> ic_leading_continued;
+    size_t ic_longest_line{0};
+    uint32_t ic_out_of_time_order_count{0};
+    bool ic_sort_needed{false};
+    bool ic_failed{false};
+    /**
+     * True if the deadline passed before the whole chunk was indexed.  The
+     * range is shrunk to the part that was indexed.
+     */
+    bool ic_interrupted{false};
+    /** True once the lines in the chunk have been scanned. */
+    bool ic_scanned{false};
+};
+
 static const typed_json_path_container<lnav::gzip::header> file_header_handlers
     = {
         yajlpp::property_handler("name").for_field(&lnav::gzip::header::h_name),
@@ -137,7 +204,13 @@ logfile::open(std::filesystem::path filename,
         lf->lf_valid_filename = false;
     }
 
-    lf->lf_line_buffer.set_fd(lf_fd);
+    try {
+        lf->lf_line_buffer.set_fd(lf_fd);
+    } catch (const line_buffer::error& e) {
+        return Err(fmt::format(FMT_STRING("unable to read {}: {}"),
+                               lf->lf_filename,
+                               strerror(e.e_err)));
+    }
     lf->lf_index.reserve(INDEX_RESERVE_INCREMENT);
 
     lf->lf_indexing = lf->lf_options.loo_is_visible;
@@ -159,10 +232,23 @@ logfile::open(std::filesystem::path filename,
                     };
                 }
             },
-            [&lf](const lnav::piper::header& phdr) {
+            [&lf, &resolved_path](const lnav::piper::header& phdr) {
                 static auto& safe_options_hier
                     = injector::get<lnav::safe_file_options_hier&>();
 
+                if (!phdr.h_line_meta.empty() && !resolved_path.empty()) {
+                    auto meta_path
+                        = resolved_path.parent_path() / phdr.h_line_meta;
+                    auto open_res = lnav::filesystem::open_file(
+                        meta_path, O_RDONLY | O_CLOEXEC);
+                    if (open_res.isOk()) {
+                        lf->lf_line_buffer.set_line_meta_fd(open_res.unwrap());
+                    } else {
+                        log_error("unable to open line metadata: %s",
+                                  open_res.unwrapErr().c_str());
+                    }
+                }
+
                 lf->lf_embedded_metadata["org.lnav.piper.header"] = {
                     text_format_t::TF_JSON,
                     lnav::piper::header_handlers.formatter_for(phdr)
@@ -323,6 +409,51 @@ logfile::set_format_base_time(log_format* lf)
                                    this->lf_cached_base_tm.value());
 }
 
+void
+logfile::update_applicable_defs()
+{
+    this->lf_applicable_taggers.clear();
+    for (auto& td_pair : this->lf_format->lf_tag_defs) {
+        bool matches = td_pair.second->ftd_paths.empty();
+        for (const auto& pr : td_pair.second->ftd_paths) {
+            if (pr.matches(this->lf_filename.c_str())) {
+                matches = true;
+                break;
+            }
+        }
+        if (!matches) {
+            continue;
+        }
+
+        log_info("%s: found applicable tag definition /%s/tags/%s",
+                 this->lf_filename.c_str(),
+                 this->lf_format->get_name().get(),
+                 td_pair.second->ftd_name.c_str());
+        this->lf_applicable_taggers.emplace_back(td_pair.second);
+    }
+
+    this->lf_applicable_partitioners.clear();
+    for (auto& pd_pair : this->lf_format->lf_partition_defs) {
+        bool matches = pd_pair.second->fpd_paths.empty();
+        for (const auto& pr : pd_pair.second->fpd_paths) {
+            if (pr.matches(this->lf_filename.c_str())) {
+                matches = true;
+                break;
+            }
+        }
+        if (!matches) {
+            continue;
+        }
+
+        log_info("%s: found applicable partition definition "
+                 "/%s/partitions/%s",
+                 this->lf_filename.c_str(),
+                 this->lf_format->get_name().get(),
+                 pd_pair.second->fpd_name.c_str());
+        this->lf_applicable_partitioners.emplace_back(pd_pair.second);
+    }
+}
+
 bool
 logfile::process_prefix(shared_buffer_ref& sbr,
                         const line_info& li,
@@ -338,7 +469,8 @@ logfile::process_prefix(shared_buffer_ref& sbr,
     bool retval = false;
 
     if (this->lf_options.loo_detect_format
-        && (this->lf_format == nullptr || this->lf_index.size() < 250))
+        && (this->lf_format == nullptr
+            || this->lf_index.size() < MAX_DETECTION_LINES))
     {
         const auto& root_formats = log_format::get_root_formats();
         std::optional<std::pair<log_format*, log_format::scan_match>>
@@ -362,7 +494,13 @@ logfile::process_prefix(shared_buffer_ref& sbr,
                   li.li_file_range.fr_size);
         auto starting_index_size = this->lf_index.size();
         size_t prev_index_size = this->lf_index.size();
-        for (const auto& curr : root_formats) {
+        auto& detector = lnav::log::format_detector::singleton();
+        const auto candidates
+            = detector.find_candidates(sbr.to_string_fragment());
+        for (size_t root_index = 0; root_index < root_formats.size();
+             root_index++)
+        {
+            const auto& curr = root_formats[root_index];
             if (this->lf_index.size()
                 >= curr->lf_max_unrecognized_lines.value_or(
                     max_unrecognized_lines))
@@ -419,17 +557,40 @@ logfile::process_prefix(shared_buffer_ref& sbr,
             }
 
             scan_count += 1;
+            auto* stats = detector.get_stats(root_index, curr.get());
+            auto is_current_format = this->lf_format != nullptr
+                && this->lf_format->lf_root_format == curr.get();
+            /*
+             * The specialized format will accept lines that do not match
+             * its patterns, so it always needs to be scanned.
+             */
+            if (!is_current_format
+                && !candidates.may_match(root_index, curr.get()))
+            {
+                if (stats != nullptr) {
+                    stats->fs_skips += 1;
+                }
+                continue;
+            }
+
+            auto scan_start = std::chrono::steady_clock::now();
             curr->clear();
             this->set_format_base_time(curr.get());
             log_format::scan_result_t scan_res{mapbox::util::no_init{}};
-            if (this->lf_format != nullptr
-                && this->lf_format->lf_root_format == curr.get())
-            {
+            if (is_current_format) {
                 scan_res = this->lf_format->scan(
                     *this, this->lf_index, li, sbr, sbc);
             } else {
                 scan_res = curr->scan(*this, this->lf_index, li, sbr, sbc);
             }
+            if (stats != nullptr) {
+                stats->fs_scans += 1;
+                stats->fs_scan_time += std::chrono::steady_clock::now()
+                    - scan_start;
+                if (scan_res.is<log_format::scan_match>()) {
+                    stats->fs_matches += 1;
+                }
+            }
 
             scan_res.match(
                 [this,
@@ -537,47 +698,7 @@ logfile::process_prefix(shared_buffer_ref& sbr,
                     = hasher().update(sbr.get_data(), sbr.length()).to_string();
             }
 
-            this->lf_applicable_taggers.clear();
-            for (auto& td_pair : this->lf_format->lf_tag_defs) {
-                bool matches = td_pair.second->ftd_paths.empty();
-                for (const auto& pr : td_pair.second->ftd_paths) {
-                    if (pr.matches(this->lf_filename.c_str())) {
-                        matches = true;
-                        break;
-                    }
-                }
-                if (!matches) {
-                    continue;
-                }
-
-                log_info("%s: found applicable tag definition /%s/tags/%s",
-                         this->lf_filename.c_str(),
-                         this->lf_format->get_name().get(),
-                         td_pair.second->ftd_name.c_str());
-                this->lf_applicable_taggers.emplace_back(td_pair.second);
-            }
-
-            this->lf_applicable_partitioners.clear();
-            for (auto& pd_pair : this->lf_format->lf_partition_defs) {
-                bool matches = pd_pair.second->fpd_paths.empty();
-                for (const auto& pr : pd_pair.second->fpd_paths) {
-                    if (pr.matches(this->lf_filename.c_str())) {
-                        matches = true;
-                        break;
-                    }
-                }
-                if (!matches) {
-                    continue;
-                }
-
-                log_info(
-                    "%s: found applicable partition definition "
-                    "/%s/partitions/%s",
-                    this->lf_filename.c_str(),
-                    this->lf_format->get_name().get(),
-                    pd_pair.second->fpd_name.c_str());
-                this->lf_applicable_partitioners.emplace_back(pd_pair.second);
-            }
+            this->update_applicable_defs();
 
             /*
              * We'll go ahead and assume that any previous lines were
@@ -686,6 +807,614 @@ logfile::process_prefix(shared_buffer_ref& sbr,
     return retval;
 }
 
+void
+logfile::process_line_defs(iterator ll, const shared_buffer_ref& sbr)
+{
+    auto sf = sbr.to_string_fragment();
+
+    for (const auto& td : this->lf_applicable_taggers) {
+        auto curr_ll = ll;
+
+        if (td->ftd_level != LEVEL_UNKNOWN
+            && td->ftd_level != curr_ll->get_msg_level())
+        {
+            continue;
+        }
+
+        if (td->ftd_pattern.pp_value->find_in(sf, PCRE2_NO_UTF_CHECK)
+                .ignore_error()
+                .has_value())
+        {
+            while (curr_ll->is_continued()) {
+                --curr_ll;
+            }
+            curr_ll->set_meta_mark(true);
+            auto line_number
+                = static_cast<uint32_t>(std::distance(this->begin(), curr_ll));
+
+            this->lf_bookmark_metadata[line_number].add_tag(td->ftd_name);
+        }
+    }
+
+    for (const auto& pd : this->lf_applicable_partitioners) {
+        static thread_local auto part_md
+            = lnav::pcre2pp::match_data::unitialized();
+
+        auto curr_ll = ll;
+
+        if (pd->fpd_level != LEVEL_UNKNOWN
+            && pd->fpd_level != curr_ll->get_msg_level())
+        {
+            continue;
+        }
+
+        auto match_res = pd->fpd_pattern.pp_value->capture_from(sf)
+                             .into(part_md)
+                             .matches(PCRE2_NO_UTF_CHECK)
+                             .ignore_error();
+        if (match_res) {
+            while (curr_ll->is_continued()) {
+                --curr_ll;
+            }
+            curr_ll->set_meta_mark(true);
+            auto line_number
+                = static_cast<uint32_t>(std::distance(this->begin(), curr_ll));
+
+            this->lf_bookmark_metadata[line_number].bm_name
+                = part_md.to_string();
+        }
+    }
+
+    if (!ll->is_continued() && !this->lf_deferred) {
+        lnav::log::watch::eval_with(*this, ll);
+    }
+}
+
+/**
+ * Find the start of the line that contains the given offset.
+ *
+ * @return The offset of the start of the line or nullopt if the line starts
+ * at or before the lower bound.
+ */
+static std::optional<file_off_t>
+find_line_start(int fd, file_off_t off, file_off_t lower_bound)
+{
+    char buffer[16 * 1024];
+
+    while (off > lower_bound) {
+        auto start = std::max(lower_bound, off - (file_off_t) sizeof(buffer));
+        auto len = off - start;
+        auto rc = pread(fd, buffer, len, start);
+
+        if (rc != len) {
+            return std::nullopt;
+        }
+
+        for (auto lpc = len; lpc > 0; lpc--) {
+            if (buffer[lpc - 1] == '\n') {
+                auto retval = start + lpc;
+
+                if (retval <= lower_bound) {
+                    return std::nullopt;
+                }
+                return retval;
+            }
+        }
+        off = start;
+    }
+
+    return std::nullopt;
+}
+
+std::optional<file_range>
+logfile::index_concurrently(file_off_t off,
+                            const struct stat& st,
+                            scan_batch_context& sbc,
+                            bool& sort_needed,
+                            std::optional<ui_clock::time_point> deadline)
+{
+    static const auto& lf_cfg = injector::get<const lnav::logfile::config&>();
+
+    /*
+     * The chunks left over from a pass that ran out of time are only used
+     * if this pass picks up where that one stopped.
+     */
+    auto pending = std::move(this->lf_pending_chunks);
+    this->lf_pending_chunks.clear();
+    if (!pending.empty() && pending.front()->ic_range.fr_offset < off) {
+        pending.clear();
+    }
+
+    if (this->lf_format == nullptr || this->lf_index.empty()
+        || this->lf_deferred || this->lf_detection_only
+        || this->in_detection_window()
+        || !this->lf_format->is_scan_thread_safe()
+        || this->lf_line_buffer.is_compressed()
+        || this->lf_line_buffer.is_pipe()
+        || this->lf_line_buffer.has_line_metadata()
+        || (pending.empty() && st.st_size - off < MIN_SPLIT_SIZE))
+    {
+        return std::nullopt;
+    }
+
+    size_t thread_count = lf_cfg.lc_index_threads;
+    if (thread_count == 0) {
+        thread_count = std::max(1U, std::thread::hardware_concurrency());
+    }
+    if (thread_count < 2) {
+        return std::nullopt;
+    }
+
+    std::vector<std::unique_ptr<index_chunk>> chunks;
+    if (pending.empty()) {
+        auto fd = this->lf_line_buffer.get_fd();
+        auto region_end = std::min(
+            static_cast<file_off_t>(st.st_size),
+            off + static_cast<file_off_t>(thread_count) * MAX_CHUNK_SIZE);
+        auto chunk_size
+            = (region_end - off) / static_cast<file_off_t>(thread_count);
+        auto chunk_start = off;
+
+        for (size_t lpc = 1; lpc <= thread_count; lpc++) {
+            auto target = lpc == thread_count
+                ? region_end
+                : off + static_cast<file_off_t>(lpc) * chunk_size;
+            auto line_start_opt = find_line_start(fd, target, chunk_start);
+
+            if (!line_start_opt) {
+                continue;
+            }
+
+            auto line_start = line_start_opt.value();
+            chunks.emplace_back(std::make_unique<index_chunk>(
+                file_range{chunk_start, line_start - chunk_start}));
+            chunk_start = line_start;
+        }
+
+        if (chunks.size() < 2) {
+            return std::nullopt;
+        }
+    } else {
+        /*
+         * Only the gaps before the chunks that were already scanned need to
+         * be indexed in this pass.
+         */
+        auto gap_start = off;
+        for (auto& pc : pending) {
+            if (gap_start < pc->ic_range.fr_offset) {
+                chunks.emplace_back(std::make_unique<index_chunk>(
+                    file_range{gap_start, pc->ic_range.fr_offset - gap_start}));
+            }
+            gap_start = pc->ic_range.next_offset();
+            chunks.emplace_back(std::move(pc));
+        }
+        log_debug("%s: resuming concurrent indexing with %zu chunks",
+                  this->lf_filename.c_str(),
+                  chunks.size());
+    }
+
+    /*
+     * specialized() modifies the format it is called on, so the copies for
+     * each chunk are made from the root format and then given the state of
+     * this file's format.
+     */
+    auto* root_format = this->lf_format->lf_root_format;
+    const auto& seed_line = this->lf_index.back();
+    for (auto& chunk : chunks) {
+        if (chunk->ic_scanned) {
+            continue;
+        }
+        chunk->ic_seed_time = seed_line.get_time<std::chrono::microseconds>();
+        chunk->ic_format
+            = root_format->specialized(this->lf_format->last_pattern_index());
+        chunk->ic_format->lf_date_time = this->lf_format->lf_date_time;
+        chunk->ic_format->lf_time_scanner = this->lf_format->lf_time_scanner;
+        chunk->ic_format->lf_timestamp_flags
+            = this->lf_format->lf_timestamp_flags;
+        for (auto& lvs : chunk->ic_format->lf_value_stats) {
+            lvs.clear();
+        }
+        chunk->ic_lines.reserve(INDEX_RESERVE_INCREMENT);
+        chunk->ic_lines.emplace_back(seed_line);
+    }
+
+    auto scan_chunk = [this, deadline](index_chunk& chunk) {
+        try {
+            line_buffer lb;
+            auto chunk_fd = auto_fd::dup_of(this->lf_line_buffer.get_fd());
+            auto& lines = chunk.ic_lines;
+            auto prev_range = file_range{chunk.ic_range.fr_offset};
+            bool found_match = false;
+            size_t line_count = 0;
+
+            lb.set_fd(chunk_fd);
+            while (prev_range.next_offset() < chunk.ic_range.next_offset()) {
+                line_count += 1;
+                if (deadline && line_count % DEADLINE_CHECK_LINES == 0
+                    && ui_clock::now() > deadline.value())
+                {
+                    chunk.ic_range.fr_size
+                        = prev_range.next_offset() - chunk.ic_range.fr_offset;
+                    chunk.ic_interrupted = true;
+                    return;
+                }
+
+                auto load_result = lb.load_next_line(prev_range);
+                if (load_result.isErr()) {
+                    chunk.ic_failed = true;
+                    return;
+                }
+
+                auto li = load_result.unwrap();
+                if (li.li_file_range.empty() || li.li_partial) {
+                    chunk.ic_failed = true;
+                    return;
+                }
+                prev_range = li.li_file_range;
+
+                auto read_result = lb.read_range(li.li_file_range);
+                if (read_result.isErr()) {
+                    chunk.ic_failed = true;
+                    return;
+                }
+
+                auto sbr = read_result.unwrap();
+                sbr.rtrim(is_line_ending);
+                if (li.li_utf8_scan_result.is_valid()
+                    && li.li_utf8_scan_result.usr_has_ansi)
+                {
+                    sbr.erase_ansi();
+                }
+
+                chunk.ic_longest_line
+                    = std::max(chunk.ic_longest_line,
+                               li.li_utf8_scan_result.usr_column_width_guess);
+
+                auto prescan_size = lines.size();
+                auto prescan_time
+                    = lines.back().get_time<std::chrono::microseconds>();
+                auto found = chunk.ic_format->scan(
+                    *this, lines, li, sbr, chunk.ic_sbc);
+
+                if (found.is<log_format::scan_match>()) {
+                    auto& last_line = lines.back();
+
+                    last_line.set_valid_utf(
+                        last_line.is_valid_utf()
+                        && li.li_utf8_scan_result.is_valid());
+                    last_line.set_has_ansi(
+                        last_line.has_ansi()
+                        || li.li_utf8_scan_result.usr_has_ansi);
+                    if (!found_match) {
+                        if (found.get<log_format::scan_match>().sm_quality
+                            > 0)
+                        {
+                            found_match = true;
+                        } else {
+                            chunk.ic_leading_continued.resize(
+                                lines.size() - 1, false);
+                        }
+                        continue;
+                    }
+                    // The first match is checked against the previous chunk
+                    // while stitching.
+                    if (prescan_size <= chunk.ic_leading_continued.size() + 1)
+                    {
+                        continue;
+                    }
+                    if (lines.size() >= prescan_size
+                        && prescan_time
+                            != lines[prescan_size - 1]
+                                   .get_time<std::chrono::microseconds>())
+                    {
+                        chunk.ic_sort_needed = true;
+                    }
+                    if (prescan_size < lines.size()) {
+                        auto& second_to_last = lines[prescan_size - 1];
+                        auto& latest = lines[prescan_size];
+
+                        if (!second_to_last.is_ignored()
+                            && latest < second_to_last)
+                        {
+                            if (chunk.ic_format->lf_time_ordered) {
+                                chunk.ic_out_of_time_order_count += 1;
+                                for (size_t lpc = prescan_size;
+                                     lpc < lines.size();
+                                     lpc++)
+                                {
+                                    auto& line_to_update = lines[lpc];
+
+                                    line_to_update.set_time_skew(true);
+                                    line_to_update.set_time(
+                                        second_to_last.get_time<
+                                            std::chrono::microseconds>());
+                                }
+                            } else {
+                                chunk.ic_sort_needed = true;
+                            }
+                        }
+                    }
+                } else if (found.is<log_format::scan_no_match>()) {
+                    const auto& ll = lines.back();
+
+                    lines.emplace_back(
+                        li.li_file_range.fr_offset,
+                        ll.get_time<std::chrono::microseconds>(),
+                        (log_level_t) (ll.get_level_and_flags()
+                                       | LEVEL_CONTINUED),
+                        ll.get_module_id(),
+                        ll.get_opid());
+                    lines.back().set_valid_utf(
+                        li.li_utf8_scan_result.is_valid());
+                    lines.back().set_has_ansi(
+                        li.li_utf8_scan_result.usr_has_ansi);
+                    if (!found_match) {
+                        chunk.ic_leading_continued.push_back(true);
+                    }
+                }
+            }
+        } catch (const line_buffer::error&) {
+            chunk.ic_failed = true;
+        }
+    };
+
+    std::vector<std::future<void>> workers;
+    workers.reserve(chunks.size());
+    for (auto& chunk : chunks) {
+        if (chunk->ic_scanned) {
+            continue;
+        }
+        workers.emplace_back(
+            std::async(std::launch::async, scan_chunk, std::ref(*chunk)));
+    }
+    for (auto& worker : workers) {
+        worker.get();
+    }
+    for (auto& chunk : chunks) {
+        chunk->ic_scanned = true;
+    }
+
+    /*
+     * The chunks after one that was interrupted do not follow on from the
+     * lines that were indexed.  They are set aside and stitched on in a
+     * later pass, once the gap in front of them has been indexed.
+     */
+    std::vector<std::unique_ptr<index_chunk>> kept;
+    auto interrupted_iter
+        = std::find_if(chunks.begin(), chunks.end(), [](const auto& chunk) {
+              return chunk->ic_interrupted;
+          });
+    if (interrupted_iter != chunks.end()) {
+        for (auto iter = std::next(interrupted_iter); iter != chunks.end();
+             ++iter)
+        {
+            if (!(*iter)->ic_failed) {
+                kept.emplace_back(std::move(*iter));
+            }
+        }
+        log_debug("%s: deadline reached while indexing chunk at %" PRId64
+                  ", keeping %zu chunks for the next pass",
+                  this->lf_filename.c_str(),
+                  (*interrupted_iter)->ic_range.fr_offset,
+                  kept.size());
+        chunks.erase(std::next(interrupted_iter), chunks.end());
+    }
+
+    /*
+     * Check that the chunks can be stitched together.  If the year rolled
+     * over or the date had to be guessed, the timestamps in a chunk depend
+     * on the chunks before it, so fall back to indexing sequentially.
+     */
+    static constexpr auto FULL_DATE
+        = ETF_DAY_SET | ETF_MONTH_SET | ETF_YEAR_SET;
+    auto has_full_date
+        = (this->lf_format->lf_timestamp_flags & FULL_DATE) == FULL_DATE;
+    auto prev_time = seed_line.get_time<std::chrono::microseconds>();
+    for (const auto& chunk : chunks) {
+        if (chunk->ic_failed) {
+            log_warning("%s: unable to index chunk at %" PRId64
+                        ", falling back",
+                        this->lf_filename.c_str(),
+                        chunk->ic_range.fr_offset);
+            return std::nullopt;
+        }
+        if (chunk->ic_lines.front().get_time<std::chrono::microseconds>()
+            != chunk->ic_seed_time)
+        {
+            log_info("%s: timestamps changed in chunk at %" PRId64
+                     ", falling back",
+                     this->lf_filename.c_str(),
+                     chunk->ic_range.fr_offset);
+            return std::nullopt;
+        }
+        auto first_match = chunk->ic_leading_continued.size() + 1;
+        if (!has_full_date && first_match < chunk->ic_lines.size()
+            && chunk->ic_lines[first_match] < prev_time)
+        {
+            log_info("%s: possible year change in chunk at %" PRId64
+                     ", falling back",
+                     this->lf_filename.c_str(),
+                     chunk->ic_range.fr_offset);
+            return std::nullopt;
+        }
+        prev_time
+            = chunk->ic_lines.back().get_time<std::chrono::microseconds>();
+    }
+
+    auto begin_size = this->lf_index.size();
+    auto& pattern_locks = this->lf_format->lf_pattern_locks;
+    auto& value_stats = this->lf_format->lf_value_stats;
+    for (auto& chunk : chunks) {
+        auto chunk_base = this->lf_index.size();
+        auto first_match = chunk->ic_leading_continued.size() + 1;
+        bool settled = false;
+
+        for (size_t lpc = 1; lpc < chunk->ic_lines.size(); lpc++) {
+            auto ll = chunk->ic_lines[lpc];
+
+            /*
+             * The lines at the start of the chunk were scanned without
+             * knowing the real previous line, so bring them in line with
+             * what a sequential scan would have done.
+             */
+            if (!settled) {
+                const auto& prev = this->lf_index.back();
+                auto prev_line_time
+                    = prev.get_time<std::chrono::microseconds>();
+                auto is_leading = lpc < first_match;
+
+                if ((is_leading && chunk->ic_leading_continued[lpc - 1])
+                    || (!is_leading && ll.is_continued()
+                        && ll.get_sub_offset() == 0))
+                {
+                    auto new_ll = logline{
+                        ll.get_offset(),
+                        prev_line_time,
+                        (log_level_t) (prev.get_level_and_flags()
+                                       | LEVEL_CONTINUED),
+                        prev.get_module_id(),
+                        prev.get_opid(),
+                    };
+
+                    new_ll.set_valid_utf(ll.is_valid_utf());
+                    new_ll.set_has_ansi(ll.has_ansi());
+                    ll = new_ll;
+                } else if (is_leading || ll.is_continued()) {
+                    ll.set_time(prev_line_time);
+                } else if (!prev.is_ignored() && ll < prev) {
+                    if (this->lf_format->lf_time_ordered) {
+                        this->lf_out_of_time_order_count += 1;
+                        ll.set_time_skew(true);
+                        ll.set_time(prev_line_time);
+                    } else {
+                        sort_needed = true;
+                        settled = true;
+                    }
+                } else {
+                    settled = true;
+                }
+            }
+            this->lf_index.emplace_back(ll);
+        }
+
+        for (const auto& pfl : chunk->ic_format->lf_pattern_locks) {
+            uint32_t line = pfl.pfl_line == 0 ? chunk_base
+                                              : chunk_base + pfl.pfl_line - 1;
+
+            if (pattern_locks.empty()) {
+                pattern_locks.emplace_back(0, pfl.pfl_pat_index);
+            } else if (pattern_locks.back().pfl_line == line) {
+                pattern_locks.back().pfl_pat_index = pfl.pfl_pat_index;
+            } else if (pattern_locks.back().pfl_pat_index != pfl.pfl_pat_index)
+            {
+                pattern_locks.emplace_back(line, pfl.pfl_pat_index);
+            }
+        }
+
+        const auto& chunk_stats = chunk->ic_format->lf_value_stats;
+        for (size_t lpc = 0;
+             lpc < value_stats.size() && lpc < chunk_stats.size();
+             lpc++)
+        {
+            value_stats[lpc].merge(chunk_stats[lpc]);
+        }
+
+        for (auto& opid_pair : chunk->ic_sbc.sbc_opids.los_opid_ranges) {
+            auto& otr = opid_pair.second;
+
+            for (auto& sub_op : otr.otr_sub_ops) {
+                sub_op.ostr_subid
+                    = sub_op.ostr_subid.to_owned(sbc.sbc_allocator);
+            }
+
+            auto opid_iter
+                = sbc.sbc_opids.los_opid_ranges.find(opid_pair.first);
+            if (opid_iter == sbc.sbc_opids.los_opid_ranges.end()) {
+                sbc.sbc_opids.los_opid_ranges.emplace(
+                    opid_pair.first.to_owned(sbc.sbc_allocator), otr);
+            } else {
+                opid_iter->second |= otr;
+            }
+        }
+
+        this->lf_longest_line
+            = std::max(this->lf_longest_line, chunk->ic_longest_line);
+        this->lf_out_of_time_order_count += chunk->ic_out_of_time_order_count;
+        sort_needed = sort_needed || chunk->ic_sort_needed;
+    }
+
+    const auto& last_format = chunks.back()->ic_format;
+    this->lf_format->lf_date_time = last_format->lf_date_time;
+    this->lf_format->lf_time_scanner = last_format->lf_time_scanner;
+    this->lf_format->lf_timestamp_flags = last_format->lf_timestamp_flags;
+
+    auto retval = file_range{chunks.back()->ic_range.next_offset()};
+    this->lf_index_size = retval.next_offset();
+    this->lf_partial_line = false;
+    this->lf_pending_chunks = std::move(kept);
+
+    /*
+     * The observers and line definitions are not thread-safe, so they are
+     * run here for the new lines.
+     */
+    if (this->lf_logline_observer == nullptr
+        && this->lf_applicable_taggers.empty()
+        && this->lf_applicable_partitioners.empty())
+    {
+        for (auto iter = this->begin() + begin_size; iter != this->end();
+             ++iter)
+        {
+            if (!iter->is_continued()) {
+                lnav::log::watch::eval_with(*this, iter);
+            }
+        }
+    } else {
+        // Use a separate buffer so the file's buffer is not moved backwards.
+        line_buffer lb;
+        auto lb_fd = auto_fd::dup_of(this->lf_line_buffer.get_fd());
+        auto iter = this->begin() + begin_size;
+
+        lb.set_fd(lb_fd);
+        while (iter != this->end()) {
+            auto iter_end = std::next(iter);
+            while (iter_end != this->end()
+                   && iter_end->get_offset() == iter->get_offset())
+            {
+                ++iter_end;
+            }
+
+            auto read_result = lb.read_range(this->get_file_range(iter, false));
+            if (read_result.isOk()) {
+                auto sbr = read_result.unwrap();
+
+                sbr.rtrim(is_line_ending);
+                if (iter->is_valid_utf() && iter->has_ansi()) {
+                    sbr.erase_ansi();
+                }
+                if (this->lf_logline_observer != nullptr) {
+                    this->lf_logline_observer->logline_new_lines(
+                        *this, iter, iter_end, sbr);
+                }
+                this->process_line_defs(std::prev(iter_end), sbr);
+            }
+            iter = iter_end;
+        }
+    }
+
+    if (this->lf_logfile_observer != nullptr) {
+        this->lf_logfile_observer->logfile_indexing(
+            this->shared_from_this(), retval.next_offset(), st.st_size);
+    }
+
+    log_info("%s: indexed %" PRId64 " bytes on %zu threads (%zu lines)",
+             this->lf_filename.c_str(),
+             retval.next_offset() - off,
+             chunks.size(),
+             this->lf_index.size() - begin_size);
+
+    return retval;
+}
+
 logfile::rebuild_result_t
 logfile::rebuild_index(std::optional<ui_clock::time_point> deadline)
 {
@@ -721,6 +1450,7 @@ logfile::rebuild_index(std::optional<ui_clock::time_point> deadline)
             opid_iter->second.otr_range.extend_to(ll.get_timeval());
             opid_iter->second.otr_level_stats.update_msg_count(
                 ll.get_msg_level());
+            writeOpids->mark_updated(opid_iter->first);
         }
         this->lf_invalidated_opids.clear();
     }
@@ -741,6 +1471,9 @@ logfile::rebuild_index(std::optional<ui_clock::time_point> deadline)
         log_info("%s: format has changed, rebuilding",
                  this->lf_filename.c_str());
         this->lf_index.clear();
+        this->lf_pending_chunks.clear();
+        this->lf_column_store.clear();
+        this->lf_schema_index.clear();
         this->lf_index_size = 0;
         this->lf_partial_line = false;
         this->lf_longest_line = 0;
@@ -749,8 +1482,7 @@ logfile::rebuild_index(std::optional<ui_clock::time_point> deadline)
             safe::WriteAccess<logfile::safe_opid_state> writable_opid_map(
                 this->lf_opids);
 
-            writable_opid_map->los_opid_ranges.clear();
-            writable_opid_map->los_sub_in_use.clear();
+            writable_opid_map->clear();
         }
         this->lf_allocator.reset();
     }
@@ -789,6 +1521,13 @@ logfile::rebuild_index(std::optional<ui_clock::time_point> deadline)
         return rebuild_result_t::NO_NEW_LINES;
     }
 
+    if (!this->lf_index_cache_checked) {
+        this->lf_index_cache_checked = true;
+        if (this->is_index_cacheable(st)) {
+            this->load_index_cache(st);
+        }
+    }
+
     if (this->lf_text_format == text_format_t::TF_BINARY) {
         this->lf_index_size = st.st_size;
         this->lf_stat = st;
@@ -857,9 +1596,28 @@ logfile::rebuild_index(std::optional<ui_clock::time_point> deadline)
             this->lf_line_buffer.flush_at(0);
             off = 0;
         }
+        {
+            // The last message might get more lines, so the values that
+            // were extracted from it need to be dropped as well.
+            auto valid_rows = this->lf_index.size();
+            while (valid_rows > 0
+                   && this->lf_index[valid_rows - 1].is_continued())
+            {
+                valid_rows -= 1;
+            }
+            if (valid_rows > 0) {
+                valid_rows -= 1;
+            }
+            this->lf_column_store.truncate(valid_rows);
+            this->lf_schema_index.truncate(valid_rows);
+        }
         if (this->lf_logline_observer != nullptr) {
             this->lf_logline_observer->logline_restart(*this, rollback_size);
         }
+        if (this->lf_deferred && !this->lf_deferred->dn_first_new_line) {
+            this->lf_deferred->dn_first_new_line = this->lf_index.size();
+            this->lf_deferred->dn_rollback_size = rollback_size;
+        }
 
         bool sort_needed = std::exchange(this->lf_sort_needed, false);
         size_t limit = SIZE_MAX;
@@ -886,7 +1644,24 @@ logfile::rebuild_index(std::optional<ui_clock::time_point> deadline)
         scan_batch_context sbc{this->lf_allocator};
         sbc.sbc_opids.los_opid_ranges.reserve(32);
         auto prev_range = file_range{off};
+        bool try_split = true;
         while (limit > 0) {
+            if (try_split) {
+                auto split_range = this->index_concurrently(
+                    prev_range.next_offset(), st, sbc, sort_needed, deadline);
+
+                if (split_range) {
+                    prev_range = split_range.value();
+                    if (deadline && ui_clock::now() > deadline.value()) {
+                        break;
+                    }
+                    continue;
+                }
+                // The lines in the detection window have to be scanned
+                // here, so check again once those are done.
+                try_split = this->in_detection_window();
+            }
+
             auto load_result = this->lf_line_buffer.load_next_line(prev_range);
 
             if (load_result.isErr()) {
@@ -961,7 +1736,9 @@ logfile::rebuild_index(std::optional<ui_clock::time_point> deadline)
                                    -> text_format_t {
                               auto sbr_str = to_string(avail_sbr);
 
-                              if (this->lf_line_buffer.is_piper()) {
+                              auto prefix_size = this->lf_line_buffer
+                                                     .get_line_meta_prefix_size();
+                              if (prefix_size > 0) {
                                   auto lines
                                       = string_fragment::from_str(sbr_str)
                                             .split_lines();
@@ -971,7 +1748,8 @@ logfile::rebuild_index(std::optional<ui_clock::time_point> deadline)
                                        std::next(line_iter) != lines.rend();
                                        ++line_iter)
                                   {
-                                      sbr_str.erase(line_iter->sf_begin, 22);
+                                      sbr_str.erase(line_iter->sf_begin,
+                                                    prefix_size);
                                   }
                               }
                               if (is_utf8(sbr_str).is_valid()) {
@@ -1057,66 +1835,7 @@ logfile::rebuild_index(std::optional<ui_clock::time_point> deadline)
             }
 #endif
             if (this->lf_format) {
-                auto sf = sbr.to_string_fragment();
-
-                for (const auto& td : this->lf_applicable_taggers) {
-                    auto curr_ll = this->end() - 1;
-
-                    if (td->ftd_level != LEVEL_UNKNOWN
-                        && td->ftd_level != curr_ll->get_msg_level())
-                    {
-                        continue;
-                    }
-
-                    if (td->ftd_pattern.pp_value
-                            ->find_in(sf, PCRE2_NO_UTF_CHECK)
-                            .ignore_error()
-                            .has_value())
-                    {
-                        while (curr_ll->is_continued()) {
-                            --curr_ll;
-                        }
-                        curr_ll->set_meta_mark(true);
-                        auto line_number = static_cast<uint32_t>(
-                            std::distance(this->begin(), curr_ll));
-
-                        this->lf_bookmark_metadata[line_number].add_tag(
-                            td->ftd_name);
-                    }
-                }
-
-                for (const auto& pd : this->lf_applicable_partitioners) {
-                    static thread_local auto part_md
-                        = lnav::pcre2pp::match_data::unitialized();
-
-                    auto curr_ll = this->end() - 1;
-
-                    if (pd->fpd_level != LEVEL_UNKNOWN
-                        && pd->fpd_level != curr_ll->get_msg_level())
-                    {
-                        continue;
-                    }
-
-                    auto match_res = pd->fpd_pattern.pp_value->capture_from(sf)
-                                         .into(part_md)
-                                         .matches(PCRE2_NO_UTF_CHECK)
-                                         .ignore_error();
-                    if (match_res) {
-                        while (curr_ll->is_continued()) {
-                            --curr_ll;
-                        }
-                        curr_ll->set_meta_mark(true);
-                        auto line_number = static_cast<uint32_t>(
-                            std::distance(this->begin(), curr_ll));
-
-                        this->lf_bookmark_metadata[line_number].bm_name
-                            = part_md.to_string();
-                    }
-                }
-
-                if (!this->back().is_continued()) {
-                    lnav::log::watch::eval_with(*this, this->end() - 1);
-                }
+                this->process_line_defs(this->end() - 1, sbr);
             }
 
             if (li.li_partial) {
@@ -1127,6 +1846,14 @@ logfile::rebuild_index(std::optional<ui_clock::time_point> deadline)
             }
 
             limit -= 1;
+
+            if (this->lf_detection_only && this->lf_format != nullptr
+                && this->lf_index.size() >= MAX_DETECTION_LINES)
+            {
+                // Leave the rest of the file so that it can be indexed in
+                // the background.
+                break;
+            }
         }
 
         if (this->lf_format == nullptr
@@ -1189,10 +1916,13 @@ logfile::rebuild_index(std::optional<ui_clock::time_point> deadline)
                     = writable_opid_map->los_opid_ranges.find(opid_pair.first);
 
                 if (opid_iter == writable_opid_map->los_opid_ranges.end()) {
-                    writable_opid_map->los_opid_ranges.emplace(opid_pair);
+                    opid_iter = writable_opid_map->los_opid_ranges
+                                    .emplace(opid_pair)
+                                    .first;
                 } else {
                     opid_iter->second |= opid_pair.second;
                 }
+                writable_opid_map->mark_updated(opid_iter->first);
             }
             log_debug(
                 "%s: opid_map size: count=%zu; sizeof(otr)=%zu; alloc=%zu",
@@ -1202,6 +1932,23 @@ logfile::rebuild_index(std::optional<ui_clock::time_point> deadline)
                 this->lf_allocator.getNumBytesAllocated());
         }
 
+        if (this->lf_index_size >= st.st_size && this->is_index_cacheable(st)) {
+            static const auto& lf_cfg
+                = injector::get<const lnav::logfile::config&>();
+            const auto growth = this->lf_index_size - this->lf_index_cache_size;
+
+            // Rewriting the cache for a file that is actively being written
+            // to can get expensive, so wait for it to grow by a decent amount.
+            if ((uint64_t) growth >= lf_cfg.lc_index_cache_min_size
+                && growth >= this->lf_index_cache_size / 4
+                && (!this->lf_index_cache_future.valid()
+                    || this->lf_index_cache_future.wait_for(std::chrono::seconds(0))
+                        == std::future_status::ready))
+            {
+                this->save_index_cache(st);
+            }
+        }
+
         if (sort_needed) {
             retval = rebuild_result_t::NEW_ORDER;
         } else {
@@ -1276,9 +2023,8 @@ logfile::read_file()
         retval.rfr_range.fr_size = fr.next_offset();
         auto sbr = TRY(this->lf_line_buffer.read_range(fr));
 
-        if (this->lf_line_buffer.is_piper()) {
-            retval.rfr_content.append(22, '\x16');
-        }
+        retval.rfr_content.append(
+            this->lf_line_buffer.get_line_meta_prefix_size(), '\x16');
         retval.rfr_content.append(sbr.get_data(), sbr.length());
         if (retval.rfr_content.size() < this->lf_stat.st_size) {
             retval.rfr_content.push_back('\n');
@@ -1378,6 +2124,80 @@ logfile::reobserve_from(iterator iter)
     }
 }
 
+bool
+logfile::can_rebuild_in_background() const
+{
+    return this->lf_format != nullptr && !this->lf_is_closed
+        && this->lf_indexing
+        && (!this->lf_options.loo_detect_format
+            || this->lf_index.size() >= MAX_DETECTION_LINES)
+        && this->lf_format->is_scan_thread_safe();
+}
+
+bool
+logfile::in_detection_window() const
+{
+    return !this->lf_is_closed && this->lf_indexing
+        && this->lf_options.loo_detect_format
+        && this->lf_index.size() < MAX_DETECTION_LINES;
+}
+
+logfile::rebuild_result_t
+logfile::rebuild_detection_window(std::optional<ui_clock::time_point> deadline)
+{
+    this->lf_detection_only = true;
+    auto retval = this->rebuild_index(deadline);
+    this->lf_detection_only = false;
+
+    return retval;
+}
+
+void
+logfile::begin_background_rebuild()
+{
+    require(!this->lf_deferred);
+
+    this->lf_deferred = deferred_notifications{
+        std::exchange(this->lf_logline_observer, nullptr),
+        std::exchange(this->lf_logfile_observer, nullptr),
+    };
+}
+
+void
+logfile::end_background_rebuild()
+{
+    require(this->lf_deferred);
+
+    auto dn = std::move(this->lf_deferred.value());
+
+    this->lf_deferred = std::nullopt;
+    this->lf_logline_observer = dn.dn_logline_observer;
+    this->lf_logfile_observer = dn.dn_logfile_observer;
+
+    if (!dn.dn_first_new_line || this->lf_is_closed) {
+        return;
+    }
+
+    auto first_new_line = this->begin() + dn.dn_first_new_line.value();
+
+    if (this->lf_format != nullptr) {
+        for (auto iter = first_new_line; iter != this->end(); ++iter) {
+            if (!iter->is_continued()) {
+                lnav::log::watch::eval_with(*this, iter);
+            }
+        }
+    }
+
+    if (this->lf_logline_observer != nullptr) {
+        this->lf_logline_observer->logline_restart(*this,
+                                                   dn.dn_rollback_size);
+        this->reobserve_from(first_new_line);
+    } else if (this->lf_logfile_observer != nullptr) {
+        this->lf_logfile_observer->logfile_indexing(
+            this->shared_from_this(), this->size(), this->size());
+    }
+}
+
 std::filesystem::path
 logfile::get_path() const
 {
@@ -1622,6 +2442,7 @@ logfile::set_logline_opid(uint32_t line_number, string_fragment opid)
     auto& otr = opid_iter->second;
 
     otr.otr_level_stats.update_msg_count(ll.get_msg_level());
+    write_opids->mark_updated(opid_iter->first);
     ll.set_opid(opid.hash());
     this->lf_bookmark_metadata[line_number].bm_opid = opid.to_string();
 }
@@ -1657,6 +2478,7 @@ logfile::clear_logline_opid(uint32_t line_number)
             return;
         }
 
+        writeOpids->mark_updated(otr_iter->first);
         if (otr_iter->second.otr_range.tr_begin != ll.get_timeval()
             && otr_iter->second.otr_range.tr_end != ll.get_timeval())
         {
@@ -1686,3 +2508,413 @@ logfile::estimated_remaining_lines() const
     return remaining_bytes / bytes_per_line;
 }
 
+
+static void
+index_cache_fingerprint(const logfile_open_options& loo,
+                        bool zoned_to_local,
+                        uint64_t (&out)[2])
+{
+    auto h = hasher();
+    const auto* tz = getenv("TZ");
+
+    h.update(std::string(PACKAGE_VERSION))
+        .update(lnav::filesystem::self_mtime())
+        .update(static_cast<int64_t>(zoned_to_local))
+        .update(std::string(tz != nullptr ? tz : ""))
+        .update(loo.loo_format_name.value_or(""));
+    for (const auto& root_format : log_format::get_root_formats()) {
+        h.update(root_format->get_name().to_string_fragment());
+
+        auto* elf = dynamic_cast<external_log_format*>(root_format.get());
+        if (elf == nullptr) {
+            continue;
+        }
+
+        h.update(static_cast<int64_t>(elf->elf_value_defs.size()));
+        for (const auto& pat : elf->elf_pattern_order) {
+            h.update(pat->p_pcre.pp_value->get_pattern());
+        }
+    }
+
+    auto bits = h.to_array();
+    memcpy(out, bits.in(), sizeof(out));
+}
+
+bool
+logfile::is_index_cacheable(const struct stat& st) const
+{
+    static const auto& cfg = injector::get<const lnav::logfile::config&>();
+
+    return cfg.lc_index_cache_min_size > 0
+        && (uint64_t) st.st_size >= cfg.lc_index_cache_min_size
+        && this->lf_indexing && !this->lf_line_buffer.is_compressed()
+        && !this->lf_line_buffer.is_piper() && !this->lf_line_buffer.is_pipe()
+        && !this->lf_file_options && this->lf_options.loo_detect_format
+        && this->lf_text_format != text_format_t::TF_BINARY;
+}
+
+bool
+logfile::load_index_cache(const struct stat& st)
+{
+    static const auto& dts_cfg
+        = injector::get<const date_time_scanner_ns::config&>();
+
+    namespace cache = lnav::logfile::cache;
+
+    if (!this->lf_index.empty() || this->lf_index_size != 0) {
+        return false;
+    }
+
+    auto cache_path = cache::path_for(st);
+    auto open_res = lnav::filesystem::open_file(cache_path, O_RDONLY);
+    if (open_res.isErr()) {
+        return false;
+    }
+
+    auto cache_fd = open_res.unwrap();
+    cache::header hdr;
+    uint64_t expected_fingerprint[2];
+
+    index_cache_fingerprint(
+        this->lf_options, dts_cfg.c_zoned_to_local, expected_fingerprint);
+    if (pread(cache_fd, &hdr, sizeof(hdr), 0) != sizeof(hdr)
+        || !hdr.is_valid() || hdr.h_logline_size != sizeof(logline)
+        || memcmp(hdr.h_fingerprint,
+                  expected_fingerprint,
+                  sizeof(expected_fingerprint))
+            != 0
+        || hdr.h_dev != (uint64_t) st.st_dev
+        || hdr.h_ino != (uint64_t) st.st_ino || hdr.h_file_size > st.st_size
+        || (hdr.h_file_size == st.st_size && hdr.h_mtime != st.st_mtime)
+        || hdr.h_index_size > st.st_size || hdr.h_line_count == 0)
+    {
+        log_info("%s: index cache is stale -- %s",
+                 this->lf_filename.c_str(),
+                 cache_path.c_str());
+        return false;
+    }
+
+    uint64_t head_hash[2];
+    uint64_t tail_hash[2];
+    auto fd = this->lf_line_buffer.get_fd();
+    if (!cache::hash_block(fd,
+                           std::min(cache::BLOCK_SIZE, hdr.h_index_size),
+                           head_hash)
+        || !cache::hash_block(fd, hdr.h_index_size, tail_hash)
+        || memcmp(head_hash, hdr.h_head_hash, sizeof(head_hash)) != 0
+        || memcmp(tail_hash, hdr.h_tail_hash, sizeof(tail_hash)) != 0)
+    {
+        log_info("%s: file content does not match index cache",
+                 this->lf_filename.c_str());
+        return false;
+    }
+
+    // Make sure the header agrees with the size of the cache file before
+    // trusting the counts in it for an allocation.
+    struct stat cache_st;
+    if (fstat(cache_fd, &cache_st) == -1
+        || hdr.h_line_count > (uint64_t) hdr.h_index_size
+        || hdr.h_line_count > (uint64_t) cache_st.st_size / sizeof(logline)
+        || hdr.h_metadata_size > (uint64_t) cache_st.st_size
+        || sizeof(hdr) + hdr.h_line_count * sizeof(logline)
+                + hdr.h_metadata_size
+            != (uint64_t) cache_st.st_size)
+    {
+        log_error("%s: index cache size does not match header",
+                  cache_path.c_str());
+        return false;
+    }
+
+    auto lines_size = hdr.h_line_count * sizeof(logline);
+    std::vector<logline> lines;
+    std::string metadata;
+
+    lines.resize(hdr.h_line_count,
+                 logline{0, std::chrono::microseconds{0}, LEVEL_UNKNOWN});
+    metadata.resize(hdr.h_metadata_size);
+    if (pread(cache_fd, lines.data(), lines_size, sizeof(hdr))
+            != (ssize_t) lines_size
+        || pread(cache_fd,
+                 metadata.data(),
+                 metadata.size(),
+                 sizeof(hdr) + lines_size)
+            != (ssize_t) metadata.size())
+    {
+        log_error("%s: short read of index cache", cache_path.c_str());
+        return false;
+    }
+
+    cache::reader rd(metadata);
+    auto text_format = rd.get<text_format_t>();
+    auto format_name = rd.get_str().to_string();
+    auto format_quality = rd.get<uint32_t>();
+    auto content_id = rd.get_str().to_string();
+    auto longest_line = rd.get<uint64_t>();
+    auto partial_line = rd.get<bool>();
+    std::shared_ptr<log_format> format;
+
+    if (!format_name.empty()) {
+        for (const auto& root_format : log_format::get_root_formats()) {
+            if (root_format->get_name().to_string() == format_name) {
+                format = root_format->specialized();
+                break;
+            }
+        }
+        if (format == nullptr) {
+            log_info("%s: format in index cache not found -- %s",
+                     this->lf_filename.c_str(),
+                     format_name.c_str());
+            return false;
+        }
+
+        auto fmt_lock = rd.get<int32_t>();
+        auto fmt_len = rd.get<int32_t>();
+        format->lf_date_time.relock({fmt_lock, fmt_len});
+
+        auto lock_count = rd.get<uint32_t>();
+        format->lf_pattern_locks.clear();
+        for (uint32_t lpc = 0; lpc < lock_count && !rd.has_error(); lpc++) {
+            auto line = rd.get<uint32_t>();
+            auto pat_index = rd.get<int32_t>();
+
+            format->lf_pattern_locks.emplace_back(line, pat_index);
+        }
+
+        auto stats_count = rd.get<uint32_t>();
+        for (uint32_t lpc = 0; lpc < stats_count && !rd.has_error(); lpc++) {
+            auto stats = rd.get<logline_value_stats>();
+
+            if (stats_count == format->lf_value_stats.size()) {
+                format->lf_value_stats[lpc] = stats;
+            }
+        }
+    }
+
+    log_opid_state opids;
+    auto opid_count = rd.get<uint32_t>();
+    for (uint32_t lpc = 0; lpc < opid_count && !rd.has_error(); lpc++) {
+        auto opid = rd.get_str().to_owned(this->lf_allocator);
+        opid_time_range otr;
+
+        otr.otr_range = rd.get<time_range>();
+        otr.otr_level_stats = rd.get<log_level_stats>();
+        if (rd.get<bool>()) {
+            otr.otr_description.lod_id
+                = intern_string::lookup(rd.get_str());
+        }
+        auto elem_count = rd.get<uint32_t>();
+        for (uint32_t elpc = 0; elpc < elem_count && !rd.has_error(); elpc++) {
+            auto key = rd.get<uint64_t>();
+
+            otr.otr_description.lod_elements.insert(key,
+                                                    rd.get_str().to_string());
+        }
+        auto sub_count = rd.get<uint32_t>();
+        for (uint32_t slpc = 0; slpc < sub_count && !rd.has_error(); slpc++) {
+            opid_sub_time_range ostr;
+
+            ostr.ostr_subid = rd.get_str().to_owned(this->lf_allocator);
+            ostr.ostr_range = rd.get<time_range>();
+            ostr.ostr_open = rd.get<bool>();
+            ostr.ostr_level_stats = rd.get<log_level_stats>();
+            ostr.ostr_description = rd.get_str().to_string();
+            otr.otr_sub_ops.emplace_back(std::move(ostr));
+        }
+        opids.los_opid_ranges.emplace(opid, std::move(otr));
+    }
+
+    robin_hood::unordered_map<uint32_t, bookmark_metadata> bm_map;
+    auto bm_count = rd.get<uint32_t>();
+    for (uint32_t lpc = 0; lpc < bm_count && !rd.has_error(); lpc++) {
+        auto line = rd.get<uint32_t>();
+        auto& bm = bm_map[line];
+
+        bm.bm_name = rd.get_str().to_string();
+        auto tag_count = rd.get<uint32_t>();
+        for (uint32_t tlpc = 0; tlpc < tag_count && !rd.has_error(); tlpc++) {
+            bm.add_tag(rd.get_str().to_string());
+        }
+    }
+
+    if (!rd.is_valid()) {
+        log_error("%s: corrupt index cache", cache_path.c_str());
+        this->lf_allocator.reset();
+        return false;
+    }
+
+    for (auto& ll : lines) {
+        ll.set_mark(false);
+        ll.set_expr_mark(false);
+    }
+
+    log_info("%s: loaded %zu lines from index cache -- %s",
+             this->lf_filename.c_str(),
+             lines.size(),
+             cache_path.c_str());
+    this->lf_text_format = text_format;
+    if (format != nullptr) {
+        this->lf_format = format;
+        this->lf_format_quality = format_quality;
+        this->set_format_base_time(this->lf_format.get());
+        this->update_applicable_defs();
+    }
+    this->lf_content_id = content_id;
+    this->lf_longest_line = longest_line;
+    this->lf_partial_line = partial_line;
+    this->lf_index = std::move(lines);
+    this->lf_index_size = hdr.h_index_size;
+    this->lf_index_cache_size = hdr.h_index_size;
+    this->lf_stat = st;
+    this->lf_sort_needed = true;
+    {
+        auto write_opids = this->lf_opids.writeAccess();
+
+        opids.los_generation = write_opids->los_generation + 1;
+        *write_opids = std::move(opids);
+    }
+    this->lf_bookmark_metadata = std::move(bm_map);
+
+    // Bump the mtime so the cleanup knows the cache is still in use.
+    std::error_code ec;
+    std::filesystem::last_write_time(
+        cache_path, std::filesystem::file_time_type::clock::now(), ec);
+
+    if (this->lf_logline_observer != nullptr) {
+        this->reobserve_from(this->begin());
+    }
+
+    return true;
+}
+
+void
+logfile::save_index_cache(const struct stat& st)
+{
+    static const auto& dts_cfg
+        = injector::get<const date_time_scanner_ns::config&>();
+
+    namespace cache = lnav::logfile::cache;
+
+    cache::header hdr;
+    auto fd = this->lf_line_buffer.get_fd();
+
+    memcpy(hdr.h_magic, cache::header::MAGIC, sizeof(hdr.h_magic));
+    hdr.h_logline_size = sizeof(logline);
+    index_cache_fingerprint(
+        this->lf_options, dts_cfg.c_zoned_to_local, hdr.h_fingerprint);
+    hdr.h_dev = st.st_dev;
+    hdr.h_ino = st.st_ino;
+    hdr.h_file_size = st.st_size;
+    hdr.h_mtime = st.st_mtime;
+    hdr.h_index_size = this->lf_index_size;
+    hdr.h_line_count = this->lf_index.size();
+    if (!cache::hash_block(fd,
+                           std::min(cache::BLOCK_SIZE, hdr.h_index_size),
+                           hdr.h_head_hash)
+        || !cache::hash_block(fd, hdr.h_index_size, hdr.h_tail_hash))
+    {
+        return;
+    }
+
+    cache::writer wr;
+    wr.put(this->lf_text_format);
+    if (this->lf_format != nullptr) {
+        wr.put(this->lf_format->get_name().to_string_fragment())
+            .put(this->lf_format_quality);
+    } else {
+        wr.put(string_fragment()).put(uint32_t{0});
+    }
+    wr.put(this->lf_content_id)
+        .put(uint64_t{this->lf_longest_line})
+        .put(this->lf_partial_line);
+    if (this->lf_format != nullptr) {
+        const auto& dts = this->lf_format->lf_date_time;
+
+        wr.put(int32_t{dts.dts_fmt_lock}).put(int32_t{dts.dts_fmt_len});
+        wr.put(static_cast<uint32_t>(this->lf_format->lf_pattern_locks.size()));
+        for (const auto& pfl : this->lf_format->lf_pattern_locks) {
+            wr.put(pfl.pfl_line).put(int32_t{pfl.pfl_pat_index});
+        }
+        wr.put(static_cast<uint32_t>(this->lf_format->lf_value_stats.size()));
+        for (const auto& stats : this->lf_format->lf_value_stats) {
+            wr.put(stats);
+        }
+    }
+
+    {
+        auto opids = this->lf_opids.readAccess();
+
+        wr.put(static_cast<uint32_t>(opids->los_opid_ranges.size()));
+        for (const auto& opid_pair : opids->los_opid_ranges) {
+            const auto& otr = opid_pair.second;
+            const auto& desc = otr.otr_description;
+
+            wr.put(opid_pair.first)
+                .put(otr.otr_range)
+                .put(otr.otr_level_stats)
+                .put(desc.lod_id.has_value());
+            if (desc.lod_id) {
+                wr.put(desc.lod_id->to_string_fragment());
+            }
+            wr.put(static_cast<uint32_t>(desc.lod_elements.size()));
+            for (const auto& elem : desc.lod_elements) {
+                wr.put(uint64_t{elem.first}).put(elem.second);
+            }
+            wr.put(static_cast<uint32_t>(otr.otr_sub_ops.size()));
+            for (const auto& ostr : otr.otr_sub_ops) {
+                wr.put(ostr.ostr_subid)
+                    .put(ostr.ostr_range)
+                    .put(ostr.ostr_open)
+                    .put(ostr.ostr_level_stats)
+                    .put(ostr.ostr_description);
+            }
+        }
+    }
+
+    // Only the partitions and tags that come from the format are saved, the
+    // rest is session state that is restored separately.
+    uint32_t bm_count = 0;
+    cache::writer bm_wr;
+    for (const auto& bm_pair : this->lf_bookmark_metadata) {
+        std::vector<std::string> tags;
+
+        for (const auto& tag : bm_pair.second.bm_tags) {
+            for (const auto& td : this->lf_applicable_taggers) {
+                if (td->ftd_name == tag) {
+                    tags.emplace_back(tag);
+                    break;
+                }
+            }
+        }
+        if (bm_pair.second.bm_name.empty() && tags.empty()) {
+            continue;
+        }
+
+        bm_count += 1;
+        bm_wr.put(bm_pair.first)
+            .put(bm_pair.second.bm_name)
+            .put(static_cast<uint32_t>(tags.size()));
+        for (const auto& tag : tags) {
+            bm_wr.put(tag);
+        }
+    }
+    wr.put(bm_count);
+
+    cache::snapshot snap;
+
+    snap.s_path = cache::path_for(st);
+    snap.s_metadata = wr.get_buffer();
+    snap.s_metadata.append(bm_wr.get_buffer());
+    hdr.h_metadata_size = snap.s_metadata.size();
+    snap.s_header = hdr;
+    // The index keeps changing while the file is being tailed, so the
+    // writer gets its own copy.
+    snap.s_lines.assign(reinterpret_cast<const char*>(this->lf_index.data()),
+                        this->lf_index.size() * sizeof(logline));
+
+    log_info("%s: saving %zu lines to index cache -- %s",
+             this->lf_filename.c_str(),
+             this->lf_index.size(),
+             snap.s_path.c_str());
+    this->lf_index_cache_future = cache::write(std::move(snap));
+    this->lf_index_cache_size = this->lf_index_size;
+}
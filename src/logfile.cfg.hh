@@ -36,6 +36,14 @@ namespace lnav::logfile {
 
 struct config {
     uint64_t lc_max_unrecognized_lines{1000};
+    /** Files smaller than this are not worth caching the index for. */
+    uint64_t lc_index_cache_min_size{64 * 1024 * 1024};
+    /** The number of threads used to index files, zero means one per CPU. */
+    uint64_t lc_index_threads{0};
+    /** The memory used to cache extracted values, zero disables the cache. */
+    uint64_t lc_column_store_max_size{128 * 1024 * 1024};
+    /** The memory used to cache extracted values across all files. */
+    uint64_t lc_column_store_total_max_size{1024 * 1024 * 1024};
 };
 
 }  // namespace lnav::logfile
@@ -0,0 +1,418 @@
+/**
+ * Copyright (c) 2024, Timothy Stack
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ * * Neither the name of Timothy Stack nor the names of its contributors
+ * may be used to endorse or promote products derived from this software
+ * without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE REGENTS AND CONTRIBUTORS ''AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * @file logfile.column_store.cc
+ */
+
+#include <mutex>
+
+#include "logfile.column_store.hh"
+
+#include "base/injector.hh"
+#include "base/lnav_log.hh"
+#include "base/string_util.hh"
+#include "config.h"
+#include "log_format.hh"
+#include "logfile.cfg.hh"
+
+namespace {
+
+/**
+ * The stores for all of the files, ordered from least to most recently
+ * queried, and the total memory they use.
+ */
+struct store_registry {
+    std::mutex sr_mutex;
+    std::list<logfile_column_store*> sr_lru;
+    size_t sr_total_memory_usage{0};
+};
+
+store_registry&
+get_registry()
+{
+    // Leaked so that it outlives any logfiles destroyed during exit.
+    static auto* retval = new store_registry();
+
+    return *retval;
+}
+
+}  // namespace
+
+logfile_column_store::logfile_column_store()
+{
+    auto& reg = get_registry();
+    std::lock_guard<std::mutex> lg(reg.sr_mutex);
+
+    this->cs_lru_iter = reg.sr_lru.insert(reg.sr_lru.end(), this);
+}
+
+logfile_column_store::~logfile_column_store()
+{
+    auto& reg = get_registry();
+    std::lock_guard<std::mutex> lg(reg.sr_mutex);
+
+    reg.sr_total_memory_usage -= this->cs_memory_usage;
+    reg.sr_lru.erase(this->cs_lru_iter);
+}
+
+size_t
+logfile_column_store::get_total_memory_usage()
+{
+    auto& reg = get_registry();
+    std::lock_guard<std::mutex> lg(reg.sr_mutex);
+
+    return reg.sr_total_memory_usage;
+}
+
+void
+logfile_column_store::set_memory_usage(size_t usage)
+{
+    auto& reg = get_registry();
+    std::lock_guard<std::mutex> lg(reg.sr_mutex);
+
+    reg.sr_total_memory_usage -= this->cs_memory_usage;
+    reg.sr_total_memory_usage += usage;
+    this->cs_memory_usage = usage;
+}
+
+bool
+logfile_column_store::make_room(size_t total_max_size)
+{
+    auto& reg = get_registry();
+    std::lock_guard<std::mutex> lg(reg.sr_mutex);
+
+    // Other stores are only modified by SQL queries, which run on the same
+    // thread as this one, and by indexing, which does not run during a
+    // query.  The callers do not hold on to the tables of other stores, so
+    // they can be cleared here.
+    for (auto iter = reg.sr_lru.begin();
+         iter != reg.sr_lru.end()
+         && reg.sr_total_memory_usage >= total_max_size;
+         ++iter)
+    {
+        auto* store = *iter;
+
+        if (store == this || store->cs_memory_usage == 0) {
+            continue;
+        }
+
+        log_info("column store is full, dropping %zu bytes of cached values",
+                 store->cs_memory_usage);
+        reg.sr_total_memory_usage -= store->cs_memory_usage;
+        store->cs_tables.clear();
+        store->cs_memory_usage = 0;
+    }
+
+    return reg.sr_total_memory_usage < total_max_size;
+}
+
+void
+logfile_column_store::column::resize(size_t rows)
+{
+    this->c_nulls.resize(rows, true);
+    switch (this->c_type) {
+        case type_t::integer:
+            this->c_integers.resize(rows);
+            break;
+        case type_t::real:
+            this->c_reals.resize(rows);
+            break;
+        case type_t::text:
+        case type_t::json:
+            this->c_codes.resize(rows);
+            break;
+        case type_t::unknown:
+        case type_t::unsupported:
+            break;
+    }
+}
+
+void
+logfile_column_store::column::set_type(type_t type)
+{
+    if (this->c_type == type || this->c_type == type_t::unsupported) {
+        return;
+    }
+
+    if (this->c_type != type_t::unknown) {
+        // The values are not all the same type, so give up on this column
+        // and leave it to the format to extract them.
+        type = type_t::unsupported;
+    }
+
+    this->c_type = type;
+    if (type == type_t::unsupported) {
+        this->c_nulls = std::vector<bool>{};
+        this->c_integers = std::vector<int64_t>{};
+        this->c_reals = std::vector<double>{};
+        this->c_codes = std::vector<uint32_t>{};
+        this->c_dictionary_index.clear();
+        this->c_dictionary.clear();
+        this->c_dictionary_size = 0;
+    } else {
+        this->resize(this->c_nulls.size());
+    }
+}
+
+void
+logfile_column_store::column::set_text(size_t row, std::string str)
+{
+    auto iter = this->c_dictionary_index.find(string_fragment::from_str(str));
+
+    if (iter != this->c_dictionary_index.end()) {
+        this->c_codes[row] = iter->second;
+        return;
+    }
+
+    auto code = (uint32_t) this->c_dictionary.size();
+
+    this->c_dictionary_size += sizeof(std::string) + str.size();
+    this->c_dictionary.emplace_back(std::move(str));
+    this->c_dictionary_index.emplace(
+        string_fragment::from_str(this->c_dictionary.back()), code);
+    this->c_codes[row] = code;
+}
+
+size_t
+logfile_column_store::column::get_memory_usage() const
+{
+    return this->c_nulls.size() / 8
+        + this->c_integers.size() * sizeof(int64_t)
+        + this->c_reals.size() * sizeof(double)
+        + this->c_codes.size() * sizeof(uint32_t) + this->c_dictionary_size;
+}
+
+size_t
+logfile_column_store::table::get_memory_usage() const
+{
+    size_t retval = this->t_rows.size() / 8;
+
+    for (const auto& col : this->t_columns) {
+        retval += col.get_memory_usage();
+    }
+
+    return retval;
+}
+
+logfile_column_store::table*
+logfile_column_store::get_table(intern_string_t name, size_t column_count)
+{
+    const auto& cfg = injector::get<const lnav::logfile::config&>();
+
+    if (cfg.lc_column_store_max_size == 0) {
+        return nullptr;
+    }
+
+    {
+        auto& reg = get_registry();
+        std::lock_guard<std::mutex> lg(reg.sr_mutex);
+
+        reg.sr_lru.splice(reg.sr_lru.end(), reg.sr_lru, this->cs_lru_iter);
+    }
+
+    auto& retval = this->cs_tables[name];
+    if (retval.t_columns.size() != column_count) {
+        // The table was redefined, so the existing values cannot be trusted.
+        this->set_memory_usage(this->cs_memory_usage
+                               - retval.get_memory_usage());
+        retval = table{};
+        retval.t_columns.resize(column_count);
+    }
+
+    return &retval;
+}
+
+void
+logfile_column_store::add_row(table& tab,
+                      size_t row,
+                      const logline_value_vector& values)
+{
+    const auto& cfg = injector::get<const lnav::logfile::config&>();
+
+    if (this->cs_memory_usage >= cfg.lc_column_store_max_size
+        || tab.has_row(row))
+    {
+        return;
+    }
+    if (!this->make_room(cfg.lc_column_store_total_max_size)) {
+        return;
+    }
+
+    auto usage_before = tab.get_memory_usage();
+
+    if (row >= tab.t_rows.size()) {
+        tab.t_rows.resize(row + 1);
+        for (auto& col : tab.t_columns) {
+            if (col.c_type != column::type_t::unsupported) {
+                col.resize(row + 1);
+            }
+        }
+    }
+
+    std::vector<bool> seen(tab.t_columns.size());
+    for (const auto& lv : values.lvv_values) {
+        if (!lv.lv_meta.lvm_column.is<logline_value_meta::table_column>()) {
+            continue;
+        }
+
+        auto index
+            = lv.lv_meta.lvm_column.get<logline_value_meta::table_column>()
+                  .value;
+        if (index >= tab.t_columns.size() || seen[index]) {
+            continue;
+        }
+        seen[index] = true;
+
+        auto& col = tab.t_columns[index];
+        if (col.c_type == column::type_t::unsupported) {
+            continue;
+        }
+        if (!lv.lv_meta.lvm_struct_name.empty()) {
+            col.set_type(column::type_t::unsupported);
+            continue;
+        }
+
+        switch (lv.lv_meta.lvm_kind) {
+            case value_kind_t::VALUE_NULL:
+                break;
+            case value_kind_t::VALUE_BOOLEAN:
+            case value_kind_t::VALUE_INTEGER:
+                col.set_type(column::type_t::integer);
+                if (col.c_type == column::type_t::integer) {
+                    col.c_nulls[row] = false;
+                    col.c_integers[row] = lv.lv_value.i;
+                }
+                break;
+            case value_kind_t::VALUE_FLOAT:
+                col.set_type(column::type_t::real);
+                if (col.c_type == column::type_t::real) {
+                    col.c_nulls[row] = false;
+                    col.c_reals[row] = lv.lv_value.d;
+                }
+                break;
+            case value_kind_t::VALUE_JSON:
+                col.set_type(column::type_t::json);
+                if (col.c_type == column::type_t::json) {
+                    col.c_nulls[row] = false;
+                    col.set_text(
+                        row, std::string(lv.text_value(), lv.text_length()));
+                }
+                break;
+            case value_kind_t::VALUE_STRUCT:
+            case value_kind_t::VALUE_TEXT:
+            case value_kind_t::VALUE_XML:
+            case value_kind_t::VALUE_TIMESTAMP:
+                col.set_type(column::type_t::text);
+                if (col.c_type == column::type_t::text) {
+                    col.c_nulls[row] = false;
+                    col.set_text(
+                        row, std::string(lv.text_value(), lv.text_length()));
+                }
+                break;
+            case value_kind_t::VALUE_QUOTED:
+            case value_kind_t::VALUE_W3C_QUOTED: {
+                col.set_type(column::type_t::text);
+                if (col.c_type != column::type_t::text) {
+                    break;
+                }
+
+                const auto* text_value = lv.text_value();
+                auto text_len = (size_t) lv.text_length();
+                std::string str;
+
+                if (text_len > 0
+                    && (text_value[0] == '\'' || text_value[0] == '"'))
+                {
+                    auto unquote_func
+                        = lv.lv_meta.lvm_kind == value_kind_t::VALUE_W3C_QUOTED
+                        ? unquote_w3c
+                        : unquote;
+
+                    str.resize(text_len);
+                    str.resize(unquote_func(str.data(), text_value, text_len));
+                } else {
+                    str.assign(text_value, text_len);
+                }
+                col.c_nulls[row] = false;
+                col.set_text(row, std::move(str));
+                break;
+            }
+            case value_kind_t::VALUE_UNKNOWN:
+            case value_kind_t::VALUE__MAX:
+                col.set_type(column::type_t::unsupported);
+                break;
+        }
+    }
+    tab.t_rows[row] = true;
+
+    this->set_memory_usage(this->cs_memory_usage - usage_before
+                           + tab.get_memory_usage());
+}
+
+void
+logfile_column_store::truncate(size_t row_count)
+{
+    for (auto& tab_pair : this->cs_tables) {
+        auto& tab = tab_pair.second;
+
+        if (tab.t_rows.size() <= row_count) {
+            continue;
+        }
+
+        auto usage_before = tab.get_memory_usage();
+        tab.t_rows.resize(row_count);
+        for (auto& col : tab.t_columns) {
+            if (col.c_type != column::type_t::unsupported) {
+                col.resize(row_count);
+            }
+        }
+        this->set_memory_usage(this->cs_memory_usage - usage_before
+                               + tab.get_memory_usage());
+    }
+}
+
+void
+logfile_column_store::drop_table(intern_string_t name)
+{
+    auto iter = this->cs_tables.find(name);
+
+    if (iter == this->cs_tables.end()) {
+        return;
+    }
+
+    this->set_memory_usage(this->cs_memory_usage
+                           - iter->second.get_memory_usage());
+    this->cs_tables.erase(iter);
+}
+
+void
+logfile_column_store::clear()
+{
+    this->cs_tables.clear();
+    this->set_memory_usage(0);
+}
@@ -0,0 +1,212 @@
+/**
+ * Copyright (c) 2024, Timothy Stack
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ * * Neither the name of Timothy Stack nor the names of its contributors
+ * may be used to endorse or promote products derived from this software
+ * without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE REGENTS AND CONTRIBUTORS ''AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * @file logfile.column_store.hh
+ */
+
+#ifndef lnav_logfile_column_store_hh
+#define lnav_logfile_column_store_hh
+
+#include <deque>
+#include <list>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <stdint.h>
+
+#include "base/intern_string.hh"
+#include "robin_hood/robin_hood.h"
+
+struct logline_value_vector;
+
+/**
+ * A cache of the values extracted from the lines of a file for the SQL
+ * tables that have been queried.  The values are stored by column so that
+ * later queries can read them without reading the file or running the
+ * format's regex again.  Strings are dictionary-encoded since most fields
+ * only have a handful of distinct values.
+ *
+ * Each store is limited by /tuning/logfile/column-store-max-size and all of
+ * the stores together are limited by
+ * /tuning/logfile/column-store-total-max-size.  When the total limit is
+ * reached, the stores that were least recently queried are cleared.
+ */
+class logfile_column_store {
+public:
+    logfile_column_store();
+
+    logfile_column_store(const logfile_column_store&) = delete;
+
+    ~logfile_column_store();
+
+    class column {
+    public:
+        enum class type_t : uint8_t {
+            unknown,
+            integer,
+            real,
+            text,
+            json,
+            /**
+             * The column has values of different types or values that are
+             * structs, so it cannot be stored.
+             */
+            unsupported,
+        };
+
+        type_t get_type() const { return this->c_type; }
+
+        bool is_null(size_t row) const { return this->c_nulls[row]; }
+
+        int64_t get_integer(size_t row) const { return this->c_integers[row]; }
+
+        double get_real(size_t row) const { return this->c_reals[row]; }
+
+        const std::string& get_text(size_t row) const
+        {
+            return this->c_dictionary[this->c_codes[row]];
+        }
+
+    private:
+        friend logfile_column_store;
+
+        void resize(size_t rows);
+
+        void set_type(type_t type);
+
+        void set_text(size_t row, std::string str);
+
+        size_t get_memory_usage() const;
+
+        type_t c_type{type_t::unknown};
+        std::vector<bool> c_nulls;
+        std::vector<int64_t> c_integers;
+        std::vector<double> c_reals;
+        std::vector<uint32_t> c_codes;
+        std::deque<std::string> c_dictionary;
+        size_t c_dictionary_size{0};
+        robin_hood::unordered_map<string_fragment,
+                                  uint32_t,
+                                  frag_hasher,
+                                  std::equal_to<string_fragment>>
+            c_dictionary_index;
+    };
+
+    class table {
+    public:
+        bool has_row(size_t row) const
+        {
+            return row < this->t_rows.size() && this->t_rows[row];
+        }
+
+        /**
+         * @return The column at the given index or nullptr if its values
+         *   could not be stored.
+         */
+        const column* get_column(size_t index) const
+        {
+            if (index >= this->t_columns.size()
+                || this->t_columns[index].get_type()
+                    == column::type_t::unsupported)
+            {
+                return nullptr;
+            }
+            return &this->t_columns[index];
+        }
+
+    private:
+        friend logfile_column_store;
+
+        size_t get_memory_usage() const;
+
+        std::vector<bool> t_rows;
+        std::vector<column> t_columns;
+    };
+
+    /**
+     * Get the storage for the given table, creating it if needed.
+     *
+     * @param name The name of the SQL table.
+     * @param column_count The number of format columns in the table.
+     * @return The table or nullptr if the store is disabled.
+     */
+    table* get_table(intern_string_t name, size_t column_count);
+
+    /**
+     * Store the values extracted from a line, if the store has not reached
+     * its size limit.
+     *
+     * @param tab The table returned from get_table().
+     * @param row The line number in the file.
+     * @param values The values extracted for the table.
+     */
+    void add_row(table& tab, size_t row, const logline_value_vector& values);
+
+    /**
+     * Drop the values for lines that are no longer in the file's index.
+     *
+     * @param row_count The number of lines that are still valid.
+     */
+    void truncate(size_t row_count);
+
+    /**
+     * Drop the values for a table that is being removed or redefined.
+     */
+    void drop_table(intern_string_t name);
+
+    void clear();
+
+    size_t get_memory_usage() const { return this->cs_memory_usage; }
+
+    /**
+     * @return The memory used by all of the stores.
+     */
+    static size_t get_total_memory_usage();
+
+private:
+    /**
+     * Update the memory used by this store and the total.
+     */
+    void set_memory_usage(size_t usage);
+
+    /**
+     * Clear the least recently used stores, other than this one, until the
+     * total is under the limit.
+     *
+     * @return True if there is room for more values.
+     */
+    bool make_room(size_t total_max_size);
+
+    std::map<intern_string_t, table> cs_tables;
+    size_t cs_memory_usage{0};
+    /** This store's position in the list of stores ordered by use. */
+    std::list<logfile_column_store*>::iterator cs_lru_iter;
+};
+
+#endif
@@ -33,6 +33,7 @@
 #define logfile_hh
 
 #include <filesystem>
+#include <future>
 #include <set>
 #include <string>
 #include <utility>
@@ -52,6 +53,8 @@
 #include "file_options.hh"
 #include "line_buffer.hh"
 #include "log_format_fwd.hh"
+#include "logfile.column_store.hh"
+#include "logfile.schema_index.hh"
 #include "logfile_fwd.hh"
 #include "safe/safe.h"
 #include "shared_buffer.hh"
@@ -90,6 +93,8 @@ struct logfile_activity {
     struct rusage la_initial_index_rusage {};
 };
 
+struct index_chunk;
+
 /**
  * Container for the lines in a log file and some metadata.
  */
@@ -309,7 +314,8 @@ public:
 
     file_off_t get_line_content_offset(const_iterator ll)
     {
-        return ll->get_offset() + (this->lf_line_buffer.is_piper() ? 22 : 0);
+        return ll->get_offset()
+            + this->lf_line_buffer.get_line_meta_prefix_size();
     }
 
     void read_full_message(const_iterator ll,
@@ -335,6 +341,41 @@ public:
     rebuild_result_t rebuild_index(std::optional<ui_clock::time_point> deadline
                                    = std::nullopt);
 
+    /**
+     * @return True if rebuild_index() can be called from a background thread
+     * for this file.  The format must already be detected and must support
+     * scanning concurrently with other files.
+     */
+    bool can_rebuild_in_background() const;
+
+    /**
+     * @return True if the file is still within the lines at the start that
+     * are checked against all of the formats.
+     */
+    bool in_detection_window() const;
+
+    /**
+     * Index the file until format detection is finished.  If a format was
+     * found, the rest of the file is left for a later call to rebuild_index()
+     * so that it can be done in the background.  Otherwise, this is the same
+     * as rebuild_index().
+     */
+    rebuild_result_t rebuild_detection_window(
+        std::optional<ui_clock::time_point> deadline = std::nullopt);
+
+    /**
+     * Prepare for rebuild_index() to be called from a background thread.  The
+     * observers are detached until end_background_rebuild() is called so that
+     * they are only ever invoked on the main thread.
+     */
+    void begin_background_rebuild();
+
+    /**
+     * Reattach the observers and replay the notifications for any lines that
+     * were indexed in the background.  Must be called from the main thread.
+     */
+    void end_background_rebuild();
+
     void reobserve_from(iterator iter);
 
     void set_logfile_observer(logfile_observer* lo)
@@ -401,6 +442,21 @@ public:
 
     void enable_cache() { this->lf_line_buffer.enable_cache(); }
 
+    /**
+     * @return The values that have been extracted from this file by SQL
+     *   queries.
+     */
+    logfile_column_store& get_column_store()
+    {
+        return this->lf_column_store;
+    }
+
+    /**
+     * @return The schemas of the messages in this file that have been
+     *   parsed so far.
+     */
+    logfile_schema_index& get_schema_index() { return this->lf_schema_index; }
+
     void dump_stats();
 
     robin_hood::unordered_map<uint32_t, bookmark_metadata>&
@@ -451,11 +507,68 @@ protected:
 
     void set_format_base_time(log_format* lf);
 
+    /**
+     * Apply the tag and partition definitions and the watch expressions to
+     * a newly indexed line.
+     *
+     * @param ll The last line of the message that was just indexed.
+     * @param sbr The contents of the line.
+     */
+    void process_line_defs(iterator ll, const shared_buffer_ref& sbr);
+
+    /**
+     * Index a large, uncompressed region of the file by splitting it into
+     * chunks at line boundaries and scanning each chunk on its own thread.
+     * The results are stitched back together in order so that the index is
+     * the same as one built sequentially.
+     *
+     * @param off The offset to start indexing at.
+     * @param st The current stat of the file.
+     * @param sbc The context for the current batch of lines.
+     * @param sort_needed Set to true if the lines are not in time order.
+     * @param deadline The time to stop indexing by.  If a chunk was not
+     * finished by then, it is kept up to the point where it stopped and the
+     * chunks after it are saved for the next pass.
+     * @return A range that ends where indexing stopped or nullopt if the
+     * region could not be indexed concurrently.
+     */
+    std::optional<file_range> index_concurrently(
+        file_off_t off,
+        const struct stat& st,
+        scan_batch_context& sbc,
+        bool& sort_needed,
+        std::optional<ui_clock::time_point> deadline);
+
+    /**
+     * Find the tag and partition definitions from the current format that
+     * apply to this file.
+     */
+    void update_applicable_defs();
+
+    /**
+     * Restore the index from the on-disk cache, if there is a valid one.
+     *
+     * @param st The current stat of the file.
+     * @return True if the index was loaded from the cache.
+     */
+    bool load_index_cache(const struct stat& st);
+
+    /**
+     * Save the index to the on-disk cache so that it can be reused the next
+     * time this file is opened.  A copy of the index is written out on a
+     * background thread.
+     *
+     * @param st The current stat of the file.
+     */
+    void save_index_cache(const struct stat& st);
+
 private:
     logfile(std::filesystem::path filename, const logfile_open_options& loo);
 
     bool file_options_have_changed();
 
+    bool is_index_cacheable(const struct stat& st) const;
+
     std::filesystem::path lf_filename;
     logfile_open_options lf_options;
     logfile_activity lf_activity;
@@ -491,6 +604,8 @@ private:
     uint32_t lf_out_of_time_order_count{0};
     safe_notes lf_notes;
     safe_opid_state lf_opids;
+    logfile_column_store lf_column_store;
+    logfile_schema_index lf_schema_index;
     size_t lf_watch_count{0};
     ArenaAlloc::Alloc<char> lf_allocator{64 * 1024};
     std::optional<time_t> lf_cached_base_time;
@@ -507,6 +622,23 @@ private:
     size_t lf_file_options_generation{0};
     std::optional<std::pair<std::string, lnav::file_options>> lf_file_options;
     std::vector<lnav::console::user_message> lf_format_match_messages;
+    struct deferred_notifications {
+        logline_observer* dn_logline_observer{nullptr};
+        logfile_observer* dn_logfile_observer{nullptr};
+        std::optional<size_t> dn_first_new_line;
+        file_size_t dn_rollback_size{0};
+    };
+    std::optional<deferred_notifications> lf_deferred;
+    bool lf_detection_only{false};
+    bool lf_index_cache_checked{false};
+    file_off_t lf_index_cache_size{0};
+    /** The write of the index cache that is in progress, if any. */
+    std::future<void> lf_index_cache_future;
+    /**
+     * Chunks that index_concurrently() finished after the one that ran out
+     * of time.  They are stitched onto the index by a later pass.
+     */
+    std::vector<std::unique_ptr<index_chunk>> lf_pending_chunks;
 };
 
 class logline_observer {
@@ -0,0 +1,186 @@
+/**
+ * Copyright (c) 2026, Timothy Stack
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ * * Neither the name of Timothy Stack nor the names of its contributors
+ * may be used to endorse or promote products derived from this software
+ * without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE REGENTS AND CONTRIBUTORS ''AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <algorithm>
+
+#include "logfile.schema_index.hh"
+
+#include "column_namer.hh"
+#include "config.h"
+#include "data_parser.hh"
+#include "log_format.hh"
+#include "logfile.hh"
+
+bool
+logfile_schema_index::parse_message(logfile& lf,
+                                    size_t line,
+                                    logline_value_vector& values,
+                                    data_scanner& ds,
+                                    data_parser& dp)
+{
+    auto ll = lf.begin() + line;
+    string_attrs_t sa;
+
+    values.clear();
+    lf.read_full_message(ll, values.lvv_sbr);
+    values.lvv_sbr.erase_ansi();
+    lf.get_format_ptr()->annotate(&lf, line, sa, values, false);
+    auto body = find_string_attr_range(sa, &SA_BODY);
+    if (body.lr_end == -1) {
+        return false;
+    }
+
+    // The pairs only hold offsets into the line, so the line does not
+    // need to be copied into the scanner.
+    ds.reset(values.lvv_sbr.to_string_fragment().sub_range(0, body.lr_end),
+             body.lr_start);
+    dp.reset(&ds);
+    dp.parse();
+
+    return true;
+}
+
+bool
+logfile_schema_index::index_lines(logfile& lf, ui_clock::time_point deadline)
+{
+    if (this->si_overflowed || this->si_next_line >= lf.size()
+        || lf.get_format_ptr() == nullptr)
+    {
+        return false;
+    }
+
+    data_scanner ds{string_fragment{}};
+    data_parser dp{&ds};
+    logline_value_vector values;
+    size_t count = 0;
+
+    while (this->si_next_line < lf.size()) {
+        if ((count % 64) == 0 && ui_clock::now() >= deadline) {
+            return true;
+        }
+
+        auto line = this->si_next_line;
+        auto ll = lf.begin() + line;
+
+        this->si_next_line += 1;
+        if (!ll->is_message()) {
+            continue;
+        }
+
+        count += 1;
+        if (!parse_message(lf, line, values, ds, dp)) {
+            continue;
+        }
+
+        ll->set_schema(dp.dp_schema_id);
+        this->add_line(line, dp);
+        if (this->si_overflowed) {
+            log_info("%s: too many schemas to index",
+                     lf.get_filename().c_str());
+            return false;
+        }
+    }
+
+    return false;
+}
+
+void
+logfile_schema_index::add_line(uint32_t line, const data_parser& dp)
+{
+    auto iter = this->si_lookup.find(dp.dp_schema_id);
+
+    if (iter == this->si_lookup.end()) {
+        if (this->si_schemas.size() >= MAX_SCHEMAS) {
+            this->clear();
+            this->si_overflowed = true;
+            return;
+        }
+
+        schema sch;
+        column_namer cn{column_namer::language::SQL};
+
+        sch.s_id = dp.dp_schema_id;
+        for (const auto& pair : dp.dp_pairs) {
+            auto key_str = dp.get_element_string(pair.e_sub_elements->front());
+
+            if (!sch.s_keys.empty()) {
+                sch.s_keys.append(", ");
+            }
+            sch.s_keys.append(cn.add_column(key_str).to_string());
+        }
+        iter = this->si_lookup
+                   .emplace(dp.dp_schema_id, this->si_schemas.size())
+                   .first;
+        this->si_schemas.emplace_back(std::move(sch));
+    }
+
+    auto& lines = this->si_schemas[iter->second].s_lines;
+
+    if (lines.empty() || lines.back() < line) {
+        lines.emplace_back(line);
+    }
+}
+
+bool
+logfile_schema_index::is_complete(const logfile& lf) const
+{
+    return !this->si_overflowed && this->si_next_line >= lf.size();
+}
+
+const logfile_schema_index::schema*
+logfile_schema_index::find(const schema_id_t& id) const
+{
+    auto iter = this->si_lookup.find(id);
+
+    if (iter == this->si_lookup.end()) {
+        return nullptr;
+    }
+
+    return &this->si_schemas[iter->second];
+}
+
+void
+logfile_schema_index::truncate(size_t row_count)
+{
+    for (auto& sch : this->si_schemas) {
+        while (!sch.s_lines.empty() && sch.s_lines.back() >= row_count) {
+            sch.s_lines.pop_back();
+        }
+    }
+    this->si_next_line = std::min(this->si_next_line, row_count);
+}
+
+void
+logfile_schema_index::clear()
+{
+    this->si_next_line = 0;
+    this->si_overflowed = false;
+    this->si_schemas.clear();
+    this->si_lookup.clear();
+}
@@ -0,0 +1,140 @@
+/**
+ * Copyright (c) 2026, Timothy Stack
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ * * Neither the name of Timothy Stack nor the names of its contributors
+ * may be used to endorse or promote products derived from this software
+ * without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE REGENTS AND CONTRIBUTORS ''AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef lnav_logfile_schema_index_hh
+#define lnav_logfile_schema_index_hh
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include <stdint.h>
+
+#include "byte_array.hh"
+#include "logfile_fwd.hh"
+
+class data_parser;
+class data_scanner;
+struct logline_value_vector;
+
+/**
+ * The schemas of the message bodies in a file, as computed by the
+ * data_parser.  The bodies are parsed a slice at a time while lnav is idle
+ * so that logline tables can go straight to the lines that match their
+ * schema and the schemas in a file can be summarized without parsing every
+ * message in the foreground.
+ */
+class logfile_schema_index {
+public:
+    using schema_id_t = byte_array<2, uint64_t>;
+
+    /**
+     * The maximum number of distinct schemas to track for a file.  Files
+     * with mostly free-form text have a different schema for nearly every
+     * message, so indexing them would not help and would use a lot of
+     * memory.
+     */
+    static constexpr size_t MAX_SCHEMAS = 4096;
+
+    struct schema {
+        schema_id_t s_id;
+        /** The column names for the keys in a message with this schema. */
+        std::string s_keys;
+        /** The lines with this schema in ascending order. */
+        std::vector<uint32_t> s_lines;
+    };
+
+    /**
+     * Parse the body of a message the same way a logline table does.
+     *
+     * @param lf The file containing the message.
+     * @param line The line number of the start of the message.
+     * @param values Receives the message text.
+     * @param ds The scanner to reset with the message body.
+     * @param dp The parser to reset and run over the body.
+     * @return false if the message does not have a body.
+     */
+    static bool parse_message(logfile& lf,
+                              size_t line,
+                              logline_value_vector& values,
+                              data_scanner& ds,
+                              data_parser& dp);
+
+    /**
+     * Parse the messages that were indexed since the last call and record
+     * their schemas, both here and in the logline.
+     *
+     * @param lf The file that owns this index.
+     * @param deadline The time to stop parsing.
+     * @return true if there are still messages to be parsed.
+     */
+    bool index_lines(logfile& lf, ui_clock::time_point deadline);
+
+    /**
+     * Record the schema of a message.
+     *
+     * @param line The line number of the start of the message.
+     * @param dp The parser that was run over the message body.
+     */
+    void add_line(uint32_t line, const data_parser& dp);
+
+    /**
+     * @return true if every message in the file has been parsed.
+     */
+    bool is_complete(const logfile& lf) const;
+
+    /**
+     * @return true if the file had too many schemas to be indexed.
+     */
+    bool is_overflowed() const { return this->si_overflowed; }
+
+    /** @return The number of lines that have been parsed. */
+    size_t get_indexed_line_count() const { return this->si_next_line; }
+
+    const schema* find(const schema_id_t& id) const;
+
+    const std::vector<schema>& get_schemas() const { return this->si_schemas; }
+
+    /**
+     * Drop the schemas for lines that are no longer in the file's index.
+     *
+     * @param row_count The number of lines that are still valid.
+     */
+    void truncate(size_t row_count);
+
+    void clear();
+
+private:
+    size_t si_next_line{0};
+    bool si_overflowed{false};
+    std::vector<schema> si_schemas;
+    std::map<schema_id_t, size_t> si_lookup;
+};
+
+#endif
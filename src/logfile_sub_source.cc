@@ -37,6 +37,7 @@
 #include "base/ansi_scrubber.hh"
 #include "base/ansi_vars.hh"
 #include "base/fs_util.hh"
+#include "base/injector.hh"
 #include "base/itertools.hh"
 #include "base/string_util.hh"
 #include "bookmarks.json.hh"
@@ -46,6 +47,7 @@
 #include "k_merge_tree.h"
 #include "lnav_util.hh"
 #include "log_accel.hh"
+#include "logfile.cfg.hh"
 #include "md2attr_line.hh"
 #include "ptimec.hh"
 #include "shlex.hh"
@@ -210,6 +212,17 @@ struct filtered_logline_cmp {
         return (*ll_lhs) < rhs;
     }
 
+    bool operator()(const struct timeval& lhs, const uint32_t& rhs) const
+    {
+        content_line_t cl_rhs = (content_line_t) llss_controller.lss_index[rhs];
+        logline* ll_rhs = this->llss_controller.find_line(cl_rhs);
+
+        if (ll_rhs == nullptr) {
+            return false;
+        }
+        return lhs < ll_rhs->get_timeval();
+    }
+
     const logfile_sub_source& llss_controller;
 };
 
@@ -227,6 +240,20 @@ logfile_sub_source::find_from_time(const struct timeval& start) const
     return std::nullopt;
 }
 
+std::optional<vis_line_t>
+logfile_sub_source::find_after_time(const struct timeval& end) const
+{
+    auto ub = std::upper_bound(this->lss_filtered_index.begin(),
+                               this->lss_filtered_index.end(),
+                               end,
+                               filtered_logline_cmp(*this));
+    if (ub != this->lss_filtered_index.end()) {
+        return vis_line_t(ub - this->lss_filtered_index.begin());
+    }
+
+    return std::nullopt;
+}
+
 line_info
 logfile_sub_source::text_value_for_line(textview_curses& tc,
                                         int row,
@@ -270,6 +297,11 @@ logfile_sub_source::text_value_for_line(textview_curses& tc,
 
     require_false(this->lss_in_value_for_line);
 
+    // The cache is keyed by the content line since find_data() below
+    // rewrites the line number to be relative to its file.
+    const auto cache_key
+        = lnav::log::render_cache::key{(uint64_t) line, (uint32_t) flags};
+
     this->lss_in_value_for_line = true;
     this->lss_token_flags = flags;
     this->lss_token_file_data = this->find_data(line);
@@ -279,7 +311,26 @@ logfile_sub_source::text_value_for_line(textview_curses& tc,
     this->lss_token_attrs.clear();
     this->lss_token_values.clear();
     this->lss_share_manager.invalidate_refs();
-    if (flags & text_sub_source::RF_FULL) {
+
+    // The hidden fields are part of the cached values, so the cache needs
+    // to be thrown out when they are changed.
+    if (this->lss_field_state_generation
+        != log_format::lf_field_state_generation)
+    {
+        this->lss_render_cache.invalidate();
+        this->lss_field_state_generation
+            = log_format::lf_field_state_generation;
+    }
+
+    // Rewriting can run arbitrary SQL, so those results are not cached.
+    auto cached = (flags & RF_REWRITE)
+        ? nullptr
+        : this->lss_render_cache.get(cache_key);
+    if (cached) {
+        cached->restore_into(this->lss_token_value,
+                             this->lss_token_attrs,
+                             this->lss_token_values);
+    } else if (flags & text_sub_source::RF_FULL) {
         shared_buffer_ref sbr;
 
         this->lss_token_file->read_full_message(this->lss_token_line, sbr);
@@ -312,10 +363,19 @@ logfile_sub_source::text_value_for_line(textview_curses& tc,
     sbr.share(this->lss_share_manager,
               (char*) this->lss_token_value.c_str(),
               this->lss_token_value.size());
-    format->annotate(this->lss_token_file.get(),
-                     line,
-                     this->lss_token_attrs,
-                     this->lss_token_values);
+    if (!cached) {
+        format->annotate(this->lss_token_file.get(),
+                         line,
+                         this->lss_token_attrs,
+                         this->lss_token_values);
+        if (!(flags & RF_REWRITE)) {
+            this->lss_render_cache.put(
+                cache_key,
+                lnav::log::render_cache::entry::capture(this->lss_token_value,
+                                                        this->lss_token_attrs,
+                                                        this->lss_token_values));
+        }
+    }
     if (flags & RF_REWRITE) {
         exec_context ec(
             &this->lss_token_values, pretty_sql_callback, pretty_pipe_callback);
@@ -677,7 +737,8 @@ logfile_sub_source::text_attrs_for_line(textview_curses& lv,
             auto eval_res
                 = this->eval_sql_filter(this->lss_preview_filter_stmt.in(),
                                         this->lss_token_file_data,
-                                        this->lss_token_line);
+                                        this->lss_token_line,
+                                        this->lss_preview_filter_prog.get());
             if (eval_res.isErr()) {
                 color = palette_color{
                     lnav::enums::to_underlying(ansi_color::yellow)};
@@ -706,9 +767,11 @@ logfile_sub_source::text_attrs_for_line(textview_curses& lv,
         auto sql_filter_opt = this->get_sql_filter();
         if (sql_filter_opt) {
             auto* sf = (sql_filter*) sql_filter_opt.value().get();
-            auto eval_res = this->eval_sql_filter(sf->sf_filter_stmt.in(),
-                                                  this->lss_token_file_data,
-                                                  this->lss_token_line);
+            auto eval_res
+                = this->eval_sql_filter(sf->sf_filter_stmt.in(),
+                                        this->lss_token_file_data,
+                                        this->lss_token_line,
+                                        sf->sf_filter_prog.get());
             if (eval_res.isErr()) {
                 auto msg = fmt::format(
                     FMT_STRING(
@@ -773,6 +836,169 @@ struct logline_cmp {
     logfile_sub_source& llss_controller;
 };
 
+/**
+ * A compact copy of the parts of a logline that determine its position in
+ * the index so that a full sort does not have to chase each content_line_t
+ * back into the owning file's line vector on every comparison.
+ */
+struct index_sort_key {
+    index_sort_key(const logline& ll, content_line_t cl)
+        : isk_time(ll.get_time<std::chrono::microseconds>().count()),
+          isk_position((uint64_t{(uint64_t) ll.get_offset()} << 15)
+                       | ll.get_sub_offset()),
+          isk_line(cl)
+    {
+    }
+
+    bool operator<(const index_sort_key& rhs) const
+    {
+        // Same ordering as logline::operator<() with the content line as a
+        // final tie-breaker so the result does not depend on the sort.
+        return std::tie(this->isk_time, this->isk_position, this->isk_line)
+            < std::tie(rhs.isk_time, rhs.isk_position, rhs.isk_line);
+    }
+
+    int64_t isk_time;
+    /** The file offset of the line shifted over to make room for the 15-bit
+     * sub-offset. */
+    uint64_t isk_position;
+    content_line_t isk_line;
+};
+
+static logfile::rebuild_result_t
+merge_rebuild_results(std::optional<logfile::rebuild_result_t> lhs,
+                      logfile::rebuild_result_t rhs)
+{
+    if (!lhs) {
+        return rhs;
+    }
+    if (lhs.value() == logfile::rebuild_result_t::INVALID
+        || rhs == logfile::rebuild_result_t::INVALID)
+    {
+        return logfile::rebuild_result_t::INVALID;
+    }
+
+    return std::max(lhs.value(), rhs);
+}
+
+void
+logfile_sub_source::invalidate_render_cache_tail(const logfile_data& ld)
+{
+    auto* lf = ld.get_file_ptr();
+    auto line_number = std::min(ld.ld_lines_indexed, lf->size());
+
+    while (line_number > 0) {
+        line_number -= 1;
+        if (!(*lf)[line_number].is_continued()) {
+            break;
+        }
+    }
+
+    uint64_t base = ld.ld_file_index * MAX_LINES_PER_FILE;
+    this->lss_render_cache.invalidate(base + line_number,
+                                      base + MAX_LINES_PER_FILE);
+}
+
+void
+logfile_sub_source::rebuild_in_background(
+    std::optional<ui_clock::time_point> deadline,
+    std::vector<std::optional<logfile::rebuild_result_t>>& results)
+{
+    static const auto& lf_cfg = injector::get<const lnav::logfile::config&>();
+
+    size_t thread_count = lf_cfg.lc_index_threads;
+    if (thread_count == 0) {
+        thread_count = std::max(1U, std::thread::hardware_concurrency());
+    }
+    if (thread_count < 2) {
+        return;
+    }
+
+    std::vector<size_t> bg_files;
+    for (size_t lpc = 0; lpc < this->lss_files.size(); lpc++) {
+        auto* lf = this->lss_files[lpc]->get_file_ptr();
+
+        if (lf == nullptr) {
+            continue;
+        }
+        // Format detection checks the lines at the start of a file against
+        // the shared root formats, so that part has to be done here before
+        // the rest of the file can be handed off to a worker.
+        if (lf->get_format_ptr() != nullptr && lf->in_detection_window()) {
+            results[lpc] = lf->rebuild_detection_window(deadline);
+        }
+        if (results[lpc] != logfile::rebuild_result_t::INVALID
+            && lf->can_rebuild_in_background())
+        {
+            bg_files.emplace_back(lpc);
+        }
+    }
+
+    thread_count = std::min(thread_count, bg_files.size());
+    if (thread_count < 2) {
+        bg_files.clear();
+    } else {
+        log_debug("indexing %zu files using %zu threads",
+                  bg_files.size(),
+                  thread_count);
+        for (const auto file_index : bg_files) {
+            this->lss_files[file_index]
+                ->get_file_ptr()
+                ->begin_background_rebuild();
+        }
+
+        std::atomic<size_t> next_file{0};
+        std::vector<std::future<void>> workers;
+        for (size_t lpc = 0; lpc < thread_count; lpc++) {
+            workers.emplace_back(std::async(
+                std::launch::async,
+                [&bg_files, &next_file, &results, deadline, this]() {
+                    while (true) {
+                        auto bg_index = next_file.fetch_add(1);
+                        if (bg_index >= bg_files.size()) {
+                            break;
+                        }
+
+                        auto file_index = bg_files[bg_index];
+                        auto* lf = this->lss_files[file_index]->get_file_ptr();
+
+                        results[file_index] = merge_rebuild_results(
+                            results[file_index], lf->rebuild_index(deadline));
+                    }
+                }));
+        }
+        for (auto& worker : workers) {
+            worker.wait();
+        }
+
+        // The observers update the UI, so they are only called once all of
+        // the background work is done.
+        for (const auto file_index : bg_files) {
+            this->lss_files[file_index]
+                ->get_file_ptr()
+                ->end_background_rebuild();
+        }
+        for (auto& worker : workers) {
+            worker.get();
+        }
+    }
+
+    // Files that went through detection above, but were not handed off,
+    // still need the rest of their content indexed.
+    for (size_t lpc = 0; lpc < this->lss_files.size(); lpc++) {
+        if (!results[lpc] || results[lpc] == logfile::rebuild_result_t::INVALID
+            || std::find(bg_files.begin(), bg_files.end(), lpc)
+                != bg_files.end())
+        {
+            continue;
+        }
+
+        auto* lf = this->lss_files[lpc]->get_file_ptr();
+        results[lpc]
+            = merge_rebuild_results(results[lpc], lf->rebuild_index(deadline));
+    }
+}
+
 logfile_sub_source::rebuild_result
 logfile_sub_source::rebuild_index(std::optional<ui_clock::time_point> deadline)
 {
@@ -824,6 +1050,12 @@ logfile_sub_source::rebuild_index(std::optional<ui_clock::time_point> deadline)
                          });
     }
 
+    std::vector<std::optional<logfile::rebuild_result_t>> bg_results(
+        this->lss_files.size());
+    if (!this->tss_view->is_paused()) {
+        this->rebuild_in_background(deadline, bg_results);
+    }
+
     bool time_left = true;
     for (const auto file_index : file_order) {
         auto& ld = *(this->lss_files[file_index]);
@@ -844,8 +1076,10 @@ logfile_sub_source::rebuild_index(std::optional<ui_clock::time_point> deadline)
                 time_left = false;
             }
 
-            if (!this->tss_view->is_paused() && time_left) {
-                switch (lf->rebuild_index(deadline)) {
+            const auto& bg_res = bg_results[file_index];
+            if (!this->tss_view->is_paused() && (time_left || bg_res)) {
+                switch (bg_res ? bg_res.value() : lf->rebuild_index(deadline))
+                {
                     case logfile::rebuild_result_t::NO_NEW_LINES:
                         // No changes
                         break;
@@ -853,6 +1087,7 @@ logfile_sub_source::rebuild_index(std::optional<ui_clock::time_point> deadline)
                         if (retval == rebuild_result::rr_no_change) {
                             retval = rebuild_result::rr_appended_lines;
                         }
+                        this->invalidate_render_cache_tail(ld);
                         log_debug("new lines for %s:%d",
                                   lf->get_filename().c_str(),
                                   lf->size());
@@ -1017,9 +1252,14 @@ logfile_sub_source::rebuild_index(std::optional<ui_clock::time_point> deadline)
         }
     }
 
+    if (force) {
+        // The files might have been reindexed or replaced, so the content
+        // lines in the cache do not refer to the same lines anymore.
+        this->lss_render_cache.invalidate();
+    }
+
     if (retval != rebuild_result::rr_no_change || force) {
         size_t index_size = 0, start_size = this->lss_index.size();
-        logline_cmp line_cmper(*this);
 
         for (auto& ld : this->lss_files) {
             auto* lf = ld->get_file_ptr();
@@ -1036,8 +1276,54 @@ logfile_sub_source::rebuild_index(std::optional<ui_clock::time_point> deadline)
                 this->lss_filename_width, lf->get_filename().native().size());
         }
 
+        auto index_meta_marks = [this](const logfile_data& ld,
+                                       logfile::const_iterator lf_iter) {
+            auto start_iter = lf_iter;
+            while (start_iter->is_continued()) {
+                --start_iter;
+            }
+            int start_index = start_iter - ld.get_file_ptr()->begin();
+            content_line_t start_con_line(ld.ld_file_index * MAX_LINES_PER_FILE
+                                          + start_index);
+
+            auto& line_meta
+                = ld.get_file_ptr()->get_bookmark_metadata()[start_index];
+            if (line_meta.has(bookmark_metadata::categories::notes)) {
+                this->lss_user_marks[&textview_curses::BM_META].insert_once(
+                    start_con_line);
+            }
+            if (line_meta.has(bookmark_metadata::categories::partition)) {
+                this->lss_user_marks[&textview_curses::BM_PARTITION]
+                    .insert_once(start_con_line);
+            }
+        };
+
+        // The lines in a file are usually already in time order, in which
+        // case a k-way merge of the files produces the same index as a full
+        // sort without the need to compare every line.
+        auto sort_start = std::chrono::steady_clock::now();
+        if (full_sort) {
+            full_sort = false;
+            for (const auto& ld : this->lss_files) {
+                auto* lf = ld->get_file_ptr();
+
+                if (lf == nullptr) {
+                    continue;
+                }
+                if (!std::is_sorted(lf->begin(), lf->end())) {
+                    log_debug("%s: lines are not in time order",
+                              lf->get_filename().c_str());
+                    full_sort = true;
+                    break;
+                }
+            }
+        }
+
         if (full_sort) {
             log_trace("rebuild_index full sort");
+            std::vector<index_sort_key> sort_keys;
+
+            sort_keys.reserve(total_lines);
             for (auto& ld : this->lss_files) {
                 auto* lf = ld->get_file_ptr();
 
@@ -1045,55 +1331,31 @@ logfile_sub_source::rebuild_index(std::optional<ui_clock::time_point> deadline)
                     continue;
                 }
 
-                for (size_t line_index = 0; line_index < lf->size();
-                     line_index++)
+                for (auto lf_iter = lf->cbegin(); lf_iter != lf->cend();
+                     ++lf_iter)
                 {
-                    const auto lf_iter
-                        = ld->get_file_ptr()->begin() + line_index;
                     if (lf_iter->is_ignored()) {
                         continue;
                     }
 
-                    content_line_t con_line(
-                        ld->ld_file_index * MAX_LINES_PER_FILE + line_index);
+                    content_line_t con_line(ld->ld_file_index
+                                                * MAX_LINES_PER_FILE
+                                            + (lf_iter - lf->cbegin()));
 
                     if (lf_iter->is_meta_marked()) {
-                        auto start_iter = lf_iter;
-                        while (start_iter->is_continued()) {
-                            --start_iter;
-                        }
-                        int start_index
-                            = start_iter - ld->get_file_ptr()->begin();
-                        content_line_t start_con_line(ld->ld_file_index
-                                                          * MAX_LINES_PER_FILE
-                                                      + start_index);
-
-                        auto& line_meta
-                            = ld->get_file_ptr()
-                                  ->get_bookmark_metadata()[start_index];
-                        if (line_meta.has(bookmark_metadata::categories::notes))
-                        {
-                            this->lss_user_marks[&textview_curses::BM_META]
-                                .insert_once(start_con_line);
-                        }
-                        if (line_meta.has(
-                                bookmark_metadata::categories::partition))
-                        {
-                            this->lss_user_marks[&textview_curses::BM_PARTITION]
-                                .insert_once(start_con_line);
-                        }
+                        index_meta_marks(*ld, lf_iter);
                     }
-                    this->lss_index.push_back(con_line);
+                    sort_keys.emplace_back(*lf_iter, con_line);
                 }
             }
 
-            // XXX get rid of this full sort on the initial run, it's not
-            // needed unless the file is not in time-order
             if (this->lss_sorting_observer) {
-                this->lss_sorting_observer(*this, 0, this->lss_index.size());
+                this->lss_sorting_observer(*this, 0, sort_keys.size());
+            }
+            std::sort(sort_keys.begin(), sort_keys.end());
+            for (const auto& key : sort_keys) {
+                this->lss_index.push_back(key.isk_line);
             }
-            std::sort(
-                this->lss_index.begin(), this->lss_index.end(), line_cmper);
             if (this->lss_sorting_observer) {
                 this->lss_sorting_observer(
                     *this, this->lss_index.size(), this->lss_index.size());
@@ -1137,29 +1399,7 @@ logfile_sub_source::rebuild_index(std::optional<ui_clock::time_point> deadline)
                                             + line_index);
 
                     if (lf_iter->is_meta_marked()) {
-                        auto start_iter = lf_iter;
-                        while (start_iter->is_continued()) {
-                            --start_iter;
-                        }
-                        int start_index
-                            = start_iter - ld->get_file_ptr()->begin();
-                        content_line_t start_con_line(
-                            file_index * MAX_LINES_PER_FILE + start_index);
-
-                        auto& line_meta
-                            = ld->get_file_ptr()
-                                  ->get_bookmark_metadata()[start_index];
-                        if (line_meta.has(bookmark_metadata::categories::notes))
-                        {
-                            this->lss_user_marks[&textview_curses::BM_META]
-                                .insert_once(start_con_line);
-                        }
-                        if (line_meta.has(
-                                bookmark_metadata::categories::partition))
-                        {
-                            this->lss_user_marks[&textview_curses::BM_PARTITION]
-                                .insert_once(start_con_line);
-                        }
+                        index_meta_marks(*ld, lf_iter);
                     }
                     this->lss_index.push_back(con_line);
                 }
@@ -1174,6 +1414,12 @@ logfile_sub_source::rebuild_index(std::optional<ui_clock::time_point> deadline)
                 this->lss_sorting_observer(*this, index_size, index_size);
             }
         }
+        log_info("rebuild_index: %s of %zu lines took %lld ms",
+                 full_sort ? "full sort" : "merge",
+                 this->lss_index.size() - start_size,
+                 std::chrono::duration_cast<std::chrono::milliseconds>(
+                     std::chrono::steady_clock::now() - sort_start)
+                     .count());
 
         for (iter = this->lss_files.begin(); iter != this->lss_files.end();
              iter++)
@@ -1189,8 +1435,12 @@ logfile_sub_source::rebuild_index(std::optional<ui_clock::time_point> deadline)
 
         this->lss_filtered_index.reserve(this->lss_index.size());
 
-        uint32_t filter_in_mask, filter_out_mask;
+        logfile_filter_state::filter_mask_t filter_in_mask, filter_out_mask;
         this->get_filters().get_enabled_mask(filter_in_mask, filter_out_mask);
+        for (auto& ld : this->lss_files) {
+            ld->ld_filter_state.update_excluded(filter_in_mask,
+                                                filter_out_mask);
+        }
 
         if (start_size == 0 && this->lss_index_delegate != nullptr) {
             this->lss_index_delegate->index_start(*this);
@@ -1217,12 +1467,14 @@ logfile_sub_source::rebuild_index(std::optional<ui_clock::time_point> deadline)
             }
 
             if (!this->tss_apply_filters
-                || (!(*ld)->ld_filter_state.excluded(
-                        filter_in_mask, filter_out_mask, line_number)
+                || (!(*ld)->ld_filter_state.excluded(line_number)
                     && this->check_extra_filters(ld, line_iter)))
             {
                 auto eval_res = this->eval_sql_filter(
-                    this->lss_marker_stmt.in(), ld, line_iter);
+                    this->lss_marker_stmt.in(),
+                    ld,
+                    line_iter,
+                    this->lss_marker_prog.get());
                 if (eval_res.isErr()) {
                     line_iter->set_expr_mark(false);
                 } else {
@@ -1338,6 +1590,7 @@ void
 logfile_sub_source::text_filters_changed()
 {
     this->lss_index_generation += 1;
+    this->lss_render_cache.invalidate();
 
     if (this->lss_line_meta_changed) {
         this->invalidate_sql_filter();
@@ -1355,9 +1608,13 @@ logfile_sub_source::text_filters_changed()
     }
 
     auto& vis_bm = this->tss_view->get_bookmarks();
-    uint32_t filtered_in_mask, filtered_out_mask;
+    logfile_filter_state::filter_mask_t filtered_in_mask, filtered_out_mask;
 
     this->get_filters().get_enabled_mask(filtered_in_mask, filtered_out_mask);
+    for (auto& ld : *this) {
+        ld->ld_filter_state.update_excluded(filtered_in_mask,
+                                            filtered_out_mask);
+    }
 
     if (this->lss_index_delegate != nullptr) {
         this->lss_index_delegate->index_start(*this);
@@ -1380,12 +1637,14 @@ logfile_sub_source::text_filters_changed()
         auto line_iter = lf->begin() + line_number;
 
         if (!this->tss_apply_filters
-            || (!(*ld)->ld_filter_state.excluded(
-                    filtered_in_mask, filtered_out_mask, line_number)
+            || (!(*ld)->ld_filter_state.excluded(line_number)
                 && this->check_extra_filters(ld, line_iter)))
         {
-            auto eval_res = this->eval_sql_filter(
-                this->lss_marker_stmt.in(), ld, line_iter);
+            auto eval_res
+                = this->eval_sql_filter(this->lss_marker_stmt.in(),
+                                        ld,
+                                        line_iter,
+                                        this->lss_marker_prog.get());
             if (eval_res.isErr()) {
                 line_iter->set_expr_mark(false);
             } else {
@@ -1616,6 +1875,9 @@ logfile_sub_source::set_sql_marker(std::string stmt_str, sqlite3_stmt* stmt)
         }
     }
 
+    this->lss_marker_prog = stmt == nullptr
+        ? nullptr
+        : lnav::log::filter_expr::compile(stmt_str).unwrapOr(nullptr);
     this->lss_marker_stmt_text = std::move(stmt_str);
     this->lss_marker_stmt = stmt;
 
@@ -1643,8 +1905,8 @@ logfile_sub_source::set_sql_marker(std::string stmt_str, sqlite3_stmt* stmt)
         if (ll->is_continued() || ll->is_ignored()) {
             continue;
         }
-        auto eval_res
-            = this->eval_sql_filter(this->lss_marker_stmt.in(), ld, ll);
+        auto eval_res = this->eval_sql_filter(
+            this->lss_marker_stmt.in(), ld, ll, this->lss_marker_prog.get());
 
         if (eval_res.isErr()) {
             ll->set_expr_mark(false);
@@ -1686,20 +1948,29 @@ logfile_sub_source::set_preview_sql_filter(sqlite3_stmt* stmt)
     }
 
     this->lss_preview_filter_stmt = stmt;
+    this->lss_preview_filter_prog = stmt == nullptr
+        ? nullptr
+        : lnav::log::filter_expr::compile(stmt).unwrapOr(nullptr);
 
     return Ok();
 }
 
 Result<bool, lnav::console::user_message>
-logfile_sub_source::eval_sql_filter(sqlite3_stmt* stmt,
-                                    iterator ld,
-                                    logfile::const_iterator ll)
+logfile_sub_source::eval_sql_filter(
+    sqlite3_stmt* stmt,
+    iterator ld,
+    logfile::const_iterator ll,
+    const lnav::log::filter_expr::program* prog)
 {
     if (stmt == nullptr) {
         return Ok(false);
     }
 
     auto* lf = (*ld)->get_file_ptr();
+    if (prog != nullptr) {
+        return Ok(prog->eval(*lf, ll));
+    }
+
     char timestamp_buffer[64];
     shared_buffer_ref raw_sbr;
     logline_value_vector values;
@@ -2207,7 +2478,7 @@ sql_filter::matches(std::optional<line_source> ls_opt,
     }
 
     auto eval_res = this->sf_log_source.eval_sql_filter(
-        this->sf_filter_stmt, ld, ls->ls_line);
+        this->sf_filter_stmt, ld, ls->ls_line, this->sf_filter_prog.get());
     if (eval_res.unwrapOr(true)) {
         return false;
     }
@@ -2304,7 +2575,7 @@ logfile_sub_source::meta_grepper::grep_begin(grep_proc<vis_line_t>& gp,
                                              vis_line_t start,
                                              vis_line_t stop)
 {
-    this->lmg_source.quiesce();
+    this->lmg_done = false;
 
     this->lmg_source.tss_view->grep_begin(gp, start, stop);
 }
@@ -2899,6 +3170,8 @@ logfile_sub_source::get_bookmark_metadata(content_line_t cl)
     auto line_number = static_cast<uint32_t>(
         std::distance(line_pair.first->begin(), line_pair.second));
 
+    // The opid in the metadata is used when annotating the line.
+    this->lss_render_cache.invalidate(cl, cl + 1);
     return line_pair.first->get_bookmark_metadata()[line_number];
 }
 
@@ -2981,6 +3254,7 @@ logfile_sub_source::erase_bookmark_metadata(content_line_t cl)
     auto bm_iter = bm.find(line_number);
     if (bm_iter != bm.end()) {
         bm.erase(bm_iter);
+        this->lss_render_cache.invalidate(cl, cl + 1);
     }
 }
 
@@ -2994,6 +3268,7 @@ logfile_sub_source::clear_bookmark_metadata()
 
         ld->get_file_ptr()->get_bookmark_metadata().clear();
     }
+    this->lss_render_cache.invalidate();
 }
 
 void
@@ -43,6 +43,8 @@
 #include "bookmarks.hh"
 #include "document.sections.hh"
 #include "filter_observer.hh"
+#include "log.filter_expr.hh"
+#include "log.render_cache.hh"
 #include "log_format.hh"
 #include "logfile.hh"
 #include "strong_int.hh"
@@ -82,6 +84,8 @@ public:
           sf_log_source(lss)
     {
         this->sf_filter_stmt = stmt;
+        this->sf_filter_prog
+            = lnav::log::filter_expr::compile(this->lf_id).unwrapOr(nullptr);
     }
 
     bool matches(std::optional<line_source> ls,
@@ -90,6 +94,8 @@ public:
     std::string to_command() const override;
 
     auto_mem<sqlite3_stmt> sf_filter_stmt{sqlite3_finalize};
+    /** The native version of the statement, if it could be compiled. */
+    std::shared_ptr<lnav::log::filter_expr::program> sf_filter_prog;
     logfile_sub_source& sf_log_source;
 };
 
@@ -424,6 +430,11 @@ public:
 
     int get_filtered_count_for(size_t filter_index) const;
 
+    const lnav::log::render_cache& get_render_cache() const
+    {
+        return this->lss_render_cache;
+    }
+
     Result<void, lnav::console::user_message> set_sql_filter(
         std::string stmt_str, sqlite3_stmt* stmt);
 
@@ -511,6 +522,12 @@ public:
 
     std::optional<vis_line_t> find_from_time(const struct timeval& start) const;
 
+    /**
+     * @return The first row with a timestamp after the given time or
+     *   std::nullopt if all the rows are at or before that time.
+     */
+    std::optional<vis_line_t> find_after_time(const struct timeval& end) const;
+
     std::optional<vis_line_t> find_from_time(time_t start) const
     {
         struct timeval tv = {start, 0};
@@ -734,8 +751,17 @@ public:
                            const listview_curses::display_line_content_t&,
                            mouse_event& me);
 
+    /**
+     * Evaluate a :filter-expr/:mark-expr statement against a message.
+     *
+     * @param prog The compiled version of the statement.  If it is not
+     *   null, it is evaluated instead of the statement.
+     */
     Result<bool, lnav::console::user_message> eval_sql_filter(
-        sqlite3_stmt* stmt, iterator ld, logfile::const_iterator ll);
+        sqlite3_stmt* stmt,
+        iterator ld,
+        logfile::const_iterator ll,
+        const lnav::log::filter_expr::program* prog = nullptr);
 
     void invalidate_sql_filter();
 
@@ -814,6 +840,27 @@ private:
 
     bool check_extra_filters(iterator ld, logfile::iterator ll);
 
+    /**
+     * Index the files that support it concurrently on a pool of threads.
+     * Format detection for files that were just promoted is finished on the
+     * calling thread first since it needs the shared root formats.
+     *
+     * @param deadline The deadline passed to logfile::rebuild_index().
+     * @param results The result of indexing each file, indexed the same as
+     * lss_files.  Files that were not indexed are left as nullopt.
+     */
+    void rebuild_in_background(
+        std::optional<ui_clock::time_point> deadline,
+        std::vector<std::optional<logfile::rebuild_result_t>>& results);
+
+    /**
+     * Drop the cached renderings of the lines in the given file that can
+     * change when lines are appended to it.  That is the last message that
+     * was indexed, since its last line might have been partial and the
+     * new lines might continue it, and everything after it.
+     */
+    void invalidate_render_cache_tail(const logfile_data& ld);
+
     size_t lss_basename_width = 0;
     size_t lss_filename_width = 0;
     unsigned long lss_flags{0};
@@ -822,9 +869,11 @@ private:
 
     std::vector<uint32_t> lss_filtered_index;
     auto_mem<sqlite3_stmt> lss_preview_filter_stmt{sqlite3_finalize};
+    std::shared_ptr<lnav::log::filter_expr::program> lss_preview_filter_prog;
 
     bookmarks<content_line_t>::type lss_user_marks;
     auto_mem<sqlite3_stmt> lss_marker_stmt{sqlite3_finalize};
+    std::shared_ptr<lnav::log::filter_expr::program> lss_marker_prog;
     std::string lss_marker_stmt_text;
 
     line_flags_t lss_token_flags{0};
@@ -842,6 +891,8 @@ private:
     logfile::iterator lss_token_line;
     std::array<std::pair<int, size_t>, LINE_SIZE_CACHE_SIZE>
         lss_line_size_cache;
+    lnav::log::render_cache lss_render_cache;
+    uint32_t lss_field_state_generation{0};
     log_level_t lss_min_log_level{LEVEL_UNKNOWN};
     struct timeval lss_min_log_time{0, 0};
     struct timeval lss_max_log_time{std::numeric_limits<time_t>::max(), 0};
@@ -0,0 +1,331 @@
+/**
+ * Copyright (c) 2026, Timothy Stack
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ * * Neither the name of Timothy Stack nor the names of its contributors
+ * may be used to endorse or promote products derived from this software
+ * without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE REGENTS AND CONTRIBUTORS ''AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "opid_vtab.hh"
+
+#include "base/lnav_log.hh"
+#include "config.h"
+#include "lnav.hh"
+#include "log.opid_index.hh"
+#include "sql_help.hh"
+#include "sql_util.hh"
+#include "vtab_module.hh"
+
+namespace {
+
+enum {
+    AO_COL_OPID,
+    AO_COL_SUBID,
+    AO_COL_START_TIME,
+    AO_COL_END_TIME,
+    AO_COL_DURATION_MSECS,
+    AO_COL_ERROR_COUNT,
+    AO_COL_WARNING_COUNT,
+    AO_COL_TOTAL_COUNT,
+    AO_COL_RANGE_START,
+    AO_COL_RANGE_END,
+};
+
+struct active_opids {
+    static constexpr const char* NAME = "active_opids";
+    static constexpr const char* CREATE_STMT = R"(
+-- The active_opids() table-valued function returns the operations that
+-- overlap a span of time in the loaded log files.
+CREATE TABLE active_opids (
+    opid TEXT,
+    subid TEXT,
+    start_time DATETIME,
+    end_time DATETIME,
+    duration_msecs INTEGER,
+    error_count INTEGER,
+    warning_count INTEGER,
+    total_count INTEGER,
+    range_start TEXT HIDDEN,
+    range_end TEXT HIDDEN
+);
+)";
+
+    struct cursor {
+        sqlite3_vtab_cursor base;
+        std::shared_ptr<const lnav::log::opid_index> c_index;
+        std::vector<const lnav::log::opid_index::entry*> c_entries;
+        size_t c_entry_index{0};
+        std::string c_range_start;
+        std::string c_range_end;
+
+        explicit cursor(sqlite3_vtab* vt) : base({vt}) {}
+
+        int reset() { return SQLITE_OK; }
+
+        int next()
+        {
+            if (this->c_entry_index < this->c_entries.size()) {
+                this->c_entry_index += 1;
+            }
+
+            return SQLITE_OK;
+        }
+
+        int eof() { return this->c_entry_index >= this->c_entries.size(); }
+
+        int get_rowid(sqlite3_int64& rowid_out)
+        {
+            rowid_out = this->c_entry_index;
+
+            return SQLITE_OK;
+        }
+    };
+
+    int get_column(const cursor& vc, sqlite3_context* ctx, int col)
+    {
+        const auto& ent = *vc.c_entries[vc.c_entry_index];
+        char time_buf[64];
+
+        switch (col) {
+            case AO_COL_OPID:
+                to_sqlite(ctx, ent.e_opid);
+                break;
+            case AO_COL_SUBID:
+                if (ent.e_subid.is_valid()) {
+                    to_sqlite(ctx, ent.e_subid);
+                } else {
+                    sqlite3_result_null(ctx);
+                }
+                break;
+            case AO_COL_START_TIME:
+                sql_strftime(
+                    time_buf, sizeof(time_buf), ent.e_range.tr_begin, ' ');
+                sqlite3_result_text(ctx, time_buf, -1, SQLITE_TRANSIENT);
+                break;
+            case AO_COL_END_TIME:
+                sql_strftime(
+                    time_buf, sizeof(time_buf), ent.e_range.tr_end, ' ');
+                sqlite3_result_text(ctx, time_buf, -1, SQLITE_TRANSIENT);
+                break;
+            case AO_COL_DURATION_MSECS:
+                to_sqlite(ctx, (int64_t) ent.e_range.duration().count());
+                break;
+            case AO_COL_ERROR_COUNT:
+                to_sqlite(ctx, (int64_t) ent.e_level_stats.lls_error_count);
+                break;
+            case AO_COL_WARNING_COUNT:
+                to_sqlite(ctx, (int64_t) ent.e_level_stats.lls_warning_count);
+                break;
+            case AO_COL_TOTAL_COUNT:
+                to_sqlite(ctx, (int64_t) ent.e_level_stats.lls_total_count);
+                break;
+            case AO_COL_RANGE_START:
+                to_sqlite(ctx, vc.c_range_start);
+                break;
+            case AO_COL_RANGE_END:
+                to_sqlite(ctx, vc.c_range_end);
+                break;
+        }
+
+        return SQLITE_OK;
+    }
+
+    /**
+     * @return an index that is up-to-date with the opids in the log files.
+     */
+    std::shared_ptr<const lnav::log::opid_index> get_index()
+    {
+        std::vector<std::shared_ptr<logfile>> files;
+
+        for (const auto& ld : lnav_data.ld_log_source) {
+            auto lf = ld->get_file();
+            if (lf != nullptr) {
+                files.emplace_back(lf);
+            }
+        }
+
+        // A cursor from an earlier query can still be holding on to the
+        // index, so build a new one instead of changing it underneath.
+        if (this->ao_index == nullptr || this->ao_index.use_count() > 1) {
+            auto index = std::make_shared<lnav::log::opid_index>();
+
+            index->update(files);
+            this->ao_index = std::move(index);
+        } else {
+            this->ao_index->update(files);
+        }
+
+        return this->ao_index;
+    }
+
+    std::shared_ptr<lnav::log::opid_index> ao_index;
+};
+
+int
+aoBestIndex(sqlite3_vtab* tab, sqlite3_index_info* pIdxInfo)
+{
+    vtab_index_constraints vic(pIdxInfo);
+    vtab_index_usage viu(pIdxInfo);
+
+    for (auto iter = vic.begin(); iter != vic.end(); ++iter) {
+        if (iter->op != SQLITE_INDEX_CONSTRAINT_EQ) {
+            continue;
+        }
+
+        switch (iter->iColumn) {
+            case AO_COL_RANGE_START:
+            case AO_COL_RANGE_END:
+                viu.column_used(iter);
+                break;
+        }
+    }
+
+    viu.allocate_args(AO_COL_RANGE_START, AO_COL_RANGE_END, 1);
+    return SQLITE_OK;
+}
+
+std::optional<timeval>
+time_arg(sqlite3_vtab* vt, sqlite3_value* arg, const char* name)
+{
+    const auto* datestr = (const char*) sqlite3_value_text(arg);
+    auto datelen = sqlite3_value_bytes(arg);
+    date_time_scanner dts;
+    struct timeval tv;
+    struct exttm tm;
+
+    if (datestr == nullptr
+        || dts.scan(datestr, datelen, nullptr, &tm, tv) != datestr + datelen)
+    {
+        auto um = lnav::console::user_message::error(
+                      attr_line_t("invalid timestamp for the ")
+                          .append_quoted(name)
+                          .append(" parameter"))
+                      .with_reason(attr_line_t("unable to parse ")
+                                       .append_quoted(datestr == nullptr
+                                                          ? ""
+                                                          : datestr))
+                      .move();
+        set_vtable_errmsg(vt, um);
+        return std::nullopt;
+    }
+
+    return tv;
+}
+
+int
+aoFilter(sqlite3_vtab_cursor* pVtabCursor,
+         int idxNum,
+         const char* idxStr,
+         int argc,
+         sqlite3_value** argv)
+{
+    auto* pCur = (active_opids::cursor*) pVtabCursor;
+    auto* mod_vt = (vtab_module<tvt_no_update<active_opids>>::vtab*)
+                       pVtabCursor->pVtab;
+
+    pCur->c_index.reset();
+    pCur->c_entries.clear();
+    pCur->c_entry_index = 0;
+    pCur->c_range_start.clear();
+    pCur->c_range_end.clear();
+    if (argc < 1) {
+        return SQLITE_OK;
+    }
+
+    auto low_opt = time_arg(pVtabCursor->pVtab, argv[0], "range_start");
+    if (!low_opt) {
+        return SQLITE_ERROR;
+    }
+    pCur->c_range_start = (const char*) sqlite3_value_text(argv[0]);
+
+    auto high_opt = low_opt;
+    if (argc > 1 && sqlite3_value_type(argv[1]) != SQLITE_NULL) {
+        high_opt = time_arg(pVtabCursor->pVtab, argv[1], "range_end");
+        if (!high_opt) {
+            return SQLITE_ERROR;
+        }
+        pCur->c_range_end = (const char*) sqlite3_value_text(argv[1]);
+    } else {
+        pCur->c_range_end = pCur->c_range_start;
+    }
+
+    pCur->c_index = mod_vt->v_impl.get_index();
+    pCur->c_entries
+        = pCur->c_index->overlapping(low_opt.value(), high_opt.value());
+
+    return SQLITE_OK;
+}
+
+}  // namespace
+
+int
+register_opid_vtab(sqlite3* db)
+{
+    static vtab_module<tvt_no_update<active_opids>> ACTIVE_OPIDS_MODULE;
+    static auto active_opids_help
+        = help_text("active_opids",
+                    "A table-valued function that returns the operations and "
+                    "sub-operations in the log files whose time range "
+                    "overlaps the given span of time.")
+              .sql_table_valued_function()
+              .with_parameter({"range_start", "The start of the time span."})
+              .with_parameter(
+                  help_text{"range_end",
+                            "The end of the time span, inclusive.  If not "
+                            "given, the operations active at range_start "
+                            "are returned."}
+                      .optional())
+              .with_result({"opid", "The ID of the operation."})
+              .with_result({"subid",
+                            "The ID of the sub-operation or NULL if the row "
+                            "is for the operation as a whole."})
+              .with_result(
+                  {"start_time", "The time of the first message in the op."})
+              .with_result(
+                  {"end_time", "The time of the last message in the op."})
+              .with_result(
+                  {"duration_msecs", "The duration of the op in milliseconds."})
+              .with_result({"error_count", "The number of error messages."})
+              .with_result(
+                  {"warning_count", "The number of warning messages."})
+              .with_result({"total_count", "The total number of messages."})
+              .with_example({
+                  "To get the operations that were active at a given time",
+                  "SELECT opid FROM active_opids('2011-11-03 00:19:37') "
+                  "WHERE subid IS NULL",
+              });
+
+    int rc;
+
+    ACTIVE_OPIDS_MODULE.vm_module.xBestIndex = aoBestIndex;
+    ACTIVE_OPIDS_MODULE.vm_module.xFilter = aoFilter;
+
+    rc = ACTIVE_OPIDS_MODULE.create(db, "active_opids");
+    sqlite_function_help.emplace("active_opids", &active_opids_help);
+    active_opids_help.index_tags();
+
+    ensure(rc == SQLITE_OK);
+
+    return rc;
+}
@@ -31,6 +31,11 @@
 
 #include "pcre2pp.hh"
 
+#include <string_view>
+
+#include <string.h>
+#include <strings.h>
+
 #include "config.h"
 #include "ww898/cp_utf8.hpp"
 
@@ -171,6 +176,68 @@ code::get_capture_count() const
     return retval;
 }
 
+bool
+code::is_anchored() const
+{
+    uint32_t options = 0;
+
+    pcre2_pattern_info(this->p_code.in(), PCRE2_INFO_ALLOPTIONS, &options);
+
+    return (options & PCRE2_ANCHORED) != 0;
+}
+
+std::optional<std::bitset<256>>
+code::get_first_bytes() const
+{
+    uint32_t code_type = 0;
+
+    pcre2_pattern_info(
+        this->p_code.in(), PCRE2_INFO_FIRSTCODETYPE, &code_type);
+    if (code_type == 1) {
+        uint32_t unit = 0;
+
+        // PCRE2 does not say if the code unit is caseless, which can happen
+        // because of an inline option like "(?i)", so both cases are
+        // allowed.  The other cases of a non-ASCII character might not
+        // start with the same byte, so those are not handled.
+        pcre2_pattern_info(this->p_code.in(), PCRE2_INFO_FIRSTCODEUNIT, &unit);
+        if (unit >= 0x80) {
+            return std::nullopt;
+        }
+
+        std::bitset<256> retval;
+        retval.set(unit);
+        retval.set(tolower(unit));
+        retval.set(toupper(unit));
+        return retval;
+    }
+
+    const uint8_t* bitmap = nullptr;
+
+    pcre2_pattern_info(this->p_code.in(), PCRE2_INFO_FIRSTBITMAP, &bitmap);
+    if (bitmap == nullptr) {
+        return std::nullopt;
+    }
+
+    std::bitset<256> retval;
+    for (size_t lpc = 0; lpc < 256; lpc++) {
+        if (bitmap[lpc / 8] & (1U << (lpc % 8))) {
+            retval.set(lpc);
+        }
+    }
+    return retval;
+}
+
+size_t
+code::get_min_length() const
+{
+    uint32_t retval = 0;
+
+    pcre2_pattern_info(this->p_code.in(), PCRE2_INFO_MINLENGTH, &retval);
+
+    return retval;
+}
+
 std::vector<string_fragment>
 code::get_captures() const
 {
@@ -267,6 +334,301 @@ code::get_captures() const
     return retval;
 }
 
+bool
+code::required_literal::is_present_in(string_fragment in) const
+{
+    if (this->rl_anchored) {
+        if ((size_t) in.length() < this->rl_text.size()) {
+            return false;
+        }
+        if (this->rl_caseless) {
+            return strncasecmp(
+                       in.data(), this->rl_text.data(), this->rl_text.size())
+                == 0;
+        }
+        return memcmp(in.data(), this->rl_text.data(), this->rl_text.size())
+            == 0;
+    }
+    if (!this->rl_caseless) {
+        return std::string_view{in.data(), (size_t) in.length()}.find(
+                   this->rl_text)
+            != std::string_view::npos;
+    }
+
+    const auto len = this->rl_text.size();
+    const auto first_lower = this->rl_text[0];
+    const auto first_upper = (char) toupper(first_lower);
+    const auto* curr = in.data();
+    const auto* end = in.data() + in.length();
+
+    while ((size_t) (end - curr) >= len) {
+        const auto* hit = (const char*) memchr(curr, first_lower, end - curr);
+        if (first_upper != first_lower) {
+            const auto* upper_hit
+                = (const char*) memchr(curr, first_upper, end - curr);
+            if (hit == nullptr || (upper_hit != nullptr && upper_hit < hit)) {
+                hit = upper_hit;
+            }
+        }
+        if (hit == nullptr || (size_t) (end - hit) < len) {
+            return false;
+        }
+        if (strncasecmp(hit, this->rl_text.data(), len) == 0) {
+            return true;
+        }
+        curr = hit + 1;
+    }
+
+    return false;
+}
+
+std::optional<code::required_literal>
+code::find_required_literal() const
+{
+    uint32_t options = 0;
+
+    pcre2_pattern_info(this->p_code.in(), PCRE2_INFO_ALLOPTIONS, &options);
+    if (options & (PCRE2_EXTENDED | PCRE2_EXTENDED_MORE)) {
+        return std::nullopt;
+    }
+
+    required_literal retval;
+    std::string curr;
+    bool curr_anchored = false;
+    const auto& pat = this->p_pattern;
+    size_t lpc = 0;
+    // The position of the first token after a leading '^', a run that
+    // starts there has to be at the start of the subject.
+    size_t anchor_end = std::string::npos;
+
+    retval.rl_caseless = (options & PCRE2_CASELESS) != 0;
+
+    auto end_run = [&]() {
+        if (curr.size() > retval.rl_text.size()) {
+            retval.rl_text = curr;
+            retval.rl_anchored = curr_anchored;
+        }
+        curr.clear();
+        curr_anchored = false;
+    };
+    // Check if a character can be part of the literal, see the default
+    // case below.
+    auto is_plain_char = [&](char ch) {
+        if (retval.rl_caseless && (options & PCRE2_UTF)
+            && (tolower(ch) == 'k' || tolower(ch) == 's'))
+        {
+            return false;
+        }
+        return (ch & 0x80) == 0;
+    };
+
+    if (options & PCRE2_LITERAL) {
+        for (auto ch : pat) {
+            if (!is_plain_char(ch)) {
+                end_run();
+                continue;
+            }
+            curr.push_back(retval.rl_caseless ? tolower(ch) : ch);
+        }
+        lpc = pat.size();
+    }
+    // Skip over a quantifier at the current position, if there is one.
+    auto skip_quantifier = [&]() {
+        if (lpc >= pat.size()) {
+            return false;
+        }
+        switch (pat[lpc]) {
+            case '*':
+            case '+':
+            case '?':
+                lpc += 1;
+                break;
+            case '{': {
+                auto close = pat.find('}', lpc);
+                if (close == std::string::npos
+                    || pat.find_first_not_of("0123456789, ", lpc + 1) != close
+                    || close == lpc + 1)
+                {
+                    return false;
+                }
+                lpc = close + 1;
+                break;
+            }
+            default:
+                return false;
+        }
+        // lazy or possessive suffix
+        if (lpc < pat.size() && (pat[lpc] == '?' || pat[lpc] == '+')) {
+            lpc += 1;
+        }
+        return true;
+    };
+    auto is_inline_option = [&](size_t paren) {
+        return paren + 2 < pat.size() && pat[paren + 1] == '?'
+            && strchr("imnsxJUar^-", pat[paren + 2]) != nullptr;
+    };
+    // Skip a bracketed character class that starts at the current position.
+    auto skip_class = [&]() {
+        lpc += 1;
+        if (lpc < pat.size() && pat[lpc] == '^') {
+            lpc += 1;
+        }
+        if (lpc < pat.size() && pat[lpc] == ']') {
+            lpc += 1;
+        }
+        while (lpc < pat.size() && pat[lpc] != ']') {
+            if (pat[lpc] == '\\') {
+                lpc += 1;
+            } else if (pat[lpc] == '[' && lpc + 1 < pat.size()
+                       && pat[lpc + 1] == ':')
+            {
+                auto close = pat.find(":]", lpc + 2);
+                if (close != std::string::npos) {
+                    lpc = close + 1;
+                }
+            }
+            lpc += 1;
+        }
+        lpc += 1;
+    };
+
+    if (!pat.empty() && pat[0] == '^' && !(options & PCRE2_MULTILINE)
+        && !(options & PCRE2_LITERAL))
+    {
+        anchor_end = 1;
+    }
+    while (lpc < pat.size()) {
+        const auto tok_start = lpc;
+        auto ch = pat[lpc];
+
+        switch (ch) {
+            case '|':
+                // An alternative at the top level means nothing is required.
+                return std::nullopt;
+            case '(': {
+                // The contents of groups might be optional, so skip them.
+                size_t depth = 0;
+
+                if (lpc + 1 < pat.size() && pat[lpc + 1] == '*') {
+                    return std::nullopt;
+                }
+                end_run();
+                while (lpc < pat.size()) {
+                    if (pat[lpc] == '\\') {
+                        if (lpc + 1 < pat.size() && pat[lpc + 1] == 'Q') {
+                            return std::nullopt;
+                        }
+                        lpc += 2;
+                        continue;
+                    }
+                    if (pat[lpc] == '[') {
+                        skip_class();
+                        continue;
+                    }
+                    if (pat[lpc] == '(') {
+                        if (is_inline_option(lpc)) {
+                            return std::nullopt;
+                        }
+                        depth += 1;
+                    } else if (pat[lpc] == ')') {
+                        depth -= 1;
+                        if (depth == 0) {
+                            lpc += 1;
+                            break;
+                        }
+                    }
+                    lpc += 1;
+                }
+                if (depth != 0) {
+                    return std::nullopt;
+                }
+                skip_quantifier();
+                break;
+            }
+            case '[':
+                end_run();
+                skip_class();
+                skip_quantifier();
+                break;
+            case '.':
+            case '^':
+            case '$':
+                end_run();
+                lpc += 1;
+                skip_quantifier();
+                break;
+            case '\\': {
+                if (lpc + 1 >= pat.size()) {
+                    return std::nullopt;
+                }
+                auto esc = pat[lpc + 1];
+                if (isalnum(esc)) {
+                    // Only accept escapes that do not take any arguments.
+                    if (strchr("dDwWsSbBhHvVRAzZGntrfea", esc) == nullptr) {
+                        return std::nullopt;
+                    }
+                    end_run();
+                    lpc += 2;
+                    skip_quantifier();
+                    break;
+                }
+                if (esc & 0x80) {
+                    return std::nullopt;
+                }
+                ch = esc;
+                lpc += 1;
+                [[fallthrough]];
+            }
+            default: {
+                if (retval.rl_caseless && (options & PCRE2_UTF)
+                    && (tolower(ch) == 'k' || tolower(ch) == 's'))
+                {
+                    // These also match the KELVIN SIGN and LONG S, so they
+                    // cannot be part of the literal.
+                    end_run();
+                    lpc += 1;
+                    skip_quantifier();
+                    break;
+                }
+                if (ch & 0x80) {
+                    // Quantifiers apply to the whole UTF-8 sequence, just
+                    // treat it as the end of the run.
+                    end_run();
+                    lpc += 1;
+                    while (lpc < pat.size() && (pat[lpc] & 0xc0) == 0x80) {
+                        lpc += 1;
+                    }
+                    skip_quantifier();
+                    break;
+                }
+                lpc += 1;
+                if (lpc < pat.size() && pat[lpc] != '+' && skip_quantifier())
+                {
+                    // The character is optional.
+                    end_run();
+                    break;
+                }
+                if (curr.empty()) {
+                    curr_anchored = tok_start == anchor_end;
+                }
+                curr.push_back(retval.rl_caseless ? tolower(ch) : ch);
+                if (skip_quantifier()) {
+                    end_run();
+                }
+                break;
+            }
+        }
+    }
+    end_run();
+
+    // PCRE2 already looks for a single required code unit.
+    if (retval.rl_text.size() < 2) {
+        return std::nullopt;
+    }
+
+    return retval;
+}
+
 std::string
 code::replace(string_fragment str, const char* repl) const
 {
@@ -32,6 +32,7 @@
 
 #define PCRE2_CODE_UNIT_WIDTH 8
 
+#include <bitset>
 #include <memory>
 #include <optional>
 #include <string>
@@ -316,6 +317,52 @@ public:
 
     size_t match_partial(string_fragment in) const;
 
+    /**
+     * A string that must appear in any subject that this pattern matches.
+     */
+    struct required_literal {
+        std::string rl_text;
+        /** True if the pattern is caseless and rl_text is lowercase. */
+        bool rl_caseless{false};
+        /** True if rl_text must appear at the start of the subject. */
+        bool rl_anchored{false};
+
+        bool is_present_in(string_fragment in) const;
+    };
+
+    const std::optional<required_literal>& get_required_literal() const
+    {
+        return this->p_required_literal;
+    }
+
+    /**
+     * Quickly check if the given subject could match this pattern.
+     *
+     * @return false if the subject is missing the required literal.
+     */
+    bool may_match(string_fragment in) const
+    {
+        return !this->p_required_literal
+            || this->p_required_literal->is_present_in(in);
+    }
+
+    /**
+     * @return True if the pattern can only match at the start of the
+     *   subject.
+     */
+    bool is_anchored() const;
+
+    /**
+     * @return The set of bytes that a match must start with or nullopt if
+     *   any byte can start a match.
+     */
+    std::optional<std::bitset<256>> get_first_bytes() const;
+
+    /**
+     * @return A lower bound on the length of a subject that can match.
+     */
+    size_t get_min_length() const;
+
     std::string replace(string_fragment str, const char* repl) const;
 
     std::shared_ptr<code> to_shared() &&
@@ -326,7 +373,8 @@ public:
 
     code(auto_mem<pcre2_code> code, std::string pattern)
         : p_code(std::move(code)), p_pattern(std::move(pattern)),
-          p_match_proto(this->create_match_data())
+          p_match_proto(this->create_match_data()),
+          p_required_literal(this->find_required_literal())
     {
     }
 
@@ -334,9 +382,12 @@ private:
     friend matcher;
     friend match_data;
 
+    std::optional<required_literal> find_required_literal() const;
+
     auto_mem<pcre2_code> p_code;
     std::string p_pattern;
     match_data p_match_proto;
+    std::optional<required_literal> p_required_literal;
 };
 
 template<typename T, std::size_t N>
@@ -268,3 +268,96 @@ TEST_CASE("anchored")
     CHECK_FALSE(re.find_in(sub2).ignore_error().has_value());
     CHECK_FALSE(re.find_in(sub3).ignore_error().has_value());
 }
+
+TEST_CASE("required_literal")
+{
+    static const std::vector<std::pair<const char*, const char*>> EXPECTED = {
+        {"abc", "abc"},
+        {"ab|cd", nullptr},
+        {"(?:ab|cd)efg", "efg"},
+        {"error: \\d+ failed!", " failed!"},
+        {"abcd?ef", "abc"},
+        {"ab+cde", "cde"},
+        {"x{2}yz", "yz"},
+        {"foo{bar", "foo{bar"},
+        {"[a-z]+\\.log", ".log"},
+        {"\\p{Lu}xyz", nullptr},
+        {"(?i)abc", nullptr},
+        {"\\Qabc\\E", nullptr},
+        {"a", nullptr},
+    };
+
+    for (const auto& pair : EXPECTED) {
+        auto re = lnav::pcre2pp::code::from(
+                      string_fragment::from_c_str(pair.first))
+                      .unwrap();
+        const auto& rl = re.get_required_literal();
+
+        INFO(std::string(pair.first));
+        if (pair.second == nullptr) {
+            CHECK_FALSE(rl.has_value());
+        } else {
+            REQUIRE(rl.has_value());
+            CHECK(rl->rl_text == pair.second);
+        }
+    }
+
+    auto re = lnav::pcre2pp::code::from_const("Warning: \\w+", PCRE2_CASELESS);
+
+    CHECK(re.get_required_literal()->rl_text == "warning: ");
+    CHECK(re.may_match(string_fragment::from_const("a WARNING: foo")));
+    CHECK_FALSE(re.may_match(string_fragment::from_const("an error: foo")));
+
+    auto anchored_re = lnav::pcre2pp::code::from_const("^\\[INFO\\] \\d+");
+
+    CHECK(anchored_re.get_required_literal()->rl_text == "[INFO] ");
+    CHECK(anchored_re.get_required_literal()->rl_anchored);
+    CHECK(anchored_re.may_match(string_fragment::from_const("[INFO] 1")));
+    CHECK_FALSE(
+        anchored_re.may_match(string_fragment::from_const("x [INFO] 1")));
+
+    auto unanchored_re = lnav::pcre2pp::code::from_const("^\\d+ \\[INFO\\]");
+
+    CHECK_FALSE(unanchored_re.get_required_literal()->rl_anchored);
+
+    auto literal_re = lnav::pcre2pp::code::from_const(
+        "Bad GATEWAY", PCRE2_LITERAL | PCRE2_CASELESS);
+
+    CHECK(literal_re.get_required_literal()->rl_text == "bad gateway");
+    auto literal_sub = string_fragment::from_const("a BAD gateway");
+    CHECK(literal_re.may_match(literal_sub));
+    CHECK(literal_re.find_in(literal_sub).ignore_error().has_value());
+}
+
+TEST_CASE("first_bytes")
+{
+    auto ts_re = lnav::pcre2pp::code::from_const(
+        "^(?<timestamp>\\d{4}-\\d{2}-\\d{2}) (?<body>.*)");
+
+    CHECK(ts_re.is_anchored());
+    CHECK(ts_re.get_min_length() == 11);
+    auto ts_first = ts_re.get_first_bytes();
+    REQUIRE(ts_first.has_value());
+    CHECK(ts_first->count() == 10);
+    CHECK(ts_first->test('0'));
+    CHECK_FALSE(ts_first->test('a'));
+
+    auto bracket_re
+        = lnav::pcre2pp::code::from_const("^\\[(\\w+)\\]", PCRE2_CASELESS);
+    auto bracket_first = bracket_re.get_first_bytes();
+    REQUIRE(bracket_first.has_value());
+    CHECK(bracket_first->count() == 1);
+    CHECK(bracket_first->test('['));
+
+    auto inline_re = lnav::pcre2pp::code::from_const("^(?i)error: (.*)");
+    auto inline_first = inline_re.get_first_bytes();
+    REQUIRE(inline_first.has_value());
+    CHECK(inline_first->count() == 2);
+    CHECK(inline_first->test('e'));
+    CHECK(inline_first->test('E'));
+
+    auto any_re = lnav::pcre2pp::code::from_const("foo|bar");
+
+    CHECK_FALSE(any_re.is_anchored());
+    CHECK(any_re.get_min_length() == 3);
+}
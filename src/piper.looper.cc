@@ -28,6 +28,8 @@
  */
 
 #include <chrono>
+#include <map>
+#include <set>
 #include <unordered_set>
 
 #include "piper.looper.hh"
@@ -39,6 +41,7 @@
 #include "base/date_time_scanner.hh"
 #include "base/fs_util.hh"
 #include "base/injector.hh"
+#include "base/lnav.gzip.hh"
 #include "base/time_util.hh"
 #include "config.h"
 #include "hasher.hh"
@@ -51,17 +54,95 @@
 using namespace std::chrono_literals;
 
 static ssize_t
-write_line_meta(int fd, struct timeval& tv, log_level_t level, off_t woff)
+write_line_meta(int fd,
+                size_t index,
+                const struct timeval& tv,
+                log_level_t level,
+                off_t woff)
 {
-    char time_str[64];
-    auto fmt_res = fmt::format_to_n(time_str,
-                                    sizeof(time_str),
-                                    FMT_STRING("{: 12}.{:06}:{};"),
-                                    tv.tv_sec,
-                                    tv.tv_usec,
-                                    level_names[level][0]);
-
-    return pwrite(fd, time_str, fmt_res.size, woff);
+    lnav::piper::line_meta lm;
+
+    lm.lm_offset = woff;
+    lm.lm_level = level;
+    lm.lm_usecs = tv.tv_sec * 1000000LL + tv.tv_usec;
+
+    return pwrite(fd, &lm, sizeof(lm), index * sizeof(lm));
+}
+
+/**
+ * Replace a capture file that is no longer being written to with a gzip
+ * file made up of independently compressed members.  The line_buffer can
+ * start decompressing at any member, so reads do not have to start from
+ * the beginning of the file.  The piper header is compressed along with
+ * the data so the offsets in the line metadata are still valid.
+ */
+static Result<void, std::string>
+compress_capture(const std::filesystem::path& path)
+{
+    static constexpr size_t BLOCK_SIZE = 512 * 1024;
+
+    auto tmp_path
+        = path.parent_path() / fmt::format(FMT_STRING("tmp.{}"), path.filename());
+    auto in_fd = TRY(lnav::filesystem::open_file(path, O_RDONLY | O_CLOEXEC));
+    auto out_fd = TRY(lnav::filesystem::create_file(
+        tmp_path, O_WRONLY | O_CLOEXEC | O_TRUNC, 0600));
+    auto block = auto_buffer::alloc(BLOCK_SIZE);
+    off_t in_off = 0;
+
+    while (true) {
+        auto rc = pread(in_fd, block.in(), block.capacity(), in_off);
+        if (rc < 0) {
+            auto err = fmt::format(FMT_STRING("unable to read {} -- {}"),
+                                   path,
+                                   strerror(errno));
+            std::filesystem::remove(tmp_path);
+            return Err(err);
+        }
+        if (rc == 0) {
+            break;
+        }
+        in_off += rc;
+
+        auto comp_res = lnav::gzip::compress(block.in(), rc);
+        if (comp_res.isErr()) {
+            std::filesystem::remove(tmp_path);
+            return Err(comp_res.unwrapErr());
+        }
+        auto comp = comp_res.unwrap();
+        if (write(out_fd, comp.in(), comp.size()) != (ssize_t) comp.size()) {
+            auto err = fmt::format(FMT_STRING("unable to write {} -- {}"),
+                                   tmp_path,
+                                   strerror(errno));
+            std::filesystem::remove(tmp_path);
+            return Err(err);
+        }
+    }
+
+    std::error_code ec;
+    std::filesystem::rename(tmp_path, path, ec);
+    if (ec) {
+        std::filesystem::remove(tmp_path);
+        return Err(fmt::format(
+            FMT_STRING("unable to rename {} -- {}"), tmp_path, ec.message()));
+    }
+
+    log_info("compressed capture file: %s (%lld -> %lld)",
+             path.c_str(),
+             (long long) in_off,
+             (long long) std::filesystem::file_size(path, ec));
+    return Ok();
+}
+
+/**
+ * The output directories of the loopers in this process, so that cleanup()
+ * does not remove a capture that is still being written.
+ */
+static safe::Safe<std::set<std::filesystem::path>>&
+live_out_dirs()
+{
+    static safe::Safe<std::set<std::filesystem::path>> retval;
+
+    return retval;
 }
 
 extern char** environ;
@@ -159,6 +240,8 @@ const typed_json_path_container<lnav::piper::header> header_handlers = {
         .with_enum_values(demux_output_values)
         .for_field(&lnav::piper::header::h_demux_output),
     yajlpp::property_handler("demux_meta").with_children(header_demux_handlers),
+    yajlpp::property_handler("line_meta").for_field(
+        &lnav::piper::header::h_line_meta),
 };
 
 static std::map<std::string, std::string>
@@ -213,6 +296,7 @@ looper::looper(std::string name,
         count += 1;
     } while (std::filesystem::exists(this->l_out_dir));
     std::filesystem::create_directories(this->l_out_dir);
+    live_out_dirs().writeAccess()->emplace(this->l_out_dir);
     this->l_future = std::async(std::launch::async, [this]() { this->loop(); });
 }
 
@@ -224,6 +308,7 @@ looper::~looper()
     this->l_looping = false;
     log_perror(write(get_wakeup_pipe().write_end(), &ch, 1));
     this->l_future.wait();
+    live_out_dirs().writeAccess()->erase(this->l_out_dir);
 }
 
 enum class read_mode_t {
@@ -259,8 +344,12 @@ looper::loop()
     } captured_fds[2];
     struct out_state {
         auto_fd os_fd;
+        auto_fd os_meta_fd;
+        std::filesystem::path os_path;
         off_t os_woff{0};
         off_t os_last_woff{0};
+        size_t os_meta_count{0};
+        size_t os_last_meta_count{0};
         std::string os_hash_id;
         std::optional<log_level_t> os_level;
     };
@@ -269,6 +358,9 @@ looper::loop()
                               frag_hasher,
                               std::equal_to<string_fragment>>
         outfds;
+    // Rotated files are compressed in the background, the futures are
+    // waited on before a path is reused and when the loop exits.
+    std::map<std::filesystem::path, std::future<void>> compressions;
     size_t rotate_count = 0;
     std::optional<demux_def> curr_demux_def;
     auto md = lnav::pcre2pp::match_data::unitialized();
@@ -577,13 +669,29 @@ looper::loop()
                         this->l_name.c_str(),
                         os.os_woff);
                     os.os_fd.reset();
+                    os.os_meta_fd.reset();
+                    if (cfg.c_compress) {
+                        compressions[os.os_path] = std::async(
+                            std::launch::async,
+                            [name = this->l_name, path = os.os_path]() {
+                                auto comp_res = compress_capture(path);
+                                if (comp_res.isErr()) {
+                                    log_error(
+                                        "unable to compress capture file: %s "
+                                        "-- %s",
+                                        name.c_str(),
+                                        comp_res.unwrapErr().c_str());
+                                }
+                            });
+                    }
                 }
 
                 if (!os.os_fd.has_value()) {
+                    const auto rotation = rotate_count % cfg.c_rotations;
                     auto tmp_path = this->l_out_dir
                         / fmt::format(FMT_STRING("tmp.{}.{}"),
                                       os.os_hash_id,
-                                      rotate_count % cfg.c_rotations);
+                                      rotation);
                     log_info("creating capturing file: %s (mux_id: %.*s) -- %s",
                              this->l_name.c_str(),
                              line_muxid_sf.length(),
@@ -598,7 +706,22 @@ looper::loop()
                         break;
                     }
 
+                    auto meta_name = fmt::format(
+                        FMT_STRING("meta.{}.{}"), os.os_hash_id, rotation);
+                    auto meta_tmp_path = this->l_out_dir
+                        / fmt::format(FMT_STRING("tmp.{}"), meta_name);
+                    auto meta_res = lnav::filesystem::create_file(
+                        meta_tmp_path, O_WRONLY | O_CLOEXEC | O_TRUNC, 0600);
+                    if (meta_res.isErr()) {
+                        log_error("unable to open line metadata file: %s -- %s",
+                                  this->l_name.c_str(),
+                                  meta_res.unwrapErr().c_str());
+                        break;
+                    }
+
                     os.os_fd = create_res.unwrap();
+                    os.os_meta_fd = meta_res.unwrap();
+                    os.os_meta_count = 0;
                     rotate_count += 1;
 
                     auto hdr = header{
@@ -611,6 +734,7 @@ looper::loop()
                         demux_output,
                     };
                     hdr.h_demux_output = demux_output;
+                    hdr.h_line_meta = meta_name;
                     if (!line_muxid_sf.empty()) {
                         hdr.h_name = fmt::format(
                             FMT_STRING("{}/{}"), hdr.h_name, line_muxid_sf);
@@ -663,13 +787,24 @@ looper::loop()
                     auto out_path = this->l_out_dir
                         / fmt::format(FMT_STRING("out.{}.{}"),
                                       os.os_hash_id,
-                                      rotate_count % cfg.c_rotations);
+                                      rotation);
+                    auto comp_iter = compressions.find(out_path);
+                    if (comp_iter != compressions.end()) {
+                        comp_iter->second.wait();
+                        compressions.erase(comp_iter);
+                    }
+                    // The metadata is moved into place first so that the
+                    // new file is never paired with the old metadata.
+                    std::filesystem::rename(meta_tmp_path,
+                                            this->l_out_dir / meta_name);
                     std::filesystem::rename(tmp_path, out_path);
+                    os.os_path = out_path;
                 }
 
                 ssize_t wrc;
 
                 os.os_last_woff = os.os_woff;
+                os.os_last_meta_count = os.os_meta_count;
                 if (!ts_sf.empty()
                     && dts.scan(ts_sf.data(),
                                 ts_sf.length(),
@@ -681,7 +816,10 @@ looper::loop()
                 } else {
                     gettimeofday(&line_tv, nullptr);
                 }
-                wrc = write_line_meta(os.os_fd.get(),
+                // The metadata is written before the line so that it is
+                // available by the time the line is read.
+                wrc = write_line_meta(os.os_meta_fd.get(),
+                                      os.os_meta_count,
                                       line_tv,
                                       os.os_level.value_or(cap.cf_level),
                                       os.os_woff);
@@ -692,7 +830,7 @@ looper::loop()
                     this->l_looping = false;
                     break;
                 }
-                os.os_woff += wrc;
+                os.os_meta_count += 1;
 
                 /* Need to do pwrite here since the fd is used by the main
                  * lnav process as well.
@@ -726,6 +864,7 @@ looper::loop()
                     && (cap.last_range.next_offset() != cap.lb.get_file_size()))
                 {
                     os.os_woff = os.os_last_woff;
+                    os.os_meta_count = os.os_last_meta_count;
                 }
             }
         }
@@ -780,6 +919,67 @@ cleanup()
             }
         }
 
+        if (cfg.c_max_total_size > 0) {
+            const auto live_dirs = *live_out_dirs().readAccess();
+            std::vector<std::pair<std::filesystem::file_time_type,
+                                  std::filesystem::path>>
+                by_age;
+            std::map<std::filesystem::path, uintmax_t> sizes;
+            std::set<std::filesystem::path> keep;
+
+            for (const auto& cache_subdir :
+                 std::filesystem::directory_iterator(cache_path))
+            {
+                if (std::find(
+                        to_remove.begin(), to_remove.end(), cache_subdir.path())
+                    != to_remove.end())
+                {
+                    continue;
+                }
+
+                auto newest = std::filesystem::file_time_type::min();
+                uintmax_t size = 0;
+                for (const auto& entry :
+                     std::filesystem::directory_iterator(cache_subdir))
+                {
+                    std::error_code ec;
+
+                    newest = std::max(newest, entry.last_write_time(ec));
+                    if (entry.is_regular_file(ec)) {
+                        size += entry.file_size(ec);
+                    }
+                }
+                by_age.emplace_back(newest, cache_subdir.path());
+                sizes[cache_subdir.path()] = size;
+                // Captures that are still being written to by this or
+                // another process count towards the total, but are left
+                // alone.
+                if (live_dirs.count(cache_subdir.path()) > 0
+                    || now < newest + cfg.c_ttl)
+                {
+                    keep.emplace(cache_subdir.path());
+                }
+            }
+
+            // Keep the newest captures that fit within the limit, but
+            // always keep the most recent one since it might still be
+            // in use.
+            std::sort(by_age.begin(), by_age.end(), std::greater<>());
+            uintmax_t total_size = 0;
+            for (size_t lpc = 0; lpc < by_age.size(); lpc++) {
+                const auto& path = by_age[lpc].second;
+
+                total_size += sizes[path];
+                if (lpc > 0 && total_size > cfg.c_max_total_size
+                    && keep.count(path) == 0)
+                {
+                    log_info("piper captures exceed max-total-size: %s",
+                             path.c_str());
+                    to_remove.emplace_back(path);
+                }
+            }
+        }
+
         for (auto& entry : to_remove) {
             log_info("removing piper directory: %s", entry.c_str());
             std::filesystem::remove_all(entry);
@@ -55,6 +55,8 @@ struct demux_def {
 struct config {
     uint64_t c_max_size{10ULL * 1024ULL * 1024ULL};
     uint32_t c_rotations{4};
+    bool c_compress{true};
+    uint64_t c_max_total_size{1024ULL * 1024ULL * 1024ULL};
     std::chrono::seconds c_ttl{std::chrono::hours(48)};
 
     std::map<std::string, demux_def> c_demux_definitions;
@@ -29,6 +29,8 @@
 
 #include <algorithm>
 
+#include <errno.h>
+
 #include "pollable.hh"
 
 #include "base/itertools.hh"
@@ -105,6 +107,83 @@ pollable_supervisor::count(pollable::category cat)
     return retval;
 }
 
+int
+pollable_supervisor::poll(std::vector<pollfd>& pollfds,
+                          std::chrono::milliseconds timeout)
+{
+    this->ps_main_state.release();
+    auto retval = ::poll(pollfds.data(), pollfds.size(), timeout.count());
+    auto poll_errno = errno;
+    this->ps_main_state.reacquire();
+    errno = poll_errno;
+
+    return retval;
+}
+
+void
+main_state_lock::release()
+{
+    std::lock_guard<std::mutex> lg(this->msl_mutex);
+
+    this->msl_main_active = false;
+    this->msl_release_turns = this->msl_turns;
+    this->msl_release_waiting = this->msl_waiting;
+    this->msl_cond.notify_all();
+}
+
+void
+main_state_lock::reacquire()
+{
+    std::unique_lock<std::mutex> lk(this->msl_mutex);
+
+    this->msl_cond.wait(lk, [this]() {
+        if (this->msl_background_active) {
+            return false;
+        }
+        return this->msl_release_waiting == 0 || this->msl_waiting == 0
+            || this->msl_turns != this->msl_release_turns;
+    });
+    this->msl_main_active = true;
+}
+
+bool
+main_state_lock::lock(const std::atomic<bool>& stop)
+{
+    std::unique_lock<std::mutex> lk(this->msl_mutex);
+
+    this->msl_waiting += 1;
+    this->msl_cond.wait(lk, [this, &stop]() {
+        return stop.load()
+            || (!this->msl_main_active && !this->msl_background_active);
+    });
+    this->msl_waiting -= 1;
+    if (stop.load()) {
+        this->msl_cond.notify_all();
+        return false;
+    }
+    this->msl_background_active = true;
+    this->msl_turns += 1;
+
+    return true;
+}
+
+void
+main_state_lock::unlock()
+{
+    std::lock_guard<std::mutex> lg(this->msl_mutex);
+
+    this->msl_background_active = false;
+    this->msl_cond.notify_all();
+}
+
+void
+main_state_lock::notify()
+{
+    std::lock_guard<std::mutex> lg(this->msl_mutex);
+
+    this->msl_cond.notify_all();
+}
+
 short
 pollfd_revents(const std::vector<struct pollfd>& pollfds, int fd)
 {
@@ -30,7 +30,11 @@
 #ifndef lnav_pollable_hh
 #define lnav_pollable_hh
 
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
 #include <memory>
+#include <mutex>
 #include <vector>
 
 #include <poll.h>
@@ -58,11 +62,57 @@ public:
 
     virtual void check_poll_set(const std::vector<pollfd>& pollfds) = 0;
 
+protected:
+    pollable_supervisor& get_supervisor() { return *this->p_supervisor; }
+
 private:
     std::shared_ptr<pollable_supervisor> p_supervisor;
     const category p_category;
 };
 
+/**
+ * Hands off access to state that is owned by the main thread, like the text
+ * sources, to background threads.  The main thread holds the lock at all
+ * times, except while it is waiting in pollable_supervisor::poll().
+ */
+class main_state_lock {
+public:
+    /** Called by the main thread before it blocks. */
+    void release();
+
+    /**
+     * Called by the main thread after it unblocks.  If a background thread
+     * was waiting when the lock was released, this waits until it has had a
+     * turn so that it is not starved by a busy main loop.
+     */
+    void reacquire();
+
+    /**
+     * Called by a background thread to get exclusive access to the main
+     * thread's state.
+     *
+     * @param stop A flag that is checked while waiting.
+     * @return False if the stop flag was set before access was granted.
+     */
+    bool lock(const std::atomic<bool>& stop);
+
+    /** Called by a background thread when it is done with its turn. */
+    void unlock();
+
+    /** Wake up the threads waiting in lock() so they check their flags. */
+    void notify();
+
+private:
+    std::mutex msl_mutex;
+    std::condition_variable msl_cond;
+    bool msl_main_active{true};
+    bool msl_background_active{false};
+    size_t msl_waiting{0};
+    size_t msl_turns{0};
+    size_t msl_release_turns{0};
+    size_t msl_release_waiting{0};
+};
+
 class pollable_supervisor : public bus<pollable> {
 public:
     struct update_result {
@@ -75,6 +125,19 @@ public:
     void check_poll_set(const std::vector<pollfd>& pollfds);
 
     size_t count(pollable::category cat);
+
+    /**
+     * Wait for events on the given file descriptors while letting background
+     * threads access the main thread's state.
+     *
+     * @return The result of poll(2).
+     */
+    int poll(std::vector<pollfd>& pollfds, std::chrono::milliseconds timeout);
+
+    main_state_lock& get_main_state_lock() { return this->ps_main_state; }
+
+private:
+    main_state_lock ps_main_state;
 };
 
 short pollfd_revents(const std::vector<pollfd>& pollfds, int fd);
@@ -188,89 +188,114 @@ log_spectro_value_source::spectro_bounds(spectrogram_bounds& sb_out)
 }
 
 void
-log_spectro_value_source::spectro_row(spectrogram_request& sr,
-                                      spectrogram_row& row_out)
+log_spectro_value_source::update_summary()
 {
     auto& lss = lnav_data.ld_log_source;
-    auto begin_line
-        = lss.find_from_time(timeval{to_time_t(sr.sr_begin_time), 0})
-              .value_or(0_vl);
-    auto end_line = lss.find_from_time(timeval{to_time_t(sr.sr_end_time), 0})
-                        .value_or(vis_line_t(lss.text_line_count()));
+    auto line_count = vis_line_t(lss.text_line_count());
 
-    for (const auto& msg_info : lss.window_at(begin_line, end_line)) {
-        const auto& ll = msg_info.get_logline();
-        if (ll.get_time<std::chrono::microseconds>() >= sr.sr_end_time) {
-            break;
+    if (this->lsvs_index_generation != lss.lss_index_generation
+        || line_count < this->lsvs_summarized_lines)
+    {
+        this->lsvs_summary.clear();
+        this->lsvs_summarized_lines = 0_vl;
+        this->lsvs_index_generation = lss.lss_index_generation;
+    }
+
+    if (this->lsvs_summarized_lines >= line_count) {
+        return;
+    }
+
+    // A window that starts in the middle of a message will include the
+    // start of that message, which has already been summarized.
+    auto skip_first = this->lsvs_summarized_lines > 0_vl
+        && !lss.find_line(lss.at(this->lsvs_summarized_lines))->is_message();
+    for (const auto& msg_info :
+         lss.window_at(this->lsvs_summarized_lines, line_count))
+    {
+        if (skip_first) {
+            skip_first = false;
+            continue;
         }
 
+        const auto& ll = msg_info.get_logline();
         const auto& values = msg_info.get_values();
         auto lv_iter = find_if(values.lvv_values.begin(),
                                values.lvv_values.end(),
                                logline_value_cmp(&this->lsvs_colname));
 
-        if (lv_iter != values.lvv_values.end()) {
-            switch (lv_iter->lv_meta.lvm_kind) {
-                case value_kind_t::VALUE_FLOAT:
-                    row_out.add_value(sr, lv_iter->lv_value.d, ll.is_marked());
-                    break;
-                case value_kind_t::VALUE_INTEGER: {
-                    row_out.add_value(sr, lv_iter->lv_value.i, ll.is_marked());
-                    break;
-                }
-                default:
-                    break;
-            }
+        if (lv_iter == values.lvv_values.end()) {
+            continue;
+        }
+
+        switch (lv_iter->lv_meta.lvm_kind) {
+            case value_kind_t::VALUE_FLOAT:
+                this->lsvs_summary.add(
+                    ll.get_time<std::chrono::microseconds>(),
+                    lv_iter->lv_value.d,
+                    msg_info.get_vis_line());
+                break;
+            case value_kind_t::VALUE_INTEGER:
+                this->lsvs_summary.add(
+                    ll.get_time<std::chrono::microseconds>(),
+                    lv_iter->lv_value.i,
+                    msg_info.get_vis_line());
+                break;
+            default:
+                break;
         }
     }
+    this->lsvs_summary.sort();
+    this->lsvs_summarized_lines = line_count;
+}
+
+static void
+add_row_quantiles(const lnav::spectro::time_series_summary& summary,
+                  const spectrogram_request& sr,
+                  spectrogram_row& row_out)
+{
+    auto bs = summary.summarize(sr.sr_begin_time, sr.sr_end_time);
+
+    row_out.sr_p50 = bs.bs_sketch.quantile(0.5) | [&bs](auto value) {
+        return std::make_optional(std::clamp(value, bs.bs_min, bs.bs_max));
+    };
+    row_out.sr_p99 = bs.bs_sketch.quantile(0.99) | [&bs](auto value) {
+        return std::make_optional(std::clamp(value, bs.bs_min, bs.bs_max));
+    };
+}
+
+void
+log_spectro_value_source::spectro_row(spectrogram_request& sr,
+                                      spectrogram_row& row_out)
+{
+    auto& lss = lnav_data.ld_log_source;
+
+    this->update_summary();
+
+    auto range = this->lsvs_summary.samples_in(sr.sr_begin_time,
+                                               sr.sr_end_time);
+    for (auto iter = range.first; iter != range.second; ++iter) {
+        const auto* ll = lss.find_line(lss.at(vis_line_t(iter->s_ref)));
+
+        row_out.add_value(sr, iter->s_value, ll->is_marked());
+    }
+    add_row_quantiles(this->lsvs_summary, sr, row_out);
 
     row_out.sr_details_source_provider = [this](const spectrogram_request& sr,
                                                 double range_min,
                                                 double range_max) {
         auto& lss = lnav_data.ld_log_source;
         auto retval = std::make_unique<filtered_sub_source>();
-        auto begin_line
-            = lss.find_from_time(timeval{to_time_t(sr.sr_begin_time), 0})
-                  .value_or(0_vl);
-        auto end_line
-            = lss.find_from_time(timeval{to_time_t(sr.sr_end_time), 0})
-                  .value_or(vis_line_t(lss.text_line_count()));
 
         retval->fss_delegate = &lss;
         retval->fss_time_delegate = &lss;
         retval->fss_overlay_delegate = nullptr;
-        for (const auto& msg_info : lss.window_at(begin_line, end_line)) {
-            const auto& ll = msg_info.get_logline();
-            if (ll.get_time<std::chrono::microseconds>() >= sr.sr_end_time) {
-                break;
-            }
 
-            const auto& values = msg_info.get_values();
-            auto lv_iter = find_if(values.lvv_values.begin(),
-                                   values.lvv_values.end(),
-                                   logline_value_cmp(&this->lsvs_colname));
-
-            if (lv_iter != values.lvv_values.end()) {
-                switch (lv_iter->lv_meta.lvm_kind) {
-                    case value_kind_t::VALUE_FLOAT:
-                        if (range_min <= lv_iter->lv_value.d
-                            && lv_iter->lv_value.d < range_max)
-                        {
-                            retval->fss_lines.emplace_back(
-                                msg_info.get_vis_line());
-                        }
-                        break;
-                    case value_kind_t::VALUE_INTEGER:
-                        if (range_min <= lv_iter->lv_value.i
-                            && lv_iter->lv_value.i < range_max)
-                        {
-                            retval->fss_lines.emplace_back(
-                                msg_info.get_vis_line());
-                        }
-                        break;
-                    default:
-                        break;
-                }
+        this->update_summary();
+        auto range = this->lsvs_summary.samples_in(sr.sr_begin_time,
+                                                   sr.sr_end_time);
+        for (auto iter = range.first; iter != range.second; ++iter) {
+            if (range_min <= iter->s_value && iter->s_value < range_max) {
+                retval->fss_lines.emplace_back(iter->s_ref);
             }
         }
 
@@ -443,7 +468,7 @@ db_spectro_value_source::update_stats()
         return;
     }
 
-    if (dls.dls_rows.empty()) {
+    if (dls.dls_rows.row_count() == 0) {
         this->dsvs_error_msg
             = lnav::console::user_message::error(
                   "Cannot generate spectrogram for database results")
@@ -466,7 +491,7 @@ db_spectro_value_source::update_stats()
         this->dsvs_stats.lvs_max_value = bs.bs_max_value;
     }
 
-    this->dsvs_stats.lvs_count = dls.dls_rows.size();
+    this->dsvs_stats.lvs_count = dls.dls_rows.row_count();
 }
 
 void
@@ -488,23 +513,74 @@ db_spectro_value_source::spectro_bounds(spectrogram_bounds& sb_out)
 }
 
 void
-db_spectro_value_source::spectro_row(spectrogram_request& sr,
-                                     spectrogram_row& row_out)
+db_spectro_value_source::update_summary()
 {
     auto& dls = lnav_data.ld_db_row_source;
-    auto begin_row
-        = dls.row_for_time({to_time_t(sr.sr_begin_time), 0}).value_or(0_vl);
-    auto end_row = dls.row_for_time({to_time_t(sr.sr_end_time), 0})
-                       .value_or(vis_line_t(dls.dls_rows.size()));
 
-    for (auto lpc = begin_row; lpc < end_row; ++lpc) {
-        auto scan_res = scn::scan_value<double>(std::string_view{
-            dls.dls_rows[lpc][this->dsvs_column_index.value()]});
+    if (this->dsvs_generation != dls.dls_generation
+        || dls.dls_rows.row_count() < this->dsvs_summarized_rows)
+    {
+        this->dsvs_summary.clear();
+        this->dsvs_summarized_rows = 0;
+        this->dsvs_generation = dls.dls_generation;
+    }
+
+    if (!this->dsvs_column_index
+        || dls.dls_time_column.size() < dls.dls_rows.row_count())
+    {
+        return;
+    }
+
+    auto col = this->dsvs_column_index.value();
+    std::string text_buffer;
+    for (auto lpc = this->dsvs_summarized_rows;
+         lpc < dls.dls_rows.row_count();
+         lpc++)
+    {
+        std::optional<double> value;
 
-        if (scan_res) {
-            row_out.add_value(sr, scan_res->value(), false);
+        switch (dls.dls_rows.get_type(lpc, col)) {
+            case db_column_store::cell_type::integer:
+                value = dls.dls_rows.get_integer(lpc, col);
+                break;
+            case db_column_store::cell_type::real:
+                value = dls.dls_rows.get_real(lpc, col);
+                break;
+            case db_column_store::cell_type::text: {
+                auto scan_res = scn::scan_value<double>(
+                    dls.dls_rows.get_text(lpc, col, text_buffer)
+                        .to_string_view());
+
+                if (scan_res) {
+                    value = scan_res->value();
+                }
+                break;
+            }
+            case db_column_store::cell_type::null:
+                break;
+        }
+
+        if (value) {
+            this->dsvs_summary.add(
+                to_us(dls.dls_time_column[lpc]), value.value(), lpc);
         }
     }
+    this->dsvs_summary.sort();
+    this->dsvs_summarized_rows = dls.dls_rows.row_count();
+}
+
+void
+db_spectro_value_source::spectro_row(spectrogram_request& sr,
+                                     spectrogram_row& row_out)
+{
+    this->update_summary();
+
+    auto range
+        = this->dsvs_summary.samples_in(sr.sr_begin_time, sr.sr_end_time);
+    for (auto iter = range.first; iter != range.second; ++iter) {
+        row_out.add_value(sr, iter->s_value, false);
+    }
+    add_row_quantiles(this->dsvs_summary, sr, row_out);
 
     row_out.sr_details_source_provider = [this](const spectrogram_request& sr,
                                                 double range_min,
@@ -515,22 +591,13 @@ db_spectro_value_source::spectro_row(spectrogram_request& sr,
         retval->fss_delegate = &dls;
         retval->fss_time_delegate = &dls;
         retval->fss_overlay_delegate = &lnav_data.ld_db_overlay;
-        auto begin_row
-            = dls.row_for_time({to_time_t(sr.sr_begin_time), 0}).value_or(0_vl);
-        auto end_row = dls.row_for_time({to_time_t(sr.sr_end_time), 0})
-                           .value_or(vis_line_t(dls.dls_rows.size()));
-
-        for (auto lpc = begin_row; lpc < end_row; ++lpc) {
-            auto scan_res = scn::scan_value<double>(std::string_view{
-                dls.dls_rows[lpc][this->dsvs_column_index.value()]});
-            if (!scan_res) {
-                continue;
-            }
-            auto value = scan_res->value();
-            if ((range_min == value)
-                || (range_min < value && value < range_max))
-            {
-                retval->fss_lines.emplace_back(lpc);
+
+        this->update_summary();
+        auto range
+            = this->dsvs_summary.samples_in(sr.sr_begin_time, sr.sr_end_time);
+        for (auto iter = range.first; iter != range.second; ++iter) {
+            if (range_min <= iter->s_value && iter->s_value < range_max) {
+                retval->fss_lines.emplace_back(iter->s_ref);
             }
         }
 
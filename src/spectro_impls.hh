@@ -32,6 +32,7 @@
 
 #include "log_format.hh"
 #include "spectro_source.hh"
+#include "spectro_summary.hh"
 
 class log_spectro_value_source : public spectrogram_value_source {
 public:
@@ -50,11 +51,20 @@ public:
                       double range_min,
                       double range_max) override;
 
+    /**
+     * Add the values from any lines that were indexed since the last call
+     * to the summary or start over if the index was rebuilt.
+     */
+    void update_summary();
+
     intern_string_t lsvs_colname;
     logline_value_stats lsvs_stats;
     std::chrono::microseconds lsvs_begin_time{0};
     std::chrono::microseconds lsvs_end_time{0};
     bool lsvs_found{false};
+    lnav::spectro::time_series_summary lsvs_summary;
+    std::optional<uint32_t> lsvs_index_generation;
+    vis_line_t lsvs_summarized_lines{0};
 };
 
 class db_spectro_value_source : public spectrogram_value_source {
@@ -76,12 +86,17 @@ public:
     {
     }
 
+    void update_summary();
+
     std::string dsvs_colname;
     logline_value_stats dsvs_stats;
     std::chrono::microseconds dsvs_begin_time{0};
     std::chrono::microseconds dsvs_end_time{0};
     std::optional<size_t> dsvs_column_index;
     std::optional<lnav::console::user_message> dsvs_error_msg;
+    lnav::spectro::time_series_summary dsvs_summary;
+    std::optional<uint32_t> dsvs_generation;
+    size_t dsvs_summarized_rows{0};
 };
 
 #endif
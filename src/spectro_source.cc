@@ -251,6 +251,17 @@ spectrogram_source::list_value_for_overlay(const listview_curses& lv,
                   .append(lnav::roles::number(
                       fmt::format(FMT_STRING("{:.2Lf}"), range_max)))
                   .append(" ");
+        if (s_row.sr_p50 && s_row.sr_p99) {
+            // The percentiles are for all of the values in the row, not
+            // just the ones in the selected range.
+            desc.append("(row p50 ")
+                .append(lnav::roles::number(
+                    fmt::format(FMT_STRING("{:.2Lf}"), s_row.sr_p50.value())))
+                .append(", p99 ")
+                .append(lnav::roles::number(
+                    fmt::format(FMT_STRING("{:.2Lf}"), s_row.sr_p99.value())))
+                .append(") ");
+        }
         auto mark_offset = this->ss_cursor_column.value();
         auto mark_is_before = true;
 
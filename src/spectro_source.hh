@@ -78,6 +78,9 @@ struct spectrogram_row {
     std::vector<row_bucket> sr_values;
     unsigned long sr_width{0};
     double sr_column_size{0.0};
+    /** Estimates of the median and 99th percentile values in the row. */
+    std::optional<double> sr_p50;
+    std::optional<double> sr_p99;
     std::function<std::unique_ptr<text_sub_source>(
         const spectrogram_request&, double range_min, double range_max)>
         sr_details_source_provider;
@@ -0,0 +1,360 @@
+/**
+ * Copyright (c) 2026, Timothy Stack
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ * * Neither the name of Timothy Stack nor the names of its contributors
+ * may be used to endorse or promote products derived from this software
+ * without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE REGENTS AND CONTRIBUTORS ''AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <algorithm>
+#include <cmath>
+
+#include "spectro_summary.hh"
+
+#include "base/lnav_log.hh"
+#include "config.h"
+
+namespace lnav::spectro {
+
+namespace {
+
+/** Values with a smaller magnitude than this are counted as zero. */
+constexpr double MIN_INDEXABLE_VALUE = 1e-9;
+
+}  // namespace
+
+quantile_sketch::quantile_sketch(double relative_accuracy)
+    : qs_gamma((1.0 + relative_accuracy) / (1.0 - relative_accuracy)),
+      qs_log_gamma(std::log(this->qs_gamma))
+{
+}
+
+int32_t
+quantile_sketch::key_for(double value) const
+{
+    return static_cast<int32_t>(
+        std::ceil(std::log(value) / this->qs_log_gamma));
+}
+
+double
+quantile_sketch::value_for(int32_t key) const
+{
+    return 2.0 * std::pow(this->qs_gamma, key) / (this->qs_gamma + 1.0);
+}
+
+void
+quantile_sketch::add_to_bins(std::vector<bin_t>& bins,
+                             int32_t key,
+                             uint64_t count)
+{
+    auto iter = std::lower_bound(
+        bins.begin(), bins.end(), key, [](const bin_t& bin, int32_t k) {
+            return bin.first < k;
+        });
+
+    if (iter != bins.end() && iter->first == key) {
+        iter->second += count;
+    } else {
+        bins.emplace(iter, key, count);
+    }
+}
+
+void
+quantile_sketch::merge_bins(std::vector<bin_t>& lhs,
+                            const std::vector<bin_t>& rhs)
+{
+    if (rhs.empty()) {
+        return;
+    }
+    if (lhs.empty()) {
+        lhs = rhs;
+        return;
+    }
+
+    std::vector<bin_t> merged;
+    auto lhs_iter = lhs.begin();
+    auto rhs_iter = rhs.begin();
+
+    merged.reserve(lhs.size() + rhs.size());
+    while (lhs_iter != lhs.end() || rhs_iter != rhs.end()) {
+        if (rhs_iter == rhs.end()
+            || (lhs_iter != lhs.end() && lhs_iter->first < rhs_iter->first))
+        {
+            merged.emplace_back(*lhs_iter);
+            ++lhs_iter;
+        } else if (lhs_iter == lhs.end() || rhs_iter->first < lhs_iter->first)
+        {
+            merged.emplace_back(*rhs_iter);
+            ++rhs_iter;
+        } else {
+            merged.emplace_back(lhs_iter->first,
+                                lhs_iter->second + rhs_iter->second);
+            ++lhs_iter;
+            ++rhs_iter;
+        }
+    }
+    lhs = std::move(merged);
+}
+
+void
+quantile_sketch::add(double value, uint64_t count)
+{
+    if (std::isnan(value) || count == 0) {
+        return;
+    }
+
+    if (value > MIN_INDEXABLE_VALUE) {
+        add_to_bins(this->qs_positive, this->key_for(value), count);
+    } else if (value < -MIN_INDEXABLE_VALUE) {
+        add_to_bins(this->qs_negative, this->key_for(-value), count);
+    } else {
+        this->qs_zero_count += count;
+    }
+    this->qs_count += count;
+}
+
+void
+quantile_sketch::merge(const quantile_sketch& rhs)
+{
+    merge_bins(this->qs_positive, rhs.qs_positive);
+    merge_bins(this->qs_negative, rhs.qs_negative);
+    this->qs_zero_count += rhs.qs_zero_count;
+    this->qs_count += rhs.qs_count;
+}
+
+std::optional<double>
+quantile_sketch::quantile(double q) const
+{
+    if (this->qs_count == 0 || q < 0.0 || q > 1.0) {
+        return std::nullopt;
+    }
+
+    const auto rank = q * (double) (this->qs_count - 1);
+    uint64_t seen = 0;
+
+    // The negative bins hold magnitudes, so the most negative values are
+    // at the end.
+    for (auto iter = this->qs_negative.rbegin();
+         iter != this->qs_negative.rend();
+         ++iter)
+    {
+        seen += iter->second;
+        if ((double) seen > rank) {
+            return -this->value_for(iter->first);
+        }
+    }
+    seen += this->qs_zero_count;
+    if ((double) seen > rank) {
+        return 0.0;
+    }
+    for (const auto& bin : this->qs_positive) {
+        seen += bin.second;
+        if ((double) seen > rank) {
+            return this->value_for(bin.first);
+        }
+    }
+
+    return this->value_for(this->qs_positive.back().first);
+}
+
+void
+bucket_summary::add(double value)
+{
+    this->bs_count += 1;
+    this->bs_sum += value;
+    this->bs_min = std::min(this->bs_min, value);
+    this->bs_max = std::max(this->bs_max, value);
+    this->bs_sketch.add(value);
+}
+
+void
+bucket_summary::merge(const bucket_summary& rhs)
+{
+    if (rhs.bs_count == 0) {
+        return;
+    }
+
+    this->bs_count += rhs.bs_count;
+    this->bs_sum += rhs.bs_sum;
+    this->bs_min = std::min(this->bs_min, rhs.bs_min);
+    this->bs_max = std::max(this->bs_max, rhs.bs_max);
+    this->bs_sketch.merge(rhs.bs_sketch);
+}
+
+time_series_summary::time_series_summary()
+{
+    using namespace std::chrono_literals;
+
+    this->tss_levels.emplace_back(1min);
+    this->tss_levels.emplace_back(1h);
+    this->tss_levels.emplace_back(24h);
+}
+
+void
+time_series_summary::clear()
+{
+    for (auto& lvl : this->tss_levels) {
+        lvl.l_buckets.clear();
+    }
+    this->tss_samples.clear();
+    this->tss_sorted = true;
+    this->tss_totals = bucket_summary{};
+}
+
+void
+time_series_summary::add(std::chrono::microseconds time,
+                         double value,
+                         int64_t ref)
+{
+    if (!this->tss_samples.empty() && time < this->tss_samples.back().s_time) {
+        // Inserting in place would be quadratic for rows that are in
+        // reverse order, so the samples are sorted once at the end.
+        this->tss_sorted = false;
+    }
+    this->tss_samples.emplace_back(sample{time, value, ref});
+    this->tss_totals.add(value);
+    if (this->tss_sorted) {
+        this->add_to_levels(time, value);
+    }
+}
+
+void
+time_series_summary::sort()
+{
+    if (this->tss_sorted) {
+        return;
+    }
+
+    std::stable_sort(this->tss_samples.begin(),
+                     this->tss_samples.end(),
+                     [](const sample& lhs, const sample& rhs) {
+                         return lhs.s_time < rhs.s_time;
+                     });
+    for (auto& lvl : this->tss_levels) {
+        lvl.l_buckets.clear();
+    }
+    for (const auto& s : this->tss_samples) {
+        this->add_to_levels(s.s_time, s.s_value);
+    }
+    this->tss_sorted = true;
+}
+
+void
+time_series_summary::add_to_levels(std::chrono::microseconds time,
+                                   double value)
+{
+    for (auto& lvl : this->tss_levels) {
+        auto bucket_time = time - (time % lvl.l_granularity);
+
+        if (lvl.l_buckets.empty()
+            || lvl.l_buckets.back().bs_time != bucket_time)
+        {
+            auto& bs = lvl.l_buckets.emplace_back();
+
+            bs.bs_time = bucket_time;
+        }
+        lvl.l_buckets.back().add(value);
+    }
+}
+
+std::pair<time_series_summary::sample_iterator,
+          time_series_summary::sample_iterator>
+time_series_summary::samples_in(std::chrono::microseconds begin,
+                                std::chrono::microseconds end) const
+{
+    require(this->tss_sorted);
+
+    auto cmp = [](const sample& lhs, std::chrono::microseconds rhs) {
+        return lhs.s_time < rhs;
+    };
+    auto begin_iter = std::lower_bound(
+        this->tss_samples.begin(), this->tss_samples.end(), begin, cmp);
+    auto end_iter
+        = std::lower_bound(begin_iter, this->tss_samples.end(), end, cmp);
+
+    return {begin_iter, end_iter};
+}
+
+bucket_summary
+time_series_summary::summarize(std::chrono::microseconds begin,
+                               std::chrono::microseconds end) const
+{
+    require(this->tss_sorted);
+
+    bucket_summary retval;
+    auto curr = begin;
+
+    retval.bs_time = begin;
+    while (curr < end) {
+        auto used_level = false;
+
+        for (auto lvl_iter = this->tss_levels.rbegin();
+             lvl_iter != this->tss_levels.rend();
+             ++lvl_iter)
+        {
+            const auto& lvl = *lvl_iter;
+
+            if (curr % lvl.l_granularity != std::chrono::microseconds::zero()
+                || curr + lvl.l_granularity > end)
+            {
+                continue;
+            }
+
+            auto bucket_iter = std::lower_bound(
+                lvl.l_buckets.begin(),
+                lvl.l_buckets.end(),
+                curr,
+                [](const bucket_summary& bs, std::chrono::microseconds t) {
+                    return bs.bs_time < t;
+                });
+            if (bucket_iter != lvl.l_buckets.end()
+                && bucket_iter->bs_time == curr)
+            {
+                retval.merge(*bucket_iter);
+            }
+            curr += lvl.l_granularity;
+            used_level = true;
+            break;
+        }
+
+        if (used_level) {
+            continue;
+        }
+
+        // Not aligned with any of the levels, fall back to the samples up
+        // to the next boundary of the finest level.
+        const auto& finest = this->tss_levels.front();
+        auto next = std::min(
+            end, curr - (curr % finest.l_granularity) + finest.l_granularity);
+        auto range = this->samples_in(curr, next);
+        for (auto iter = range.first; iter != range.second; ++iter) {
+            retval.add(iter->s_value);
+        }
+        curr = next;
+    }
+
+    return retval;
+}
+
+}  // namespace lnav::spectro
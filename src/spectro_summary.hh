@@ -0,0 +1,177 @@
+/**
+ * Copyright (c) 2026, Timothy Stack
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ * * Neither the name of Timothy Stack nor the names of its contributors
+ * may be used to endorse or promote products derived from this software
+ * without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE REGENTS AND CONTRIBUTORS ''AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef lnav_spectro_summary_hh
+#define lnav_spectro_summary_hh
+
+#include <chrono>
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <utility>
+#include <vector>
+
+namespace lnav::spectro {
+
+/**
+ * A mergeable sketch for estimating quantiles of a set of values.  Values
+ * are counted in logarithmically-sized bins so any estimate is within the
+ * given relative accuracy of an actual value in the set.
+ */
+class quantile_sketch {
+public:
+    static constexpr double DEFAULT_RELATIVE_ACCURACY = 0.01;
+
+    explicit quantile_sketch(
+        double relative_accuracy = DEFAULT_RELATIVE_ACCURACY);
+
+    void add(double value, uint64_t count = 1);
+
+    void merge(const quantile_sketch& rhs);
+
+    std::optional<double> quantile(double q) const;
+
+    uint64_t count() const { return this->qs_count; }
+
+    bool empty() const { return this->qs_count == 0; }
+
+private:
+    using bin_t = std::pair<int32_t, uint64_t>;
+
+    int32_t key_for(double value) const;
+
+    double value_for(int32_t key) const;
+
+    static void add_to_bins(std::vector<bin_t>& bins,
+                            int32_t key,
+                            uint64_t count);
+
+    static void merge_bins(std::vector<bin_t>& lhs,
+                           const std::vector<bin_t>& rhs);
+
+    double qs_gamma;
+    double qs_log_gamma;
+    /** Sorted bins for the positive values. */
+    std::vector<bin_t> qs_positive;
+    /** Sorted bins for the magnitudes of the negative values. */
+    std::vector<bin_t> qs_negative;
+    uint64_t qs_zero_count{0};
+    uint64_t qs_count{0};
+};
+
+/**
+ * Summary statistics for the values in a span of time.
+ */
+struct bucket_summary {
+    std::chrono::microseconds bs_time{0};
+    uint64_t bs_count{0};
+    double bs_sum{0.0};
+    double bs_min{std::numeric_limits<double>::max()};
+    double bs_max{std::numeric_limits<double>::lowest()};
+    quantile_sketch bs_sketch;
+
+    void add(double value);
+
+    void merge(const bucket_summary& rhs);
+};
+
+/**
+ * A multi-resolution summary of a numeric series that is built
+ * incrementally as samples arrive.  The samples are kept so
+ * exact distributions can be computed for a span of time and the summary
+ * levels answer aggregate questions without touching every sample.
+ */
+class time_series_summary {
+public:
+    struct sample {
+        std::chrono::microseconds s_time;
+        double s_value;
+        /** An identifier for where the sample came from, like a row. */
+        int64_t s_ref;
+    };
+
+    using sample_iterator = std::vector<sample>::const_iterator;
+
+    time_series_summary();
+
+    void clear();
+
+    /**
+     * Add a sample to the series.  Samples are expected to arrive in time
+     * order.  An older sample is appended as-is and sort() has to be called
+     * before the series is queried again.
+     */
+    void add(std::chrono::microseconds time, double value, int64_t ref);
+
+    /**
+     * Put the samples that were added out of time order in place and
+     * rebuild the summary levels.  This is a no-op if the samples are
+     * already in order.
+     */
+    void sort();
+
+    /** @return the samples in the half-open range [begin, end). */
+    std::pair<sample_iterator, sample_iterator> samples_in(
+        std::chrono::microseconds begin, std::chrono::microseconds end) const;
+
+    /** Summarize the samples in the half-open range [begin, end). */
+    bucket_summary summarize(std::chrono::microseconds begin,
+                             std::chrono::microseconds end) const;
+
+    const bucket_summary& totals() const { return this->tss_totals; }
+
+    size_t size() const { return this->tss_samples.size(); }
+
+private:
+    void add_to_levels(std::chrono::microseconds time, double value);
+
+    struct level {
+        explicit level(std::chrono::microseconds granularity)
+            : l_granularity(granularity)
+        {
+        }
+
+        std::chrono::microseconds l_granularity;
+        std::vector<bucket_summary> l_buckets;
+    };
+
+    /** The levels, ordered from the finest to the coarsest. */
+    std::vector<level> tss_levels;
+    std::vector<sample> tss_samples;
+    /**
+     * False if a sample was added out of order, in which case the levels
+     * are out of date until sort() is called.
+     */
+    bool tss_sorted{true};
+    bucket_summary tss_totals;
+};
+
+}  // namespace lnav::spectro
+
+#endif
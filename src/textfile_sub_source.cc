@@ -421,17 +421,16 @@ textfile_sub_source::text_filters_changed()
     }
 
     auto* lfo = (line_filter_observer*) lf->get_logline_observer();
-    uint32_t filter_in_mask, filter_out_mask;
+    logfile_filter_state::filter_mask_t filter_in_mask, filter_out_mask;
 
     lfo->clear_deleted_filter_state();
     lf->reobserve_from(lf->begin() + lfo->get_min_count(lf->size()));
 
     this->get_filters().get_enabled_mask(filter_in_mask, filter_out_mask);
+    lfo->update_excluded(filter_in_mask, filter_out_mask);
     lfo->lfo_filter_state.tfs_index.clear();
     for (uint32_t lpc = 0; lpc < lf->size(); lpc++) {
-        if (this->tss_apply_filters
-            && lfo->excluded(filter_in_mask, filter_out_mask, lpc))
-        {
+        if (this->tss_apply_filters && lfo->excluded(lpc)) {
             continue;
         }
         lfo->lfo_filter_state.tfs_index.push_back(lpc);
@@ -871,15 +870,15 @@ textfile_sub_source::rescan_files(textfile_sub_source::scan_callback& callback,
                 }
             }
 
-            uint32_t filter_in_mask, filter_out_mask;
+            logfile_filter_state::filter_mask_t filter_in_mask,
+                filter_out_mask;
 
             this->get_filters().get_enabled_mask(filter_in_mask,
                                                  filter_out_mask);
             auto* lfo = (line_filter_observer*) lf->get_logline_observer();
+            lfo->update_excluded(filter_in_mask, filter_out_mask);
             for (uint32_t lpc = old_size; lpc < lf->size(); lpc++) {
-                if (this->tss_apply_filters
-                    && lfo->excluded(filter_in_mask, filter_out_mask, lpc))
-                {
+                if (this->tss_apply_filters && lfo->excluded(lpc)) {
                     continue;
                 }
                 lfo->lfo_filter_state.tfs_index.push_back(lpc);
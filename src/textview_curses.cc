@@ -66,7 +66,7 @@ text_filter::revert_to_last(logfile_filter_state& lfs, size_t rollback_size)
         lfs.tfs_filter_count[this->lf_index] -= 1;
         size_t line_number = lfs.tfs_filter_count[this->lf_index];
 
-        lfs.tfs_mask[line_number] &= ~(((uint32_t) 1) << this->lf_index);
+        lfs.set_bit(this->lf_index, line_number, false);
     }
     if (lfs.tfs_lines_for_message[this->lf_index] > 0) {
         require(lfs.tfs_lines_for_message[this->lf_index] >= rollback_size);
@@ -97,10 +97,6 @@ text_filter::add_line(logfile_filter_state& lfs,
 void
 text_filter::end_of_message(logfile_filter_state& lfs)
 {
-    uint32_t mask = 0;
-
-    mask = ((uint32_t) 1U << this->lf_index);
-
     for (size_t lpc = 0; lpc < lfs.tfs_lines_for_message[this->lf_index]; lpc++)
     {
         require(lfs.tfs_filter_count[this->lf_index]
@@ -108,11 +104,9 @@ text_filter::end_of_message(logfile_filter_state& lfs)
 
         size_t line_number = lfs.tfs_filter_count[this->lf_index];
 
-        if (lfs.tfs_message_matched[this->lf_index]) {
-            lfs.tfs_mask[line_number] |= mask;
-        } else {
-            lfs.tfs_mask[line_number] &= ~mask;
-        }
+        lfs.set_bit(this->lf_index,
+                    line_number,
+                    lfs.tfs_message_matched[this->lf_index]);
         lfs.tfs_filter_count[this->lf_index] += 1;
         if (lfs.tfs_message_matched[this->lf_index]) {
             lfs.tfs_filter_hits[this->lf_index] += 1;
@@ -213,6 +207,7 @@ textview_curses::reload_config(error_reporter& reporter)
 
         iter = this->tc_highlights.erase(iter);
     }
+    this->tc_highlights_generation += 1;
 
     std::map<std::string, scoped_value_t> vars;
     auto curr_theme_iter
@@ -778,34 +773,75 @@ textview_curses::textview_value_for_row(vis_line_t row, attr_line_t& value_out)
         }
     }
 
-    for (auto& tc_highlight : this->tc_highlights) {
-        bool internal_hl
-            = tc_highlight.first.first == highlight_source_t::INTERNAL
-            || tc_highlight.first.first == highlight_source_t::THEME;
-
-        if (!tc_highlight.second.h_text_formats.empty()
-            && tc_highlight.second.h_text_formats.count(source_format) == 0)
-        {
+    if (this->tc_highlight_cache_generation != this->tc_highlights_generation)
+    {
+        this->tc_highlight_cache.clear();
+        this->tc_highlight_cache_generation = this->tc_highlights_generation;
+    }
+
+    // The highlighters only depend on the text, the ranges they are applied
+    // to, and the existing styles for the non-nestable highlighters, so the
+    // results can be reused when the row is drawn again.
+    hasher row_hasher;
+    row_hasher.update(str)
+        .update(body.lr_start)
+        .update(orig_line.lr_start)
+        .update((int64_t) (intptr_t) format_name.get())
+        .update((int64_t) source_format);
+    for (const auto hl_source : this->tc_disabled_highlights) {
+        row_hasher.update((int64_t) hl_source);
+    }
+    for (const auto& attr : sa) {
+        if (attr.sa_range.lr_end == -1) {
             continue;
         }
-
-        if (!tc_highlight.second.h_format_name.empty()
-            && tc_highlight.second.h_format_name != format_name)
+        if (attr.sa_type == &VC_STYLE || attr.sa_type == &VC_ROLE
+            || attr.sa_type == &VC_FOREGROUND || attr.sa_type == &VC_BACKGROUND)
         {
-            continue;
+            row_hasher.update(attr.sa_range.lr_start)
+                .update(attr.sa_range.lr_end);
         }
+    }
+    auto hl_key = row_hasher.to_array();
+    auto cached_hl = this->tc_highlight_cache.get(hl_key);
+    auto hl_start = sa.size();
 
-        if (this->tc_disabled_highlights.count(tc_highlight.first.first)) {
-            continue;
-        }
+    if (cached_hl) {
+        sa.insert(sa.end(), cached_hl->begin(), cached_hl->end());
+    } else {
+        for (auto& tc_highlight : this->tc_highlights) {
+            bool internal_hl
+                = tc_highlight.first.first == highlight_source_t::INTERNAL
+                || tc_highlight.first.first == highlight_source_t::THEME;
+
+            if (!tc_highlight.second.h_text_formats.empty()
+                && tc_highlight.second.h_text_formats.count(source_format)
+                    == 0)
+            {
+                continue;
+            }
+
+            if (!tc_highlight.second.h_format_name.empty()
+                && tc_highlight.second.h_format_name != format_name)
+            {
+                continue;
+            }
 
-        // Internal highlights should only apply to the log message body so
-        // that we don't start highlighting other fields.  User-provided
-        // highlights should apply only to the line itself and not any of the
-        // surrounding decorations that are added (for example, the file lines
-        // that are inserted at the beginning of the log view).
-        int start_pos = internal_hl ? body.lr_start : orig_line.lr_start;
-        tc_highlight.second.annotate(value_out, start_pos);
+            if (this->tc_disabled_highlights.count(tc_highlight.first.first)) {
+                continue;
+            }
+
+            // Internal highlights should only apply to the log message body
+            // so that we don't start highlighting other fields.
+            // User-provided highlights should apply only to the line itself
+            // and not any of the surrounding decorations that are added (for
+            // example, the file lines that are inserted at the beginning of
+            // the log view).
+            int start_pos = internal_hl ? body.lr_start : orig_line.lr_start;
+            tc_highlight.second.annotate(value_out, start_pos);
+        }
+        this->tc_highlight_cache.put(
+            hl_key, std::vector<string_attr>(sa.begin() + hl_start, sa.end()));
     }
 
     if (this->tc_hide_fields) {
@@ -843,6 +879,7 @@ textview_curses::execute_search(const std::string& regex_orig)
         this->match_reset();
 
         this->tc_search_child.reset();
+        this->tc_highlights_generation += 1;
         this->tc_source_search_child.reset();
 
         log_debug("start search for: '%s'", regex.c_str());
@@ -880,10 +917,13 @@ textview_curses::execute_search(const std::string& regex_orig)
             auto& hm = this->get_highlights();
             hm[{highlight_source_t::PREVIEW, "search"}] = hl;
 
+            const auto& search_cfg
+                = injector::get<const lnav::search::config&>();
             auto gp = injector::get<std::shared_ptr<grep_proc<vis_line_t>>>(
                 code, *this);
 
             gp->set_sink(this);
+            gp->set_thread_count(search_cfg.c_threads);
             auto top = this->get_top();
             if (top < REVERSE_SEARCH_OFFSET) {
                 top = 0_vl;
@@ -906,6 +946,8 @@ textview_curses::execute_search(const std::string& regex_orig)
                             code, *pair.first);
 
                     sgp->set_sink(pair.second);
+                    sgp->set_thread_count(this->tc_search_child->get_grep_proc()
+                                              ->get_thread_count());
                     sgp->queue_request(0_vl);
                     sgp->start();
 
@@ -1143,9 +1185,8 @@ empty_filter::to_command() const
 std::optional<size_t>
 filter_stack::next_index()
 {
-    bool used[32];
+    logfile_filter_state::filter_mask_t used;
 
-    memset(used, 0, sizeof(used));
     for (auto& iter : *this) {
         if (iter->lf_deleted) {
             continue;
@@ -1153,15 +1194,15 @@ filter_stack::next_index()
 
         size_t index = iter->get_index();
 
-        require(used[index] == false);
+        require(!used.test(index));
 
-        used[index] = true;
+        used.set(index);
     }
     for (size_t lpc = this->fs_reserved;
          lpc < logfile_filter_state::MAX_FILTERS;
          lpc++)
     {
-        if (!used[lpc]) {
+        if (!used.test(lpc)) {
             return lpc;
         }
     }
@@ -1199,9 +1240,9 @@ filter_stack::delete_filter(const std::string& id)
 }
 
 void
-filter_stack::get_mask(uint32_t& filter_mask)
+filter_stack::get_mask(logfile_filter_state::filter_mask_t& filter_mask)
 {
-    filter_mask = 0;
+    filter_mask.reset();
     for (auto& iter : *this) {
         std::shared_ptr<text_filter> tf = iter;
 
@@ -1209,12 +1250,10 @@ filter_stack::get_mask(uint32_t& filter_mask)
             continue;
         }
         if (tf->is_enabled()) {
-            uint32_t bit = (1UL << tf->get_index());
-
             switch (tf->get_type()) {
                 case text_filter::EXCLUDE:
                 case text_filter::INCLUDE:
-                    filter_mask |= bit;
+                    filter_mask.set(tf->get_index());
                     break;
                 default:
                     ensure(0);
@@ -1225,10 +1264,12 @@ filter_stack::get_mask(uint32_t& filter_mask)
 }
 
 void
-filter_stack::get_enabled_mask(uint32_t& filter_in_mask,
-                               uint32_t& filter_out_mask)
+filter_stack::get_enabled_mask(
+    logfile_filter_state::filter_mask_t& filter_in_mask,
+    logfile_filter_state::filter_mask_t& filter_out_mask)
 {
-    filter_in_mask = filter_out_mask = 0;
+    filter_in_mask.reset();
+    filter_out_mask.reset();
     for (auto& iter : *this) {
         std::shared_ptr<text_filter> tf = iter;
 
@@ -1236,14 +1277,12 @@ filter_stack::get_enabled_mask(uint32_t& filter_in_mask,
             continue;
         }
         if (tf->is_enabled()) {
-            uint32_t bit = (1UL << tf->get_index());
-
             switch (tf->get_type()) {
                 case text_filter::EXCLUDE:
-                    filter_out_mask |= bit;
+                    filter_out_mask.set(tf->get_index());
                     break;
                 case text_filter::INCLUDE:
-                    filter_in_mask |= bit;
+                    filter_in_mask.set(tf->get_index());
                     break;
                 default:
                     ensure(0);
@@ -1326,7 +1365,6 @@ logfile_filter_state::logfile_filter_state(std::shared_ptr<logfile> lf)
     memset(this->tfs_last_lines_for_message,
            0,
            sizeof(this->tfs_last_lines_for_message));
-    this->tfs_mask.reserve(64 * 1024);
 }
 
 void
@@ -1343,8 +1381,13 @@ logfile_filter_state::clear()
     memset(this->tfs_last_lines_for_message,
            0,
            sizeof(this->tfs_last_lines_for_message));
-    this->tfs_mask.clear();
+    for (auto& bits : this->tfs_filter_bits) {
+        bits.clear();
+    }
+    this->tfs_line_count = 0;
     this->tfs_index.clear();
+    this->tfs_excluded.clear();
+    this->tfs_excluded_valid_lines = 0;
 }
 
 void
@@ -1356,32 +1399,111 @@ logfile_filter_state::clear_filter_state(size_t index)
     this->tfs_lines_for_message[index] = 0;
     this->tfs_last_message_matched[index] = false;
     this->tfs_last_lines_for_message[index] = 0;
+    if (!this->tfs_filter_bits[index].empty()) {
+        this->tfs_filter_bits[index] = std::vector<uint64_t>{};
+        this->tfs_excluded_valid_lines = 0;
+    }
 }
 
 void
-logfile_filter_state::clear_deleted_filter_state(uint32_t used_mask)
+logfile_filter_state::clear_deleted_filter_state(const filter_mask_t& used_mask)
 {
     for (int lpc = 0; lpc < MAX_FILTERS; lpc++) {
-        if (!(used_mask & (1L << lpc))) {
+        if (!used_mask.test(lpc)) {
             this->clear_filter_state(lpc);
         }
     }
-    for (size_t lpc = 0; lpc < this->tfs_mask.size(); lpc++) {
-        this->tfs_mask[lpc] &= used_mask;
-    }
 }
 
 void
 logfile_filter_state::resize(size_t newsize)
 {
-    size_t old_mask_size = this->tfs_mask.size();
+    if (newsize < this->tfs_line_count) {
+        auto word_count = (newsize + 63) / 64;
+
+        for (auto& bits : this->tfs_filter_bits) {
+            if (bits.size() > word_count) {
+                bits.resize(word_count);
+            }
+            if (newsize % 64 != 0 && word_count > 0
+                && word_count <= bits.size())
+            {
+                bits[word_count - 1] &= (1ULL << (newsize % 64)) - 1;
+            }
+        }
+        this->tfs_excluded_valid_lines
+            = std::min(this->tfs_excluded_valid_lines, newsize);
+    }
+    this->tfs_line_count = newsize;
+}
+
+void
+logfile_filter_state::set_bit(size_t index, size_t line, bool value)
+{
+    auto& bits = this->tfs_filter_bits[index];
+    auto word = line / 64;
+    auto mask = 1ULL << (line % 64);
+
+    if (value) {
+        if (word >= bits.size()) {
+            bits.resize(word + 1);
+        }
+        bits[word] |= mask;
+    } else if (word < bits.size()) {
+        bits[word] &= ~mask;
+    }
+    this->tfs_excluded_valid_lines
+        = std::min(this->tfs_excluded_valid_lines, line);
+}
+
+void
+logfile_filter_state::update_excluded(const filter_mask_t& filter_in_mask,
+                                      const filter_mask_t& filter_out_mask)
+{
+    if (filter_in_mask != this->tfs_excluded_in_mask
+        || filter_out_mask != this->tfs_excluded_out_mask)
+    {
+        this->tfs_excluded_in_mask = filter_in_mask;
+        this->tfs_excluded_out_mask = filter_out_mask;
+        this->tfs_excluded_valid_lines = 0;
+    }
+
+    auto word_count = (this->tfs_line_count + 63) / 64;
+    auto start = this->tfs_excluded_valid_lines / 64;
+
+    this->tfs_excluded.resize(word_count);
+    if (start < word_count) {
+        // A line is excluded if there are "in" filters and none of them
+        // matched the line or if any of the "out" filters matched it.
+        std::fill(this->tfs_excluded.begin() + start,
+                  this->tfs_excluded.end(),
+                  filter_in_mask.none() ? 0ULL : ~0ULL);
+        for (int lpc = 0; lpc < MAX_FILTERS; lpc++) {
+            if (!filter_in_mask.test(lpc)) {
+                continue;
+            }
 
-    this->tfs_mask.resize(newsize);
-    if (newsize > old_mask_size) {
-        memset(&this->tfs_mask[old_mask_size],
-               0,
-               sizeof(uint32_t) * (newsize - old_mask_size));
+            const auto& bits = this->tfs_filter_bits[lpc];
+            auto end = std::min(word_count, bits.size());
+
+            for (auto word = start; word < end; word++) {
+                this->tfs_excluded[word] &= ~bits[word];
+            }
+        }
+        for (int lpc = 0; lpc < MAX_FILTERS; lpc++) {
+            if (!filter_out_mask.test(lpc)) {
+                continue;
+            }
+
+            const auto& bits = this->tfs_filter_bits[lpc];
+            auto end = std::min(word_count, bits.size());
+
+            for (auto word = start; word < end; word++) {
+                this->tfs_excluded[word] |= bits[word];
+            }
+        }
     }
+    this->tfs_excluded_valid_lines = this->tfs_line_count;
 }
 
 std::optional<size_t>
@@ -32,14 +32,17 @@
 #ifndef textview_curses_hh
 #define textview_curses_hh
 
+#include <bitset>
 #include <utility>
 #include <vector>
 
 #include "base/func_util.hh"
 #include "base/lnav_log.hh"
+#include "base/lrucache.hpp"
 #include "bookmarks.hh"
 #include "breadcrumb.hh"
 #include "grep_proc.hh"
+#include "hasher.hh"
 #include "highlighter.hh"
 #include "listview_curses.hh"
 #include "lnav_config_fwd.hh"
@@ -55,19 +58,51 @@ using vis_bookmarks = bookmarks<vis_line_t>::type;
 
 class logfile_filter_state {
 public:
+    const static int MAX_FILTERS = 128;
+
+    using filter_mask_t = std::bitset<MAX_FILTERS>;
+
     logfile_filter_state(std::shared_ptr<logfile> lf = nullptr);
 
     void clear();
 
     void clear_filter_state(size_t index);
 
-    void clear_deleted_filter_state(uint32_t used_mask);
+    void clear_deleted_filter_state(const filter_mask_t& used_mask);
 
     void resize(size_t newsize);
 
     std::optional<size_t> content_line_to_vis_line(uint32_t line);
 
-    const static int MAX_FILTERS = 32;
+    /**
+     * @return True if the line was matched by the filter with the given
+     *   index.
+     */
+    bool is_set(size_t index, size_t line) const
+    {
+        const auto& bits = this->tfs_filter_bits[index];
+        auto word = line / 64;
+
+        return word < bits.size() && (bits[word] >> (line % 64)) & 1;
+    }
+
+    void set_bit(size_t index, size_t line, bool value);
+
+    /**
+     * Compute which lines are excluded by the given filters by combining
+     * the per-filter bitmaps a word at a time.  Only the words that have
+     * changed since the last call are recomputed.
+     */
+    void update_excluded(const filter_mask_t& filter_in_mask,
+                         const filter_mask_t& filter_out_mask);
+
+    bool is_excluded(size_t line) const
+    {
+        auto word = line / 64;
+
+        return word < this->tfs_excluded.size()
+            && (this->tfs_excluded[word] >> (line % 64)) & 1;
+    }
 
     std::shared_ptr<logfile> tfs_logfile;
     size_t tfs_filter_count[MAX_FILTERS];
@@ -76,8 +111,20 @@ public:
     size_t tfs_lines_for_message[MAX_FILTERS];
     bool tfs_last_message_matched[MAX_FILTERS];
     size_t tfs_last_lines_for_message[MAX_FILTERS];
-    std::vector<uint32_t> tfs_mask;
+    /**
+     * A bitmap for each filter of the lines that it matched.  The bitmaps
+     * are only allocated for the filters that are in use.
+     */
+    std::vector<uint64_t> tfs_filter_bits[MAX_FILTERS];
+    size_t tfs_line_count{0};
     std::vector<uint32_t> tfs_index;
+
+private:
+    std::vector<uint64_t> tfs_excluded;
+    filter_mask_t tfs_excluded_in_mask;
+    filter_mask_t tfs_excluded_out_mask;
+    /** The lines at and after this one need to be recomputed. */
+    size_t tfs_excluded_valid_lines{0};
 };
 
 enum class filter_lang_t : int {
@@ -239,9 +286,10 @@ public:
 
     bool delete_filter(const std::string& id);
 
-    void get_mask(uint32_t& filter_mask);
+    void get_mask(logfile_filter_state::filter_mask_t& filter_mask);
 
-    void get_enabled_mask(uint32_t& filter_in_mask, uint32_t& filter_out_mask);
+    void get_enabled_mask(logfile_filter_state::filter_mask_t& filter_in_mask,
+                          logfile_filter_state::filter_mask_t& filter_out_mask);
 
 private:
     const size_t fs_reserved;
@@ -573,6 +621,8 @@ class textview_curses
 public:
     using action = std::function<void(textview_curses*)>;
 
+    static constexpr size_t HIGHLIGHT_CACHE_SIZE = 1024;
+
     const static bookmark_type_t BM_USER;
     const static bookmark_type_t BM_USER_EXPR;
     const static bookmark_type_t BM_SEARCH;
@@ -678,13 +728,6 @@ public:
     std::optional<line_info> grep_value_for_line(vis_line_t line,
                                                  std::string& value_out);
 
-    void grep_quiesce()
-    {
-        if (this->tc_sub_source != nullptr) {
-            this->tc_sub_source->quiesce();
-        }
-    }
-
     void grep_begin(grep_proc<vis_line_t>& gp,
                     vis_line_t start,
                     vis_line_t stop);
@@ -715,7 +758,15 @@ public:
         }
     }
 
-    highlight_map_t& get_highlights() { return this->tc_highlights; }
+    /**
+     * @return The highlights for this view, which the caller might modify,
+     * so any cached highlight results are invalidated.
+     */
+    highlight_map_t& get_highlights()
+    {
+        this->tc_highlights_generation += 1;
+        return this->tc_highlights;
+    }
 
     const highlight_map_t& get_highlights() const
     {
@@ -857,6 +908,15 @@ protected:
 
     highlight_map_t tc_highlights;
     std::set<highlight_source_t> tc_disabled_highlights;
+    size_t tc_highlights_generation{0};
+
+    /**
+     * The attributes added by the highlighters, keyed by a hash of the row
+     * content and anything else that affects the highlighting.
+     */
+    cache::lru_cache<hasher::array_t, std::vector<string_attr>>
+        tc_highlight_cache{HIGHLIGHT_CACHE_SIZE};
+    size_t tc_highlight_cache_generation{0};
 
     std::optional<vis_line_t> tc_selection_start;
     mouse_event tc_press_event;
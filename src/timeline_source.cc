@@ -627,6 +627,99 @@ timeline_source::text_size_for_line(textview_curses& tc,
     return this->gs_total_width;
 }
 
+static void
+merge_opid_range(timeline_source& ts,
+                 timeline_source::opid_row& row,
+                 const std::shared_ptr<log_format>& format,
+                 const opid_time_range& otr)
+{
+    if (row.or_file_count == 0) {
+        row.or_value = otr;
+    } else {
+        row.or_value |= otr;
+    }
+    row.or_file_count += 1;
+
+    for (auto& sub : row.or_value.otr_sub_ops) {
+        auto subid_iter = ts.gs_subid_map.find(sub.ostr_subid);
+
+        if (subid_iter == ts.gs_subid_map.end()) {
+            subid_iter = ts.gs_subid_map
+                             .emplace(sub.ostr_subid.to_owned(ts.gs_allocator),
+                                      true)
+                             .first;
+        }
+        sub.ostr_subid = subid_iter->first;
+        if (sub.ostr_subid.length() > row.or_max_subid_width) {
+            row.or_max_subid_width = sub.ostr_subid.length();
+        }
+    }
+
+    if (otr.otr_description.lod_id) {
+        auto desc_id = otr.otr_description.lod_id.value();
+        auto desc_def_iter = format->lf_opid_description_def->find(desc_id);
+
+        if (desc_def_iter == format->lf_opid_description_def->end()) {
+            log_error("cannot find description: %s", row.or_name.data());
+        } else {
+            auto desc_key = timeline_source::opid_description_def_key{
+                format->get_name(), desc_id};
+            auto desc_defs_iter
+                = row.or_description_defs.odd_defs.find(desc_key);
+            if (desc_defs_iter == row.or_description_defs.odd_defs.end()) {
+                row.or_description_defs.odd_defs.insert(desc_key,
+                                                        desc_def_iter->second);
+            }
+
+            auto& curr_desc_m = row.or_descriptions[desc_key];
+            const auto& new_desc_v = otr.otr_description.lod_elements;
+
+            for (const auto& desc_pair : new_desc_v) {
+                curr_desc_m[desc_pair.first] = desc_pair.second;
+            }
+        }
+    } else {
+        ensure(otr.otr_description.lod_elements.empty());
+    }
+    row.or_value.otr_description.lod_elements.clear();
+}
+
+static void
+apply_opid_filters(const filter_stack& filters, timeline_source::opid_row& row)
+{
+    shared_buffer sb_opid;
+    shared_buffer_ref sbr_opid;
+    sbr_opid.share(sb_opid, row.or_name.data(), row.or_name.length());
+    shared_buffer sb_desc;
+    shared_buffer_ref sbr_desc;
+    sbr_desc.share(
+        sb_desc, row.or_description.data(), row.or_description.length());
+
+    row.or_filter_matches.clear();
+    row.or_filtered_in = false;
+    row.or_filtered_out = false;
+    for (const auto& filt : filters) {
+        if (!filt->is_enabled()) {
+            continue;
+        }
+        for (const auto sbr : {&sbr_opid, &sbr_desc}) {
+            if (filt->matches(std::nullopt, *sbr)) {
+                row.or_filter_matches.emplace_back(filt->get_index());
+                switch (filt->get_type()) {
+                    case text_filter::INCLUDE:
+                        row.or_filtered_in = true;
+                        break;
+                    case text_filter::EXCLUDE:
+                        row.or_filtered_out = true;
+                        break;
+                    default:
+                        break;
+                }
+            }
+        }
+    }
+}
+
 void
 timeline_source::rebuild_indexes()
 {
@@ -637,23 +730,12 @@ timeline_source::rebuild_indexes()
     bm_errs.clear();
     bm_warns.clear();
 
-    this->gs_lower_bound = {};
-    this->gs_upper_bound = {};
-    this->gs_opid_width = 0;
-    this->gs_total_width = 0;
-    this->gs_filtered_count = 0;
-    this->gs_active_opids.clear();
-    this->gs_descriptions.clear();
-    this->gs_subid_map.clear();
-    this->gs_allocator.reset();
     this->gs_preview_source.clear();
     this->gs_preview_rows.clear();
     this->gs_preview_status_source.get_description().clear();
 
-    auto min_log_time_opt = this->gs_lss.get_min_log_time();
-    auto max_log_time_opt = this->gs_lss.get_max_log_time();
-    auto max_desc_width = size_t{0};
-
+    std::vector<opid_source> curr_sources;
+    std::vector<logfile*> curr_files;
     for (const auto& ld : this->gs_lss) {
         if (ld->get_file_ptr() == nullptr) {
             continue;
@@ -662,98 +744,108 @@ timeline_source::rebuild_indexes()
             continue;
         }
 
-        auto format = ld->get_file_ptr()->get_format();
-        safe::ReadAccess<logfile::safe_opid_state> r_opid_map(
-            ld->get_file_ptr()->get_opids());
-        for (const auto& pair : r_opid_map->los_opid_ranges) {
-            auto& otr = pair.second;
-            auto active_iter = this->gs_active_opids.find(pair.first);
-            if (active_iter == this->gs_active_opids.end()) {
-                auto opid = pair.first.to_owned(this->gs_allocator);
-                auto active_emp_res = this->gs_active_opids.emplace(
-                    opid,
-                    opid_row{
-                        opid,
-                        otr,
-                        string_fragment::invalid(),
-                    });
-                active_iter = active_emp_res.first;
-            } else {
-                active_iter->second.or_value |= otr;
-            }
+        auto* lf = ld->get_file_ptr();
+        safe::ReadAccess<logfile::safe_opid_state> r_opid_map(lf->get_opids());
 
-            auto& row = active_iter->second;
-            for (auto& sub : active_iter->second.or_value.otr_sub_ops) {
-                auto subid_iter = this->gs_subid_map.find(sub.ostr_subid);
+        curr_files.emplace_back(lf);
+        curr_sources.emplace_back(
+            opid_source{lf, r_opid_map->los_generation});
+    }
 
-                if (subid_iter == this->gs_subid_map.end()) {
-                    subid_iter = this->gs_subid_map
-                                     .emplace(sub.ostr_subid.to_owned(
-                                                  this->gs_allocator),
-                                              true)
-                                     .first;
-                }
-                sub.ostr_subid = subid_iter->first;
-                if (sub.ostr_subid.length()
-                    > active_iter->second.or_max_subid_width)
-                {
-                    active_iter->second.or_max_subid_width
-                        = sub.ostr_subid.length();
-                }
-            }
+    // Opids from files that were closed, hidden, or re-indexed cannot be
+    // subtracted out of the rows, so start over in those cases.
+    auto full_rebuild = curr_sources != this->gs_opid_sources;
+    if (full_rebuild) {
+        this->gs_opid_sources = std::move(curr_sources);
+        this->gs_time_order.clear();
+        this->gs_time_tree = std::nullopt;
+        this->gs_active_opids.clear();
+        this->gs_descriptions.clear();
+        this->gs_subid_map.clear();
+        this->gs_allocator.reset();
+    }
 
-            if (otr.otr_description.lod_id) {
-                auto desc_id = otr.otr_description.lod_id.value();
-                auto desc_def_iter
-                    = format->lf_opid_description_def->find(desc_id);
+    std::vector<opid_row*> dirty_rows;
+    auto mark_dirty = [this, &dirty_rows](const string_fragment& opid) {
+        auto active_iter = this->gs_active_opids.find(opid);
+        if (active_iter == this->gs_active_opids.end()) {
+            auto opid_copy = opid.to_owned(this->gs_allocator);
+            active_iter = this->gs_active_opids
+                              .emplace(opid_copy,
+                                       opid_row{
+                                           opid_copy,
+                                           opid_time_range{},
+                                           string_fragment::invalid(),
+                                       })
+                              .first;
+        }
 
-                if (desc_def_iter == format->lf_opid_description_def->end()) {
-                    log_error("cannot find description: %s",
-                              active_iter->first.data());
-                } else {
-                    auto desc_key
-                        = opid_description_def_key{format->get_name(), desc_id};
-                    auto desc_defs_iter
-                        = row.or_description_defs.odd_defs.find(desc_key);
-                    if (desc_defs_iter
-                        == row.or_description_defs.odd_defs.end())
+        auto& row = active_iter->second;
+        if (!row.or_dirty) {
+            row.or_dirty = true;
+            row.or_value = opid_time_range{};
+            row.or_description_defs.odd_defs.clear();
+            row.or_descriptions.clear();
+            row.or_max_subid_width = 0;
+            row.or_file_count = 0;
+            dirty_rows.emplace_back(&row);
+        }
+    };
+    for (auto* lf : curr_files) {
+        safe::WriteAccess<logfile::safe_opid_state> w_opid_map(
+            lf->get_opids());
+
+        auto& updates = w_opid_map->los_timeline_updates;
+        if (full_rebuild || updates.ou_all) {
+            for (const auto& pair : w_opid_map->los_opid_ranges) {
+                mark_dirty(pair.first);
+            }
+        } else {
+            for (const auto& opid : updates.ou_opids) {
+                mark_dirty(opid);
+            }
+        }
+        updates.reset();
+    }
+
+    // Recompute the dirty rows by merging the ranges from every file in
+    // the same order as a full rebuild would.
+    if (!dirty_rows.empty()) {
+        for (auto* lf : curr_files) {
+            auto format = lf->get_format();
+            safe::ReadAccess<logfile::safe_opid_state> r_opid_map(
+                lf->get_opids());
+
+            if (dirty_rows.size() >= r_opid_map->los_opid_ranges.size()) {
+                for (const auto& pair : r_opid_map->los_opid_ranges) {
+                    auto active_iter = this->gs_active_opids.find(pair.first);
+                    if (active_iter == this->gs_active_opids.end()
+                        || !active_iter->second.or_dirty)
                     {
-                        row.or_description_defs.odd_defs.insert(
-                            desc_key, desc_def_iter->second);
+                        continue;
                     }
 
-                    auto& all_descs = active_iter->second.or_descriptions;
-                    auto& curr_desc_m = all_descs[desc_key];
-                    const auto& new_desc_v = otr.otr_description.lod_elements;
-
-                    for (const auto& desc_pair : new_desc_v) {
-                        curr_desc_m[desc_pair.first] = desc_pair.second;
-                    }
+                    merge_opid_range(
+                        *this, active_iter->second, format, pair.second);
                 }
             } else {
-                ensure(otr.otr_description.lod_elements.empty());
+                for (auto* row : dirty_rows) {
+                    auto otr_iter
+                        = r_opid_map->los_opid_ranges.find(row->or_name);
+                    if (otr_iter == r_opid_map->los_opid_ranges.end()) {
+                        continue;
+                    }
+
+                    merge_opid_range(*this, *row, format, otr_iter->second);
+                }
             }
-            active_iter->second.or_value.otr_description.lod_elements.clear();
         }
     }
 
-    size_t filtered_in_count = 0;
-    for (const auto& filt : this->tss_filters) {
-        if (!filt->is_enabled()) {
-            continue;
-        }
-        if (filt->get_type() == text_filter::INCLUDE) {
-            filtered_in_count += 1;
-        }
-    }
-    this->gs_filter_hits = {};
-    this->gs_time_order.clear();
-    this->gs_time_order.reserve(this->gs_active_opids.size());
-    for (auto& pair : this->gs_active_opids) {
-        auto& otr = pair.second.or_value;
+    for (auto* row : dirty_rows) {
         std::string full_desc;
-        const auto& desc_defs = pair.second.or_description_defs.odd_defs;
-        for (auto& desc : pair.second.or_descriptions) {
+        const auto& desc_defs = row->or_description_defs.odd_defs;
+        for (auto& desc : row->or_descriptions) {
             auto desc_def_iter = desc_defs.find(desc.first);
             if (desc_def_iter == desc_defs.end()) {
                 continue;
@@ -761,87 +853,161 @@ timeline_source::rebuild_indexes()
             const auto& desc_def = desc_def_iter->second;
             full_desc = desc_def.to_string(desc.second);
         }
-        pair.second.or_descriptions.clear();
+        row->or_descriptions.clear();
         auto full_desc_sf = string_fragment::from_str(full_desc);
         auto desc_sf_iter = this->gs_descriptions.find(full_desc_sf);
         if (desc_sf_iter == this->gs_descriptions.end()) {
-            full_desc_sf = string_fragment::from_str(full_desc).to_owned(
-                this->gs_allocator);
+            full_desc_sf = full_desc_sf.to_owned(this->gs_allocator);
+            this->gs_descriptions.emplace(full_desc_sf);
+        } else {
+            full_desc_sf = *desc_sf_iter;
         }
-        pair.second.or_description = full_desc_sf;
-
-        shared_buffer sb_opid;
-        shared_buffer_ref sbr_opid;
-        sbr_opid.share(
-            sb_opid, pair.second.or_name.data(), pair.second.or_name.length());
-        shared_buffer sb_desc;
-        shared_buffer_ref sbr_desc;
-        sbr_desc.share(sb_desc, full_desc.c_str(), full_desc.length());
-        if (this->tss_apply_filters) {
-            auto filtered_in = false;
-            auto filtered_out = false;
-            for (const auto& filt : this->tss_filters) {
-                if (!filt->is_enabled()) {
-                    continue;
-                }
-                for (const auto sbr : {&sbr_opid, &sbr_desc}) {
-                    if (filt->matches(std::nullopt, *sbr)) {
-                        this->gs_filter_hits[filt->get_index()] += 1;
-                        switch (filt->get_type()) {
-                            case text_filter::INCLUDE:
-                                filtered_in = true;
-                                break;
-                            case text_filter::EXCLUDE:
-                                filtered_out = true;
-                                break;
-                            default:
-                                break;
-                        }
-                    }
-                }
-            }
+        row->or_description = full_desc_sf;
+    }
 
-            if (min_log_time_opt
-                && otr.otr_range.tr_end < min_log_time_opt.value())
-            {
-                filtered_out = true;
+    // The filter results for each row are cached until the filters change.
+    std::string filter_signature = this->tss_apply_filters ? "apply\n" : "";
+    size_t filtered_in_count = 0;
+    for (const auto& filt : this->tss_filters) {
+        if (!filt->is_enabled()) {
+            continue;
+        }
+        if (filt->get_type() == text_filter::INCLUDE) {
+            filtered_in_count += 1;
+        }
+        filter_signature += fmt::format(FMT_STRING("{}:{}:{}:{}\n"),
+                                        filt->get_index(),
+                                        static_cast<int>(filt->get_type()),
+                                        static_cast<int>(filt->get_lang()),
+                                        filt->get_id());
+    }
+    auto filters_changed
+        = full_rebuild || filter_signature != this->gs_filter_signature;
+    this->gs_filter_signature = std::move(filter_signature);
+    if (this->tss_apply_filters) {
+        if (filters_changed) {
+            for (auto& pair : this->gs_active_opids) {
+                apply_opid_filters(this->tss_filters, pair.second);
             }
-            if (max_log_time_opt
-                && max_log_time_opt.value() < otr.otr_range.tr_begin)
-            {
-                filtered_out = true;
+        } else {
+            for (auto* row : dirty_rows) {
+                apply_opid_filters(this->tss_filters, *row);
             }
+        }
+    }
 
-            if ((filtered_in_count > 0 && !filtered_in) || filtered_out) {
-                this->gs_filtered_count += 1;
-                continue;
+    auto min_log_time_opt = this->gs_lss.get_min_log_time();
+    auto max_log_time_opt = this->gs_lss.get_max_log_time();
+    auto bounds_changed = min_log_time_opt != this->gs_min_log_time
+        || max_log_time_opt != this->gs_max_log_time;
+    this->gs_min_log_time = min_log_time_opt;
+    this->gs_max_log_time = max_log_time_opt;
+
+    auto is_visible = [&](const opid_row& row) {
+        if (row.or_file_count == 0) {
+            return false;
+        }
+        if (!this->tss_apply_filters) {
+            return true;
+        }
+
+        auto filtered_out = row.or_filtered_out;
+        if (min_log_time_opt
+            && row.or_value.otr_range.tr_end < min_log_time_opt.value())
+        {
+            filtered_out = true;
+        }
+        if (max_log_time_opt
+            && max_log_time_opt.value() < row.or_value.otr_range.tr_begin)
+        {
+            filtered_out = true;
+        }
+
+        return !((filtered_in_count > 0 && !row.or_filtered_in)
+                 || filtered_out);
+    };
+
+    if (filters_changed || bounds_changed) {
+        this->gs_time_order.clear();
+        this->gs_time_order.reserve(this->gs_active_opids.size());
+        for (auto& pair : this->gs_active_opids) {
+            if (is_visible(pair.second)) {
+                this->gs_time_order.emplace_back(pair.second);
+            }
+        }
+        std::stable_sort(this->gs_time_order.begin(),
+                         this->gs_time_order.end(),
+                         std::less<const opid_row>{});
+    } else if (!dirty_rows.empty()) {
+        // Pull the changed rows out of the time order and merge them back
+        // in at their new positions.
+        this->gs_time_order.erase(
+            std::remove_if(this->gs_time_order.begin(),
+                           this->gs_time_order.end(),
+                           [](const auto& row) { return row.get().or_dirty; }),
+            this->gs_time_order.end());
+        auto mid = this->gs_time_order.size();
+        for (auto* row : dirty_rows) {
+            if (is_visible(*row)) {
+                this->gs_time_order.emplace_back(*row);
             }
         }
+        std::stable_sort(this->gs_time_order.begin() + mid,
+                         this->gs_time_order.end(),
+                         std::less<const opid_row>{});
+        std::inplace_merge(this->gs_time_order.begin(),
+                           this->gs_time_order.begin() + mid,
+                           this->gs_time_order.end(),
+                           std::less<const opid_row>{});
+    }
+    if (filters_changed || bounds_changed || !dirty_rows.empty()) {
+        this->gs_time_tree = std::nullopt;
+    }
 
-        if (pair.second.or_name.length() > this->gs_opid_width) {
-            this->gs_opid_width = pair.second.or_name.length();
+    for (auto* row : dirty_rows) {
+        row->or_dirty = false;
+        if (row->or_file_count == 0) {
+            auto opid = row->or_name;
+
+            this->gs_active_opids.erase(opid);
         }
-        if (full_desc.size() > max_desc_width) {
-            max_desc_width = full_desc.size();
+    }
+
+    this->gs_filtered_count = 0;
+    this->gs_filter_hits = {};
+    if (this->tss_apply_filters) {
+        this->gs_filtered_count
+            = this->gs_active_opids.size() - this->gs_time_order.size();
+        for (const auto& pair : this->gs_active_opids) {
+            for (const auto filter_index : pair.second.or_filter_matches) {
+                this->gs_filter_hits[filter_index] += 1;
+            }
         }
+    }
+
+    this->gs_lower_bound = {};
+    this->gs_upper_bound = {};
+    this->gs_opid_width = 0;
+    auto max_desc_width = size_t{0};
+    for (size_t lpc = 0; lpc < this->gs_time_order.size(); lpc++) {
+        const auto& row = this->gs_time_order[lpc].get();
 
+        if (row.or_name.length() > this->gs_opid_width) {
+            this->gs_opid_width = row.or_name.length();
+        }
+        if (row.or_description.length() > max_desc_width) {
+            max_desc_width = row.or_description.length();
+        }
         if (this->gs_lower_bound.tv_sec == 0
-            || pair.second.or_value.otr_range.tr_begin < this->gs_lower_bound)
+            || row.or_value.otr_range.tr_begin < this->gs_lower_bound)
         {
-            this->gs_lower_bound = pair.second.or_value.otr_range.tr_begin;
+            this->gs_lower_bound = row.or_value.otr_range.tr_begin;
         }
         if (this->gs_upper_bound.tv_sec == 0
-            || this->gs_upper_bound < pair.second.or_value.otr_range.tr_end)
+            || this->gs_upper_bound < row.or_value.otr_range.tr_end)
         {
-            this->gs_upper_bound = pair.second.or_value.otr_range.tr_end;
+            this->gs_upper_bound = row.or_value.otr_range.tr_end;
         }
-        this->gs_time_order.emplace_back(pair.second);
-    }
-    std::stable_sort(this->gs_time_order.begin(),
-                     this->gs_time_order.end(),
-                     std::less<const opid_row>{});
-    for (size_t lpc = 0; lpc < this->gs_time_order.size(); lpc++) {
-        const auto& row = this->gs_time_order[lpc].get();
         if (row.or_value.otr_level_stats.lls_error_count > 0) {
             bm_errs.insert_once(vis_line_t(lpc));
         } else if (row.or_value.otr_level_stats.lls_warning_count > 0) {
@@ -860,48 +1026,58 @@ timeline_source::rebuild_indexes()
 std::optional<vis_line_t>
 timeline_source::row_for_time(struct timeval time_bucket)
 {
-    auto iter = this->gs_time_order.begin();
-    while (true) {
-        if (iter == this->gs_time_order.end()) {
-            return std::nullopt;
-        }
+    if (!this->gs_time_tree) {
+        time_order_tree::interval_vector intervals;
 
-        if (iter->get().or_value.otr_range.contains_inclusive(time_bucket)) {
-            break;
-        }
-        ++iter;
-    }
+        intervals.reserve(this->gs_time_order.size());
+        for (size_t lpc = 0; lpc < this->gs_time_order.size(); lpc++) {
+            const auto& range
+                = this->gs_time_order[lpc].get().or_value.otr_range;
 
-    auto closest_iter = iter;
-    auto closest_diff = time_bucket - iter->get().or_value.otr_range.tr_begin;
-    for (; iter != this->gs_time_order.end(); ++iter) {
-        if (time_bucket < iter->get().or_value.otr_range.tr_begin) {
-            break;
-        }
-        if (!iter->get().or_value.otr_range.contains_inclusive(time_bucket)) {
-            continue;
+            if (range.tr_end < range.tr_begin) {
+                continue;
+            }
+            intervals.emplace_back(to_us(range.tr_begin).count(),
+                                   to_us(range.tr_end).count(),
+                                   lpc);
         }
+        this->gs_time_tree = time_order_tree{std::move(intervals)};
+    }
 
-        auto diff = time_bucket - iter->get().or_value.otr_range.tr_begin;
+    std::vector<size_t> hits;
+    this->gs_time_tree->visit_overlapping(
+        to_us(time_bucket).count(),
+        [&hits](const auto& ival) { hits.emplace_back(ival.value); });
+    if (hits.empty()) {
+        return std::nullopt;
+    }
+    std::sort(hits.begin(), hits.end());
+
+    auto closest_index = hits.front();
+    auto closest_diff = time_bucket
+        - this->gs_time_order[closest_index].get().or_value.otr_range.tr_begin;
+    for (const auto index : hits) {
+        const auto& otr = this->gs_time_order[index].get().or_value;
+        auto diff = time_bucket - otr.otr_range.tr_begin;
         if (diff < closest_diff) {
-            closest_iter = iter;
+            closest_index = index;
             closest_diff = diff;
         }
 
-        for (const auto& sub : iter->get().or_value.otr_sub_ops) {
+        for (const auto& sub : otr.otr_sub_ops) {
             if (!sub.ostr_range.contains_inclusive(time_bucket)) {
                 continue;
             }
 
             diff = time_bucket - sub.ostr_range.tr_begin;
             if (diff < closest_diff) {
-                closest_iter = iter;
+                closest_index = index;
                 closest_diff = diff;
             }
         }
     }
 
-    return vis_line_t(std::distance(this->gs_time_order.begin(), closest_iter));
+    return vis_line_t(closest_index);
 }
 
 std::optional<text_time_translator::row_info>
@@ -31,6 +31,7 @@
 #define lnav_timeline_source_hh
 
 #include "base/map_util.hh"
+#include "intervaltree/IntervalTree.h"
 #include "logfile_sub_source.hh"
 #include "plain_text_source.hh"
 #include "text_overlay_menu.hh"
@@ -91,6 +92,11 @@ public:
     std::optional<vis_line_t> row_for_time(struct timeval time_bucket) override;
     std::optional<row_info> time_for_row(vis_line_t row) override;
 
+    /**
+     * Bring the rows up-to-date with the opids in the log files.  Only the
+     * opids that have changed since the last call are recomputed unless the
+     * set of files has changed.
+     */
     void rebuild_indexes();
 
     std::pair<timeval, timeval> get_time_bounds_for(int line);
@@ -142,6 +148,14 @@ public:
                          lnav::map::small<size_t, std::string>>
             or_descriptions;
         size_t or_max_subid_width{0};
+        /** The number of files that have contributed to this row. */
+        size_t or_file_count{0};
+        /** True if the row needs to be recomputed from the files. */
+        bool or_dirty{false};
+        /** The indexes of the filters that matched the opid/description. */
+        std::vector<size_t> or_filter_matches;
+        bool or_filtered_in{false};
+        bool or_filtered_out{false};
 
         bool operator<(const opid_row& rhs) const
         {
@@ -160,10 +174,10 @@ public:
     };
 
     using timeline_opid_row_map
-        = robin_hood::unordered_map<string_fragment,
-                                    opid_row,
-                                    frag_hasher,
-                                    std::equal_to<string_fragment>>;
+        = robin_hood::unordered_node_map<string_fragment,
+                                         opid_row,
+                                         frag_hasher,
+                                         std::equal_to<string_fragment>>;
     using timeline_desc_map
         = robin_hood::unordered_set<string_fragment,
                                     frag_hasher,
@@ -176,6 +190,32 @@ public:
     timeline_opid_row_map gs_active_opids;
     timeline_desc_map gs_descriptions;
     std::vector<std::reference_wrapper<opid_row>> gs_time_order;
+
+    using time_order_tree = interval_tree::IntervalTree<int64_t, size_t>;
+
+    /**
+     * The time ranges of the rows in gs_time_order, built on demand and
+     * reset whenever the order changes.
+     */
+    std::optional<time_order_tree> gs_time_tree;
+
+    /** A file whose opids are merged into the rows. */
+    struct opid_source {
+        const logfile* os_file;
+        uint32_t os_generation;
+
+        bool operator==(const opid_source& rhs) const
+        {
+            return this->os_file == rhs.os_file
+                && this->os_generation == rhs.os_generation;
+        }
+    };
+
+    std::vector<opid_source> gs_opid_sources;
+    /** Describes the filters that the cached filter results are from. */
+    std::string gs_filter_signature;
+    std::optional<timeval> gs_min_log_time;
+    std::optional<timeval> gs_max_log_time;
     struct timeval gs_lower_bound{};
     struct timeval gs_upper_bound{};
     size_t gs_filtered_count{0};
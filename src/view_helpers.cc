@@ -1043,10 +1043,11 @@ execute_example(std::unordered_map<std::string, attr_line_t>& res_map,
                 if (exec_res.isErr()) {
                     auto um = exec_res.unwrapErr();
                     result.append(um.to_attr_line());
-                } else if (dls.dls_rows.size() == 1
-                           && dls.dls_rows[0].size() == 1)
+                } else if (dls.dls_rows.row_count() == 1
+                           && dls.dls_rows.column_count() == 1)
                 {
-                    result.append(dls.dls_rows[0][0]);
+                    dls.dls_rows.append_cell(
+                        0, 0, db_label_source::NULL_STR, result.get_string());
                 } else {
                     attr_line_t al;
                     dos.list_static_overlay(db_tc, 0, 1, al);
@@ -1418,7 +1419,7 @@ view_title_poss()
                 units = "file";
                 break;
             case LNV_DB:
-                quantity = lnav_data.ld_db_row_source.dls_rows.size();
+                quantity = lnav_data.ld_db_row_source.dls_rows.row_count();
                 units = "row";
                 break;
         }
@@ -38,6 +38,8 @@
 #include "base/opt_util.hh"
 #include "config.h"
 #include "lnav.hh"
+#include "log.format_detect.hh"
+#include "log_vtab_impl.hh"
 #include "sql_util.hh"
 #include "vtab_module_json.hh"
 #include "yajlpp/yajlpp_def.hh"
@@ -1311,12 +1313,270 @@ CREATE TABLE lnav_view_files (
     }
 };
 
+struct lnav_db_indexes : public tvt_iterator_cursor<lnav_db_indexes> {
+    static constexpr const char* NAME = "lnav_db_indexes";
+    static constexpr const char* CREATE_STMT = R"(
+-- The indexes that have been built for the columns of the log tables.
+CREATE TABLE lnav_db_indexes (
+    table_name      TEXT,     -- The name of the log table.
+    column_name     TEXT,     -- The name of the indexed column.
+    kinds           TEXT,     -- The kinds of lookups supported (equality/range).
+    max_line        INTEGER,  -- The lines before this one have been indexed.
+    distinct_values INTEGER,  -- The number of distinct values in the index.
+    entries         INTEGER,  -- The number of numeric values in the index.
+    memory_usage    INTEGER   -- The approximate memory used by the index.
+);
+)";
+
+    struct index_entry {
+        std::shared_ptr<log_vtab_impl> ie_impl;
+        int32_t ie_column;
+    };
+
+    using iterator = std::vector<index_entry>::iterator;
+
+    iterator begin()
+    {
+        this->ldi_entries.clear();
+        if (lnav_data.ld_vtab_manager != nullptr) {
+            for (const auto& vi_pair : *lnav_data.ld_vtab_manager) {
+                for (const auto& ci_pair : vi_pair.second->vi_column_indexes) {
+                    this->ldi_entries.emplace_back(
+                        index_entry{vi_pair.second, ci_pair.first});
+                }
+            }
+        }
+
+        return this->ldi_entries.begin();
+    }
+
+    iterator end() { return this->ldi_entries.end(); }
+
+    int get_column(cursor& vc, sqlite3_context* ctx, int col)
+    {
+        const auto& vi = vc.iter->ie_impl;
+        const auto& ci = vi->vi_column_indexes[vc.iter->ie_column];
+
+        switch (col) {
+            case 0:
+                to_sqlite(ctx, vi->get_name().to_string_fragment());
+                break;
+            case 1: {
+                std::vector<log_vtab_impl::vtab_column> cols;
+                auto index = (size_t) (vc.iter->ie_column - VT_COL_MAX);
+
+                vi->get_columns(cols);
+                if (index < cols.size()) {
+                    to_sqlite(ctx, cols[index].vc_name);
+                } else {
+                    sqlite3_result_null(ctx);
+                }
+                break;
+            }
+            case 2: {
+                std::vector<const char*> kinds;
+
+                if (ci.ci_equality) {
+                    kinds.emplace_back("equality");
+                }
+                if (ci.ci_range) {
+                    kinds.emplace_back("range");
+                }
+                to_sqlite(ctx, fmt::to_string(fmt::join(kinds, ",")));
+                break;
+            }
+            case 3:
+                to_sqlite(ctx, (int64_t) ci.ci_max_line);
+                break;
+            case 4:
+                to_sqlite(ctx, (int64_t) ci.ci_value_to_lines.size());
+                break;
+            case 5:
+                to_sqlite(ctx, (int64_t) ci.ci_numeric_lines.size());
+                break;
+            case 6:
+                to_sqlite(ctx, (int64_t) ci.memory_usage());
+                break;
+        }
+
+        return SQLITE_OK;
+    }
+
+    int delete_row(sqlite3_vtab* tab, sqlite3_int64 rowid)
+    {
+        if (rowid < 0 || rowid >= (sqlite3_int64) this->ldi_entries.size()) {
+            return SQLITE_OK;
+        }
+
+        const auto& entry = this->ldi_entries[rowid];
+        entry.ie_impl->vi_column_indexes.erase(entry.ie_column);
+
+        return SQLITE_OK;
+    }
+
+    int insert_row(sqlite3_vtab* tab, sqlite3_int64& rowid_out)
+    {
+        tab->zErrMsg = sqlite3_mprintf(
+            "Rows cannot be inserted into the lnav_db_indexes table");
+        return SQLITE_ERROR;
+    }
+
+    int update_row(sqlite3_vtab* tab, sqlite3_int64& rowid_out)
+    {
+        tab->zErrMsg = sqlite3_mprintf(
+            "Rows cannot be updated in the lnav_db_indexes table");
+        return SQLITE_ERROR;
+    }
+
+    std::vector<index_entry> ldi_entries;
+};
+
+struct lnav_view_render_cache
+    : public tvt_iterator_cursor<lnav_view_render_cache> {
+    static constexpr const char* NAME = "lnav_view_render_cache";
+    static constexpr const char* CREATE_STMT = R"(
+-- Statistics for the caches of rendered lines.
+CREATE TABLE lnav_view_render_cache (
+    view_name     TEXT,     -- The name of the view.
+    entries       INTEGER,  -- The number of lines in the cache.
+    memory_usage  INTEGER,  -- The approximate memory used by the cache.
+    memory_budget INTEGER,  -- The memory limit for the cache.
+    hits          INTEGER,  -- The number of lookups that were in the cache.
+    misses        INTEGER,  -- The number of lookups that were not.
+    evictions     INTEGER,  -- The number of lines dropped to stay in budget.
+    invalidations INTEGER   -- The number of times the cache was cleared.
+);
+)";
+
+    using iterator = std::vector<lnav_view_t>::iterator;
+
+    iterator begin()
+    {
+        this->lvrc_views = {LNV_LOG};
+        return this->lvrc_views.begin();
+    }
+
+    iterator end() { return this->lvrc_views.end(); }
+
+    int get_column(cursor& vc, sqlite3_context* ctx, int col)
+    {
+        const auto& rc = lnav_data.ld_log_source.get_render_cache();
+        const auto& stats = rc.get_stats();
+
+        switch (col) {
+            case 0:
+                sqlite3_result_text(
+                    ctx, lnav_view_strings[*vc.iter], -1, SQLITE_STATIC);
+                break;
+            case 1:
+                to_sqlite(ctx, (int64_t) rc.size());
+                break;
+            case 2:
+                to_sqlite(ctx, (int64_t) rc.get_memory_usage());
+                break;
+            case 3:
+                to_sqlite(ctx, (int64_t) rc.get_budget());
+                break;
+            case 4:
+                to_sqlite(ctx, (int64_t) stats.s_hits);
+                break;
+            case 5:
+                to_sqlite(ctx, (int64_t) stats.s_misses);
+                break;
+            case 6:
+                to_sqlite(ctx, (int64_t) stats.s_evictions);
+                break;
+            case 7:
+                to_sqlite(ctx, (int64_t) stats.s_invalidations);
+                break;
+        }
+
+        return SQLITE_OK;
+    }
+
+    std::vector<lnav_view_t> lvrc_views;
+};
+
+struct lnav_format_detection
+    : public tvt_iterator_cursor<lnav_format_detection> {
+    static constexpr const char* NAME = "lnav_format_detection";
+    static constexpr const char* CREATE_STMT = R"(
+-- The cost of detecting the format of log files.
+CREATE TABLE lnav_format_detection (
+    format_name  TEXT,     -- The name of the log format.
+    prefilter    TEXT,     -- The check used to skip lines: none, json, pattern
+    scans        INTEGER,  -- The number of lines scanned with the format.
+    skips        INTEGER,  -- The number of lines skipped by the prefilter.
+    matches      INTEGER,  -- The number of scanned lines that matched.
+    scan_time_us INTEGER   -- The total time spent scanning, in microseconds.
+);
+)";
+
+    using iterator = std::vector<lnav::log::format_detector::entry>::iterator;
+
+    iterator begin()
+    {
+        this->lfd_entries
+            = lnav::log::format_detector::singleton().get_entries();
+        return this->lfd_entries.begin();
+    }
+
+    iterator end() { return this->lfd_entries.end(); }
+
+    int get_column(cursor& vc, sqlite3_context* ctx, int col)
+    {
+        const auto& ent = *vc.iter;
+
+        switch (col) {
+            case 0:
+                to_sqlite(ctx, ent.e_name.to_string_fragment());
+                break;
+            case 1:
+                switch (ent.e_prefilter) {
+                    case lnav::log::format_detector::prefilter_t::none:
+                        to_sqlite(ctx, "none");
+                        break;
+                    case lnav::log::format_detector::prefilter_t::json:
+                        to_sqlite(ctx, "json");
+                        break;
+                    case lnav::log::format_detector::prefilter_t::pattern:
+                        to_sqlite(ctx, "pattern");
+                        break;
+                }
+                break;
+            case 2:
+                to_sqlite(ctx, (int64_t) ent.e_stats.fs_scans);
+                break;
+            case 3:
+                to_sqlite(ctx, (int64_t) ent.e_stats.fs_skips);
+                break;
+            case 4:
+                to_sqlite(ctx, (int64_t) ent.e_stats.fs_matches);
+                break;
+            case 5:
+                to_sqlite(
+                    ctx,
+                    (int64_t) std::chrono::duration_cast<
+                        std::chrono::microseconds>(ent.e_stats.fs_scan_time)
+                        .count());
+                break;
+        }
+
+        return SQLITE_OK;
+    }
+
+    std::vector<lnav::log::format_detector::entry> lfd_entries;
+};
+
 static auto a = injector::bind_multiple<vtab_module_base>()
                     .add<vtab_module<lnav_views>>()
                     .add<vtab_module<lnav_view_stack>>()
                     .add<vtab_module<lnav_view_filters>>()
                     .add<vtab_module<tvt_no_update<lnav_view_filter_stats>>>()
-                    .add<vtab_module<lnav_view_files>>();
+                    .add<vtab_module<lnav_view_files>>()
+                    .add<vtab_module<lnav_db_indexes>>()
+                    .add<vtab_module<tvt_no_update<lnav_view_render_cache>>>()
+                    .add<vtab_module<tvt_no_update<lnav_format_detection>>>();
 
 }  // namespace
 
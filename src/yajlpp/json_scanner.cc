@@ -0,0 +1,625 @@
+/**
+ * Copyright (c) 2024, Timothy Stack
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ * * Neither the name of Timothy Stack nor the names of its contributors
+ * may be used to endorse or promote products derived from this software
+ * without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE REGENTS AND CONTRIBUTORS ''AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * @file json_scanner.cc
+ */
+
+#include "json_scanner.hh"
+
+#include "config.h"
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#    define JSON_SCANNER_SSE2 1
+#    include <emmintrin.h>
+#endif
+
+namespace yajlpp {
+
+namespace {
+
+constexpr size_t MAX_DEPTH = 128;
+constexpr size_t UNUSUAL_NUMBER_LENGTH = 16;
+
+struct cursor {
+    const char* c_pos;
+    const char* c_end;
+    bool c_unusual_numbers{false};
+
+    bool at_end() const { return this->c_pos >= this->c_end; }
+
+    char peek() const { return *this->c_pos; }
+
+    void skip_ws()
+    {
+        while (this->c_pos < this->c_end) {
+            switch (*this->c_pos) {
+                case ' ':
+                case '\t':
+                case '\n':
+                case '\v':
+                case '\f':
+                case '\r':
+                    this->c_pos += 1;
+                    break;
+                default:
+                    return;
+            }
+        }
+    }
+};
+
+/**
+ * Find the next byte that ends the plain part of a string: a quote, a
+ * backslash, or a control character.
+ */
+const char*
+find_string_special(const char* pos, const char* end)
+{
+#ifdef JSON_SCANNER_SSE2
+    const auto quote = _mm_set1_epi8('"');
+    const auto backslash = _mm_set1_epi8('\\');
+    const auto max_ctrl = _mm_set1_epi8(0x1f);
+
+    while (end - pos >= 16) {
+        const auto chunk = _mm_loadu_si128((const __m128i*) pos);
+        const auto specials = _mm_or_si128(
+            _mm_or_si128(_mm_cmpeq_epi8(chunk, quote),
+                         _mm_cmpeq_epi8(chunk, backslash)),
+            _mm_cmpeq_epi8(_mm_min_epu8(chunk, max_ctrl), chunk));
+        const auto mask = _mm_movemask_epi8(specials);
+
+        if (mask != 0) {
+            return pos + __builtin_ctz(mask);
+        }
+        pos += 16;
+    }
+#endif
+    while (pos < end) {
+        const auto ch = (unsigned char) *pos;
+
+        if (ch == '"' || ch == '\\' || ch < 0x20) {
+            return pos;
+        }
+        pos += 1;
+    }
+
+    return end;
+}
+
+bool
+is_hex(char ch)
+{
+    return ('0' <= ch && ch <= '9') || ('a' <= ch && ch <= 'f')
+        || ('A' <= ch && ch <= 'F');
+}
+
+/**
+ * Scan a string that starts after the opening quote.
+ *
+ * @return true if the string is valid, the cursor will be after the
+ *   closing quote.
+ */
+bool
+scan_string(cursor& cur, string_fragment& contents_out, bool& escaped_out)
+{
+    const auto* start = cur.c_pos;
+
+    escaped_out = false;
+    while (true) {
+        cur.c_pos = find_string_special(cur.c_pos, cur.c_end);
+        if (cur.at_end()) {
+            return false;
+        }
+        switch (cur.peek()) {
+            case '"':
+                contents_out = string_fragment::from_bytes(
+                    start, cur.c_pos - start);
+                cur.c_pos += 1;
+                return true;
+            case '\\':
+                escaped_out = true;
+                if (cur.c_end - cur.c_pos < 2) {
+                    return false;
+                }
+                switch (cur.c_pos[1]) {
+                    case '"':
+                    case '\\':
+                    case '/':
+                    case 'b':
+                    case 'f':
+                    case 'n':
+                    case 'r':
+                    case 't':
+                        cur.c_pos += 2;
+                        break;
+                    case 'u':
+                        if (cur.c_end - cur.c_pos < 6 || !is_hex(cur.c_pos[2])
+                            || !is_hex(cur.c_pos[3]) || !is_hex(cur.c_pos[4])
+                            || !is_hex(cur.c_pos[5]))
+                        {
+                            return false;
+                        }
+                        cur.c_pos += 6;
+                        break;
+                    default:
+                        return false;
+                }
+                break;
+            default:
+                // control character
+                return false;
+        }
+    }
+}
+
+bool
+scan_digits(cursor& cur)
+{
+    const auto* start = cur.c_pos;
+
+    while (!cur.at_end() && '0' <= cur.peek() && cur.peek() <= '9') {
+        cur.c_pos += 1;
+    }
+
+    return cur.c_pos > start;
+}
+
+bool
+scan_number(cursor& cur, string_fragment& number_out)
+{
+    const auto* start = cur.c_pos;
+
+    if (cur.peek() == '-') {
+        cur.c_pos += 1;
+    }
+    if (cur.at_end()) {
+        return false;
+    }
+    if (cur.peek() == '0') {
+        cur.c_pos += 1;
+    } else if (!scan_digits(cur)) {
+        return false;
+    }
+    if (!cur.at_end() && cur.peek() == '.') {
+        cur.c_pos += 1;
+        if (!scan_digits(cur)) {
+            return false;
+        }
+    }
+    if (!cur.at_end() && (cur.peek() == 'e' || cur.peek() == 'E')) {
+        cur.c_pos += 1;
+        if (!cur.at_end() && (cur.peek() == '+' || cur.peek() == '-')) {
+            cur.c_pos += 1;
+        }
+        if (!scan_digits(cur)) {
+            return false;
+        }
+        cur.c_unusual_numbers = true;
+    }
+    if (!cur.at_end() && '0' <= cur.peek() && cur.peek() <= '9') {
+        // a leading zero followed by more digits
+        return false;
+    }
+    if ((size_t) (cur.c_pos - start) >= UNUSUAL_NUMBER_LENGTH) {
+        cur.c_unusual_numbers = true;
+    }
+    number_out = string_fragment::from_bytes(start, cur.c_pos - start);
+
+    return true;
+}
+
+bool
+scan_keyword(cursor& cur, const char* keyword, size_t len)
+{
+    if ((size_t) (cur.c_end - cur.c_pos) < len
+        || memcmp(cur.c_pos, keyword, len) != 0)
+    {
+        return false;
+    }
+    cur.c_pos += len;
+    return true;
+}
+
+bool scan_value(cursor& cur, json_scanner::member& mem, size_t depth);
+
+bool
+scan_container(cursor& cur, bool is_object, size_t depth)
+{
+    const char close = is_object ? '}' : ']';
+    json_scanner::member mem;
+
+    if (depth >= MAX_DEPTH) {
+        return false;
+    }
+
+    // skip the opening bracket
+    cur.c_pos += 1;
+    cur.skip_ws();
+    if (cur.at_end()) {
+        return false;
+    }
+    if (cur.peek() == close) {
+        cur.c_pos += 1;
+        return true;
+    }
+    while (true) {
+        if (is_object) {
+            if (cur.peek() != '"') {
+                return false;
+            }
+            cur.c_pos += 1;
+            if (!scan_string(cur, mem.m_key, mem.m_key_escaped)) {
+                return false;
+            }
+            cur.skip_ws();
+            if (cur.at_end() || cur.peek() != ':') {
+                return false;
+            }
+            cur.c_pos += 1;
+            cur.skip_ws();
+        }
+        if (!scan_value(cur, mem, depth + 1)) {
+            return false;
+        }
+        cur.skip_ws();
+        if (cur.at_end()) {
+            return false;
+        }
+        if (cur.peek() == close) {
+            cur.c_pos += 1;
+            return true;
+        }
+        if (cur.peek() != ',') {
+            return false;
+        }
+        cur.c_pos += 1;
+        cur.skip_ws();
+        if (cur.at_end()) {
+            return false;
+        }
+    }
+}
+
+bool
+scan_value(cursor& cur, json_scanner::member& mem, size_t depth)
+{
+    using value_type = json_scanner::value_type;
+
+    if (cur.at_end()) {
+        return false;
+    }
+
+    const auto* start = cur.c_pos;
+    mem.m_value_escaped = false;
+    switch (cur.peek()) {
+        case '"':
+            mem.m_type = value_type::string;
+            cur.c_pos += 1;
+            return scan_string(cur, mem.m_value, mem.m_value_escaped);
+        case '{':
+        case '[': {
+            auto is_object = cur.peek() == '{';
+
+            mem.m_type = is_object ? value_type::object : value_type::array;
+            if (!scan_container(cur, is_object, depth)) {
+                return false;
+            }
+            mem.m_value = string_fragment::from_bytes(start, cur.c_pos - start);
+            return true;
+        }
+        case 't':
+            mem.m_type = value_type::boolean_true;
+            if (!scan_keyword(cur, "true", 4)) {
+                return false;
+            }
+            break;
+        case 'f':
+            mem.m_type = value_type::boolean_false;
+            if (!scan_keyword(cur, "false", 5)) {
+                return false;
+            }
+            break;
+        case 'n':
+            mem.m_type = value_type::null;
+            if (!scan_keyword(cur, "null", 4)) {
+                return false;
+            }
+            break;
+        default:
+            mem.m_type = value_type::number;
+            return scan_number(cur, mem.m_value);
+    }
+    mem.m_value = string_fragment::from_bytes(start, cur.c_pos - start);
+
+    return true;
+}
+
+void
+hex_to_digit(unsigned int* val, const char* hex)
+{
+    for (size_t lpc = 0; lpc < 4; lpc++) {
+        auto ch = (unsigned char) hex[lpc];
+
+        if (ch >= 'A') {
+            ch = (ch & ~0x20) - 7;
+        }
+        ch -= '0';
+        *val = (*val << 4) | ch;
+    }
+}
+
+void
+append_utf8(unsigned int codepoint, std::string& out)
+{
+    if (codepoint < 0x80) {
+        out.push_back((char) codepoint);
+    } else if (codepoint < 0x0800) {
+        out.push_back((char) ((codepoint >> 6) | 0xC0));
+        out.push_back((char) ((codepoint & 0x3F) | 0x80));
+    } else if (codepoint < 0x10000) {
+        out.push_back((char) ((codepoint >> 12) | 0xE0));
+        out.push_back((char) (((codepoint >> 6) & 0x3F) | 0x80));
+        out.push_back((char) ((codepoint & 0x3F) | 0x80));
+    } else if (codepoint < 0x200000) {
+        out.push_back((char) ((codepoint >> 18) | 0xF0));
+        out.push_back((char) (((codepoint >> 12) & 0x3F) | 0x80));
+        out.push_back((char) (((codepoint >> 6) & 0x3F) | 0x80));
+        out.push_back((char) ((codepoint & 0x3F) | 0x80));
+    } else {
+        out.push_back('?');
+    }
+}
+
+void
+walk_container(string_fragment container,
+               std::string& path,
+               const json_scanner::nested_callback& cb)
+{
+    cursor cur{container.begin(), container.end()};
+    const auto is_object = cur.peek() == '{';
+    const auto close = is_object ? '}' : ']';
+    const auto base_len = path.size();
+    json_scanner::member mem;
+    std::string key;
+
+    if (!is_object) {
+        path.push_back('#');
+    }
+    cur.c_pos += 1;
+    cur.skip_ws();
+    while (!cur.at_end() && cur.peek() != close) {
+        if (is_object) {
+            cur.c_pos += 1;
+            scan_string(cur, mem.m_key, mem.m_key_escaped);
+            cur.skip_ws();
+            cur.c_pos += 1;
+            cur.skip_ws();
+
+            path.resize(base_len);
+            if (!path.empty() && path.back() != '/') {
+                path.push_back('/');
+            }
+            if (mem.m_key_escaped) {
+                key.clear();
+                json_scanner::unescape(mem.m_key, key);
+                json_scanner::append_path_key(string_fragment::from_str(key),
+                                              path);
+            } else {
+                json_scanner::append_path_key(mem.m_key, path);
+            }
+        }
+        scan_value(cur, mem, 0);
+        if (mem.is_container()) {
+            walk_container(mem.m_value, path, cb);
+        } else {
+            cb(path, mem);
+        }
+        cur.skip_ws();
+        if (!cur.at_end() && cur.peek() == ',') {
+            cur.c_pos += 1;
+            cur.skip_ws();
+        }
+    }
+    path.resize(base_len);
+}
+
+}  // namespace
+
+json_scanner::scan_result
+json_scanner::scan_object(string_fragment line, std::vector<member>& members_out)
+{
+    cursor cur{line.begin(), line.end()};
+    scan_result retval;
+
+    members_out.clear();
+    cur.skip_ws();
+    if (cur.at_end() || cur.peek() != '{') {
+        return retval;
+    }
+    cur.c_pos += 1;
+    cur.skip_ws();
+    if (cur.at_end()) {
+        return retval;
+    }
+    if (cur.peek() != '}') {
+        while (true) {
+            auto& mem = members_out.emplace_back();
+
+            if (cur.peek() != '"') {
+                return retval;
+            }
+            cur.c_pos += 1;
+            if (!scan_string(cur, mem.m_key, mem.m_key_escaped)) {
+                return retval;
+            }
+            cur.skip_ws();
+            if (cur.at_end() || cur.peek() != ':') {
+                return retval;
+            }
+            cur.c_pos += 1;
+            cur.skip_ws();
+            if (!scan_value(cur, mem, 1)) {
+                return retval;
+            }
+            cur.skip_ws();
+            if (cur.at_end()) {
+                return retval;
+            }
+            if (cur.peek() == '}') {
+                break;
+            }
+            if (cur.peek() != ',') {
+                return retval;
+            }
+            cur.c_pos += 1;
+            cur.skip_ws();
+            if (cur.at_end()) {
+                return retval;
+            }
+        }
+    }
+    cur.c_pos += 1;
+    cur.skip_ws();
+    if (!cur.at_end()) {
+        // trailing garbage
+        return retval;
+    }
+
+    retval.sr_valid = true;
+    retval.sr_unusual_numbers = cur.c_unusual_numbers;
+    return retval;
+}
+
+void
+json_scanner::walk_nested(const member& container,
+                          std::string& path,
+                          const nested_callback& cb)
+{
+    if (!container.is_container()) {
+        return;
+    }
+
+    walk_container(container.m_value, path, cb);
+}
+
+void
+json_scanner::unescape(string_fragment raw, std::string& out)
+{
+    const auto* str = raw.data();
+    const size_t len = raw.length();
+    size_t beg = 0;
+    size_t end = 0;
+
+    while (end < len) {
+        if (str[end] != '\\') {
+            end += 1;
+            continue;
+        }
+
+        out.append(str + beg, end - beg);
+        end += 1;
+        switch (str[end]) {
+            case 'r':
+                out.push_back('\r');
+                break;
+            case 'n':
+                out.push_back('\n');
+                break;
+            case '\\':
+                out.push_back('\\');
+                break;
+            case '/':
+                out.push_back('/');
+                break;
+            case '"':
+                out.push_back('"');
+                break;
+            case 'f':
+                out.push_back('\f');
+                break;
+            case 'b':
+                out.push_back('\b');
+                break;
+            case 't':
+                out.push_back('\t');
+                break;
+            case 'u': {
+                unsigned int codepoint = 0;
+
+                end += 1;
+                hex_to_digit(&codepoint, str + end);
+                end += 3;
+                if ((codepoint & 0xFC00) == 0xD800) {
+                    if (end + 2 < len && str[end + 1] == '\\'
+                        && str[end + 2] == 'u')
+                    {
+                        unsigned int surrogate = 0;
+
+                        end += 1;
+                        hex_to_digit(&surrogate, str + end + 2);
+                        codepoint = (((codepoint & 0x3F) << 10)
+                                     | ((((codepoint >> 6) & 0xF) + 1) << 16)
+                                     | (surrogate & 0x3FF));
+                        end += 5;
+                    } else {
+                        out.push_back('?');
+                        break;
+                    }
+                }
+                append_utf8(codepoint, out);
+                break;
+            }
+        }
+        end += 1;
+        beg = end;
+    }
+    out.append(str + beg, end - beg);
+}
+
+void
+json_scanner::append_path_key(string_fragment key, std::string& path)
+{
+    for (const auto ch : key) {
+        switch (ch) {
+            case '~':
+                path.append("~0");
+                break;
+            case '/':
+                path.append("~1");
+                break;
+            case '#':
+                path.append("~2");
+                break;
+            default:
+                path.push_back(ch);
+                break;
+        }
+    }
+}
+
+}  // namespace yajlpp
@@ -0,0 +1,134 @@
+/**
+ * Copyright (c) 2024, Timothy Stack
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ * * Neither the name of Timothy Stack nor the names of its contributors
+ * may be used to endorse or promote products derived from this software
+ * without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE REGENTS AND CONTRIBUTORS ''AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * @file json_scanner.hh
+ */
+
+#ifndef yajlpp_json_scanner_hh
+#define yajlpp_json_scanner_hh
+
+#include <functional>
+#include <string>
+#include <vector>
+
+#include <stdint.h>
+
+#include "base/intern_string.hh"
+
+namespace yajlpp {
+
+/**
+ * A scanner for lines that hold a single JSON object, like the lines of a
+ * JSON-lines log file.  Unlike a yajl parse, no callbacks are made while
+ * scanning.  The line is checked to be valid JSON and the top-level
+ * members are collected as fragments of the line.  Nested objects and
+ * arrays are skipped over as a whole and can be walked later if they are
+ * needed.  Anything the scanner is not sure about is treated as an error,
+ * so callers can fall back to a full parse.
+ */
+class json_scanner {
+public:
+    enum class value_type : uint8_t {
+        string,
+        number,
+        boolean_true,
+        boolean_false,
+        null,
+        object,
+        array,
+    };
+
+    struct member {
+        /** The key without the quotes and with any escapes still in it. */
+        string_fragment m_key;
+        bool m_key_escaped{false};
+        value_type m_type{value_type::null};
+        /**
+         * The value as it appears in the line, minus the quotes for a
+         * string.  For objects and arrays, this includes the brackets.
+         */
+        string_fragment m_value;
+        bool m_value_escaped{false};
+
+        bool is_container() const
+        {
+            return this->m_type == value_type::object
+                || this->m_type == value_type::array;
+        }
+    };
+
+    struct scan_result {
+        /** True if the line is a single JSON object. */
+        bool sr_valid{false};
+        /**
+         * True if a number in the line has an exponent or is very long
+         * and might not convert to a double.
+         */
+        bool sr_unusual_numbers{false};
+    };
+
+    /**
+     * Scan a line that should contain a single JSON object.
+     *
+     * @param line The line to scan.
+     * @param members_out Receives the top-level members of the object.
+     */
+    static scan_result scan_object(string_fragment line,
+                                   std::vector<member>& members_out);
+
+    using nested_callback
+        = std::function<void(const std::string& path, const member& value)>;
+
+    /**
+     * Call the callback for each scalar nested in a container that was
+     * returned by scan_object().  The paths have the same format as the
+     * ones produced by yajlpp_parse_context::get_path(), so they start
+     * with the given path prefix.
+     *
+     * @param container The object or array value to walk.
+     * @param path The path of the container, this is modified during the
+     *   walk and restored when done.
+     */
+    static void walk_nested(const member& container,
+                            std::string& path,
+                            const nested_callback& cb);
+
+    /**
+     * Decode the escapes in a string the same way yajl does.
+     */
+    static void unescape(string_fragment raw, std::string& out);
+
+    /**
+     * Append a key to a path, escaping it the way yajlpp does.
+     */
+    static void append_path_key(string_fragment key, std::string& path);
+};
+
+}  // namespace yajlpp
+
+#endif
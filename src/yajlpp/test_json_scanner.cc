@@ -0,0 +1,139 @@
+/**
+ * Copyright (c) 2026, Timothy Stack
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ * * Neither the name of Timothy Stack nor the names of its contributors
+ * may be used to endorse or promote products derived from this software
+ * without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY TIMOTHY STACK AND CONTRIBUTORS ''AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * @file test_json_scanner.cc
+ */
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "config.h"
+#include "yajlpp/json_scanner.hh"
+
+using yajlpp::json_scanner;
+
+static bool
+is_valid(const char* line)
+{
+    std::vector<json_scanner::member> members;
+
+    return json_scanner::scan_object(string_fragment::from_c_str(line),
+                                     members)
+        .sr_valid;
+}
+
+int
+main(int argc, const char* argv[])
+{
+    assert(is_valid("{}"));
+    assert(is_valid(" { } "));
+    assert(is_valid(R"({"a": 1, "b": [1, 2.5, -0.1], "c": {"d": null}})"));
+    assert(is_valid(R"({"a": "é\n\"", "b": true, "c": false})"));
+    assert(!is_valid(""));
+    assert(!is_valid("[]"));
+    assert(!is_valid("{"));
+    assert(!is_valid(R"({"a": 1,})"));
+    assert(!is_valid(R"({"a": 01})"));
+    assert(!is_valid(R"({"a": 1.})"));
+    assert(!is_valid(R"({"a": tru})"));
+    assert(!is_valid(R"({"a": "\x"})"));
+    assert(!is_valid(R"({"a": "\u12"})"));
+    assert(!is_valid("{\"a\": \"\t\"}"));
+    assert(!is_valid(R"({"a": [1, 2})"));
+    assert(!is_valid(R"({"a": 1} x)"));
+    assert(!is_valid(R"({"a": 1}{})"));
+
+    {
+        std::vector<json_scanner::member> members;
+        auto res = json_scanner::scan_object(
+            string_fragment::from_const(
+                R"({"ts": 1.5, "msg": "hello, \"world\"", )"
+                R"("a\/b": {"c": [1, {"d": "x"}]}, "n": 1e3})"),
+            members);
+
+        assert(res.sr_valid);
+        assert(res.sr_unusual_numbers);
+        assert(members.size() == 4);
+        assert(members[0].m_key == "ts");
+        assert(members[0].m_type == json_scanner::value_type::number);
+        assert(members[0].m_value == "1.5");
+        assert(members[1].m_type == json_scanner::value_type::string);
+        assert(members[1].m_value_escaped);
+        assert(members[1].m_value == R"(hello, \"world\")");
+        assert(members[2].m_key_escaped);
+        assert(members[2].m_type == json_scanner::value_type::object);
+        assert(members[2].m_value == R"({"c": [1, {"d": "x"}]})");
+
+        std::string unescaped;
+        json_scanner::unescape(members[1].m_value, unescaped);
+        assert(unescaped == R"(hello, "world")");
+
+        std::string path;
+        unescaped.clear();
+        json_scanner::unescape(members[2].m_key, unescaped);
+        json_scanner::append_path_key(string_fragment::from_str(unescaped),
+                                      path);
+        assert(path == "a~1b");
+
+        std::map<std::string, std::string> nested;
+        json_scanner::walk_nested(
+            members[2],
+            path,
+            [&nested](const std::string& nested_path,
+                      const json_scanner::member& mem) {
+                nested[nested_path] = mem.m_value.to_string();
+            });
+        assert(path == "a~1b");
+        assert(nested.size() == 2);
+        assert(nested["a~1b/c#"] == "1");
+        assert(nested["a~1b/c#/d"] == "x");
+    }
+
+    {
+        std::string out;
+
+        json_scanner::unescape(string_fragment::from_const(R"(\u00e9\t\/)"),
+                               out);
+        assert(out == "\xc3\xa9\t/");
+
+        out.clear();
+        json_scanner::unescape(
+            string_fragment::from_const(R"(\ud83d\ude00!)"), out);
+        assert(out == "\xf0\x9f\x98\x80!");
+
+        out.clear();
+        json_scanner::unescape(string_fragment::from_const(R"(\ud83d!)"),
+                               out);
+        assert(out == "?!");
+    }
+}
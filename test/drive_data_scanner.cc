@@ -31,8 +31,11 @@
 #    include <alloca.h>
 #endif
 
+#include <atomic>
+#include <chrono>
 #include <fstream>
 #include <iostream>
+#include <new>
 
 #include <stdio.h>
 #include <stdlib.h>
@@ -52,6 +55,103 @@
 
 const char* TMP_NAME = "scanned.tmp";
 
+static std::atomic<size_t> ALLOCATION_COUNT{0};
+
+void*
+operator new(std::size_t size)
+{
+    ALLOCATION_COUNT += 1;
+    auto* retval = malloc(size == 0 ? 1 : size);
+    if (retval == nullptr) {
+        throw std::bad_alloc();
+    }
+    return retval;
+}
+
+void
+operator delete(void* ptr) noexcept
+{
+    free(ptr);
+}
+
+void
+operator delete(void* ptr, std::size_t) noexcept
+{
+    free(ptr);
+}
+
+/**
+ * Parse every line in the given file the given number of times and report
+ * the throughput and the number of heap allocations done for each line.
+ */
+static int
+benchmark(const char* path, int iterations)
+{
+    std::ifstream in(path);
+    std::vector<std::string> lines;
+    std::string line;
+
+    if (!in.is_open()) {
+        fprintf(stderr, "error: unable to open file -- %s\n", path);
+        return EXIT_FAILURE;
+    }
+    while (getline(in, line)) {
+        lines.emplace_back(line);
+    }
+    if (lines.empty()) {
+        fprintf(stderr, "error: file is empty -- %s\n", path);
+        return EXIT_FAILURE;
+    }
+
+    shared_buffer share_manager;
+    std::vector<shared_buffer_ref> sbrs(lines.size());
+    for (size_t lpc = 0; lpc < lines.size(); lpc++) {
+        sbrs[lpc].share(share_manager, lines[lpc].data(), lines[lpc].size());
+    }
+
+    // "fresh" creates a scanner and parser for every line while "reused"
+    // resets a single pair, like the log data tables do.
+    for (const auto reuse : {false, true}) {
+        data_scanner reused_ds{string_fragment{}};
+        data_parser reused_dp(&reused_ds);
+        size_t pair_count = 0;
+        auto start_allocs = ALLOCATION_COUNT.load();
+        auto start_time = std::chrono::steady_clock::now();
+
+        for (int iter = 0; iter < iterations; iter++) {
+            for (const auto& sbr : sbrs) {
+                if (reuse) {
+                    reused_ds.reset(sbr.to_string_fragment(), 0);
+                    reused_dp.reset(&reused_ds);
+                    reused_dp.parse();
+                    pair_count += reused_dp.dp_pairs.size();
+                } else {
+                    data_scanner ds(sbr, 0, sbr.length());
+                    data_parser dp(&ds);
+
+                    dp.parse();
+                    pair_count += dp.dp_pairs.size();
+                }
+            }
+        }
+
+        auto end_time = std::chrono::steady_clock::now();
+        auto allocs = ALLOCATION_COUNT.load() - start_allocs;
+        auto total_lines = lines.size() * iterations;
+        auto secs
+            = std::chrono::duration<double>(end_time - start_time).count();
+
+        printf("%-6s lines=%zu pairs=%zu lines/sec=%.0f allocs/line=%.1f\n",
+               reuse ? "reused" : "fresh",
+               total_lines,
+               pair_count,
+               secs > 0.0 ? total_lines / secs : 0.0,
+               (double) allocs / total_lines);
+    }
+
+    return EXIT_SUCCESS;
+}
+
 static auto bound_file_options_hier
     = injector::bind<lnav::safe_file_options_hier>::to_singleton();
 
@@ -61,6 +161,7 @@ main(int argc, char* argv[])
     int c, retval = EXIT_SUCCESS;
     bool prompt = false, is_log = false, pretty_print = false;
     bool scanner_details = false;
+    int bench_iterations = 0;
 
     {
         static auto builtin_formats
@@ -80,8 +181,16 @@ main(int argc, char* argv[])
         load_formats(paths, errors);
     }
 
-    while ((c = getopt(argc, argv, "pPls")) != -1) {
+    while ((c = getopt(argc, argv, "b:pPls")) != -1) {
         switch (c) {
+            case 'b':
+                bench_iterations = atoi(optarg);
+                if (bench_iterations <= 0) {
+                    fprintf(stderr, "error: expecting a positive count\n");
+                    retval = EXIT_FAILURE;
+                }
+                break;
+
             case 'p':
                 prompt = true;
                 break;
@@ -111,6 +220,10 @@ main(int argc, char* argv[])
     } else if (argc < 1) {
         fprintf(stderr, "error: expecting file name argument(s)\n");
         retval = EXIT_FAILURE;
+    } else if (bench_iterations > 0) {
+        for (int lpc = 0; lpc < argc && retval == EXIT_SUCCESS; lpc++) {
+            retval = benchmark(argv[lpc], bench_iterations);
+        }
     } else {
         for (int lpc = 0; lpc < argc; lpc++) {
             std::unique_ptr<std::ifstream> in_ptr;
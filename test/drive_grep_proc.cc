@@ -137,7 +137,7 @@ main(int argc, char* argv[])
                 vector<struct pollfd> pollfds;
 
                 psuperv->update_poll_set(pollfds);
-                poll(&pollfds[0], pollfds.size(), -1);
+                psuperv->poll(pollfds, std::chrono::milliseconds(-1));
 
                 psuperv->check_poll_set(pollfds);
             }
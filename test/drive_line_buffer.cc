@@ -42,6 +42,9 @@
 #include <unistd.h>
 
 #include "base/auto_fd.hh"
+#include "base/injector.hh"
+#include "base/isc.hh"
+#include "base/lnav_log.hh"
 #include "base/string_util.hh"
 #include "config.h"
 #include "line_buffer.hh"
@@ -57,9 +60,12 @@ main(int argc, char* argv[])
     int offseti = 0;
     off_t offset = 0;
     int count = 1000;
+    bool cache = false;
     struct stat st;
+    // The line buffer preloads data using the io_looper service.
+    isc::supervisor root_superv(injector::get<isc::service_list>());
 
-    while ((c = getopt(argc, argv, "o:i:n:c:")) != -1) {
+    while ((c = getopt(argc, argv, "o:i:n:c:Cd:")) != -1) {
         switch (c) {
             case 'o':
                 if (sscanf(optarg, "%d", &offseti) != 1) {
@@ -87,6 +93,12 @@ main(int argc, char* argv[])
                     retval = EXIT_FAILURE;
                 }
                 break;
+            case 'C':
+                cache = true;
+                break;
+            case 'd':
+                lnav_log_file = fopen(optarg, "w");
+                break;
             case 'i': {
                 FILE* file;
 
@@ -145,6 +157,9 @@ main(int argc, char* argv[])
             int fd2 = (argc > 1) ? fd_cmp.get() : fd.get();
             assert(fd2 >= 0);
             lb.set_fd(fd);
+            if (cache) {
+                lb.enable_cache();
+            }
             if (index.size() == 0) {
                 while (count) {
                     auto load_result = lb.load_next_line(last_range);
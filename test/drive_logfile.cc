@@ -39,8 +39,10 @@
 
 #include "base/injector.bind.hh"
 #include "base/injector.hh"
+#include "base/lnav_log.hh"
 #include "base/opt_util.hh"
 #include "config.h"
+#include "lnav_config.hh"
 #include "log_format.hh"
 #include "log_format_loader.hh"
 #include "logfile.hh"
@@ -70,6 +72,7 @@ main(int argc, char* argv[])
     int c, retval = EXIT_SUCCESS;
     dl_mode_t mode = MODE_NONE;
     string expected_format;
+    bool use_deadline = false;
 
     {
         static auto builtin_formats
@@ -91,8 +94,17 @@ main(int argc, char* argv[])
         load_formats(paths, errors);
     }
 
-    while ((c = getopt(argc, argv, "ef:ltv")) != -1) {
+    while ((c = getopt(argc, argv, "Dd:ef:j:ltv")) != -1) {
         switch (c) {
+            case 'D':
+                use_deadline = true;
+                break;
+            case 'd':
+                lnav_log_file = fopen(optarg, "w");
+                break;
+            case 'j':
+                lnav_config.lc_logfile.lc_index_threads = atoi(optarg);
+                break;
             case 'f':
                 expected_format = optarg;
                 break;
@@ -134,13 +146,23 @@ main(int argc, char* argv[])
         stat(argv[0], &st);
         assert(strcmp(argv[0], lf->get_filename().c_str()) == 0);
 
-        lf->rebuild_index();
-        assert(!lf->is_closed());
-        lf->rebuild_index();
-        assert(!lf->is_closed());
-        lf->rebuild_index();
-        assert(!lf->is_closed());
-        assert(lf->get_activity().la_polls == 3);
+        if (use_deadline) {
+            // Index with a deadline that has already passed so that every
+            // pass stops as soon as it checks the time.
+            auto rebuild_res = logfile::rebuild_result_t::NEW_LINES;
+            while (rebuild_res != logfile::rebuild_result_t::NO_NEW_LINES) {
+                rebuild_res = lf->rebuild_index(ui_clock::now());
+                assert(!lf->is_closed());
+            }
+        } else {
+            lf->rebuild_index();
+            assert(!lf->is_closed());
+            lf->rebuild_index();
+            assert(!lf->is_closed());
+            lf->rebuild_index();
+            assert(!lf->is_closed());
+            assert(lf->get_activity().la_polls == 3);
+        }
         if (expected_format.empty()) {
             assert(lf->get_format() == nullptr);
         } else {
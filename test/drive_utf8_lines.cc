@@ -0,0 +1,168 @@
+/**
+ * Copyright (c) 2024, Timothy Stack
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ * * Neither the name of Timothy Stack nor the names of its contributors
+ * may be used to endorse or promote products derived from this software
+ * without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE REGENTS AND CONTRIBUTORS ''AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <chrono>
+#include <string>
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "base/auto_fd.hh"
+#include "base/is_utf8.hh"
+#include "base/is_utf8.lines.hh"
+#include "config.h"
+
+/**
+ * Microbenchmark for the line splitting done when the line_buffer loads a
+ * buffer, comparing the per-line is_utf8() scan with is_utf8_lines().
+ */
+
+static std::string
+generate_log(size_t size)
+{
+    static const char* LINES[] = {
+        "2024-01-01T12:00:00.000Z INFO  [main] Server started on port 8080\n",
+        "2024-01-01T12:00:00.123Z DEBUG [worker-1] Processing request "
+        "id=12345 user=alice path=/api/v1/items\n",
+        "2024-01-01T12:00:01.456Z WARN  [worker-2] Slow query took 1534ms\t"
+        "SELECT * FROM items\n",
+        "2024-01-01T12:00:02.789Z ERROR [worker-3] \x1b[31mFailed\x1b[0m to "
+        "connect to db\n",
+        "2024-01-01T12:00:03.000Z INFO  [worker-4] caf\xc3\xa9 \xe2\x82\xac "
+        "total=42\n",
+    };
+    std::string retval;
+
+    for (size_t lpc = 0; retval.size() < size; lpc++) {
+        retval.append(LINES[lpc % 5]);
+    }
+
+    return retval;
+}
+
+template<typename F>
+static double
+measure(const std::string& data, int iterations, F func)
+{
+    auto start = std::chrono::steady_clock::now();
+    for (int lpc = 0; lpc < iterations; lpc++) {
+        func();
+    }
+    auto end = std::chrono::steady_clock::now();
+    std::chrono::duration<double> secs = end - start;
+
+    return (double) data.size() * iterations / secs.count() / 1e9;
+}
+
+int
+main(int argc, char* argv[])
+{
+    int c, retval = EXIT_SUCCESS;
+    int iterations = 100;
+    std::string data;
+
+    while ((c = getopt(argc, argv, "n:")) != -1) {
+        switch (c) {
+            case 'n':
+                if (sscanf(optarg, "%d", &iterations) != 1) {
+                    fprintf(stderr,
+                            "error: iterations is not an integer -- %s\n",
+                            optarg);
+                    retval = EXIT_FAILURE;
+                }
+                break;
+            default:
+                retval = EXIT_FAILURE;
+                break;
+        }
+    }
+
+    argc -= optind;
+    argv += optind;
+
+    if (retval != EXIT_SUCCESS) {
+        return retval;
+    }
+
+    if (argc > 0) {
+        auto_fd fd;
+        char buffer[64 * 1024];
+        ssize_t rc;
+
+        if ((fd = open(argv[0], O_RDONLY)) == -1) {
+            perror("open");
+            return EXIT_FAILURE;
+        }
+        while ((rc = read(fd, buffer, sizeof(buffer))) > 0) {
+            data.append(buffer, rc);
+        }
+    } else {
+        data = generate_log(4 * 1024 * 1024);
+    }
+
+    auto frag = string_fragment::from_str(data);
+    size_t per_line_count = 0, batch_count = 0;
+
+    auto per_line_gbps = measure(data, iterations, [&]() {
+        auto line_frag = frag;
+
+        per_line_count = 0;
+        while (!line_frag.empty()) {
+            auto scan_res = is_utf8(line_frag, '\n');
+
+            per_line_count += 1;
+            if (!scan_res.usr_remaining) {
+                break;
+            }
+            line_frag = scan_res.usr_remaining.value();
+        }
+    });
+    auto batch_gbps = measure(data, iterations, [&]() {
+        utf8_line_batch batch;
+
+        is_utf8_lines(frag, batch);
+        batch_count = batch.size();
+    });
+
+    printf("bytes: %zu  lines: %zu\n", data.size(), batch_count);
+    printf("is_utf8 per line: %6.2f GB/s\n", per_line_gbps);
+    printf("is_utf8_lines:    %6.2f GB/s\n", batch_gbps);
+
+    if (per_line_count != batch_count) {
+        fprintf(stderr,
+                "error: line counts differ -- %zu != %zu\n",
+                per_line_count,
+                batch_count);
+        retval = EXIT_FAILURE;
+    }
+
+    return retval;
+}
@@ -30,17 +30,38 @@
 #include "config.h"
 
 #define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include <arpa/inet.h>
 #include <data_parser.hh>
+#include <set>
+#include <sqlite3.h>
+#include <thread>
 
+#ifdef HAVE_ZSTD_H
+#    include <zstd.h>
+#endif
+
+#include "base/auto_mem.hh"
 #include "base/from_trait.hh"
+#include "base/fs_util.hh"
+#include "base/lnav.gzip.hh"
 #include "byte_array.hh"
 #include "data_scanner.hh"
+#include "db_sub_source.column_store.hh"
 #include "doctest/doctest.h"
+#include "hist_source.hh"
+#include "line_buffer.hh"
+#include "line_buffer.zstd.hh"
 #include "lnav_config.hh"
 #include "lnav_util.hh"
+#include "log.filter_expr.hh"
+#include "log.opid_index.hh"
+#include "logfile.schema_index.hh"
+#include "piper.looper.hh"
 #include "ptimec.hh"
 #include "relative_time.hh"
 #include "shlex.hh"
+#include "spectro_summary.hh"
+#include "textview_curses.hh"
 #include "unique_path.hh"
 
 using namespace std;
@@ -320,3 +341,718 @@ TEST_CASE("data_scanner quote")
         dp.parse();
     }
 }
+
+TEST_CASE("filter_expr::compile")
+{
+    using namespace lnav::log::filter_expr;
+
+    CHECK(compile(":sc_status >= 500 AND :cs_method = 'GET'").isOk());
+    CHECK(compile("NOT (:a IN (1, 2, NULL) OR :b IS NOT NULL)").isOk());
+    CHECK(compile(":log_text REGEXP 'a+b'").isOk());
+    CHECK(compile("timeslice(:log_time_msecs, '5m') IS NOT NULL").isErr());
+    CHECK(compile(":a BETWEEN 1 AND 2").isErr());
+    CHECK(compile(":log_tags = 'x'").isErr());
+    CHECK(compile(":a = 'unterminated").isErr());
+    CHECK(compile(":a REGEXP '('").isErr());
+}
+
+TEST_CASE("filter_expr::eval")
+{
+    using namespace lnav::log::filter_expr;
+
+    static const char* EXPRS[] = {
+        ":a = 500",
+        ":a >= 500 AND :b = 'GET'",
+        ":a < :b",
+        ":a <> 1.5",
+        ":a == '500'",
+        ":b LIKE 'g%'",
+        ":b NOT LIKE '%E_'",
+        ":a LIKE '5%'",
+        ":a IN (1, 500, 'GET')",
+        ":b NOT IN (1, NULL)",
+        ":a IS NULL OR :b IS NOT NULL",
+        "NOT :a",
+        ":b",
+        "(:a > 100 OR :b = 'x') AND NOT :c = -1",
+        ":c IN (-1, 0x10)",
+        "TRUE AND :a > 1e2",
+    };
+
+    const std::vector<value> ROWS[] = {
+        {value::from_integer(500),
+         value::from_text(string_fragment::from_const("GET")),
+         value::from_integer(-1)},
+        {value::from_integer(200),
+         value::from_text(string_fragment::from_const("POST")),
+         value::from_integer(16)},
+        {value::from_real(1.5), value{}, value::from_integer(0)},
+        {value{},
+         value::from_text(string_fragment::from_const("gEt")),
+         value{}},
+        {value::from_text(string_fragment::from_const("500")),
+         value::from_integer(1),
+         value::from_real(-1.0)},
+    };
+
+    auto_mem<sqlite3> db(sqlite3_close);
+    REQUIRE(sqlite3_open(":memory:", db.out()) == SQLITE_OK);
+
+    for (const auto* expr : EXPRS) {
+        auto compile_res = compile(expr);
+        REQUIRE_MESSAGE(compile_res.isOk(), expr);
+        auto prog = compile_res.unwrap();
+
+        auto sql = fmt::format(FMT_STRING("SELECT 1 WHERE {}"), expr);
+        auto_mem<sqlite3_stmt> stmt(sqlite3_finalize);
+        REQUIRE(sqlite3_prepare_v2(db, sql.c_str(), -1, stmt.out(), nullptr)
+                == SQLITE_OK);
+
+        for (const auto& row : ROWS) {
+            std::vector<value> vars;
+
+            sqlite3_reset(stmt.in());
+            sqlite3_clear_bindings(stmt.in());
+            for (const auto& var : prog->get_variables()) {
+                auto index = var.v_name[1] - 'a';
+                const auto& val = row[index];
+                auto param = sqlite3_bind_parameter_index(stmt.in(),
+                                                          var.v_name.c_str());
+
+                vars.emplace_back(val);
+                switch (val.v_kind) {
+                    case value::kind_t::null:
+                        break;
+                    case value::kind_t::integer:
+                        sqlite3_bind_int64(stmt.in(), param, val.v_integer);
+                        break;
+                    case value::kind_t::real:
+                        sqlite3_bind_double(stmt.in(), param, val.v_real);
+                        break;
+                    case value::kind_t::text:
+                        sqlite3_bind_text(stmt.in(),
+                                          param,
+                                          val.v_text.data(),
+                                          val.v_text.length(),
+                                          SQLITE_STATIC);
+                        break;
+                }
+            }
+
+            auto expected = sqlite3_step(stmt.in()) == SQLITE_ROW;
+            INFO(expr);
+            CHECK(prog->eval(vars) == expected);
+        }
+    }
+}
+
+TEST_CASE("filter_expr::precheck")
+{
+    using namespace lnav::log::filter_expr;
+
+    auto prog = compile(":log_level = 'error' AND :sc_status >= 500").unwrap();
+    REQUIRE(prog->get_cost() == cost_t::annotate);
+
+    const auto& vars = prog->get_variables();
+    REQUIRE(vars.size() == 2);
+    CHECK(vars[0].v_kind == variable_kind_t::log_level);
+
+    auto error_level = value::from_text(string_fragment::from_const("error"));
+    auto info_level = value::from_text(string_fragment::from_const("info"));
+    const value null_value;
+    CHECK(prog->precheck({error_level, null_value}));
+    CHECK_FALSE(prog->precheck({info_level, null_value}));
+    CHECK_FALSE(prog->precheck({info_level, value::from_integer(500)}));
+
+    auto or_prog = compile(":log_level = 'error' OR :sc_status >= 500").unwrap();
+    CHECK(or_prog->precheck({info_level, null_value}));
+
+    auto text_prog = compile(":log_text LIKE '%fail%'").unwrap();
+    CHECK(text_prog->get_cost() == cost_t::read);
+    CHECK(compile(":log_level = 'error'").unwrap()->get_cost()
+          == cost_t::none);
+}
+
+TEST_CASE("spectro::quantile_sketch")
+{
+    lnav::spectro::quantile_sketch lhs;
+    lnav::spectro::quantile_sketch rhs;
+
+    CHECK(!lhs.quantile(0.5).has_value());
+    for (int lpc = 1; lpc <= 1000; lpc++) {
+        if (lpc % 2) {
+            lhs.add(lpc);
+        } else {
+            rhs.add(lpc);
+        }
+    }
+    lhs.merge(rhs);
+
+    CHECK(lhs.count() == 1000);
+    CHECK(lhs.quantile(0.5).value() == doctest::Approx(500).epsilon(0.02));
+    CHECK(lhs.quantile(0.99).value() == doctest::Approx(990).epsilon(0.02));
+
+    lnav::spectro::quantile_sketch signs;
+
+    signs.add(-10.0);
+    signs.add(0.0);
+    signs.add(10.0);
+    CHECK(signs.quantile(0.0).value() == doctest::Approx(-10.0).epsilon(0.02));
+    CHECK(signs.quantile(0.5).value() == 0.0);
+    CHECK(signs.quantile(1.0).value() == doctest::Approx(10.0).epsilon(0.02));
+}
+
+TEST_CASE("spectro::time_series_summary")
+{
+    using namespace std::chrono_literals;
+
+    lnav::spectro::time_series_summary tss;
+
+    // one sample every ten seconds for two days
+    for (int64_t lpc = 0; lpc < 2 * 24 * 60 * 6; lpc++) {
+        tss.add(std::chrono::seconds(lpc * 10), lpc % 100, lpc);
+    }
+
+    auto range = tss.samples_in(15s, 1h + 5s);
+    CHECK(std::distance(range.first, range.second) == 359);
+    CHECK(range.first->s_ref == 2);
+
+    auto bs = tss.summarize(15s, 26h + 5s);
+    int64_t count = 0;
+    double sum = 0.0;
+    for (int64_t lpc = 2; lpc * 10 < 26 * 60 * 60 + 5; lpc++) {
+        count += 1;
+        sum += lpc % 100;
+    }
+    CHECK(bs.bs_count == count);
+    CHECK(bs.bs_sum == sum);
+    CHECK(bs.bs_min == 0.0);
+    CHECK(bs.bs_max == 99.0);
+    CHECK(bs.bs_sketch.quantile(0.5).value()
+          == doctest::Approx(50).epsilon(0.05));
+    CHECK(tss.totals().bs_count == tss.size());
+
+    // The rows from a query are not necessarily in time order.
+    tss.add(25s, 1000.0, -1);
+    tss.sort();
+    range = tss.samples_in(20s, 30s);
+    CHECK(std::distance(range.first, range.second) == 2);
+    CHECK(std::next(range.first)->s_ref == -1);
+    CHECK(tss.summarize(15s, 35s).bs_max == 1000.0);
+    bs = tss.summarize(0s, 1h);
+    CHECK(bs.bs_count == 361);
+    CHECK(bs.bs_max == 1000.0);
+    CHECK(tss.totals().bs_count == tss.size());
+
+    // Rows from an "ORDER BY ... DESC" query arrive in reverse.
+    lnav::spectro::time_series_summary rev;
+    for (int64_t lpc = 2 * 24 * 60 * 6 - 1; lpc >= 0; lpc--) {
+        rev.add(std::chrono::seconds(lpc * 10), lpc % 100, lpc);
+    }
+    rev.sort();
+    range = rev.samples_in(15s, 1h + 5s);
+    CHECK(std::distance(range.first, range.second) == 359);
+    CHECK(range.first->s_ref == 2);
+    bs = rev.summarize(15s, 26h + 5s);
+    CHECK(bs.bs_count == count);
+    CHECK(bs.bs_sum == sum);
+}
+
+TEST_CASE("opid_index")
+{
+    auto make_range = [](time_t begin, time_t end) {
+        time_range retval;
+
+        retval.tr_begin = timeval{begin, 0};
+        retval.tr_end = timeval{end, 0};
+        return retval;
+    };
+
+    log_opid_map file1;
+    log_opid_map file2;
+
+    file1[string_fragment::from_const("a")].otr_range = make_range(10, 20);
+    file1[string_fragment::from_const("b")].otr_range = make_range(15, 30);
+    {
+        auto& otr = file1[string_fragment::from_const("b")];
+        opid_sub_time_range sub;
+
+        sub.ostr_subid = string_fragment::from_const("b1");
+        sub.ostr_range = make_range(16, 18);
+        otr.otr_sub_ops.emplace_back(sub);
+    }
+    file2[string_fragment::from_const("a")].otr_range = make_range(5, 12);
+    file2[string_fragment::from_const("c")].otr_range = make_range(40, 50);
+
+    lnav::log::opid_index oi;
+
+    oi.add(file1);
+    oi.add(file2);
+    oi.build();
+    CHECK(oi.size() == 4);
+
+    auto at_17 = oi.overlapping(timeval{17, 0}, timeval{17, 0});
+    REQUIRE(at_17.size() == 3);
+    CHECK(at_17[0]->e_opid == "a");
+    CHECK(at_17[0]->e_range.tr_begin.tv_sec == 5);
+    CHECK(at_17[1]->e_opid == "b");
+    CHECK(!at_17[1]->e_subid.is_valid());
+    CHECK(at_17[2]->e_subid == "b1");
+
+    CHECK(oi.overlapping(timeval{31, 0}, timeval{39, 0}).empty());
+    auto at_end = oi.overlapping(timeval{30, 0}, timeval{40, 0});
+    REQUIRE(at_end.size() == 2);
+    CHECK(at_end[0]->e_opid == "b");
+    CHECK(at_end[1]->e_opid == "c");
+
+    // Updating a single opid should replace its entry without a rebuild.
+    file1[string_fragment::from_const("a")].otr_range = make_range(10, 35);
+    file2[string_fragment::from_const("d")].otr_range = make_range(16, 17);
+    oi.update_opid(string_fragment::from_const("a"), {&file1, &file2});
+    oi.update_opid(string_fragment::from_const("d"), {&file1, &file2});
+    CHECK(oi.size() == 5);
+
+    auto at_17_updated = oi.overlapping(timeval{17, 0}, timeval{17, 0});
+    REQUIRE(at_17_updated.size() == 4);
+    CHECK(at_17_updated[0]->e_opid == "a");
+    CHECK(at_17_updated[0]->e_range.tr_end.tv_sec == 35);
+    CHECK(at_17_updated[1]->e_opid == "b");
+    CHECK(at_17_updated[2]->e_subid == "b1");
+    CHECK(at_17_updated[3]->e_opid == "d");
+
+    auto at_end_updated = oi.overlapping(timeval{31, 0}, timeval{39, 0});
+    REQUIRE(at_end_updated.size() == 1);
+    CHECK(at_end_updated[0]->e_opid == "a");
+
+    file2.erase(string_fragment::from_const("d"));
+    oi.update_opid(string_fragment::from_const("d"), {&file1, &file2});
+    CHECK(oi.size() == 4);
+    CHECK(oi.overlapping(timeval{16, 0}, timeval{16, 0}).size() == 3);
+}
+
+TEST_CASE("db_column_store")
+{
+    db_column_store store;
+    std::string buffer;
+
+    store.set_max_memory_size(64);
+    store.add_column();
+    store.add_column();
+    for (int lpc = 0; lpc < 100; lpc++) {
+        store.add_row();
+        store.push_integer(lpc);
+        if (lpc % 10 == 0) {
+            store.push_null();
+        } else {
+            store.push_text(string_fragment::from_str(
+                fmt::format(FMT_STRING("value-{}"), lpc % 3)));
+        }
+    }
+    store.add_row();
+    store.push_real(1.5);
+    auto long_str = std::string(100, 'x');
+    store.push_text(string_fragment::from_str(long_str));
+    store.add_row();
+    store.push_real(2.5);
+    store.push_text(string_fragment::from_str(long_str + "y"));
+
+    CHECK(store.row_count() == 102);
+    CHECK(store.get_integer(42, 0) == 42);
+    CHECK(store.get_text(42, 1, buffer) == "value-0");
+    CHECK(store.is_null(50, 1));
+    CHECK(store.get_type(100, 0) == db_column_store::cell_type::real);
+    CHECK(store.get_real(101, 0) == 2.5);
+    CHECK(store.get_text(100, 1, buffer) == long_str);
+    CHECK(store.get_text(101, 1, buffer) == long_str + "y");
+    CHECK(store.get_memory_usage() <= 64);
+    CHECK(store.get_spilled_size() > 0);
+
+    std::string cell;
+    store.append_cell(50, 1, "<NULL>", cell);
+    store.append_cell(100, 0, "<NULL>", cell);
+    CHECK(cell == "<NULL>1.5");
+}
+
+TEST_CASE("logfile_schema_index")
+{
+    static const char* const INPUTS[] = {
+        "user=alice status=ok",
+        "took 10ms to run",
+        "user=bob status=failed",
+    };
+
+    logfile_schema_index si;
+    uint32_t line = 0;
+
+    for (const auto* input : INPUTS) {
+        data_scanner ds(string_fragment::from_c_str(input));
+        data_parser dp(&ds);
+
+        dp.parse();
+        si.add_line(line, dp);
+        line += 2;
+    }
+
+    REQUIRE(si.get_schemas().size() == 2);
+    const auto& first = si.get_schemas().front();
+    CHECK(first.s_keys == "user, status");
+    CHECK(first.s_lines == std::vector<uint32_t>{0, 4});
+    CHECK(si.find(first.s_id) == &first);
+
+    si.truncate(3);
+    CHECK(first.s_lines == std::vector<uint32_t>{0});
+    CHECK(si.get_schemas().back().s_lines == std::vector<uint32_t>{2});
+}
+
+TEST_CASE("line_buffer piper line_meta")
+{
+    static const char* const LINES[] = {
+        "first line\n",
+        "second line\n",
+    };
+
+    char dir_template[] = "/tmp/lnav-doctests.XXXXXX";
+    auto dir = std::filesystem::path(mkdtemp(dir_template));
+
+    lnav::piper::header hdr;
+    hdr.h_name = "test";
+    hdr.h_line_meta = "meta.0";
+    auto hdr_str = lnav::piper::header_handlers.to_string(hdr);
+    uint32_t meta_size = htonl(hdr_str.size());
+    std::string data(lnav::piper::HEADER_MAGIC,
+                     sizeof(lnav::piper::HEADER_MAGIC));
+    data.append((const char*) &meta_size, sizeof(meta_size));
+    data.append(hdr_str);
+
+    std::vector<lnav::piper::line_meta> metas;
+    for (const auto* line : LINES) {
+        auto& lm = metas.emplace_back();
+
+        lm.lm_offset = data.size();
+        lm.lm_level = metas.size() == 1 ? LEVEL_INFO : LEVEL_ERROR;
+        lm.lm_usecs = 1000000LL * 1370546000LL + 123 * metas.size();
+        data.append(line);
+    }
+    lnav::filesystem::write_file(
+        dir / "meta.0",
+        string_fragment::from_bytes((const char*) metas.data(),
+                                    metas.size() * sizeof(metas[0])))
+        .unwrap();
+
+    SUBCASE("uncompressed")
+    {
+        lnav::filesystem::write_file(dir / "out.0",
+                                     string_fragment::from_str(data))
+            .unwrap();
+    }
+
+    SUBCASE("compressed")
+    {
+        // Split the data across two gzip members like a rotated capture.
+        auto split = data.size() - 5;
+        auto first = lnav::gzip::compress(data.data(), split).unwrap();
+        auto second
+            = lnav::gzip::compress(data.data() + split, data.size() - split)
+                  .unwrap();
+        std::string gz(first.in(), first.size());
+        gz.append(second.in(), second.size());
+        lnav::filesystem::write_file(dir / "out.0",
+                                     string_fragment::from_str(gz))
+            .unwrap();
+    }
+
+    line_buffer lb;
+    auto fd = lnav::filesystem::open_file(dir / "out.0", O_RDONLY).unwrap();
+    lb.set_fd(fd);
+    lb.set_line_meta_fd(
+        lnav::filesystem::open_file(dir / "meta.0", O_RDONLY).unwrap());
+
+    CHECK(lb.is_piper());
+    CHECK(lb.get_line_meta_prefix_size() == 0);
+
+    file_range last_range;
+    for (size_t lpc = 0; lpc < metas.size(); lpc++) {
+        auto li = lb.load_next_line(last_range).unwrap();
+
+        CHECK(li.li_file_range.fr_offset == (file_off_t) metas[lpc].lm_offset);
+        CHECK(li.li_level == (log_level_t) metas[lpc].lm_level);
+        CHECK(li.li_timestamp.tv_usec == 123 * (lpc + 1));
+
+        auto sbr = lb.read_range(li.li_file_range).unwrap();
+        CHECK(sbr.to_string_fragment().to_string() == LINES[lpc]);
+        last_range = li.li_file_range;
+    }
+
+    std::filesystem::remove_all(dir);
+}
+
+#ifdef HAVE_ZSTD_H
+TEST_CASE("line_buffer zstd")
+{
+    char dir_template[] = "/tmp/lnav-doctests.XXXXXX";
+    auto dir = std::filesystem::path(mkdtemp(dir_template));
+    auto prev_tmpdir_ptr = getenv("TMPDIR");
+    auto prev_tmpdir = prev_tmpdir_ptr != nullptr
+        ? std::make_optional<std::string>(prev_tmpdir_ptr)
+        : std::nullopt;
+    auto _cleanup = finally([&] {
+        if (prev_tmpdir) {
+            setenv("TMPDIR", prev_tmpdir->c_str(), 1);
+        } else {
+            unsetenv("TMPDIR");
+        }
+        std::filesystem::remove_all(dir);
+    });
+
+    // Keep the decompressed copies out of the real work directory.
+    setenv("TMPDIR", dir.c_str(), 1);
+
+    std::vector<std::string> lines;
+    std::string data;
+    for (int lpc = 0; lpc < 300; lpc++) {
+        auto& line = lines.emplace_back(
+            fmt::format(FMT_STRING("line {} of the zstd test\n"), lpc));
+        data.append(line);
+    }
+
+    auto compress_frame = [](const std::string& src) {
+        std::string retval(ZSTD_compressBound(src.size()), '\0');
+        auto rc = ZSTD_compress(
+            retval.data(), retval.size(), src.data(), src.size(), 3);
+        REQUIRE(!ZSTD_isError(rc));
+        retval.resize(rc);
+        return retval;
+    };
+    auto append_le32 = [](std::string& dst, uint32_t value) {
+        for (int lpc = 0; lpc < 4; lpc++) {
+            dst.push_back((char) ((value >> (lpc * 8)) & 0xff));
+        }
+    };
+
+    std::string zst;
+    size_t expected_frames = 0;
+    SUBCASE("single frame")
+    {
+        zst = compress_frame(data);
+        expected_frames = 1;
+    }
+
+    SUBCASE("multiple frames")
+    {
+        for (size_t off = 0; off < data.size(); off += 1000) {
+            zst.append(compress_frame(data.substr(off, 1000)));
+            expected_frames += 1;
+        }
+    }
+
+    SUBCASE("seekable")
+    {
+        std::string table;
+        for (size_t off = 0; off < data.size(); off += 1000) {
+            auto chunk = data.substr(off, 1000);
+            auto frame = compress_frame(chunk);
+
+            zst.append(frame);
+            append_le32(table, frame.size());
+            append_le32(table, chunk.size());
+            expected_frames += 1;
+        }
+        append_le32(zst, 0x184D2A5E);
+        append_le32(zst, table.size() + 9);
+        zst.append(table);
+        append_le32(zst, expected_frames);
+        zst.push_back('\0');
+        append_le32(zst, 0x8F92EAB1);
+    }
+
+    lnav::filesystem::write_file(dir / "test.zst",
+                                 string_fragment::from_str(zst))
+        .unwrap();
+
+    auto frames_fd
+        = lnav::filesystem::open_file(dir / "test.zst", O_RDONLY).unwrap();
+    auto frames = lnav::zstd::find_frames(frames_fd).unwrap();
+    CHECK(frames.size() == expected_frames);
+
+    line_buffer lb;
+    auto fd = lnav::filesystem::open_file(dir / "test.zst", O_RDONLY).unwrap();
+    lb.set_fd(fd);
+    CHECK(lb.is_compressed());
+
+    std::vector<file_range> ranges;
+    file_range last_range;
+    for (const auto& line : lines) {
+        auto li = lb.load_next_line(last_range).unwrap();
+        auto sbr = lb.read_range(li.li_file_range).unwrap();
+
+        CHECK(sbr.to_string_fragment().to_string() == line);
+        last_range = li.li_file_range;
+        ranges.emplace_back(last_range);
+    }
+    CHECK(lb.get_file_size() == (file_ssize_t) data.size());
+
+    // Going back has to restart the decompression at an earlier frame.
+    auto first_sbr = lb.read_range(ranges.front()).unwrap();
+    CHECK(first_sbr.to_string_fragment().to_string() == lines.front());
+
+    lb.enable_cache();
+    auto mid_sbr = lb.read_range(ranges[ranges.size() / 2]).unwrap();
+    CHECK(mid_sbr.to_string_fragment().to_string()
+          == lines[lines.size() / 2]);
+}
+#endif
+
+TEST_CASE("piper looper rotation")
+{
+    char dir_template[] = "/tmp/lnav-doctests.XXXXXX";
+    auto dir = std::filesystem::path(mkdtemp(dir_template));
+    auto prev_piper_cfg = lnav_config.lc_piper;
+    const auto* prev_tmpdir_ptr = getenv("TMPDIR");
+    auto prev_tmpdir = prev_tmpdir_ptr != nullptr
+        ? std::make_optional<std::string>(prev_tmpdir_ptr)
+        : std::nullopt;
+    auto _cleanup = finally([&] {
+        if (prev_tmpdir) {
+            setenv("TMPDIR", prev_tmpdir->c_str(), 1);
+        } else {
+            unsetenv("TMPDIR");
+        }
+        lnav_config.lc_piper = prev_piper_cfg;
+        std::filesystem::remove_all(dir);
+    });
+
+    setenv("TMPDIR", dir.c_str(), 1);
+    lnav_config.lc_piper.c_max_size = 128;
+    lnav_config.lc_piper.c_rotations = 4;
+    lnav_config.lc_piper.c_compress = true;
+
+    std::vector<std::string> lines;
+    int pipe_fds[2];
+    REQUIRE(pipe(pipe_fds) == 0);
+    auto read_fd = auto_fd(pipe_fds[0]);
+    auto write_fd = auto_fd(pipe_fds[1]);
+    for (int lpc = 0; lpc < 6; lpc++) {
+        // Every line is past the max size, so each one gets its own file.
+        auto& line = lines.emplace_back(fmt::format(
+            FMT_STRING("line {} {}\n"), lpc, std::string(120, '0')));
+        REQUIRE(write(write_fd.get(), line.data(), line.size())
+                == (ssize_t) line.size());
+    }
+    write_fd.reset();
+
+    std::filesystem::path out_dir;
+    {
+        auto hand = lnav::piper::create_looper("rotation",
+                                               std::move(read_fd),
+                                               auto_fd{},
+                                               lnav::piper::options{}
+                                                   .with_tail(false))
+                        .unwrap();
+
+        out_dir = hand.get_out_dir();
+        while (!hand.is_finished()) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+    }
+
+    // The last four lines remain and only the active file is uncompressed.
+    std::set<std::string> lines_read;
+    size_t compressed_count = 0;
+    size_t meta_count = 0;
+    for (const auto& entry : std::filesystem::directory_iterator(out_dir)) {
+        auto filename = entry.path().filename().string();
+
+        if (startswith(filename, "meta.")) {
+            meta_count += 1;
+            continue;
+        }
+        REQUIRE(startswith(filename, "out."));
+
+        line_buffer lb;
+        auto fd = lnav::filesystem::open_file(entry.path(), O_RDONLY).unwrap();
+        lb.set_fd(fd);
+        REQUIRE(lb.is_piper());
+        if (lb.is_compressed()) {
+            compressed_count += 1;
+        }
+
+        const auto& hdr
+            = lb.get_header_data().get<lnav::piper::header>();
+        REQUIRE(!hdr.h_line_meta.empty());
+        CHECK(hdr.h_line_meta.substr(4) == filename.substr(3));
+        lb.set_line_meta_fd(lnav::filesystem::open_file(
+                                out_dir / hdr.h_line_meta, O_RDONLY)
+                                .unwrap());
+
+        auto li = lb.load_next_line().unwrap();
+        CHECK(li.li_level == LEVEL_INFO);
+        CHECK(li.li_timestamp.tv_sec > 0);
+        auto sbr = lb.read_range(li.li_file_range).unwrap();
+        lines_read.emplace(sbr.to_string_fragment().to_string());
+    }
+    CHECK(compressed_count == 3);
+    CHECK(meta_count == 4);
+    CHECK(lines_read
+          == std::set<std::string>(lines.begin() + 2, lines.end()));
+}
+
+TEST_CASE("hist_source2::set_time_slice")
+{
+    using namespace std::chrono_literals;
+
+    // Sun Sep 13 12:26:00 2020
+    static constexpr auto START = std::chrono::microseconds(1599999960s);
+
+    hist_source2 hs;
+    textview_curses tc;
+    std::string value;
+
+    CHECK(hs.get_time_slice() == 1s);
+
+    hs.add_value(START, hist_source2::HT_NORMAL);
+    hs.add_value(START, hist_source2::HT_NORMAL);
+    hs.add_value(START + 1s, hist_source2::HT_ERROR);
+    hs.add_value(START + 59s, hist_source2::HT_WARNING);
+    hs.add_value(START + 60s, hist_source2::HT_NORMAL);
+    hs.add_value(START + 125s, hist_source2::HT_NORMAL);
+    hs.end_of_row();
+    CHECK(hs.text_line_count() == 5);
+
+    hs.set_time_slice(1min);
+    CHECK(hs.text_line_count() == 3);
+    hs.text_value_for_line(tc, 0, value, text_sub_source::RF_RAW);
+    CHECK(value
+          == " Sun Sep 13 12:26:00          2 normal         1 errors  "
+             "       1 warnings         0 marks");
+    hs.text_value_for_line(tc, 2, value, text_sub_source::RF_RAW);
+    CHECK(value
+          == " Sun Sep 13 12:28:00          1 normal         0 errors  "
+             "       0 warnings         0 marks");
+
+    // Derived from the one-minute series.
+    hs.set_time_slice(2min);
+    CHECK(hs.text_line_count() == 2);
+    hs.text_value_for_line(tc, 0, value, text_sub_source::RF_RAW);
+    CHECK(value
+          == " Sun Sep 13 12:26:00          3 normal         1 errors  "
+             "       1 warnings         0 marks");
+
+    // New values are added to all of the series.
+    hs.add_value(START + 130s, hist_source2::HT_ERROR);
+    hs.end_of_row();
+    hs.text_value_for_line(tc, 1, value, text_sub_source::RF_RAW);
+    CHECK(value
+          == " Sun Sep 13 12:28:00          1 normal         1 errors  "
+             "       0 warnings         0 marks");
+
+    hs.set_time_slice(1min);
+    CHECK(hs.text_line_count() == 3);
+    hs.text_value_for_line(tc, 2, value, text_sub_source::RF_RAW);
+    CHECK(value
+          == " Sun Sep 13 12:28:00          1 normal         1 errors  "
+             "       0 warnings         0 marks");
+
+    hs.set_time_slice(1s);
+    CHECK(hs.text_line_count() == 6);
+    CHECK(hs.row_for_time(timeval{1599999960 + 59, 0}) == 2_vl);
+}
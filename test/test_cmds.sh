@@ -187,6 +187,12 @@ run_cap_test ${lnav_test} -n \
     -c ":hide-fields access_log.c_ip access_log.cs_uri_stem" \
     ${test_dir}/logfile_access_log.0
 
+run_cap_test ${lnav_test} -n \
+    -c ":write-screen-to -" \
+    -c ":hide-fields access_log.cs_uri_stem" \
+    -c ":write-screen-to -" \
+    ${test_dir}/logfile_access_log.0
+
 run_cap_test ${lnav_test} -n \
     -c ':hide-fields log_time log_level' \
     ${test_dir}/logfile_generic.0
@@ -350,7 +356,7 @@ run_cap_test ${lnav_test} -n \
     ${test_dir}/logfile_plain.0
 
 TOO_MANY_FILTERS=""
-for i in `seq 1 32`; do
+for i in `seq 1 128`; do
     TOO_MANY_FILTERS="$TOO_MANY_FILTERS -c ':filter-out $i'"
 done
 run_cap_test eval ${lnav_test} -d /tmp/lnav.err -n \
@@ -15,3 +15,9 @@ run_cap_test ${lnav_test} -n \
     -c ";select * from leveltest_log" \
     -c ':write-csv-to -' \
     ${test_dir}/logfile_leveltest.0
+
+run_cap_test ${lnav_test} -n \
+    -I ${test_dir} \
+    -c ";SELECT log_line, log_body FROM caseless_log" \
+    -c ':write-csv-to -' \
+    ${test_dir}/logfile_caseless.0
@@ -31,7 +31,6 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <sys/types.h>
-#include <sys/wait.h>
 
 #include "config.h"
 #include "grep_proc.hh"
@@ -70,44 +69,95 @@ public:
     int ms_current_line;
 };
 
-class my_sleeper_source : public grep_proc_source<vis_line_t> {
+class my_big_source : public grep_proc_source<vis_line_t> {
+public:
+    static const int LINE_COUNT = 100000;
+
     std::optional<line_info> grep_value_for_line(vis_line_t line_number,
                                                  string& value_out) override
     {
-        sleep(1000);
-        return {};
+        if (line_number >= LINE_COUNT) {
+            return std::nullopt;
+        }
+
+        if ((line_number % 3) == 0) {
+            value_out = "abc foobar def";
+        } else {
+            value_out = "abc def";
+        }
+
+        return line_info{};
+    }
+};
+
+class my_bad_utf8_source : public grep_proc_source<vis_line_t> {
+public:
+    std::optional<line_info> grep_value_for_line(vis_line_t line_number,
+                                                 string& value_out) override
+    {
+        if (line_number >= 10) {
+            return std::nullopt;
+        }
+
+        line_info retval;
+
+        value_out = "abc \xff foobar";
+        retval.li_utf8_scan_result.usr_message = "invalid UTF-8";
+
+        return retval;
+    }
+};
+
+class my_control : public grep_proc_control {
+public:
+    void grep_error(const std::string& msg) override
+    {
+        this->mc_errors.emplace_back(msg);
     }
+
+    std::vector<std::string> mc_errors;
 };
 
 class my_sink : public grep_proc_sink<vis_line_t> {
 public:
-    my_sink() : ms_finished(false) {};
+    void grep_begin(grep_proc<vis_line_t>& gp,
+                    vis_line_t start,
+                    vis_line_t stop) override
+    {
+        this->ms_outstanding += 1;
+    }
 
-    void grep_match(grep_proc<vis_line_t>& gp, vis_line_t line) override {}
+    void grep_match(grep_proc<vis_line_t>& gp, vis_line_t line) override
+    {
+        this->ms_matches.emplace_back(line);
+    }
 
     void grep_end(grep_proc<vis_line_t>& gp) override
     {
-        this->ms_finished = true;
+        this->ms_outstanding -= 1;
     }
 
-    bool ms_finished;
+    int ms_outstanding{0};
+    std::vector<vis_line_t> ms_matches;
 };
 
 static void
-looper(grep_proc<vis_line_t>& gp)
+looper(pollable_supervisor& ps, grep_proc<vis_line_t>& gp, my_sink& msink)
 {
-    my_sink msink;
-
-    gp.set_sink(&msink);
-
-    while (!msink.ms_finished) {
+    while (true) {
         vector<struct pollfd> pollfds;
 
+        // The wakeup pipe is only registered until the search is done.
         gp.update_poll_set(pollfds);
-        poll(&pollfds[0], pollfds.size(), -1);
+        if (pollfds.empty()) {
+            break;
+        }
+        ps.poll(pollfds, std::chrono::milliseconds(-1));
 
         gp.check_poll_set(pollfds);
     }
+
+    assert(msink.ms_outstanding == 0);
 }
 
 int
@@ -121,29 +171,66 @@ main(int argc, char* argv[])
     auto psuperv = std::make_shared<pollable_supervisor>();
     {
         my_source ms;
+        my_sink msink;
         grep_proc<vis_line_t> gp(code, ms, psuperv);
 
+        gp.set_sink(&msink);
         gp.queue_request(10_vl, 14_vl);
         gp.queue_request(0_vl, 3_vl);
         gp.start();
-        looper(gp);
+        looper(*psuperv, gp, msink);
+        assert(ms.ms_current_line == 7);
+    }
+
+    for (size_t threads : {1, 4}) {
+        my_big_source mbs;
+        my_sink msink;
+        grep_proc<vis_line_t> gp(code, mbs, psuperv);
+
+        gp.set_sink(&msink);
+        gp.set_thread_count(threads);
+        gp.queue_request();
+        gp.start();
+        looper(*psuperv, gp, msink);
+
+        // The matches should be delivered in order, regardless of the
+        // number of threads doing the matching.
+        assert(msink.ms_matches.size()
+               == (size_t) (my_big_source::LINE_COUNT + 2) / 3);
+        for (size_t lpc = 0; lpc < msink.ms_matches.size(); lpc++) {
+            assert(msink.ms_matches[lpc] == vis_line_t(lpc * 3));
+        }
     }
 
     {
-        my_sleeper_source mss;
-        grep_proc<vis_line_t>* gp
-            = new grep_proc<vis_line_t>(code, mss, psuperv);
-        int status;
+        my_bad_utf8_source mbus;
+        my_sink msink;
+        my_control mcontrol;
+        grep_proc<vis_line_t> gp(code, mbus, psuperv);
+
+        gp.set_sink(&msink);
+        gp.set_control(&mcontrol);
+        gp.queue_request();
+        gp.start();
+        looper(*psuperv, gp, msink);
 
+        // Match failures should be reported instead of silently dropped.
+        assert(msink.ms_matches.empty());
+        assert(!mcontrol.mc_errors.empty());
+    }
+
+    {
+        my_big_source mbs;
+        my_sink msink;
+        auto* gp = new grep_proc<vis_line_t>(code, mbs, psuperv);
+
+        gp->set_sink(&msink);
         gp->queue_request();
         gp->start();
 
-        assert(wait3(&status, WNOHANG, NULL) == 0);
-
         delete gp;
 
-        assert(wait(&status) == -1);
-        assert(errno == ECHILD);
+        assert(msink.ms_outstanding == 0);
     }
 
     return retval;
@@ -75,4 +75,84 @@ run_test ./drive_line_buffer -i lb-3.index -n 10 lb-3.gz lb-3.dat
 
 check_output "Random gzipped reads don't match input" <<EOF
 All done
-EOF
\ No newline at end of file
+EOF
+
+# The start of each member in a multi-member file is a syncpoint, so
+# seeking into the middle of the file does not start from the beginning.
+rm -rf lb-tmp lb-multi-part.* lb-gz-open.log lb-gz-index.log lb-gz-stale.log
+mkdir -p lb-tmp
+cat lb-2.dat lb-2.dat > lb-multi.dat
+split -b 1000000 lb-multi.dat lb-multi-part.
+for part in lb-multi-part.*; do
+    gzip -c ${part}
+done > lb-multi.gz
+grep -b '$' lb-multi.dat | cut -f 1 -d : | awk 'NR % 500 == 1' > lb-multi.index
+
+run_test env TMPDIR=${PWD}/lb-tmp \
+    ./drive_line_buffer -i lb-multi.index -n 2 lb-multi.gz lb-multi.dat
+
+check_output "Random multi-member gzipped reads don't match input" <<EOF
+All done
+EOF
+
+# The syncpoints are saved once the file has been read to the end and
+# are loaded the next time it is opened.
+run_test env TMPDIR=${PWD}/lb-tmp \
+    ./drive_line_buffer -i lb-multi.index -n 2 lb-multi.gz lb-multi.dat
+
+check_output "Random reads with a saved gzip index don't match input" <<EOF
+All done
+EOF
+
+# Opening the file does not decompress all of it up front.
+rm -rf lb-tmp/*/buffer-cache
+run_test env TMPDIR=${PWD}/lb-tmp ${lnav_test} -n -d lb-gz-open.log \
+    lb-multi.gz
+
+check_output "reading with a saved gzip index failed" < lb-multi.dat
+
+run_test grep -c "cached file content using the gzip index" lb-gz-open.log
+
+check_output "gzip file was decompressed when opened" <<EOF
+0
+EOF
+
+# A saved index is used to decompress the file in parallel when the
+# content is cached.
+run_test env TMPDIR=${PWD}/lb-tmp \
+    ./drive_line_buffer -C -d lb-gz-index.log -i lb-multi.index -n 2 \
+    lb-multi.gz lb-multi.dat
+
+check_output "Random reads from the gzip cache don't match input" <<EOF
+All done
+EOF
+
+run_test grep -c "cached file content using the gzip index" lb-gz-index.log
+
+check_output "saved gzip index was not used" <<EOF
+1
+EOF
+
+# The index is not used once the file changes.
+rm -rf lb-tmp/*/buffer-cache
+touch -d '2020-01-01' lb-multi.gz
+
+run_test env TMPDIR=${PWD}/lb-tmp \
+    ./drive_line_buffer -C -d lb-gz-stale.log -i lb-multi.index -n 2 \
+    lb-multi.gz lb-multi.dat
+
+check_output "Random reads with a stale gzip index don't match input" <<EOF
+All done
+EOF
+
+run_test grep -m 1 -o "gzip index is stale" lb-gz-stale.log
+
+check_output "stale gzip index was not detected" <<EOF
+gzip index is stale
+EOF
+
+run_test grep -c "cached file content using the gzip index" lb-gz-stale.log
+
+check_output "stale gzip index was used" <<EOF
+0
+EOF
@@ -751,3 +751,237 @@ touch -t 202411030000 ${test_dir}/logfile_dst.0
 run_cap_test env TZ=America/Los_Angeles ${lnav_test} -n \
     -c ':set-file-timezone America/Los_Angeles' \
     ${test_dir}/logfile_dst.0
+
+# The index of a large file is cached in the work directory and reused.
+rm -rf idx-home idx-tmp
+mkdir -p idx-home idx-tmp
+cp ${test_dir}/logfile_access_log.0 idx-access.log
+idx_lnav="env HOME=${PWD}/idx-home TMPDIR=${PWD}/idx-tmp ${lnav_test}"
+${idx_lnav} -Nn -c ':config /tuning/logfile/index-cache-min-size 1'
+
+run_test ${idx_lnav} -n -d idx-save.log \
+    -c ';SELECT count(*) AS total FROM access_log' \
+    idx-access.log
+
+check_output "index cache first run" <<EOF
+total
+    3
+EOF
+
+run_test grep -c "saving 3 lines to index cache" idx-save.log
+
+check_output "index cache was not saved" <<EOF
+1
+EOF
+
+run_test ${idx_lnav} -n -d idx-load.log \
+    -c ';SELECT count(*) AS total FROM access_log' \
+    idx-access.log
+
+check_output "index cache second run" <<EOF
+total
+    3
+EOF
+
+run_test grep -c "loaded 3 lines from index cache" idx-load.log
+
+check_output "index cache was not loaded" <<EOF
+1
+EOF
+
+# Lines appended after the cache was saved are indexed on top of it.
+tail -1 ${test_dir}/logfile_access_log.0 >> idx-access.log
+
+run_test ${idx_lnav} -n -d idx-append.log \
+    -c ';SELECT count(*) AS total FROM access_log' \
+    idx-access.log
+
+check_output "index cache with appended lines" <<EOF
+total
+    4
+EOF
+
+run_test grep -c "loaded 3 lines from index cache" idx-append.log
+
+check_output "index cache was not extended" <<EOF
+1
+EOF
+
+# A change to the indexed content invalidates the cache.
+status_off=$(grep -bo '" 200 134' idx-access.log | cut -d: -f1)
+printf '5' | dd of=idx-access.log bs=1 seek=$((status_off + 2)) \
+    conv=notrunc 2> /dev/null
+
+run_test ${idx_lnav} -n -d idx-change.log \
+    -c ';SELECT sc_status FROM access_log LIMIT 1' \
+    idx-access.log
+
+check_output "index cache was not invalidated" <<EOF
+sc_status
+      500
+EOF
+
+run_test grep -c "from index cache" idx-change.log
+
+check_output "stale index cache was loaded" <<EOF
+0
+EOF
+
+# A cache with a bogus line count is rejected before allocating the lines.
+idx_file=$(find idx-tmp -name '*.idx' | head -1)
+printf '\377\377\377\377\377\377\377\017' | \
+    dd of=${idx_file} bs=1 seek=104 conv=notrunc 2> /dev/null
+
+run_test ${idx_lnav} -n -d idx-corrupt.log \
+    -c ';SELECT count(*) AS total FROM access_log' \
+    idx-access.log
+
+check_output "corrupt index cache" <<EOF
+total
+    4
+EOF
+
+run_test grep -c "index cache size does not match header" idx-corrupt.log
+
+check_output "corrupt index cache was not detected" <<EOF
+1
+EOF
+
+# Files are handed off to the indexing threads once their format is known,
+# which should give the same index as doing them one at a time.
+rm -rf mt-home mt-tmp
+mkdir -p mt-home mt-tmp
+
+mt_lnav="env HOME=${PWD}/mt-home TMPDIR=${PWD}/mt-tmp ${lnav_test}"
+
+for mt_index in 1 2 3 4; do
+    awk -v idx=${mt_index} 'BEGIN {
+        for (lpc = 0; lpc < 1000; lpc++) {
+            printf("10.0.0.%d - - [20/Jul/2009:%02d:%02d:%02d +0000] " \
+                   "\"GET /file%d HTTP/1.0\" 200 %d \"-\" \"test\"\n",
+                   idx, idx, lpc / 60, lpc % 60, lpc, lpc);
+        }
+    }' > mt-access-${mt_index}.log
+    awk -v idx=${mt_index} 'BEGIN {
+        for (lpc = 0; lpc < 1000; lpc++) {
+            printf("Nov  3 %02d:%02d:%02d veridian automount[%d]: " \
+                   "lookup %d\n",
+                   idx, lpc / 60, lpc % 60, lpc, lpc);
+        }
+    }' > mt-syslog-${mt_index}.log
+done
+
+${mt_lnav} -Nn -c ':config /tuning/logfile/index-threads 4'
+
+run_test ${mt_lnav} -n -d mt-index.log \
+    -c ';SELECT basename(log_path) AS name, count(*) AS total, sum(sc_bytes) AS bytes, min(log_time) AS first, max(log_time) AS last FROM access_log GROUP BY name' \
+    mt-access-*.log mt-syslog-*.log
+
+check_output "files indexed concurrently" <<EOF
+     name         total      bytes             first                   last
+mt-access-1.log       1000     499500 2009-07-20 01:00:00.000 2009-07-20 01:16:39.000
+mt-access-2.log       1000     499500 2009-07-20 02:00:00.000 2009-07-20 02:16:39.000
+mt-access-3.log       1000     499500 2009-07-20 03:00:00.000 2009-07-20 03:16:39.000
+mt-access-4.log       1000     499500 2009-07-20 04:00:00.000 2009-07-20 04:16:39.000
+EOF
+
+run_test ${mt_lnav} -n \
+    -c ';SELECT basename(log_path) AS name, count(*) AS total, count(DISTINCT log_body) AS bodies FROM syslog_log GROUP BY name' \
+    mt-access-*.log mt-syslog-*.log
+
+check_output "module formats indexed with other files" <<EOF
+     name         total      bodies
+mt-syslog-1.log       1000       1000
+mt-syslog-2.log       1000       1000
+mt-syslog-3.log       1000       1000
+mt-syslog-4.log       1000       1000
+EOF
+
+# The syslog files can have modules, so only the access logs are handed off.
+run_test grep -o -m 1 "indexing [0-9]* files using [0-9]* threads" mt-index.log
+
+check_output "files were not indexed concurrently" <<EOF
+indexing 4 files using 4 threads
+EOF
+
+# A large file is split into chunks that are indexed by separate threads.
+# The multi-line messages and operations that cross the seams between the
+# chunks should come out the same as when the file is indexed in one go.
+awk 'BEGIN {
+    for (lpc = 0; lpc < 300000; lpc++) {
+        printf("2024-01-01 %02d:%02d:%02d.%03d [main] %s opId=op-%d " \
+               "com.example.App - message %d\n",
+               lpc / 3600000, (lpc / 60000) % 60, (lpc / 1000) % 60,
+               lpc % 1000, lpc % 7 == 0 ? "ERROR" : "INFO", lpc % 100, lpc);
+        printf("    at com.example.App.run(App.java:%d)\n", lpc);
+    }
+}' > mt-java.log
+
+for mt_threads in 1 4; do
+    ${mt_lnav} -Nn -c ":config /tuning/logfile/index-threads ${mt_threads}"
+
+    ${mt_lnav} -n \
+        -c ";SELECT count(*) AS total, max(log_line) AS last_line, sum(length(log_text)) AS text_size, sum(log_level = 'error') AS errors FROM java_log" \
+        mt-java.log > mt-java-lines-${mt_threads}.out
+
+    ${mt_lnav} -n \
+        -c ";SELECT opid, start_time, end_time, total_count, error_count FROM active_opids('2024-01-01 00:00:00', '2024-01-02 00:00:00') WHERE subid IS NULL ORDER BY opid" \
+        mt-java.log > mt-java-opids-${mt_threads}.out
+done
+
+run_test cat mt-java-lines-4.out
+
+check_output "lines across chunk seams" <<EOF
+  total    last_line  text_size    errors
+    300000     599998   36690638      42858
+EOF
+
+run_test diff -u mt-java-lines-1.out mt-java-lines-4.out
+
+check_output "lines differ when indexed concurrently" <<EOF
+EOF
+
+run_test awk 'NR == 2 || NR == 101 { print $1, $2, $3, $4, $5 }' \
+    mt-java-opids-4.out
+
+check_output "opids across chunk seams" <<EOF
+op-0 2024-01-01 00:00:00.000 2024-01-01 00:04:59.900
+op-99 2024-01-01 00:00:00.099 2024-01-01 00:04:59.999
+EOF
+
+run_test diff -u mt-java-opids-1.out mt-java-opids-4.out
+
+check_output "opids differ when indexed concurrently" <<EOF
+EOF
+
+# When the deadline passes while the first chunk is still being indexed,
+# the chunks after it that were finished are kept for the next pass.  The
+# first chunk has many short lines, so it checks the time and stops, while
+# the other chunks have fewer long lines than are read between checks.
+awk 'BEGIN {
+    pad = "x";
+    while (length(pad) < 40000) {
+        pad = pad pad;
+    }
+    for (lpc = 0; lpc < 100800; lpc++) {
+        printf("2024-01-01 %02d:%02d:%02d.%03d [main] INFO opId=op-%d " \
+               "com.example.App - message %d%s\n",
+               lpc / 3600000, (lpc / 60000) % 60, (lpc / 1000) % 60,
+               lpc % 1000, lpc % 100, lpc, lpc < 100000 ? "" : pad);
+    }
+}' > mt-deadline.log
+
+./drive_logfile -j 1 -t -f java_log mt-deadline.log > mt-deadline-1.out
+./drive_logfile -D -j 4 -d mt-deadline.dbg -t -f java_log mt-deadline.log \
+    > mt-deadline-4.out
+
+run_test diff -u mt-deadline-1.out mt-deadline-4.out
+
+check_output "lines differ when indexed with a deadline" <<EOF
+EOF
+
+run_test grep -o -m 1 "keeping [0-9]* chunks for the next pass" mt-deadline.dbg
+
+check_output "finished chunks were not kept after the deadline" <<EOF
+keeping 3 chunks for the next pass
+EOF
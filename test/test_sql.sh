@@ -31,6 +31,19 @@ log_line,log_body
 1, attempting to mount entry /auto/opt
 EOF
 
+run_test ${lnav_test} -n \
+    -c ";SELECT c_ip, cs_method, sc_status, sc_bytes FROM access_log" \
+    -c ";SELECT c_ip, cs_method, sc_status, sc_bytes FROM access_log" \
+    -c ':write-csv-to -' \
+    ${test_dir}/logfile_access_log.0
+
+check_output "cached column values are not working?" <<EOF
+c_ip,cs_method,sc_status,sc_bytes
+192.168.202.254,GET,200,134
+192.168.202.254,GET,404,46210
+192.168.202.254,GET,200,78929
+EOF
+
 
 run_cap_test ${lnav_test} -n \
     -c ";SELECT replicate('foobar', 120)" \
@@ -236,6 +249,11 @@ run_cap_test env TZ=UTC ${lnav_test} -n \
     -c ":write-csv-to -" \
     ${test_dir}/logfile_bro_http.log.0
 
+run_cap_test env TZ=UTC ${lnav_test} -n \
+    -c ";SELECT opid, start_time, end_time, total_count FROM active_opids('2011-11-03 00:19:37', '2011-11-03 00:19:38') WHERE subid IS NULL ORDER BY start_time, opid" \
+    -c ":write-csv-to -" \
+    ${test_dir}/logfile_bro_http.log.0
+
 run_test ${lnav_test} -n \
     -c ';select log_time from access_log where log_line > 100000' \
     -c ':switch-to-view db' \
@@ -574,7 +592,7 @@ EOF
 
 
 schema_dump() {
-    ${lnav_test} -n -c ';.schema' ${test_dir}/logfile_access_log.0 | head -n21
+    ${lnav_test} -n -c ';.schema' ${test_dir}/logfile_access_log.0 | head -n25
 }
 
 run_test schema_dump
@@ -583,8 +601,11 @@ check_output "schema view is not working" <<EOF
 ATTACH DATABASE '' AS 'main';
 CREATE VIRTUAL TABLE environ USING environ_vtab_impl();
 CREATE VIRTUAL TABLE lnav_static_files USING lnav_static_file_vtab_impl();
+CREATE VIRTUAL TABLE lnav_format_detection USING lnav_format_detection_impl();
 CREATE VIRTUAL TABLE lnav_view_filter_stats USING lnav_view_filter_stats_impl();
+CREATE VIRTUAL TABLE lnav_view_render_cache USING lnav_view_render_cache_impl();
 CREATE VIRTUAL TABLE lnav_views USING lnav_views_impl();
+CREATE VIRTUAL TABLE lnav_db_indexes USING lnav_db_indexes_impl();
 CREATE VIRTUAL TABLE lnav_view_files USING lnav_view_files_impl();
 CREATE VIRTUAL TABLE lnav_view_stack USING lnav_view_stack_impl();
 CREATE VIRTUAL TABLE lnav_view_filters USING lnav_view_filters_impl();
@@ -596,6 +617,7 @@ CREATE VIRTUAL TABLE regexp_capture USING regexp_capture_impl();
 CREATE VIRTUAL TABLE regexp_capture_into_json USING regexp_capture_into_json_impl();
 CREATE VIRTUAL TABLE xpath USING xpath_impl();
 CREATE VIRTUAL TABLE fstat USING fstat_impl();
+CREATE VIRTUAL TABLE active_opids USING active_opids_impl();
 CREATE TABLE [1m[35mlnav_events[0m (
    ts TEXT NOT NULL DEFAULT(strftime('%Y-%m-%dT%H:%M:%f', 'now')),
    content TEXT
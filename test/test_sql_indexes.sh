@@ -48,3 +48,42 @@ run_cap_test ${lnav_test} -n \
 run_cap_test ${lnav_test} -n \
     -c ";SELECT * FROM all_logs WHERE log_line <= 20" \
     ${test_dir}/logfile_access_log.*
+
+run_cap_test ${lnav_test} -n \
+    -c ";EXPLAIN QUERY PLAN SELECT * FROM access_log WHERE sc_bytes > 40000 AND cs_method = 'GET'" \
+    -c ";SELECT \$id, \$parent, replace(\$detail, 'SCAN TABLE', 'SCAN')" \
+    ${test_dir}/logfile_access_log.*
+
+run_cap_test ${lnav_test} -n \
+    -c ";SELECT log_line, cs_method, sc_bytes FROM access_log WHERE sc_bytes > 40000 AND cs_method = 'GET'" \
+    ${test_dir}/logfile_access_log.*
+
+run_cap_test ${lnav_test} -n \
+    -c ";SELECT log_line, cs_method, sc_bytes FROM access_log WHERE sc_bytes > 40000 AND cs_method = 'GET'" \
+    -c ";SELECT log_line, cs_method, sc_bytes FROM access_log WHERE sc_bytes <= 134 AND cs_method = 'GET'" \
+    ${test_dir}/logfile_access_log.*
+
+run_cap_test ${lnav_test} -n \
+    -c ";SELECT log_line, cs_method, sc_bytes FROM access_log WHERE sc_bytes <= 134 AND cs_method = 'GET'" \
+    -c ";SELECT table_name, column_name, kinds, max_line, distinct_values, entries FROM lnav_db_indexes" \
+    ${test_dir}/logfile_access_log.*
+
+run_cap_test ${lnav_test} -n \
+    -c ";EXPLAIN QUERY PLAN SELECT * FROM all_logs WHERE log_time >= '2009-07-20 22:59:29' ORDER BY log_time" \
+    -c ";SELECT \$id, \$parent, replace(\$detail, 'SCAN TABLE', 'SCAN')" \
+    ${test_dir}/logfile_access_log.*
+
+run_cap_test ${lnav_test} -n \
+    -c ";SELECT log_line, log_time FROM all_logs WHERE log_time >= '2009-07-20 22:59:29.000' AND log_time <= '2009-07-20 22:59:29.000' ORDER BY log_time" \
+    ${test_dir}/logfile_access_log.*
+
+run_cap_test ${lnav_test} -n \
+    -c ";SELECT log_line, cs_method, sc_bytes FROM access_log WHERE sc_bytes <= 134 AND cs_method = 'GET'" \
+    -c ";DELETE FROM lnav_db_indexes WHERE column_name = 'sc_bytes'" \
+    -c ";SELECT table_name, column_name, kinds FROM lnav_db_indexes" \
+    ${test_dir}/logfile_access_log.*
+
+run_cap_test ${lnav_test} -n \
+    -c ";EXPLAIN QUERY PLAN SELECT * FROM access_log WHERE cs_method > 'G'" \
+    -c ";SELECT \$id, \$parent, replace(\$detail, 'SCAN TABLE', 'SCAN')" \
+    ${test_dir}/logfile_access_log.*
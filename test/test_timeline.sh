@@ -51,3 +51,25 @@ run_cap_test ${lnav_test} -n \
     -c ':switch-to-view timeline' \
     -c ':hide-lines-after 2011-11-03 00:20:30' \
     ${test_dir}/logfile_bro_http.log.0
+
+# The rows for the opids that were updated by the appended lines should be
+# the same as when the whole file is indexed at once.
+head -n 100 ${test_dir}/logfile_bro_http.log.0 > timeline-append.log
+tail -n +101 ${test_dir}/logfile_bro_http.log.0 > timeline-append.tail
+
+${lnav_test} -n \
+    -c ':switch-to-view timeline' \
+    -c ':shexec cat timeline-append.tail >> timeline-append.log' \
+    -c ':rebuild' \
+    -c ':switch-to-view log' \
+    -c ':switch-to-view timeline' \
+    timeline-append.log > timeline-append-incr.out
+
+${lnav_test} -n \
+    -c ':switch-to-view timeline' \
+    timeline-append.log > timeline-append-full.out
+
+run_test diff -u timeline-append-full.out timeline-append-incr.out
+
+check_output "incremental timeline differs from a full rebuild" <<EOF
+EOF